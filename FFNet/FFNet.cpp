@@ -39,6 +39,7 @@
 #include "PatternList.h"
 #include "Collection.h"
 #include "Categories.h"
+#include "MelderThread.h"
 
 static void bookkeeping (FFNet me);
 
@@ -414,29 +415,33 @@ void FFNet_computeDerivative (FFNet me) {
 
 /******* end operation ******************************************************/
 
-integer FFNet_getWinningUnit (FFNet me, integer labeling) {
-	const integer k = my numberOfNodes - my numberOfOutputs;
+integer FFNet_getWinningUnitOfOutputs (FFNet me, constVEC outputs, integer labeling) {
+	Melder_assert (outputs.size == my numberOfOutputs);
 	integer winningUnit = 1;
 	if (labeling == 2) { /* stochastic */
 		double sum = 0.0;
 		for (integer ioutput = 1; ioutput <= my numberOfOutputs; ioutput ++)
-			sum += my activity [k + ioutput];
+			sum += outputs [ioutput];
 
 		const double random = NUMrandomUniform (0.0, sum);
 		for (winningUnit = my numberOfOutputs; winningUnit >= 2; winningUnit--)
-			if (random > (sum -= my activity [k + winningUnit]))
+			if (random > (sum -= outputs [winningUnit]))
 				break;
 	} else { /* winner-takes-all */
-		double max = my activity [k + 1];
+		double max = outputs [1];
 		for (integer ioutput = 2; ioutput <= my numberOfOutputs; ioutput ++)
-			if (my activity [k + ioutput] > max) {
-				max = my activity [k + ioutput];
+			if (outputs [ioutput] > max) {
+				max = outputs [ioutput];
 				winningUnit = ioutput;
 			}
 	}
 	return winningUnit;
 }
 
+integer FFNet_getWinningUnit (FFNet me, integer labeling) {
+	return FFNet_getWinningUnitOfOutputs (me, my activity.part (my numberOfNodes - my numberOfOutputs + 1, my numberOfNodes), labeling);
+}
+
 void FFNet_propagateToLayer (FFNet me, constVEC input, VEC activity, integer layer) {
 	Melder_require (layer > 0,
 		U"Layer must be greater than zero.");
@@ -450,6 +455,270 @@ void FFNet_propagateToLayer (FFNet me, constVEC input, VEC activity, integer lay
 		activity [iunit] = my activity [k + iunit];
 }
 
+/******* batch operation ****************************************************/
+
+/*
+	The weights of layer `layer` are a row-major matrix inside my w, with one row per unit and
+	one column per unit in the previous layer, plus a last column for the bias.
+	If the rows of A are the activities of a block of patterns in the previous layer,
+	with a column of ones appended for the bias node, the net inputs of the block are A . W'.
+	For these products, the transposes of the weight matrices are copied into a vector
+	with the same layout as my w.
+	The patterns are visited in blocks of rows; the blocks are divided over threads.
+	Melder_debug 67 switches back to the pattern-by-pattern computation of steps (1) to (4).
+*/
+constexpr integer FFNet_BLOCK_SIZE = 256;
+
+static integer FFNet_getNumberOfUnitsInLayer_ (FFNet me, integer layer) {
+	return ( layer == 0 ? my numberOfInputs : my numberOfUnitsInLayer [layer] );
+}
+
+static integer FFNet_getFirstWeightOfLayer (FFNet me, integer layer) {
+	integer firstWeight = 1;
+	for (integer ilayer = 1; ilayer < layer; ilayer ++)
+		firstWeight += my numberOfUnitsInLayer [ilayer] * (FFNet_getNumberOfUnitsInLayer_ (me, ilayer - 1) + 1);
+	return firstWeight;
+}
+
+static MAT FFNet_getWeightsOfLayer (FFNet me, VEC const& weights, integer layer) {
+	return MAT (& weights [FFNet_getFirstWeightOfLayer (me, layer)],
+			my numberOfUnitsInLayer [layer], FFNet_getNumberOfUnitsInLayer_ (me, layer - 1) + 1);
+}
+
+static constMAT FFNet_getTransposedWeightsOfLayer (FFNet me, constVEC const& transposedWeights, integer layer) {
+	return constMAT (& transposedWeights [FFNet_getFirstWeightOfLayer (me, layer)],
+			FFNet_getNumberOfUnitsInLayer_ (me, layer - 1) + 1, my numberOfUnitsInLayer [layer]);
+}
+
+static autoVEC FFNet_getTransposedWeights (FFNet me) {
+	autoVEC result = newVECraw (my numberOfWeights);
+	for (integer ilayer = 1; ilayer <= my numberOfLayers; ilayer ++) {
+		const constMAT weights = FFNet_getWeightsOfLayer (me, my w.get(), ilayer);
+		MAT (& result [FFNet_getFirstWeightOfLayer (me, ilayer)], weights.ncol, weights.nrow)  <<=  weights.transpose();
+	}
+	return result;
+}
+
+/*
+	The activities (or cost derivatives) of a block of patterns in layer `layer` (0 for the inputs)
+	are the first columns of a matrix with a last column for the bias node;
+	the matrices of all layers lie one after another in `memory`,
+	which should have room for FFNet_getBlockMemorySize () values.
+*/
+static integer FFNet_getBlockMemorySize (FFNet me) {
+	integer size = 0;
+	for (integer ilayer = 0; ilayer <= my numberOfLayers; ilayer ++)
+		size += FFNet_BLOCK_SIZE * (FFNet_getNumberOfUnitsInLayer_ (me, ilayer) + 1);
+	return size;
+}
+
+static MAT FFNet_getBlockOfLayer (FFNet me, double *memory, integer layer, integer numberOfRows) {
+	Melder_assert (numberOfRows <= FFNet_BLOCK_SIZE);
+	for (integer ilayer = 0; ilayer < layer; ilayer ++)
+		memory += FFNet_BLOCK_SIZE * (FFNet_getNumberOfUnitsInLayer_ (me, ilayer) + 1);
+	return MAT (memory, numberOfRows, FFNet_getNumberOfUnitsInLayer_ (me, layer) + 1);
+}
+
+static bool FFNet_layerIsLinear (FFNet me, integer layer) {
+	return layer == my numberOfLayers && my outputsAreLinear;
+}
+
+/*
+	target += x . y, where the cells of a row of target, and of a row of y, are adjacent,
+	so that the compiler can vectorize the inner loop.
+*/
+static void FFNet_addProduct (MATVU const& target, constMATVU const& x, constMATVU const& y) {
+	Melder_assert (target.colStride == 1 && y.colStride == 1);
+	Melder_assert (target.nrow == x.nrow && target.ncol == y.ncol && x.ncol == y.nrow);
+	const integer numberOfColumns = target.ncol;
+	for (integer irow = 1; irow <= target.nrow; irow ++) {
+		double * const targetRow = & target [irow] [1];
+		for (integer k = 1; k <= x.ncol; k ++) {
+			const double xcell = x [irow] [k];
+			const double * const yRow = & y [k] [1];
+			for (integer icol = 0; icol < numberOfColumns; icol ++)
+				targetRow [icol] += xcell * yRow [icol];
+		}
+	}
+}
+
+/*
+	The same activities as FFNet_propagate, for all rows of `input` and up to layer `toLayer`.
+*/
+static void FFNet_propagateBlock (FFNet me, constVEC const& transposedWeights, constMATVU const& input, integer toLayer, double *activityMemory) {
+	const integer numberOfRows = input.nrow;
+	MAT previous = FFNet_getBlockOfLayer (me, activityMemory, 0, numberOfRows);
+	previous.verticalBand (1, my numberOfInputs)  <<=  input;
+	previous.column (my numberOfInputs + 1)  <<=  1.0;
+	for (integer ilayer = 1; ilayer <= toLayer; ilayer ++) {
+		const integer numberOfUnits = my numberOfUnitsInLayer [ilayer];
+		const MAT current = FFNet_getBlockOfLayer (me, activityMemory, ilayer, numberOfRows);
+		const MATVU net = current.verticalBand (1, numberOfUnits);
+		net  <<=  0.0;
+		FFNet_addProduct (net, previous, FFNet_getTransposedWeightsOfLayer (me, transposedWeights, ilayer));
+		if (! FFNet_layerIsLinear (me, ilayer))
+			for (integer irow = 1; irow <= numberOfRows; irow ++) {
+				double * const activity = & current [irow] [1];
+				for (integer iunit = 0; iunit < numberOfUnits; iunit ++)
+					activity [iunit] = NUMsigmoid (activity [iunit]);
+			}
+		current.column (numberOfUnits + 1)  <<=  1.0;
+		previous = current;
+	}
+}
+
+/*
+	The same cost as the sum of FFNet_computeError over the rows of `input` and `target`.
+	If `gradient` is not empty, the derivatives of the cost with respect to the weights
+	(the sum of my dwi after FFNet_computeDerivative) are added to it; it has the layout of my w.
+	If D [layer] are the derivatives of the cost with respect to the net inputs of the units of a layer
+	(i.e. minus my error after backpropagation), they are backpropagated as
+	D [layer - 1] = D [layer] . W [layer] (without the bias column), times the derivative of the sigmoid,
+	and the derivatives with respect to the weights of a layer are D [layer]' . A [layer - 1].
+*/
+static double FFNet_addBlockGradient (FFNet me, constVEC const& transposedWeights, constMATVU const& input, constMATVU const& target,
+	double *activityMemory, double *derivativeMemory, VEC const& gradient)
+{
+	const integer numberOfRows = input.nrow;
+	FFNet_propagateBlock (me, transposedWeights, input, my numberOfLayers, activityMemory);
+	const MAT outputs = FFNet_getBlockOfLayer (me, activityMemory, my numberOfLayers, numberOfRows);
+	const MAT outputDerivatives = FFNet_getBlockOfLayer (me, derivativeMemory, my numberOfLayers, numberOfRows);
+	const bool outputsAreLinear = FFNet_layerIsLinear (me, my numberOfLayers);
+	longdouble cost = 0.0;
+	for (integer irow = 1; irow <= numberOfRows; irow ++) {
+		for (integer iunit = 1; iunit <= my numberOfOutputs; iunit ++) {
+			const double activity = outputs [irow] [iunit], desired = target [irow] [iunit];
+			double error;
+			if (my costFunctionType == 2) {   // minimumCrossEntropy
+				const double t1 = 1.0 - desired, o1 = 1.0 - activity;
+				cost -= desired * log (activity) + t1 * log (o1);
+				error = - t1 / o1 + desired / activity;
+			} else {   // minimumSquaredError
+				error = desired - activity;
+				cost += 0.5 * error * error;
+			}
+			outputDerivatives [irow] [iunit] = ( outputsAreLinear ? - error : - error * activity * (1.0 - activity) );
+		}
+	}
+	if (gradient.size == 0)
+		return (double) cost;
+	for (integer ilayer = my numberOfLayers; ilayer >= 2; ilayer --) {
+		const integer numberOfUnitsInPreviousLayer = my numberOfUnitsInLayer [ilayer - 1];
+		const MAT derivatives = FFNet_getBlockOfLayer (me, derivativeMemory, ilayer, numberOfRows);
+		const MAT previousDerivatives = FFNet_getBlockOfLayer (me, derivativeMemory, ilayer - 1, numberOfRows);
+		const MAT previousActivities = FFNet_getBlockOfLayer (me, activityMemory, ilayer - 1, numberOfRows);
+		const MATVU previousNetDerivatives = previousDerivatives.verticalBand (1, numberOfUnitsInPreviousLayer);
+		previousNetDerivatives  <<=  0.0;
+		FFNet_addProduct (previousNetDerivatives, derivatives.verticalBand (1, my numberOfUnitsInLayer [ilayer]),
+				FFNet_getWeightsOfLayer (me, my w.get(), ilayer).verticalBand (1, numberOfUnitsInPreviousLayer));
+		for (integer irow = 1; irow <= numberOfRows; irow ++)
+			for (integer iunit = 1; iunit <= numberOfUnitsInPreviousLayer; iunit ++) {
+				const double activity = previousActivities [irow] [iunit];
+				previousNetDerivatives [irow] [iunit] *= activity * (1.0 - activity);
+			}
+	}
+	for (integer ilayer = 1; ilayer <= my numberOfLayers; ilayer ++) {
+		const MAT derivatives = FFNet_getBlockOfLayer (me, derivativeMemory, ilayer, numberOfRows);
+		FFNet_addProduct (FFNet_getWeightsOfLayer (me, gradient, ilayer),
+				derivatives.verticalBand (1, my numberOfUnitsInLayer [ilayer]).transpose(),
+				FFNet_getBlockOfLayer (me, activityMemory, ilayer - 1, numberOfRows));
+	}
+	return (double) cost;
+}
+
+static integer FFNet_getNumberOfBlocks (integer numberOfRows) {
+	return (numberOfRows + FFNet_BLOCK_SIZE - 1) / FFNet_BLOCK_SIZE;
+}
+
+static void FFNet_getBlockRows (integer iblock, integer numberOfRows, integer *out_firstRow, integer *out_lastRow) {
+	*out_firstRow = (iblock - 1) * FFNet_BLOCK_SIZE + 1;
+	*out_lastRow = std::min (iblock * FFNet_BLOCK_SIZE, numberOfRows);
+}
+
+void FFNet_propagateBatch (FFNet me, constMAT const& input, MAT const& activities, integer layer) {
+	Melder_assert (input.ncol == my numberOfInputs);
+	Melder_assert (layer >= 1 && layer <= my numberOfLayers);
+	Melder_assert (activities.nrow == input.nrow && activities.ncol == my numberOfUnitsInLayer [layer]);
+	if (Melder_debug == 67) {
+		for (integer irow = 1; irow <= input.nrow; irow ++)
+			FFNet_propagateToLayer (me, input.row (irow), activities.row (irow), layer);
+		return;
+	}
+	autoVEC transposedWeights = FFNet_getTransposedWeights (me);
+	const integer numberOfBlocks = FFNet_getNumberOfBlocks (input.nrow);
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfBlocks, 4);
+	const integer blockMemorySize = FFNet_getBlockMemorySize (me);
+	autoVEC activityMemory = newVECraw (numberOfThreads * blockMemorySize);
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		double *threadActivityMemory = & activityMemory [1 + (ithread - 1) * blockMemorySize];
+		integer firstBlock, lastBlock;
+		MelderThread_getRange (numberOfBlocks, numberOfThreads, ithread, & firstBlock, & lastBlock);
+		for (integer iblock = firstBlock; iblock <= lastBlock; iblock ++) {
+			integer firstRow, lastRow;
+			FFNet_getBlockRows (iblock, input.nrow, & firstRow, & lastRow);
+			FFNet_propagateBlock (me, transposedWeights.get(), input.horizontalBand (firstRow, lastRow), layer, threadActivityMemory);
+			activities.horizontalBand (firstRow, lastRow)  <<=
+					FFNet_getBlockOfLayer (me, threadActivityMemory, layer, lastRow - firstRow + 1).verticalBand (1, activities.ncol);
+		}
+	});
+}
+
+double FFNet_computeBatchCostAndGradient (FFNet me, constMAT const& input, constMAT const& target, VEC const& gradient) {
+	Melder_assert (input.ncol == my numberOfInputs);
+	Melder_assert (target.nrow == input.nrow && target.ncol == my numberOfOutputs);
+	Melder_assert (gradient.size == 0 || gradient.size == my numberOfWeights);
+	if (Melder_debug == 67) {
+		longdouble cost = 0.0;
+		gradient  <<=  0.0;
+		for (integer irow = 1; irow <= input.nrow; irow ++) {
+			FFNet_propagate (me, input.row (irow), nullptr);
+			cost += FFNet_computeError (me, target.row (irow));
+			if (gradient.size > 0) {
+				FFNet_computeDerivative (me);
+				gradient  +=  my dwi.get();
+			}
+		}
+		return (double) cost;
+	}
+	autoVEC transposedWeights = FFNet_getTransposedWeights (me);
+	const integer numberOfBlocks = FFNet_getNumberOfBlocks (input.nrow);
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfBlocks, 4);
+	const integer blockMemorySize = FFNet_getBlockMemorySize (me);
+	autoVEC activityMemory = newVECraw (numberOfThreads * blockMemorySize);
+	autoVEC derivativeMemory = newVECraw (numberOfThreads * blockMemorySize);
+	autoVEC partialGradients = newVECzero (numberOfThreads * gradient.size);
+	autoVEC partialCosts = newVECzero (numberOfThreads);
+	auto partialGradient = [&] (integer ithread) {
+		return partialGradients.part ((ithread - 1) * gradient.size + 1, ithread * gradient.size);
+	};
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		double *threadActivityMemory = & activityMemory [1 + (ithread - 1) * blockMemorySize];
+		double *threadDerivativeMemory = & derivativeMemory [1 + (ithread - 1) * blockMemorySize];
+		integer firstBlock, lastBlock;
+		MelderThread_getRange (numberOfBlocks, numberOfThreads, ithread, & firstBlock, & lastBlock);
+		for (integer iblock = firstBlock; iblock <= lastBlock; iblock ++) {
+			integer firstRow, lastRow;
+			FFNet_getBlockRows (iblock, input.nrow, & firstRow, & lastRow);
+			partialCosts [ithread] += FFNet_addBlockGradient (me, transposedWeights.get(),
+				input.horizontalBand (firstRow, lastRow), target.horizontalBand (firstRow, lastRow),
+				threadActivityMemory, threadDerivativeMemory, partialGradient (ithread)
+			);
+		}
+	});
+	/*
+		Add the partial sums in thread order, so that the result does not depend on the timing of the threads.
+	*/
+	gradient  <<=  0.0;
+	longdouble cost = 0.0;
+	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++) {
+		cost += partialCosts [ithread];
+		gradient  +=  partialGradient (ithread);
+	}
+	return (double) cost;
+}
+
+/******* end batch operation ************************************************/
+
 void FFNet_selectAllWeights (FFNet me) {
 	for (integer iweight = 1; iweight <= my numberOfWeights; iweight ++)
 		my wSelected [iweight] = 1;
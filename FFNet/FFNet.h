@@ -178,6 +178,21 @@ integer FFNet_getWinningUnit (FFNet me, integer labeling);
 /* labeling = 1 : winner-takes-all */
 /* labeling = 2 : stochastic */
 
+integer FFNet_getWinningUnitOfOutputs (FFNet me, constVEC outputs, integer labeling);
+/* as FFNet_getWinningUnit, but for the output activities in outputs */
+
+void FFNet_propagateBatch (FFNet me, constMAT const& input, MAT const& activities, integer layer);
+/* Feed forward every row of input, and put the activities of the units in layer in the corresponding row of activities.
+ * The rows are propagated in blocks, one matrix product per layer, and the blocks are divided over threads.
+ * my activities are not changed.
+ */
+
+double FFNet_computeBatchCostAndGradient (FFNet me, constMAT const& input, constMAT const& target, VEC const& gradient);
+/* The total cost of the rows of input w.r.t. the rows of target, i.e., the sum of what steps (1) and (2) give;
+ * if gradient is not empty, it receives the sum of what step (4) puts in my dwi.
+ * Computed in blocks of rows, as FFNet_propagateBatch.
+ */
+
 void FFNet_selectAllWeights (FFNet me);
 
 void FFNet_selectBiasesInLayer (FFNet me, integer layer);
@@ -77,10 +77,10 @@ autoCategories FFNet_PatternList_to_Categories (FFNet me, PatternList thee, int
 			U"All PatternList elements should be in the interval [0, 1].\nYou could use \"Formula...\" to scale the PatternList values first.");
 
 		autoCategories him = Categories_create ();
-
+		autoMAT outputs = newMATraw (thy ny, my numberOfOutputs);
+		FFNet_propagateBatch (me, thy z.get(), outputs.get(), my numberOfLayers);
 		for (integer k = 1; k <= thy ny; k ++) {
-			FFNet_propagate (me, thy z.row (k), nullptr);
-			const integer index = FFNet_getWinningUnit (me, labeling);
+			const integer index = FFNet_getWinningUnitOfOutputs (me, outputs.row (k), labeling);
 			autoSimpleString item = Data_copy (my outputCategories->at [index]);
 			his addItem_move (item.move());
 		}
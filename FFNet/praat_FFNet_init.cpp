@@ -402,7 +402,7 @@ FORM (NEW1_FFNet_PatternList_to_Categories, U"FFNet & PatternList: To Categories
 		RADIOBUTTON (U"Stochastic")
 	OK
 DO
-	GRAPHICS_TWO (FFNet, PatternList)
+	CONVERT_TWO (FFNet, PatternList)
 		autoCategories result = FFNet_PatternList_to_Categories (me, you, categorizationgMethod);
 	CONVERT_TWO_END (my name.get(), U"_", your name.get())
 }
@@ -411,7 +411,7 @@ FORM (NEW1_FFNet_PatternList_to_ActivationList, U"To activations in layer", null
 	NATURAL (layer, U"Layer", U"1")
 	OK
 DO
-	GRAPHICS_TWO (FFNet, PatternList)
+	CONVERT_TWO (FFNet, PatternList)
 		autoActivationList result = FFNet_PatternList_to_ActivationList (me, you, layer);
 	CONVERT_TWO_END (my name.get(), U"_", your name.get())
 }
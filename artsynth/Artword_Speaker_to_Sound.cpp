@@ -37,8 +37,29 @@
 #define MASS_LEAPFROG  0
 #define B91  0
 
-autoSound Artword_Speaker_to_Sound (Artword artword, Speaker speaker,
-	double fsamp, int oversampling,
+/*
+	The rest positions, lengths and stiffnesses that Art_Speaker_intoDelta () computes,
+	linearly interpolated between two geometries.
+*/
+static void Delta_interpolateGeometry (Delta me, Delta previous, Delta next, double fraction) {
+	for (integer m = 1; m <= my numberOfTubes; m ++) {
+		Delta_Tube t = & my tubes [m], t1 = & previous -> tubes [m], t2 = & next -> tubes [m];
+		t->Dxeq = t1->Dxeq + fraction * (t2->Dxeq - t1->Dxeq);
+		t->Dyeq = t1->Dyeq + fraction * (t2->Dyeq - t1->Dyeq);
+		t->k1 = t1->k1 + fraction * (t2->k1 - t1->k1);
+		t->k3 = t1->k3 + fraction * (t2->k3 - t1->k3);
+		t->s1 = t1->s1 + fraction * (t2->s1 - t1->s1);
+		t->s3 = t1->s3 + fraction * (t2->s3 - t1->s3);
+	}
+}
+
+/*
+	With a geometryInterval of 1, the articulation is converted to tube geometry at every sample;
+	otherwise, only every geometryInterval samples, with interpolation in between.
+	Without graphics, there is no drawing and no monitoring.
+*/
+static autoSound Artword_Speaker_to_Sound_ (Artword artword, Speaker speaker,
+	double fsamp, int oversampling, integer geometryInterval, Graphics graphics,
 	autoSound *out_w1, int iw1, autoSound *out_w2, int iw2, autoSound *out_w3, int iw3,
 	autoSound *out_p1, int ip1, autoSound *out_p2, int ip2, autoSound *out_p3, int ip3,
 	autoSound *out_v1, int iv1, autoSound *out_v2, int iv2, autoSound *out_v3, int iv3)
@@ -58,12 +79,23 @@ autoSound Artword_Speaker_to_Sound (Artword artword, Speaker speaker,
 			twoc2Dt = 2.0 * c * c * Dt,
 			onebytworho0 = 1.0 / (2.0 * rho0),
 			Dtbytworho0 = Dt / (2.0 * rho0);
-		double tension, rrad, onebygrad, totalVolume;
+		double tension, totalVolume;
+		double rrad = 1.0 - c * Dt / 0.02;   // radiation resistance, 5.135
+		double onebygrad = 1.0 / (1.0 + c * Dt / 0.02);   // radiation conductance, 5.135
+		#if NO_RADIATION_DAMPING
+			rrad = 0;
+			onebygrad = 0;
+		#endif
 		autoArt art = Art_create ();
 		autoDelta delta = Speaker_to_Delta (speaker);
-		autoMelderMonitor monitor (U"Articulatory synthesis");
 		Artword_intoArt (artword, art.get(), 0.0);
 		Art_Speaker_intoDelta (art.get(), speaker, delta.get());
+		autoDelta previousGeometry, nextGeometry;
+		if (geometryInterval > 1) {
+			previousGeometry = Speaker_to_Delta (speaker);
+			nextGeometry = Speaker_to_Delta (speaker);
+			Art_Speaker_intoDelta (art.get(), speaker, nextGeometry.get());
+		}
 		integer M = delta -> numberOfTubes;
 		autoSound w1, w2, w3, p1, p2, p3, v1, v2, v3;
 		if (iw1 > 0 && iw1 <= M) w1 = Sound_createSimple (1, artword -> totalTime, fsamp); else iw1 = 0;
@@ -103,10 +135,19 @@ autoSound Artword_Speaker_to_Sound (Artword artword, Speaker speaker,
 		//Melder_casual (U"Starting volume: ", totalVolume * 1000, U" litres.");
 		for (integer sample = 1; sample <= numberOfSamples; sample ++) {
 			double time = (sample - 1) / fsamp;
-			Artword_intoArt (artword, art.get(), time);
-			Art_Speaker_intoDelta (art.get(), speaker, delta.get());
-			if (sample % MONITOR_SAMPLES == 0 && monitor.graphics()) {   // because we can be in batch
-				Graphics graphics = monitor.graphics();
+			if (geometryInterval <= 1) {
+				Artword_intoArt (artword, art.get(), time);
+				Art_Speaker_intoDelta (art.get(), speaker, delta.get());
+			} else {
+				const integer phase = (sample - 1) % geometryInterval;
+				if (phase == 0) {
+					std::swap (previousGeometry, nextGeometry);
+					Artword_intoArt (artword, art.get(), std::min (time + geometryInterval / fsamp, artword -> totalTime));
+					Art_Speaker_intoDelta (art.get(), speaker, nextGeometry.get());
+				}
+				Delta_interpolateGeometry (delta.get(), previousGeometry.get(), nextGeometry.get(), (double) phase / geometryInterval);
+			}
+			if (sample % MONITOR_SAMPLES == 0 && graphics) {   // because we can be in batch
 				double area [1+78];
 				for (int i = 1; i <= 78; i ++) {
 					area [i] = delta -> tubes [i]. A;
@@ -115,7 +156,7 @@ autoSound Artword_Speaker_to_Sound (Artword artword, Speaker speaker,
 				}
 				Graphics_beginMovieFrame (graphics, & Melder_WHITE);
 
-				Graphics_Viewport vp = Graphics_insetViewport (monitor.graphics(), 0.0, 0.5, 0.5, 1.0);
+				Graphics_Viewport vp = Graphics_insetViewport (graphics, 0.0, 0.5, 0.5, 1.0);
 				Graphics_setWindow (graphics, 0.0, 1.0, 0.0, 0.05);
 				Graphics_setColour (graphics, Melder_RED);
 				Graphics_function (graphics, minTract, 1, 35, 0.0, 0.9);
@@ -261,12 +302,6 @@ autoSound Artword_Speaker_to_Sound (Artword artword, Speaker speaker,
 					else   // left boundary open to another tube will be handled...
 						(void) 0;   // ...together with the right boundary of the tube to the left
 					if (! r) {   // open boundary at the right side (lips, nostrils)?
-						rrad = 1.0 - c * Dt / 0.02;   // radiation resistance, 5.135
-						onebygrad = 1.0 / (1.0 + c * Dt / 0.02);   // radiation conductance, 5.135
-						#if NO_RADIATION_DAMPING
-							rrad = 0;
-							onebygrad = 0;
-						#endif
 						l->prightnew = ((l->Dxhalf / Dt + c * onebygrad) * l->pright +
 							 2.0 * ((l->Qhalf - rho0c2) - (l->Qright - rho0c2) * onebygrad)) /
 							(l->r * l->Anew / Dt + c * onebygrad);   // 5.136
@@ -426,4 +461,29 @@ autoSound Artword_Speaker_to_Sound (Artword artword, Speaker speaker,
 	}
 }
 
+autoSound Artword_Speaker_to_Sound (Artword artword, Speaker speaker,
+	double fsamp, int oversampling,
+	autoSound *out_w1, int iw1, autoSound *out_w2, int iw2, autoSound *out_w3, int iw3,
+	autoSound *out_p1, int ip1, autoSound *out_p2, int ip2, autoSound *out_p3, int ip3,
+	autoSound *out_v1, int iv1, autoSound *out_v2, int iv2, autoSound *out_v3, int iv3)
+{
+	autoMelderMonitor monitor (U"Articulatory synthesis");
+	return Artword_Speaker_to_Sound_ (artword, speaker, fsamp, oversampling, 1, monitor.graphics(),
+		out_w1, iw1, out_w2, iw2, out_w3, iw3, out_p1, ip1, out_p2, ip2, out_p3, ip3, out_v1, iv1, out_v2, iv2, out_v3, iv3);
+}
+
+autoSound Artword_Speaker_to_Sound_fast (Artword artword, Speaker speaker,
+	double samplingFrequency, int oversampling, double geometryTimeStep)
+{
+	try {
+		Melder_require (geometryTimeStep >= 0.0,
+			U"The geometry time step should not be negative.");
+		const integer geometryInterval = std::max (1_integer, Melder_iround (geometryTimeStep * samplingFrequency));
+		return Artword_Speaker_to_Sound_ (artword, speaker, samplingFrequency, oversampling, geometryInterval, nullptr,
+			nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0, nullptr, 0);
+	} catch (MelderError) {
+		Melder_throw (artword, U" & ", speaker, U": articulatory synthesis not performed.");
+	}
+}
+
 /* End of file Artword_Speaker_to_Sound.cpp */
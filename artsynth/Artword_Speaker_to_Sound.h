@@ -26,4 +26,13 @@ autoSound Artword_Speaker_to_Sound (Artword artword, Speaker speaker,
    autoSound *p1, int ip1, autoSound *p2, int ip2, autoSound *p3, int ip3,
    autoSound *v1, int iv1, autoSound *v2, int iv2, autoSound *v3, int iv3);
 
+autoSound Artword_Speaker_to_Sound_fast (Artword artword, Speaker speaker,
+   double samplingFrequency, int oversampling, double geometryTimeStep);
+/*
+	As Artword_Speaker_to_Sound (), but for batch runs: without the monitor and without the width, pressure and velocity Sounds.
+	The articulation is converted to the geometry of the tubes only every geometryTimeStep seconds
+	(rounded to a whole number of samples), with linear interpolation of the rest positions, lengths and stiffnesses
+	in between, instead of at every sample; a geometryTimeStep of 0 gives the same Sound as Artword_Speaker_to_Sound ().
+*/
+
 /* End of file Artword_Speaker_to_Sound.h */
@@ -198,6 +198,18 @@ DO
 	END
 }
 
+FORM (NEW1_Artword_Speaker_to_Sound_fast, U"Articulatory synthesizer (fast)", U"Artword & Speaker: To Sound...") {
+	POSITIVE (samplingFrequency, U"Sampling frequency (Hz)", U"22050.0")
+	NATURAL (oversamplingFactor, U"Oversampling factor", U"25")
+	REAL (geometryTimeStep, U"Geometry time step (s)", U"0.001")
+	OK
+DO
+	FIND_TWO (Artword, Speaker)
+		autoSound result = Artword_Speaker_to_Sound_fast (me, you, samplingFrequency, oversamplingFactor, geometryTimeStep);
+		praat_new (result.move(), my name.get(), U"_", your name.get());
+	END
+}
+
 DIRECT (MOVIE_Artword_Speaker_playMovie) {
 	MOVIE_TWO (Artword, Speaker, U"Artword & Speaker movie", 300, 300)
 		Artword_Speaker_playMovie (me, you, graphics);
@@ -359,6 +371,7 @@ void praat_uvafon_Artsynth_init () {
 	praat_addAction2 (classArtword, 1, classSpeaker, 1, U"Draw...", nullptr, 0, GRAPHICS_Artword_Speaker_draw);
 	praat_addAction2 (classArtword, 1, classSpeaker, 1, U"Synthesize", nullptr, 0, nullptr);
 	praat_addAction2 (classArtword, 1, classSpeaker, 1, U"To Sound...", nullptr, 0, NEW1_Artword_Speaker_to_Sound);
+	praat_addAction2 (classArtword, 1, classSpeaker, 1, U"To Sound (fast)...", nullptr, 0, NEW1_Artword_Speaker_to_Sound_fast);
 
 	praat_addAction3 (classArtword, 1, classSpeaker, 1, classSound, 1, U"Play movie", nullptr, 0, MOVIE_Artword_Speaker_Sound_playMovie);
 	praat_addAction3 (classArtword, 1, classSpeaker, 1, classSound, 1, U"Movie", nullptr, praat_HIDDEN, MOVIE_Artword_Speaker_Sound_playMovie);
@@ -17,6 +17,7 @@
  */
 
 #include "Graphics.h"
+#include "MelderThread.h"
 #include "NMF.h"
 #include "NUMmachar.h"
 #include "NUM2.h"
@@ -186,25 +187,155 @@ double NMF_getItakuraSaitoDivergence (NMF me, constMATVU const& data) {
 	return MATgetDivergence_ItakuraSaito (data, synthesis.get());
 }
 
-static double getMaximumChange (constMATVU const& m, MATVU const& m0, const double sqrteps) {
-	double min = NUMmin (m0);
-	double max = NUMmax (m0);
-	const double extremum1 = std::max (fabs (min), fabs (max));
-	m0  -=  m;
-	min = NUMmin (m0);
-	max = NUMmax (m0);
-	const double extremum2 = std::max (fabs (min), fabs (max));
-	const double dmat = extremum2 / (sqrteps + extremum1);
-	return dmat;
+/*
+	The data matrix D, with a compressed copy by rows and by columns if at most one in ten cells differ from zero.
+	For such sparse data, D.W' and F'.D are computed by multithreaded passes over the nonzero cells only;
+	for dense data, by the blocked multithreaded matrix multiplication.
+	Melder_debug 62 switches the sparse computation off.
+*/
+struct NMFdata {
+	constMATVU data;
+	bool isSparse;
+	autoINTVEC rowStart, columnOfCell;   // the cells of row `irow` are rowStart [irow] .. rowStart [irow + 1] - 1
+	autoVEC valueByRow;
+	autoINTVEC columnStart, rowOfCell;   // the cells of column `icol` are columnStart [icol] .. columnStart [icol + 1] - 1
+	autoVEC valueByColumn;
+	autoMAT weightsTransposed;   // numberOfColumns x numberOfFeatures
+	autoMAT threadSums;   // numberOfThreads x numberOfFeatures
+};
+
+static void NMFdata_init (NMFdata *me, constMATVU const& data, integer numberOfFeatures) {
+	my data = data;
+	integer numberOfCells = 0;
+	for (integer irow = 1; irow <= data.nrow; irow ++)
+		for (integer icol = 1; icol <= data.ncol; icol ++)
+			if (data [irow] [icol] != 0.0)
+				numberOfCells ++;
+	my isSparse = ( Melder_debug != 62 && numberOfCells <= data.nrow * data.ncol / 10 );
+	if (! my isSparse)
+		return;
+	my rowStart = newINTVECraw (data.nrow + 1);
+	my columnOfCell = newINTVECraw (numberOfCells);
+	my valueByRow = newVECraw (numberOfCells);
+	my columnStart = newINTVECzero (data.ncol + 1);
+	my rowOfCell = newINTVECraw (numberOfCells);
+	my valueByColumn = newVECraw (numberOfCells);
+	integer icell = 0;
+	for (integer irow = 1; irow <= data.nrow; irow ++) {
+		my rowStart [irow] = icell + 1;
+		for (integer icol = 1; icol <= data.ncol; icol ++)
+			if (data [irow] [icol] != 0.0) {
+				icell ++;
+				my columnOfCell [icell] = icol;
+				my valueByRow [icell] = data [irow] [icol];
+				my columnStart [icol] ++;   // count for now
+			}
+	}
+	my rowStart [data.nrow + 1] = icell + 1;
+	integer start = 1;
+	for (integer icol = 1; icol <= data.ncol + 1; icol ++) {
+		const integer count = my columnStart [icol];
+		my columnStart [icol] = start;
+		start += count;
+	}
+	autoINTVEC next = newINTVECcopy (my columnStart.get());
+	for (integer irow = 1; irow <= data.nrow; irow ++)
+		for (integer jcell = my rowStart [irow]; jcell < my rowStart [irow + 1]; jcell ++) {
+			const integer kcell = next [my columnOfCell [jcell]] ++;
+			my rowOfCell [kcell] = irow;
+			my valueByColumn [kcell] = my valueByRow [jcell];
+		}
+	my weightsTransposed = newMATraw (data.ncol, numberOfFeatures);
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (data.ncol, 16);
+	my threadSums = newMATraw (numberOfThreads, numberOfFeatures);
+}
+
+/*
+	productFtD = F'.D, a numberOfFeatures x numberOfColumns matrix.
+*/
+static void NMFdata_mulFeaturesTransposed (NMFdata *me, MATVU const& productFtD, constMATVU const& features) {
+	if (! my isSparse) {
+		MATmul_allowAllocation (productFtD, features.transpose(), my data);
+		return;
+	}
+	const integer numberOfColumns = productFtD.ncol;
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfColumns, 16);
+	Melder_assert (numberOfThreads <= my threadSums.nrow);
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		VEC sum = my threadSums.row (ithread);
+		integer firstColumn, lastColumn;
+		MelderThread_getRange (numberOfColumns, numberOfThreads, ithread, & firstColumn, & lastColumn);
+		for (integer icol = firstColumn; icol <= lastColumn; icol ++) {
+			sum  <<=  0.0;
+			for (integer icell = my columnStart [icol]; icell < my columnStart [icol + 1]; icell ++)
+				sum  +=  features.row (my rowOfCell [icell])  *  my valueByColumn [icell];
+			productFtD.column (icol)  <<=  sum;
+		}
+	});
+}
+
+/*
+	productDWt = D.W', a numberOfRows x numberOfFeatures matrix.
+*/
+static void NMFdata_mulWeightsTransposed (NMFdata *me, MATVU const& productDWt, constMATVU const& weights) {
+	if (! my isSparse) {
+		MATmul_allowAllocation (productDWt, my data, weights.transpose());
+		return;
+	}
+	my weightsTransposed.all()  <<=  weights.transpose();
+	const integer numberOfRows = productDWt.nrow;
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfRows, 16);
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		integer firstRow, lastRow;
+		MelderThread_getRange (numberOfRows, numberOfThreads, ithread, & firstRow, & lastRow);
+		for (integer irow = firstRow; irow <= lastRow; irow ++) {
+			VECVU const row = productDWt.row (irow);
+			row  <<=  0.0;
+			for (integer icell = my rowStart [irow]; icell < my rowStart [irow + 1]; icell ++)
+				row  +=  my weightsTransposed.row (my columnOfCell [icell])  *  my valueByRow [icell];
+		}
+	});
 }
 
 /*
-	Calculating elementwise matrix multiplication, division and addition m = m0 .* (numerm ./(denom + eps))
+	Replace every element of m by newValue (irow, icol, m [irow] [icol]), multithreaded by rows.
+	Returns the maximum absolute change relative to the maximum absolute old value,
+	which serves as the convergence criterion without extra passes over m.
+*/
+template <typename Function>
+static double updateInPlace (MATVU const& m, double sqrteps, Function const& newValue) {
+	constexpr integer maximumNumberOfThreads = 16;
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (m.nrow, std::max (1_integer, 10000 / std::max (m.ncol, 1_integer)), maximumNumberOfThreads);
+	double maximumOfThread [1 + maximumNumberOfThreads], maximumChangeOfThread [1 + maximumNumberOfThreads];
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		double maximum = 0.0, maximumChange = 0.0;
+		integer firstRow, lastRow;
+		MelderThread_getRange (m.nrow, numberOfThreads, ithread, & firstRow, & lastRow);
+		for (integer irow = firstRow; irow <= lastRow; irow ++)
+			for (integer icol = 1; icol <= m.ncol; icol ++) {
+				const double oldValue = m [irow] [icol];
+				const double value = newValue (irow, icol, oldValue);
+				m [irow] [icol] = value;
+				maximum = std::max (maximum, fabs (oldValue));
+				maximumChange = std::max (maximumChange, fabs (value - oldValue));
+			}
+		maximumOfThread [ithread] = maximum;
+		maximumChangeOfThread [ithread] = maximumChange;
+	});
+	double maximum = 0.0, maximumChange = 0.0;
+	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++) {
+		maximum = std::max (maximum, maximumOfThread [ithread]);
+		maximumChange = std::max (maximumChange, maximumChangeOfThread [ithread]);
+	}
+	return maximumChange / (sqrteps + maximum);
+}
+
+/*
+	Calculating in place the elementwise matrix multiplication, division and addition m = m .* (numer ./(denom + eps))
 	Set elements < zero_threshold to zero
 */
 
-static const void update (MATVU const& m, constMATVU const& m0, constMATVU const& numer, constMATVU const& denom, double zeroThreshold, double maximum) {
-	Melder_assert (m.nrow == m0.nrow && m.ncol == m0.ncol);
+static double update (MATVU const& m, constMATVU const& numer, constMATVU const& denom, double zeroThreshold, double maximum, double sqrteps) {
 	Melder_assert (m.nrow == numer.nrow && m.ncol == numer.ncol);
 	Melder_assert (m.nrow == denom.nrow && m.ncol == denom.ncol);
 	/*
@@ -214,14 +345,28 @@ static const void update (MATVU const& m, constMATVU const& m0, constMATVU const
 		A scaling with the maximum value seems reasonable.
 	*/
 	const double divByZeroAvoidance = 1e-09 * ( maximum < 1.0 ? maximum : 1.0 );
-	for (integer irow = 1; irow <= m.nrow; irow ++) 
-		for (integer icol = 1; icol <= m.ncol; icol++) {
-			if (m0 [irow] [icol] == 0.0 || numer [irow] [icol]  == 0.0) {
-				m [irow] [icol] = 0.0;
-			} else {
-				double update = m0 [irow] [icol] * (numer [irow] [icol] / (denom [irow] [icol] + divByZeroAvoidance));
-				m [irow] [icol] = ( update < zeroThreshold ? 0.0 : update );
-			}
+	return updateInPlace (m, sqrteps, [&] (integer irow, integer icol, double oldValue) {
+		if (oldValue == 0.0 || numer [irow] [icol] == 0.0)
+			return 0.0;
+		const double update = oldValue * (numer [irow] [icol] / (denom [irow] [icol] + divByZeroAvoidance));
+		return ( update < zeroThreshold ? 0.0 : update );
+	});
+}
+
+/*
+	The pseudo-inverse V D^-1 U' of a square matrix from its SVD,
+	so that the solutions of a system for all columns of the right-hand side come from one matrix multiplication.
+*/
+static void SVD_getPseudoInverse_preallocated (SVD me, MATVU const& result) {
+	Melder_assert (my numberOfRows == my numberOfColumns && ! my isTransposed);
+	Melder_assert (result.nrow == my numberOfColumns && result.ncol == my numberOfRows);
+	for (integer irow = 1; irow <= result.nrow; irow ++)
+		for (integer icol = 1; icol <= result.ncol; icol ++) {
+			double value = 0.0;
+			for (integer k = 1; k <= my numberOfColumns; k ++)
+				if (my d [k] > 0.0)
+					value += my v [irow] [k] * my u [icol] [k] / my d [k];
+			result [irow] [icol] = value;
 		}
 }
 
@@ -232,6 +377,8 @@ static const void update (MATVU const& m, constMATVU const& m0, constMATVU const
 		"LIBNMF - A library for nonnegative matrix factorization."
 		Computing and informatics% #30: 205--224.
 
+	All products with the data run on the blocked multithreaded matrix multiplication
+	(or on the sparse kernels above); W and F are updated in place, with all workspaces allocated once.
 */
 void NMF_improveFactorization_mu (NMF me, constMATVU const& data, integer maximumNumberOfIterations, double changeTolerance, double approximationTolerance, bool info) {
 	try {
@@ -242,18 +389,16 @@ void NMF_improveFactorization_mu (NMF me, constMATVU const& data, integer maximu
 		
 		autoMAT productFtD = newMATzero (my numberOfFeatures, my numberOfColumns); // calculations of F'D
 		autoMAT productFtFW = newMATzero (my numberOfFeatures, my numberOfColumns); // calculations of F'F W
-		autoMAT weights0 = newMATzero (my numberOfFeatures, my numberOfColumns);
 		
 		autoMAT productDWt = newMATzero (my numberOfRows, my numberOfFeatures); // calculations of DW'
 		autoMAT productFWWt = newMATzero (my numberOfRows, my numberOfFeatures); // calculations of FWW'
-		autoMAT features0 = newMATzero (my numberOfRows, my numberOfFeatures);
 		
 		autoMAT productWWt = newMATzero (my numberOfFeatures, my numberOfFeatures); // calculations of WW'
 		autoMAT productFtF = newMATzero (my numberOfFeatures, my numberOfFeatures); // calculations of F'F
 		
+		NMFdata dataProducts;
+		NMFdata_init (& dataProducts, data, my numberOfFeatures);
 		const double traceDtD = NUMtrace2 (data.transpose(), data); // for distance calculation
-		features0.get() <<= my features.get();
-		weights0.get() <<= my weights.get();
 		
 		if (! NUMfpp)
 			NUMmachar ();
@@ -275,18 +420,16 @@ void NMF_improveFactorization_mu (NMF me, constMATVU const& data, integer maximu
 			*/
 			
 			// 1. Update W matrix
-			features0.get() <<= my features.get();
-			weights0.get() <<= my weights.get();
-			MATmul (productFtD.get(), features0.transpose(), data);
-			MATmul (productFtF.get(), features0.transpose(), features0.get());
-			MATmul (productFtFW.get(), productFtF.get(), weights0.get());
-			update (my weights.get(), weights0.get(), productFtD.get(), productFtFW.get(), eps, maximum);
+			NMFdata_mulFeaturesTransposed (& dataProducts, productFtD.get(), my features.get());
+			MATmul_allowAllocation (productFtF.get(), my features.transpose(), my features.get());
+			MATmul_allowAllocation (productFtFW.get(), productFtF.get(), my weights.get());
+			const double dw = update (my weights.get(), productFtD.get(), productFtFW.get(), eps, maximum, sqrteps);
 
 			// 2. Update F matrix
-			MATmul (productDWt.get(), data, my weights.transpose()); // productDWt = data*weights'
-			MATmul (productWWt.get(), my weights.get(), my weights.transpose()); // work1 = weights*weights'
-			MATmul (productFWWt.get(), features0.get(), productWWt.get()); // productFWWt = features0 * work1
-			update (my features.get(), features0.get(), productDWt.get(), productFWWt.get(), eps, maximum);
+			NMFdata_mulWeightsTransposed (& dataProducts, productDWt.get(), my weights.get()); // productDWt = data*weights'
+			MATmul_allowAllocation (productWWt.get(), my weights.get(), my weights.transpose()); // work1 = weights*weights'
+			MATmul_allowAllocation (productFWWt.get(), my features.get(), productWWt.get()); // productFWWt = features * work1
+			const double df = update (my features.get(), productDWt.get(), productFWWt.get(), eps, maximum, sqrteps);
 			
 			/* 3. Convergence test:
 				The Frobenius norm ||D-FW|| of a matrix can be written as
@@ -294,14 +437,13 @@ void NMF_improveFactorization_mu (NMF me, constMATVU const& data, integer maximu
 						=trace(D'D) - 2trace(W'(F'D))+trace((F'F)(WW'))
 				This saves us from explicitly calculating the reconstruction FW because we already have performed most of
 				the needed matrix multiplications in the update step.
+				The maximum changes of W and F were collected during their updates.
 			*/
 			
 			const double traceWtFtD  = NUMtrace2 (my weights.transpose(), productFtD.get());
 			const double traceWtFtFW = NUMtrace2 (productFtF.get(), productWWt.get());
 			const double distance = sqrt (std::max (traceDtD - 2.0 * traceWtFtD + traceWtFtFW, 0.0)); // just in case
 			const double dnorm = distance / (my numberOfRows * my numberOfColumns);
-			const double df = getMaximumChange (my features.get(), features0.get(), sqrteps);
-			const double dw = getMaximumChange (my weights.get(), weights0.get(), sqrteps);
 			const double delta = std::max (df, dw);
 			convergence = ( iter > 1 && (delta < changeTolerance || dnorm < dnorm0 * approximationTolerance) );
 			if (info)
@@ -323,17 +465,20 @@ void NMF_improveFactorization_als (NMF me, constMATVU const& data, integer maxim
 		Melder_require (my numberOfRows == data.nrow, U"The number of rows should be equal.");
 		
 		autoMAT productFtD = newMATzero (my numberOfFeatures, my numberOfColumns); // calculations of F'D
-		autoMAT productWDt = newMATzero (my numberOfFeatures, my numberOfRows); // calculations of WD'
+		autoMAT productDWt = newMATzero (my numberOfRows, my numberOfFeatures); // calculations of DW'
 		
-		autoMAT weights0 = newMATzero (my numberOfFeatures, my numberOfColumns);
-		autoMAT features0 = newMATzero (my numberOfRows, my numberOfFeatures);
+		autoMAT weights = newMATzero (my numberOfFeatures, my numberOfColumns); // unconstrained solution for W
+		autoMAT features = newMATzero (my numberOfRows, my numberOfFeatures); // unconstrained solution for F
 
 		autoMAT productFtF = newMATzero (my numberOfFeatures, my numberOfFeatures); // calculations of F'F
 		autoMAT productWWt = newMATzero (my numberOfFeatures, my numberOfFeatures); // calculations of WW'
+		autoMAT pseudoInverse = newMATzero (my numberOfFeatures, my numberOfFeatures);
 		
 		autoSVD svd_WWt = SVD_create (my numberOfFeatures, my numberOfFeatures); // solving W*W'*F' = W*D'
 		autoSVD svd_FtF = SVD_create (my numberOfFeatures, my numberOfFeatures); // solving F´*F*W = F'*D
 				
+		NMFdata dataProducts;
+		NMFdata_init (& dataProducts, data, my numberOfFeatures);
 		const double traceDtD = NUMtrace2 (data.transpose(), data); // for distance calculation
 		
 		if (! NUMfpp)
@@ -355,32 +500,35 @@ void NMF_improveFactorization_als (NMF me, constMATVU const& data, integer maxim
 				endfor
 			*/
 			
-			// 1. Solve equations for new W:  F´*F*W = F'*D.
-			weights0.get() <<= my weights.get(); // save previous weigts for convergence test
-			MATmul (productFtD.get(), my features.transpose(), data);
-			MATmul (productFtF.get(), my features.transpose(), my features.get());
+			// 1. Solve equations for new W:  F´*F*W = F'*D, i.e. W = (F'F)^+ * F'D
+			NMFdata_mulFeaturesTransposed (& dataProducts, productFtD.get(), my features.get());
+			MATmul_allowAllocation (productFtF.get(), my features.transpose(), my features.get());
 
 			svd_FtF -> u.get() <<= productFtF.get();
 			SVD_compute (svd_FtF.get());
-			SVD_solve_preallocated (svd_FtF.get(), productFtD.get(), my weights.get());
-			MATmakeElementsNonNegative (my weights.get(), 0);
+			SVD_getPseudoInverse_preallocated (svd_FtF.get(), pseudoInverse.get());
+			MATmul_allowAllocation (weights.get(), pseudoInverse.get(), productFtD.get());
+			const double dw = updateInPlace (my weights.get(), sqrteps, [&] (integer irow, integer icol, double) {
+				return std::max (weights [irow] [icol], 0.0);
+			});
 			
-			// 2. Solve equations for new F:  W*W'*F' = W*D'
-			features0.get() <<= my features.get(); // save previous features for convergence test
-			MATmul  (productWDt.get(), my weights.get(), data.transpose());
-			MATmul (productWWt.get(), my weights.get(), my weights.transpose());
+			// 2. Solve equations for new F:  W*W'*F' = W*D', i.e. F = DW' * ((WW')^+)'
+			NMFdata_mulWeightsTransposed (& dataProducts, productDWt.get(), my weights.get());
+			MATmul_allowAllocation (productWWt.get(), my weights.get(), my weights.transpose());
 
 			svd_WWt -> u.get() <<= productWWt.get();
 			SVD_compute (svd_WWt.get());
-			SVD_solve_preallocated (svd_WWt.get(), productWDt.get(), my features.transpose());
+			SVD_getPseudoInverse_preallocated (svd_WWt.get(), pseudoInverse.get());
+			MATmul_allowAllocation (features.get(), productDWt.get(), pseudoInverse.transpose());
+			const double df = updateInPlace (my features.get(), sqrteps, [&] (integer irow, integer icol, double) {
+				return std::max (features [irow] [icol], 0.0);
+			});
 
 			// 3. Convergence test
 			const double traceWtFtD  = NUMtrace2 (my weights.transpose(), productFtD.get());
 			const double traceWtFtFW = NUMtrace2 (productFtF.get(), productWWt.get());
 			const double distance = sqrt (std::max (traceDtD - 2.0 * traceWtFtD + traceWtFtFW, 0.0)); // just in case
 			const double dnorm = distance / (my numberOfRows * my numberOfColumns);
-			const double df = getMaximumChange (my features.get(), features0.get(), sqrteps);
-			const double dw = getMaximumChange (my weights.get(), weights0.get(), sqrteps);
 			const double delta = std::max (df, dw);
 			
 			convergence = ( iter > 1 && (delta < changeTolerance || dnorm < dnorm0 * approximationTolerance) );
@@ -307,7 +307,7 @@ static autoCovariance Covariances_pool (Covariance me, Covariance thee) {
 
 static double traceOfSquaredMatrixProduct (constMAT const& s1, constMAT const& s2) {
 	// tr ((s1*s2)^2), s1, s2 are symmetric
-	autoMAT m = newMATmul (s1, s2);
+	autoMAT m = newMATmul_allowAllocation (s1, s2);
 	double trace2 = NUMtrace2 (m.get(), m.get());
 	return trace2;
 }
@@ -510,13 +510,13 @@ void Covariances_equality (CovarianceList me, int method, double *out_prob, doub
 			for (integer i = 1; i <= numberOfMatrices; i ++) {
 				const Covariance ci = my at [i];
 				const double ni = ci -> numberOfObservations - 1;
-				autoMAT s1 = newMATmul (ci -> data.get(), si.get());
+				autoMAT s1 = newMATmul_allowAllocation (ci -> data.get(), si.get());
 				const double trace_ii = NUMtrace2 (s1.get(), s1.get());
 				trace += (ni / ns) * (1 - (ni / ns)) * trace_ii;
 				for (integer j = i + 1; j <= numberOfMatrices; j ++) {
 					const Covariance cj = my at [j];
 					const double nj = cj -> numberOfObservations - 1;
-					autoMAT s2 = newMATmul (cj -> data.get(), si.get());
+					autoMAT s2 = newMATmul_allowAllocation (cj -> data.get(), si.get());
 					const double trace_ij = NUMtrace2 (s1.get(), s2.get());
 					trace -= 2.0 * (ni / ns) * (nj / ns) * trace_ij;
 				}
@@ -41,6 +41,8 @@
 #include "Sound_extensions.h"
 #include "NUM2.h"
 #include "NUMmachar.h"
+#include "MelderThread.h"
+#include <atomic>
 
 #include "oo_DESTROY.h"
 #include "DTW_def.h"
@@ -65,6 +67,13 @@ Thing_implement (DTW, Matrix, 2);
 
 #define DTW_BIG 1e308
 
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+	#define DTW_HAS_X86_KERNELS  1
+	#include <immintrin.h>
+#else
+	#define DTW_HAS_X86_KERNELS  0
+#endif
+
 void structDTW :: v_info () {
 	structDaata :: v_info ();
 	MelderInfo_writeLine (U"Domain of prototype: ", ymin, U" to ", ymax, U" (s).");   // ppgb: Wat is een domain prototype?
@@ -766,6 +775,111 @@ void DTW_drawDistancesAlongPath (DTW me, Graphics g, double xmin, double xmax, d
 	}
 }
 
+/*
+	Sums of absolute and of squared differences between two frames that are stored contiguously.
+	Both accumulate in four interleaved partial sums, which is exactly what one AVX2 register does,
+	so the AVX2 kernels (chosen at run time) and the generic ones give identical results.
+	No fused multiply-add, for the same reason.
+*/
+typedef double (*DTW_FrameKernel) (const double *x, const double *y, integer n);
+
+static double DTW_sumOfAbsoluteDifferences_generic (const double *x, const double *y, integer n) {
+	double sum [4] = { 0.0, 0.0, 0.0, 0.0 };
+	integer k = 0;
+	for (; k + 4 <= n; k += 4)
+		for (integer lane = 0; lane < 4; lane ++)
+			sum [lane] += fabs (x [k + lane] - y [k + lane]);
+	for (; k < n; k ++)
+		sum [0] += fabs (x [k] - y [k]);
+	return (sum [0] + sum [1]) + (sum [2] + sum [3]);
+}
+
+static double DTW_sumOfSquaredDifferences_generic (const double *x, const double *y, integer n) {
+	double sum [4] = { 0.0, 0.0, 0.0, 0.0 };
+	integer k = 0;
+	for (; k + 4 <= n; k += 4)
+		for (integer lane = 0; lane < 4; lane ++) {
+			const double d = x [k + lane] - y [k + lane];
+			sum [lane] += d * d;
+		}
+	for (; k < n; k ++) {
+		const double d = x [k] - y [k];
+		sum [0] += d * d;
+	}
+	return (sum [0] + sum [1]) + (sum [2] + sum [3]);
+}
+
+#if DTW_HAS_X86_KERNELS
+__attribute__ ((target ("avx2")))
+static double DTW_sumOfAbsoluteDifferences_avx2 (const double *x, const double *y, integer n) {
+	const __m256d signMask = _mm256_set1_pd (-0.0);
+	__m256d sum4 = _mm256_setzero_pd ();
+	integer k = 0;
+	for (; k + 4 <= n; k += 4) {
+		const __m256d d = _mm256_sub_pd (_mm256_loadu_pd (x + k), _mm256_loadu_pd (y + k));
+		sum4 = _mm256_add_pd (sum4, _mm256_andnot_pd (signMask, d));
+	}
+	double sum [4];
+	_mm256_storeu_pd (sum, sum4);
+	for (; k < n; k ++)
+		sum [0] += fabs (x [k] - y [k]);
+	return (sum [0] + sum [1]) + (sum [2] + sum [3]);
+}
+
+__attribute__ ((target ("avx2")))
+static double DTW_sumOfSquaredDifferences_avx2 (const double *x, const double *y, integer n) {
+	__m256d sum4 = _mm256_setzero_pd ();
+	integer k = 0;
+	for (; k + 4 <= n; k += 4) {
+		const __m256d d = _mm256_sub_pd (_mm256_loadu_pd (x + k), _mm256_loadu_pd (y + k));
+		sum4 = _mm256_add_pd (sum4, _mm256_mul_pd (d, d));
+	}
+	double sum [4];
+	_mm256_storeu_pd (sum, sum4);
+	for (; k < n; k ++) {
+		const double d = x [k] - y [k];
+		sum [0] += d * d;
+	}
+	return (sum [0] + sum [1]) + (sum [2] + sum [3]);
+}
+#endif
+
+static DTW_FrameKernel DTW_chooseFrameKernel (double metric) {
+	#if DTW_HAS_X86_KERNELS
+		static const bool hasAvx2 = __builtin_cpu_supports ("avx2");
+		if (hasAvx2)
+			return ( metric == 1.0 ? DTW_sumOfAbsoluteDifferences_avx2 : DTW_sumOfSquaredDifferences_avx2 );
+	#endif
+	return ( metric == 1.0 ? DTW_sumOfAbsoluteDifferences_generic : DTW_sumOfSquaredDifferences_generic );
+}
+
+/*
+	metric = 1...n (sum (a_i^n))^(1/n), divided by the number of coefficients,
+	between two frames that are stored contiguously.
+	For metrics other than 1 and 2 we first divide by the maximum difference
+	to prevent overflow when metric is a large number.
+*/
+static double DTW_frameDistance (const double *x, const double *y, integer n, double metric) {
+	if (metric == 1.0 || metric == 2.0) {
+		static const DTW_FrameKernel cityBlock = DTW_chooseFrameKernel (1.0), euclidean = DTW_chooseFrameKernel (2.0);
+		return ( metric == 1.0 ? cityBlock (x, y, n) : sqrt (euclidean (x, y, n)) ) / n;
+	}
+	double dmax = 0.0, d = 0.0;
+	for (integer k = 0; k < n; k ++) {
+		const double dtmp = fabs (x [k] - y [k]);
+		if (dtmp > dmax)
+			dmax = dtmp;
+	}
+	if (dmax > 0) {
+		for (integer k = 0; k < n; k ++) {
+			const double dtmp = fabs (x [k] - y [k]) / dmax;
+			d +=  pow (dtmp, metric);
+		}
+	}
+	d = dmax * pow (d, 1.0 / metric);
+	return d / n;
+}
+
 /*
 	metric = 1...n (sum (a_i^n))^(1/n)
 */
@@ -776,6 +890,17 @@ autoDTW Matrices_to_DTW (Matrix me, Matrix thee, bool matchStart, bool matchEnd,
 
 		autoDTW him = DTW_create (my xmin, my xmax, my nx, my dx, my x1, thy xmin, thy xmax, thy nx, thy dx, thy x1);
 		autoMelderProgress progess (U"Calculate distances");
+		if (Melder_debug != 61) {
+			autoMAT myFrames = newMATtranspose (my z.get()), thyFrames = newMATtranspose (thy z.get());
+			for (integer i = 1; i <= my nx; i ++) {
+				for (integer j = 1; j <= thy nx; j ++)
+					his z [i] [j] = DTW_frameDistance (& myFrames [i] [1], & thyFrames [j] [1], my ny, metric);
+				if ((i % 10) == 1)
+					Melder_progress (0.999 * i / my nx, U"Calculate distances: column ", i, U" from ", my nx, U".");
+			}
+			DTW_findPath (him.get(), matchStart, matchEnd, slope);
+			return him;
+		}
 		for (integer i = 1; i <= my nx; i ++) {
 			for (integer j = 1; j <= thy nx; j ++) {
 				/*
@@ -972,7 +1097,7 @@ autoMatrix DTW_to_Matrix_cumulativeDistances (DTW me, double sakoeChibaBand, int
     }
 }
 
-static void DTW_relaxConstraints (DTW me, double band, int slope, double *relaxedBand, int *relaxedSlope) {
+static void DTW_relaxConstraints (SampledXY me, double band, int slope, double *relaxedBand, int *relaxedSlope) {
 	(void) slope;
 	double dtw_slope = (my ymax - my ymin - band) / (my xmax - my xmin - band);
 	dtw_slope = dtw_slope+1.0; // fake instruction to avoid compiler warning
@@ -980,7 +1105,7 @@ static void DTW_relaxConstraints (DTW me, double band, int slope, double *relaxe
 	*relaxedSlope = 1;
 }
 
-static void DTW_checkSlopeConstraints (DTW me, double band, int slope) {
+static void DTW_checkSlopeConstraints (SampledXY me, double band, int slope) {
     try {
         const double slopes [5] = { DTW_BIG, DTW_BIG, 3.0, 2.0, 1.5 } ;
         double dtw_slope = (my ymax - my ymin - band) / (my xmax - my xmin - band);
@@ -999,48 +1124,68 @@ static void DTW_checkSlopeConstraints (DTW me, double band, int slope) {
     }
 }
 
+static void DTW_Polygon_checkOverlap (SampledXY me, Polygon thee) {
+	double xmin, xmax, ymin, ymax;
+	Polygon_getExtrema (thee, & xmin, & xmax, & ymin, & ymax);
+	// if the Polygon and the DTW don't overlap everything is unreachable!
+	Melder_require (! (xmax <= my xmin || xmin >= my xmax || ymax <= my ymin || ymin >= my ymax),
+		U"DTW and Polygon don't overlap.");
+}
+
+/*
+	In each column ix, the rows from lowestRow [ix] to highestRow [ix] are reachable from the diagonal
+	without crossing the border of the polygon. Does not throw or allocate, so that threads can call it.
+*/
+static void DTW_Polygon_getReachableRows (SampledXY me, Polygon thee, INTVEC const& lowestRow, INTVEC const& highestRow) {
+	Melder_assert (lowestRow.size == my nx && highestRow.size == my nx);
+	const double eps = my dx / 100.0;   // safe enough
+	const double dtw_slope = (my ymax - my ymin) / (my xmax - my xmin);
+
+	// find border "above" polygon
+	for (integer ix = 1; ix <= my nx; ix ++) {
+		const double x = my x1 + (ix - 1) * my dx;
+		const integer iystart = Melder_ifloor (dtw_slope * ix * (my dx / my dy)) + 1;
+		highestRow [ix] = my ny;
+		for (integer iy = iystart + 1; iy <= my ny; iy ++) {
+			const double y = my y1 + (iy - 1) * my dy;
+			if (Polygon_getLocationOfPoint (thee, x, y, eps) == Polygon_OUTSIDE) {
+				highestRow [ix] = iy - 1;
+				break;
+			}
+		}
+	}
+	// find border "below" polygon
+	lowestRow [1] = 1;
+	for (integer ix = 2; ix <= my nx; ix ++) {
+		const double x = my x1 + (ix - 1) * my dx;
+		integer iystart = Melder_ifloor (dtw_slope * ix * (my dx / my dy));   // start 1 lower
+		if (iystart > my ny)
+			iystart = my ny;
+		lowestRow [ix] = 1;
+		for (integer iy = iystart - 1; iy >= 1; iy --) {
+			const double y = my y1 + (iy - 1) * my dy;
+			if (Polygon_getLocationOfPoint (thee, x, y, eps) == Polygon_OUTSIDE) {
+				lowestRow [ix] = iy + 1;
+				break;
+			}
+		}
+	}
+}
+
 static void DTW_Polygon_setUnreachableParts (DTW me, Polygon thee, INTMAT const& psi) {
-    try {
-        const double eps = my dx / 100.0;   // safe enough
-        const double dtw_slope = (my ymax - my ymin) / (my xmax - my xmin);
-
-        double xmin, xmax, ymin, ymax;
-        Polygon_getExtrema (thee, & xmin, & xmax, & ymin, & ymax);
-        // if the Polygon and the DTW don't overlap everything is unreachable!
-		Melder_require (! (xmax <= my xmin || xmin >= my xmax || ymax <= my ymin || ymin >= my ymax),
-			U"DTW and Polygon don't overlap.");
-
-        // find border "above" polygon
-        for (integer ix = 1; ix <= my nx; ix ++) {
-            const double x = my x1 + (ix - 1) * my dx;
-            const integer iystart = Melder_ifloor (dtw_slope * ix * (my dx / my dy)) + 1;
-            for (integer iy = iystart + 1; iy <= my ny; iy ++) {
-				const double y = my y1 + (iy - 1) * my dy;
-                if (Polygon_getLocationOfPoint (thee, x, y, eps) == Polygon_OUTSIDE) {
-                    for (integer k = iy; k <= my ny; k ++)
-                        psi [k] [ix] = DTW_UNREACHABLE;
-                    break;
-                }
-            }
-        }
-        // find border "below" polygon
-        for (integer ix = 2; ix <= my nx; ix ++) {
-            const double x = my x1 + (ix - 1) * my dx;
-            integer iystart = Melder_ifloor (dtw_slope * ix * (my dx / my dy));   // start 1 lower
-            if (iystart > my ny)
-				iystart = my ny;
-            for (integer iy = iystart - 1; iy >= 1; iy --) {
-                const double y = my y1 + (iy - 1) * my dy;
-                if (Polygon_getLocationOfPoint (thee, x, y, eps) == Polygon_OUTSIDE) {
-                    for (integer k = iy; k >= 1; k --)
-                        psi [k] [ix] = DTW_UNREACHABLE;
-                    break;
-                }
-            }
-        }
-    } catch (MelderError) {
-        Melder_throw (me, U" cannot set unreachable parts.");
-    }
+	try {
+		DTW_Polygon_checkOverlap (me, thee);
+		autoINTVEC lowestRow = newINTVECraw (my nx), highestRow = newINTVECraw (my nx);
+		DTW_Polygon_getReachableRows (me, thee, lowestRow.get(), highestRow.get());
+		for (integer ix = 1; ix <= my nx; ix ++) {
+			for (integer k = highestRow [ix] + 1; k <= my ny; k ++)
+				psi [k] [ix] = DTW_UNREACHABLE;
+			for (integer k = 1; k < lowestRow [ix]; k ++)
+				psi [k] [ix] = DTW_UNREACHABLE;
+		}
+	} catch (MelderError) {
+		Melder_throw (me, U" cannot set unreachable parts.");
+	}
 }
 
 #define DTW_ISREACHABLE(y,x) ((psi [y] [x] != DTW_UNREACHABLE) && (psi [y] [x] != DTW_FORBIDDEN))
@@ -1062,115 +1207,119 @@ static void getIntersectionPoint (double x1, double y1, double x2, double y2, do
     *y3 = a * *x3 + y1 - a * x1;
 }
 
-autoPolygon DTW_to_Polygon (DTW me, double band, int slope) {
-    try {
-		try {
-			DTW_checkSlopeConstraints (me, band, slope);
-		} catch (MelderError) {
-			DTW_relaxConstraints (me, band, slope, & band, & slope);
-			Melder_flushError ();
-		}
-			
-        double slopes [5] = { DTW_BIG, DTW_BIG, 3.0, 2.0, 1.5 } ;
-        if (band <= 0) {
-            if (slope == 1) {
-                autoPolygon thee = Polygon_create (4);
-                thy x [1] = my xmin;
-				thy y [1] = my ymin;
-                thy x [2] = my xmin;
-				thy y [2] = my ymax;
-                thy x [3] = my xmax;
-				thy y [3] = my ymax;
-                thy x [4] = my xmax;
-				thy y [4] = my ymin;
-                return thee;
-            } else {
-                autoPolygon thee = Polygon_create (4);
-                thy x [1] = my xmin;
-				thy y [1] = my ymin;
-                thy x [3] = my xmax;
-				thy y [3] = my ymax;
-                double x, y;
-                getIntersectionPoint (my xmin, my ymin, my xmax, my ymax, slopes [slope], & x, & y);
-                if (x < my xmin)
-					x = my xmin;
-                if (x > my xmax)
-					x = my xmax;
-                if (y < my ymin)
-					y = my ymin;
-                if (y > my ymax)
-					y = my ymax;
-                thy x [2] = x;
-                thy y [2] = y;
-                getIntersectionPoint (my xmin, my ymin, my xmax, my ymax, 1.0 / slopes [slope], & x, & y);
-                if (x < my xmin)
-					x = my xmin;
-                if (x > my xmax)
-					x = my xmax;
-                if (y < my ymin)
-					y = my ymin;
-                if (y > my ymax)
-					y = my ymax;
-                thy x [4] = x;
-                thy y [4] = y;
-                return thee;
-            }
+static autoPolygon DTW_getBandPolygon (SampledXY me, double band, int slope) {
+	try {
+		DTW_checkSlopeConstraints (me, band, slope);
+	} catch (MelderError) {
+		DTW_relaxConstraints (me, band, slope, & band, & slope);
+		Melder_flushError ();
+	}
+		
+    double slopes [5] = { DTW_BIG, DTW_BIG, 3.0, 2.0, 1.5 } ;
+    if (band <= 0) {
+        if (slope == 1) {
+            autoPolygon thee = Polygon_create (4);
+            thy x [1] = my xmin;
+			thy y [1] = my ymin;
+            thy x [2] = my xmin;
+			thy y [2] = my ymax;
+            thy x [3] = my xmax;
+			thy y [3] = my ymax;
+            thy x [4] = my xmax;
+			thy y [4] = my ymin;
+            return thee;
         } else {
-            if (slope == 1) {
-                autoPolygon thee = Polygon_create (6);
-                thy x [1] = my xmin;
-				thy y [1] = my ymin;
-                thy x [2] = my xmin;
-				thy y [2] = my ymin + band;
-                thy x [3] = my xmax - band;
-				thy y [3] = my ymax;
-                thy x [4] = my xmax;
-				thy y [4] = my ymax;
-                thy x [5] = my xmax;
-				thy y [5] = my ymax - band;
-                thy x [6] = my xmin + band;
-				thy y [6] = my ymin;
-                return thee;
-            } else {
-                autoPolygon thee = Polygon_create (8);
-                double x, y;
-                thy x [1] = my xmin;
-				thy y [1] = my ymin;
-                thy x [2] = my xmin;
-				thy y [2] = my ymin + band;
-                getIntersectionPoint (my xmin, my ymin + band, my xmax - band, my ymax, slopes [slope], & x, & y);
-                if (x < my xmin)
-					x = my xmin;
-                if (x > my xmax)
-					x = my xmax;
-                if (y < my ymin)
-					y = my ymin;
-                if (y > my ymax)
-					y = my ymax;
-                thy x [3] = x;
-                thy y [3] = y;
-                thy x [4] = my xmax - band;
-				thy y [4] = my ymax;
-                thy x [5] = my xmax;
-				thy y [5]= my ymax;
-                thy x [6] = my xmax;
-				thy y [6] = my ymax - band;
-                getIntersectionPoint (my xmin + band, my ymin, my xmax, my ymax - band, 1.0 / slopes [slope], & x, & y);
-                if (x < my xmin)
-					x = my xmin;
-                if (x > my xmax)
-					x = my xmax;
-                if (y < my ymin)
-					y = my ymin;
-                if (y > my ymax)
-					y = my ymax;
-                thy x [7] = x;
-                thy y [7] = y;
-                thy x [8] = my xmin + band;
-				thy y [8] = my ymin;
-                return thee;
-            }
+            autoPolygon thee = Polygon_create (4);
+            thy x [1] = my xmin;
+			thy y [1] = my ymin;
+            thy x [3] = my xmax;
+			thy y [3] = my ymax;
+            double x, y;
+            getIntersectionPoint (my xmin, my ymin, my xmax, my ymax, slopes [slope], & x, & y);
+            if (x < my xmin)
+				x = my xmin;
+            if (x > my xmax)
+				x = my xmax;
+            if (y < my ymin)
+				y = my ymin;
+            if (y > my ymax)
+				y = my ymax;
+            thy x [2] = x;
+            thy y [2] = y;
+            getIntersectionPoint (my xmin, my ymin, my xmax, my ymax, 1.0 / slopes [slope], & x, & y);
+            if (x < my xmin)
+				x = my xmin;
+            if (x > my xmax)
+				x = my xmax;
+            if (y < my ymin)
+				y = my ymin;
+            if (y > my ymax)
+				y = my ymax;
+            thy x [4] = x;
+            thy y [4] = y;
+            return thee;
+        }
+    } else {
+        if (slope == 1) {
+            autoPolygon thee = Polygon_create (6);
+            thy x [1] = my xmin;
+			thy y [1] = my ymin;
+            thy x [2] = my xmin;
+			thy y [2] = my ymin + band;
+            thy x [3] = my xmax - band;
+			thy y [3] = my ymax;
+            thy x [4] = my xmax;
+			thy y [4] = my ymax;
+            thy x [5] = my xmax;
+			thy y [5] = my ymax - band;
+            thy x [6] = my xmin + band;
+			thy y [6] = my ymin;
+            return thee;
+        } else {
+            autoPolygon thee = Polygon_create (8);
+            double x, y;
+            thy x [1] = my xmin;
+			thy y [1] = my ymin;
+            thy x [2] = my xmin;
+			thy y [2] = my ymin + band;
+            getIntersectionPoint (my xmin, my ymin + band, my xmax - band, my ymax, slopes [slope], & x, & y);
+            if (x < my xmin)
+				x = my xmin;
+            if (x > my xmax)
+				x = my xmax;
+            if (y < my ymin)
+				y = my ymin;
+            if (y > my ymax)
+				y = my ymax;
+            thy x [3] = x;
+            thy y [3] = y;
+            thy x [4] = my xmax - band;
+			thy y [4] = my ymax;
+            thy x [5] = my xmax;
+			thy y [5]= my ymax;
+            thy x [6] = my xmax;
+			thy y [6] = my ymax - band;
+            getIntersectionPoint (my xmin + band, my ymin, my xmax, my ymax - band, 1.0 / slopes [slope], & x, & y);
+            if (x < my xmin)
+				x = my xmin;
+            if (x > my xmax)
+				x = my xmax;
+            if (y < my ymin)
+				y = my ymin;
+            if (y > my ymax)
+				y = my ymax;
+            thy x [7] = x;
+            thy y [7] = y;
+            thy x [8] = my xmin + band;
+			thy y [8] = my ymin;
+            return thee;
         }
+    }
+}
+
+autoPolygon DTW_to_Polygon (DTW me, double band, int slope) {
+    try {
+		return DTW_getBandPolygon (me, band, slope);
     } catch (MelderError) {
         Melder_throw (me, U" no Polygon created.");
     }
@@ -1405,4 +1554,476 @@ void DTW_Polygon_findPathInside (DTW me, Polygon thee, int localSlope, autoMatri
     }
 }
 
+/*
+	Which cells DTW_Polygon_findPathInside can reach: the rows from lowestRow [j] to highestRow [j]
+	in column j, except in the first row and column, where only the first few cells are reachable.
+	A path can start in the first row or column, and in every cell that none of its predecessors can reach;
+	no path starts to the right of lastStartColumn.
+*/
+struct DTW_Reach {
+	integer nx, ny, rowto, colto, lastStartColumn;
+	constINTVEC lowestRow, highestRow;
+	bool isReachable (integer i, integer j) const {
+		if (i < lowestRow [j] || i > highestRow [j])
+			return false;
+		if (i == 1)
+			return j >= 2 && j <= colto;
+		if (j == 1)
+			return i <= rowto;
+		return true;
+	}
+};
+
+static DTW_Reach DTW_Reach_make (integer nx, integer ny, constINTVEC const& lowestRow, constINTVEC const& highestRow, int localSlope) {
+	Melder_assert (lowestRow.size >= nx && highestRow.size >= nx);
+	const double slopes [5] = { DTW_BIG, DTW_BIG, 3.0, 2.0, 1.5 };
+	const integer delta_xy = std::min (nx, ny) / 10;
+	DTW_Reach reach;
+	reach.nx = nx;
+	reach.ny = ny;
+	reach.rowto = std::min (( localSlope != 1 ? Melder_ifloor (slopes [localSlope]) + 1 : delta_xy ), ny);
+	reach.colto = std::min (( localSlope != 1 ? Melder_ifloor (slopes [localSlope]) + 1 : delta_xy ), nx);
+	reach.lowestRow = lowestRow.part (1, nx);
+	reach.highestRow = highestRow.part (1, nx);
+	reach.lastStartColumn = std::max (reach.colto, integer (1));
+	for (integer j = 2; j <= nx; j ++)
+		for (integer i = std::max (lowestRow [j], integer (2)); i <= highestRow [j]; i ++)
+			if (! reach.isReachable (i - 1, j - 1) && ! reach.isReachable (i, j - 1) && ! reach.isReachable (i - 1, j))
+				reach.lastStartColumn = j;
+	return reach;
+}
+
+/*
+	The forward pass of DTW_Polygon_findPathInside, restricted to the reachable rows of each column.
+	Distances are computed only when a cell is reached, and only the last four columns of
+	distances, cumulative distances and directions are kept (two without slope constraint),
+	in delta, z and psi, which should have at least four rows and reach.ny columns,
+	so that memory is linear in the number of frames.
+	Cumulative distances never decrease along a path, hence once no path can start any more,
+	the smallest cumulative distance in the last few columns is a lower bound of the result;
+	if that bound exceeds abandonAbove we give up and return undefined.
+	A completed distance that exceeds abandonAbove is returned as undefined as well.
+*/
+template <typename DistanceFunction>
+static double DTW_getWeightedDistance_rolling (DTW_Reach const& reach, int localSlope, DistanceFunction distance, double abandonAbove,
+	MATVU const& delta, MATVU const& z, INTMATVU const& psi)
+{
+	const integer nx = reach.nx, ny = reach.ny, rowto = reach.rowto, colto = reach.colto;
+	const constINTVEC lowestRow = reach.lowestRow, highestRow = reach.highestRow;
+	auto isReachable = [&] (integer i, integer j) -> bool {
+		return reach.isReachable (i, j);
+	};
+	const integer numberOfColumns = ( localSlope == 1 ? 2 : 4 );
+	Melder_assert (delta.nrow >= numberOfColumns && delta.ncol >= ny);
+	auto column = [&] (integer j) -> integer {
+		return (j - 1) % numberOfColumns + 1;
+	};
+	auto direction = [&] (integer i, integer j) -> integer {
+		return ( isReachable (i, j) ? psi [column (j)] [i] : DTW_UNREACHABLE );
+	};
+
+	const integer window = ( localSlope == 1 ? 1 : 3 );   // the largest step back in x
+	const bool mayAbandon = isdefined (abandonAbove) && isReachable (ny, nx);
+	const integer lastStartColumn = reach.lastStartColumn;
+	double columnMinima [3];
+
+	double firstRowDelta = 0.0;
+	for (integer j = 1; j <= nx; j ++) {
+		const integer jc = column (j);
+		double columnMinimum = DTW_BIG;
+		if (j == 1) {
+			double firstColumnDelta = 0.0;
+			for (integer i = 1; i <= std::max (rowto, integer (1)); i ++) {
+				const double zij = z [jc] [i] = distance (i, 1);
+				if (i == 1)
+					firstColumnDelta = firstRowDelta = zij;
+				else if (localSlope != 1)
+					firstColumnDelta += zij;
+				delta [jc] [i] = ( localSlope != 1 ? firstColumnDelta : zij );
+				psi [jc] [i] = ( localSlope != 1 ? DTW_Y : DTW_START );
+				if (isReachable (i, 1) && delta [jc] [i] < columnMinimum)
+					columnMinimum = delta [jc] [i];
+			}
+		} else {
+			if (j <= colto) {
+				const double z1j = z [jc] [1] = distance (1, j);
+				firstRowDelta += z1j;
+				delta [jc] [1] = ( localSlope != 1 ? firstRowDelta : z1j );
+				psi [jc] [1] = ( localSlope != 1 ? DTW_X : DTW_START );
+				if (isReachable (1, j) && delta [jc] [1] < columnMinimum)
+					columnMinimum = delta [jc] [1];
+			}
+			const integer jc1 = column (j - 1);
+			for (integer i = std::max (lowestRow [j], integer (2)); i <= highestRow [j]; i ++) {
+				const double zij = z [jc] [i] = distance (i, j);
+				double g, gmin = DTW_BIG;
+				integer dir = 0;
+				if (isReachable (i - 1, j - 1)) {
+					gmin = delta [jc1] [i - 1] + 2.0 * zij;
+					dir = DTW_XANDY;
+				} else if (isReachable (i, j - 1)) {
+					gmin = delta [jc1] [i] + zij;
+					dir = DTW_X;
+				} else if (isReachable (i - 1, j)) {
+					gmin = delta [jc] [i - 1] + zij;
+					dir = DTW_Y;
+				} else {
+					psi [jc] [i] = 0;   // isolated
+					delta [jc] [i] = zij;
+					if (zij < columnMinimum)
+						columnMinimum = zij;
+					continue;
+				}
+				switch (localSlope) {
+					case 1: {   // no restriction
+						if (isReachable (i, j - 1) && ((g = delta [jc1] [i] + zij) < gmin)) {
+							gmin = g;
+							dir = DTW_X;
+						}
+						if (isReachable (i - 1, j) && ((g = delta [jc] [i - 1] + zij) < gmin)) {
+							gmin = g;
+							dir = DTW_Y;
+						}
+					}
+					break;
+					case 2: {   // P = 1/2
+						if (j >= 4 && isReachable (i - 1, j - 3) && direction (i, j - 1) == DTW_X && direction (i, j - 2) == DTW_XANDY &&
+							(g = delta [column (j - 3)] [i - 1] + 2.0 * z [column (j - 2)] [i] + z [jc1] [i] + zij) < gmin) {
+							gmin = g;
+							dir = DTW_X;
+						}
+						if (j >= 3 && isReachable (i - 1, j - 2) && direction (i, j - 1) == DTW_XANDY &&
+							(g = delta [column (j - 2)] [i - 1] + 2.0 * z [jc1] [i] + zij) < gmin) {
+							gmin = g;
+							dir = DTW_X;
+						}
+						if (i >= 3 && isReachable (i - 2, j - 1) && direction (i - 1, j) == DTW_XANDY &&
+							(g = delta [jc1] [i - 2] + 2.0 * z [jc] [i - 1] + zij) < gmin) {
+							gmin = g;
+							dir = DTW_Y;
+						}
+						if (i >= 4 && isReachable (i - 3, j - 1) && direction (i - 1, j) == DTW_Y && direction (i - 2, j) == DTW_XANDY &&
+							(g = delta [jc1] [i - 3] + 2.0 * z [jc] [i - 2] + z [jc] [i - 1] + zij) < gmin) {
+							gmin = g;
+							dir = DTW_Y;
+						}
+					}
+					break;
+					case 3: {   // P = 1
+						if (j >= 3 && isReachable (i - 1, j - 2) && direction (i, j - 1) == DTW_XANDY &&
+							(g = delta [column (j - 2)] [i - 1] + 2.0 * z [jc1] [i] + zij) < gmin) {
+							gmin = g;
+							dir = DTW_X;
+						}
+						if (i >= 3 && isReachable (i - 2, j - 1) && direction (i - 1, j) == DTW_XANDY &&
+							(g = delta [jc1] [i - 2] + 2.0 * z [jc] [i - 1] + zij) < gmin) {
+							gmin = g;
+							dir = DTW_Y;
+						}
+					}
+					break;
+					case 4: {   // P = 2
+						if (i >= 3 && j >= 4 && isReachable (i - 2, j - 3) && direction (i, j - 1) == DTW_XANDY && direction (i - 1, j - 2) == DTW_XANDY &&
+							(g = delta [column (j - 3)] [i - 2] + 2.0 * z [column (j - 2)] [i - 1] + 2.0 * z [jc1] [i] + zij) < gmin) {
+							gmin = g;
+							dir = DTW_X;
+						}
+						if (i >= 4 && j >= 3 && isReachable (i - 3, j - 2) && direction (i - 1, j) == DTW_XANDY && direction (i - 2, j - 1) == DTW_XANDY &&
+							(g = delta [column (j - 2)] [i - 3] + 2.0 * z [jc1] [i - 2] + 2.0 * z [jc] [i - 1] + zij) < gmin) {
+							gmin = g;
+							dir = DTW_Y;
+						}
+					}
+					break;
+					default:
+					break;
+				}
+				psi [jc] [i] = dir;
+				delta [jc] [i] = gmin;
+				if (gmin < columnMinimum)
+					columnMinimum = gmin;
+			}
+		}
+		columnMinima [(j - 1) % window] = columnMinimum;
+		if (mayAbandon && j >= lastStartColumn) {
+			double lowerBound = columnMinima [0];
+			for (integer k = 1; k < std::min (window, j); k ++)
+				lowerBound = std::min (lowerBound, columnMinima [k]);
+			if (lowerBound / (nx + ny) > abandonAbove)
+				return undefined;
+		}
+	}
+
+	const integer jc = column (nx);
+	double minimum = ( isReachable (ny, nx) ? delta [jc] [ny] : distance (ny, nx) );
+	for (integer i = ny - 1; i > 0; i --) {
+		if (! isReachable (i, nx))
+			break;   // we're in unreachable places
+		else if (delta [jc] [i] < minimum)
+			minimum = delta [jc] [i];
+	}
+	const double weightedDistance = minimum / (nx + ny);
+	if (isdefined (abandonAbove) && weightedDistance > abandonAbove)
+		return undefined;
+	return weightedDistance;
+}
+
+static autoSampledXY Matrices_to_SampledXY_dtw (Matrix me, Matrix thee) {
+	autoSampledXY him = Thing_new (SampledXY);
+	SampledXY_init (him.get(), thy xmin, thy xmax, thy nx, thy dx, thy x1, my xmin, my xmax, my nx, my dx, my x1);
+	return him;
+}
+
+double Matrices_Polygon_getDTWDistance (Matrix me, Matrix thee, Polygon him, int localSlope, double metric, double abandonAbove) {
+	try {
+		Melder_require (thy ny == my ny,
+			U"Column sizes should be equal.");
+		Melder_require (my nx > 1 && thy nx > 1,
+			U"Both matrices should have at least two columns.");
+		Melder_require (localSlope > 0 && localSlope < 5,
+			U"Local slope parameter ", localSlope, U" not supported.");
+		autoSampledXY grid = Matrices_to_SampledXY_dtw (me, thee);
+		DTW_Polygon_checkOverlap (grid.get(), him);
+		autoINTVEC lowestRow = newINTVECraw (thy nx), highestRow = newINTVECraw (thy nx);
+		DTW_Polygon_getReachableRows (grid.get(), him, lowestRow.get(), highestRow.get());
+		const DTW_Reach reach = DTW_Reach_make (thy nx, my nx, lowestRow.get(), highestRow.get(), localSlope);
+		autoMAT myFrames = newMATtranspose (my z.get()), thyFrames = newMATtranspose (thy z.get());
+		autoMAT delta = newMATraw (4, my nx), z = newMATraw (4, my nx);
+		autoINTMAT psi = newINTMATraw (4, my nx);
+		return DTW_getWeightedDistance_rolling (reach, localSlope,
+			[&] (integer i, integer j) {
+				return DTW_frameDistance (& myFrames [i] [1], & thyFrames [j] [1], my ny, metric);
+			}, abandonAbove, delta.get(), z.get(), psi.get()
+		);
+	} catch (MelderError) {
+		Melder_throw (me, U" & ", thee, U": no DTW distance computed.");
+	}
+}
+
+double Matrices_getDTWDistance (Matrix me, Matrix thee, double sakoeChibaBand, int localSlope, double metric, double abandonAbove) {
+	try {
+		autoSampledXY grid = Matrices_to_SampledXY_dtw (me, thee);
+		autoPolygon band = DTW_getBandPolygon (grid.get(), sakoeChibaBand, localSlope);
+		return Matrices_Polygon_getDTWDistance (me, thee, band.get(), localSlope, metric, abandonAbove);
+	} catch (MelderError) {
+		Melder_throw (me, U" & ", thee, U": no DTW distance computed.");
+	}
+}
+
+/*
+	An LB_Keogh lower bound of the weighted distance between the frames (columns) of y, on the y-axis,
+	and those of x, on the x-axis. In column j, frame j of x is compared with the envelope
+	(the minimum and maximum of every coefficient) of the frames of y in the reachable rows;
+	its distance to that envelope cannot exceed the distance to any of those frames.
+	Every path passes through all columns from reach.lastStartColumn on.
+	The envelopes slide along with monotonic queues, so that the bound costs O ((nx + ny) numberOfCoefficients).
+	We return 0.0 if the reachable rows do not move up monotonically (a strange polygon).
+*/
+static double DTW_getLowerBound (DTW_Reach const& reach, constMAT const& y, constMAT const& x, double metric,
+	VEC const& columnSums, INTVEC const& upperQueue, INTVEC const& lowerQueue)
+{
+	const integer nx = reach.nx, ny = reach.ny, numberOfCoefficients = y.nrow;
+	if (! reach.isReachable (ny, nx))
+		return 0.0;
+	for (integer j = 2; j <= nx; j ++)
+		if (reach.lowestRow [j] < reach.lowestRow [j - 1] || reach.highestRow [j] < reach.highestRow [j - 1])
+			return 0.0;
+	columnSums.part (1, nx) <<= 0.0;
+	for (integer k = 1; k <= numberOfCoefficients; k ++) {
+		const constVEC yk = y.row (k);
+		integer upperFirst = 1, upperLast = 0, lowerFirst = 1, lowerLast = 0, nextRow = 1;
+		for (integer j = 1; j <= nx; j ++) {
+			for (; nextRow <= reach.highestRow [j]; nextRow ++) {
+				while (upperLast >= upperFirst && yk [upperQueue [upperLast]] <= yk [nextRow])
+					upperLast --;
+				upperQueue [++ upperLast] = nextRow;
+				while (lowerLast >= lowerFirst && yk [lowerQueue [lowerLast]] >= yk [nextRow])
+					lowerLast --;
+				lowerQueue [++ lowerLast] = nextRow;
+			}
+			while (upperFirst <= upperLast && upperQueue [upperFirst] < reach.lowestRow [j])
+				upperFirst ++;
+			while (lowerFirst <= lowerLast && lowerQueue [lowerFirst] < reach.lowestRow [j])
+				lowerFirst ++;
+			if (upperFirst > upperLast)
+				continue;
+			const double xkj = x [k] [j], upper = yk [upperQueue [upperFirst]], lower = yk [lowerQueue [lowerFirst]];
+			const double e = ( xkj > upper ? xkj - upper : xkj < lower ? lower - xkj : 0.0 );
+			if (metric == 1.0)
+				columnSums [j] += e;
+			else if (metric == 2.0)
+				columnSums [j] += e * e;
+			else if (e > columnSums [j])
+				columnSums [j] = e;   // (sum e^p)^(1/p) >= max e
+		}
+	}
+	double sum = 0.0;
+	for (integer j = reach.lastStartColumn; j <= nx; j ++)
+		sum += ( metric == 2.0 ? sqrt (columnSums [j]) : columnSums [j] );
+	return sum / numberOfCoefficients / (nx + ny);
+}
+
+autoTable Matrices_searchDTW (Matrix query, OrderedOf<structMatrix> *references, double sakoeChibaBand, int localSlope, double metric, integer numberOfBestMatches) {
+	try {
+		const integer numberOfReferences = references -> size, ny = query -> nx, numberOfCoefficients = query -> ny;
+		Melder_require (numberOfReferences > 0,
+			U"There should be at least one reference.");
+		Melder_require (ny > 1,
+			U"The query should have at least two columns.");
+		Melder_require (localSlope > 0 && localSlope < 5,
+			U"Local slope parameter ", localSlope, U" not supported.");
+		const integer numberOfMatches = ( numberOfBestMatches > 0 ? std::min (numberOfBestMatches, numberOfReferences) : numberOfReferences );
+		integer maximumNumberOfFrames = 0;
+		for (integer iref = 1; iref <= numberOfReferences; iref ++) {
+			const Matrix reference = references -> at [iref];
+			Melder_require (reference -> ny == numberOfCoefficients,
+				U"Reference ", iref, U" should have as many rows as the query.");
+			Melder_require (reference -> nx > 1,
+				U"Reference ", iref, U" should have at least two columns.");
+			maximumNumberOfFrames = std::max (maximumNumberOfFrames, reference -> nx);
+		}
+		/*
+			The band polygons are made here, because they may complain about the slope constraint.
+		*/
+		OrderedOf<structSampledXY> grids;
+		OrderedOf<structPolygon> bands;
+		for (integer iref = 1; iref <= numberOfReferences; iref ++) {
+			autoSampledXY grid = Matrices_to_SampledXY_dtw (query, references -> at [iref]);
+			autoPolygon band = DTW_getBandPolygon (grid.get(), sakoeChibaBand, localSlope);
+			DTW_Polygon_checkOverlap (grid.get(), band.get());
+			grids. addItem_move (grid.move());
+			bands. addItem_move (band.move());
+		}
+		autoMAT queryFrames = newMATtranspose (query -> z.get());
+		autoINTMAT lowestRows = newINTMATraw (numberOfReferences, maximumNumberOfFrames), highestRows = newINTMATraw (numberOfReferences, maximumNumberOfFrames);
+		autovector <DTW_Reach> reaches = newvectorzero <DTW_Reach> (numberOfReferences);
+		autoVEC lowerBounds = newVECraw (numberOfReferences);
+
+		const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfReferences, 1);
+		autoMAT columnSums = newMATraw (numberOfThreads, maximumNumberOfFrames);
+		autoINTMAT queues = newINTMATraw (2 * numberOfThreads, ny);
+		autoMAT deltas = newMATraw (4 * numberOfThreads, ny), distances = newMATraw (4 * numberOfThreads, ny);
+		autoINTMAT directions = newINTMATraw (4 * numberOfThreads, ny);
+		autoMAT referenceFrames = newMATraw (numberOfThreads * maximumNumberOfFrames, numberOfCoefficients);
+		autoMAT bestDistances = newMATraw (numberOfThreads, numberOfMatches);
+		autoINTMAT bestReferences = newINTMATraw (numberOfThreads, numberOfMatches);
+		autoINTVEC numberOfBest = newINTVECzero (numberOfThreads);
+
+		/*
+			First the reachable cells and the lower bound of every reference.
+		*/
+		MelderThread_run (numberOfThreads, [&] (integer ithread) {
+			integer firstReference, lastReference;
+			MelderThread_getRange (numberOfReferences, numberOfThreads, ithread, & firstReference, & lastReference);
+			for (integer iref = firstReference; iref <= lastReference; iref ++) {
+				const Matrix reference = references -> at [iref];
+				const INTVEC lowestRow = lowestRows.row (iref).part (1, reference -> nx), highestRow = highestRows.row (iref).part (1, reference -> nx);
+				DTW_Polygon_getReachableRows (grids.at [iref], bands.at [iref], lowestRow, highestRow);
+				reaches [iref] = DTW_Reach_make (reference -> nx, ny, lowestRow, highestRow, localSlope);
+				lowerBounds [iref] = DTW_getLowerBound (reaches [iref], query -> z.get(), reference -> z.get(), metric,
+						columnSums.row (ithread), queues.row (2 * ithread - 1), queues.row (2 * ithread));
+			}
+		});
+
+		/*
+			Then the alignments, the most promising ones first, handed out one by one to whichever thread is free.
+			Each thread keeps its own best matches; the worst of those bounds the distance that can still matter,
+			so references whose lower bound exceeds the smallest such bound over all threads are skipped,
+			and the other alignments are abandoned as soon as they exceed it.
+		*/
+		autoINTVEC order = newINTVECraw (numberOfReferences);
+		for (integer iref = 1; iref <= numberOfReferences; iref ++)
+			order [iref] = iref;
+		std::sort (order.begin(), order.end(), [&] (integer a, integer b) {
+			return lowerBounds [a] < lowerBounds [b] || (lowerBounds [a] == lowerBounds [b] && a < b);
+		});
+		std::atomic <integer> numberOfReferencesHandedOut (0);
+		std::atomic <double> sharedBound (DTW_BIG);
+		MelderThread_run (numberOfThreads, [&] (integer ithread) {
+			const MATVU delta = deltas.horizontalBand (4 * ithread - 3, 4 * ithread);
+			const MATVU z = distances.horizontalBand (4 * ithread - 3, 4 * ithread);
+			const INTMATVU psi = directions.horizontalBand (4 * ithread - 3, 4 * ithread);
+			const integer frameOffset = (ithread - 1) * maximumNumberOfFrames;
+			const VEC best = bestDistances.row (ithread);
+			const INTVEC bestReference = bestReferences.row (ithread);
+			integer& numberOfBestInThread = numberOfBest [ithread];
+			for (;;) {
+				const integer iorder = ++ numberOfReferencesHandedOut;
+				if (iorder > numberOfReferences)
+					break;
+				const integer iref = order [iorder];
+				const double bound = sharedBound. load ();
+				if (lowerBounds [iref] * (1.0 - 1e-12) > bound)
+					continue;
+				const Matrix reference = references -> at [iref];
+				for (integer j = 1; j <= reference -> nx; j ++)
+					for (integer k = 1; k <= numberOfCoefficients; k ++)
+						referenceFrames [frameOffset + j] [k] = reference -> z [k] [j];
+				const double distance = DTW_getWeightedDistance_rolling (reaches [iref], localSlope,
+					[&] (integer i, integer j) {
+						return DTW_frameDistance (& queryFrames [i] [1], & referenceFrames [frameOffset + j] [1], numberOfCoefficients, metric);
+					}, ( bound < DTW_BIG ? bound : undefined ), delta, z, psi
+				);
+				if (isundef (distance))
+					continue;
+				/*
+					Insert into this thread's best matches, which are sorted by distance and then by reference number.
+				*/
+				if (numberOfBestInThread == numberOfMatches &&
+						(distance > best [numberOfMatches] || (distance == best [numberOfMatches] && iref > bestReference [numberOfMatches])))
+					continue;
+				integer position = std::min (numberOfBestInThread + 1, numberOfMatches);
+				for (; position > 1; position --) {
+					const integer previous = position - 1;
+					if (best [previous] < distance || (best [previous] == distance && bestReference [previous] < iref))
+						break;
+					best [position] = best [previous];
+					bestReference [position] = bestReference [previous];
+				}
+				best [position] = distance;
+				bestReference [position] = iref;
+				if (numberOfBestInThread < numberOfMatches)
+					numberOfBestInThread ++;
+				if (numberOfBestInThread == numberOfMatches) {
+					double current = sharedBound. load ();
+					while (best [numberOfMatches] < current && ! sharedBound. compare_exchange_weak (current, best [numberOfMatches])) { }
+				}
+			}
+		});
+
+		/*
+			Merge the best matches of all threads.
+		*/
+		integer numberOfCandidates = 0;
+		for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+			numberOfCandidates += numberOfBest [ithread];
+		autoVEC candidateDistances = newVECraw (numberOfCandidates);
+		autoINTVEC candidateReferences = newINTVECraw (numberOfCandidates), ranking = newINTVECraw (numberOfCandidates);
+		integer icandidate = 0;
+		for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+			for (integer ibest = 1; ibest <= numberOfBest [ithread]; ibest ++) {
+				candidateDistances [++ icandidate] = bestDistances [ithread] [ibest];
+				candidateReferences [icandidate] = bestReferences [ithread] [ibest];
+				ranking [icandidate] = icandidate;
+			}
+		std::sort (ranking.begin(), ranking.end(), [&] (integer a, integer b) {
+			return candidateDistances [a] < candidateDistances [b] ||
+				(candidateDistances [a] == candidateDistances [b] && candidateReferences [a] < candidateReferences [b]);
+		});
+		Melder_assert (numberOfCandidates >= numberOfMatches);
+		autoTable thee = Table_createWithColumnNames (numberOfMatches, U"rank reference name distance");
+		for (integer irank = 1; irank <= numberOfMatches; irank ++) {
+			const integer iref = candidateReferences [ranking [irank]];
+			const Matrix reference = references -> at [iref];
+			Table_setNumericValue (thee.get(), irank, 1, irank);
+			Table_setNumericValue (thee.get(), irank, 2, iref);
+			Table_setStringValue (thee.get(), irank, 3, reference -> name ? reference -> name.get() : U"");
+			Table_setNumericValue (thee.get(), irank, 4, candidateDistances [ranking [irank]]);
+		}
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (query, U": no DTW search done.");
+	}
+}
+
 /* End of file DTW.cpp */
@@ -28,6 +28,7 @@
 #include "Pitch.h"
 #include "DurationTier.h"
 #include "Sound.h"
+#include "Table.h"
 
 #include "DTW_def.h"
 
@@ -115,6 +116,25 @@ autoMatrix DTW_Polygon_to_Matrix_cumulativeDistances (DTW me, Polygon thee, int
 
 autoDTW Matrices_to_DTW (Matrix me, Matrix thee, bool matchStart, bool matchEnd, int slope, double metric);
 
+double Matrices_getDTWDistance (Matrix me, Matrix thee, double sakoeChibaBand, int localSlope, double metric, double abandonAbove);
+double Matrices_Polygon_getDTWDistance (Matrix me, Matrix thee, Polygon him, int localSlope, double metric, double abandonAbove);
+/*
+	The weighted distance of the path that Matrices_to_DTW followed by DTW_findPath_bandAndSlope
+	(or DTW_Polygon_findPathInside) would find, without creating the DTW:
+	distances are only computed inside the band or polygon and memory is linear in the number of frames.
+	Returns undefined as soon as the distance is certain to exceed abandonAbove
+	(use abandonAbove = undefined to always get the distance).
+*/
+
+autoTable Matrices_searchDTW (Matrix query, OrderedOf<structMatrix> *references, double sakoeChibaBand, int localSlope, double metric, integer numberOfBestMatches);
+/*
+	Ranks the references by their Matrices_getDTWDistance from the query (the query on the y-axis),
+	in a Table with the columns "rank", "reference" (the number in the list), "name" and "distance",
+	and with at most numberOfBestMatches rows (numberOfBestMatches = 0: all references).
+	References whose LB_Keogh lower bound already exceeds the distance of the worst of the best matches so far
+	are skipped; the others are aligned in parallel, with early abandoning, without creating DTW objects.
+*/
+
 autoDTW Spectrograms_to_DTW (Spectrogram me, Spectrogram thee, bool matchStart, bool matchEnd, int slope, double metric);
 
 autoDTW Pitches_to_DTW (Pitch me, Pitch thee, double vuv_costs, double time_weight, bool matchStart, bool matchEnd, int slope);
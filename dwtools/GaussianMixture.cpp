@@ -21,6 +21,7 @@
 */
 #include "Distributions_and_Strings.h"
 #include "GaussianMixture.h"
+#include "MelderThread.h"
 #include "NUMmachar.h"
 #include "NUM2.h"
 #include "Strings_extensions.h"
@@ -155,6 +156,137 @@ static void GaussianMixture_getResponsibilities (GaussianMixture me, constMATVU
 	MATnormalizeRows_inplace (responsibilities, 1.0, 1.0);
 }
 
+/*
+	The E-step and the M-step visit the data in blocks of rows; the blocks are divided over threads.
+*/
+constexpr integer GaussianMixture_BLOCK_SIZE = 256;
+
+static integer GaussianMixture_getNumberOfBlocks (integer numberOfRows) {
+	return (numberOfRows + GaussianMixture_BLOCK_SIZE - 1) / GaussianMixture_BLOCK_SIZE;
+}
+
+static void GaussianMixture_getBlockRows (integer iblock, integer numberOfRows, integer *out_firstRow, integer *out_numberOfRowsInBlock) {
+	*out_firstRow = (iblock - 1) * GaussianMixture_BLOCK_SIZE + 1;
+	*out_numberOfRowsInBlock = std::min (GaussianMixture_BLOCK_SIZE, numberOfRows - *out_firstRow + 1);
+}
+
+/*
+	probabilities [irow] [component] = N (data [irow] | mu [component], S [component]).
+	The inverse Cholesky factor and the log determinant of each component are computed once, before the rows are visited.
+	The squared Mahalanobis distances of a block of rows are the row sums of squares of the product (X - mu) . L^-T,
+	where L^-1 is the lower-triangular inverse of the Cholesky factor of S.
+*/
+static void GaussianMixture_getComponentProbabilities (GaussianMixture me, constMATVU const& data, integer componentToUpdate, MATVU const& probabilities) {
+	const integer numberOfRows = data.nrow, dimension = my dimension;
+	Melder_assert (data.ncol == dimension && probabilities.nrow == numberOfRows && probabilities.ncol == my numberOfComponents);
+	const integer fromComponent = componentToUpdate == 0 ? 1 : componentToUpdate;
+	const integer toComponent = componentToUpdate == 0 ? my numberOfComponents : componentToUpdate;
+	const double ln2pid = dimension * log (NUM2pi);
+
+	autoMAT inverseFactors = newMATzero ((toComponent - fromComponent + 1) * dimension, dimension);
+	auto inverseFactor = [&] (integer component) {
+		return inverseFactors.horizontalBand ((component - fromComponent) * dimension + 1, (component - fromComponent + 1) * dimension);
+	};
+	for (integer component = fromComponent; component <= toComponent; component ++) {
+		const Covariance covi = my covariances->at [component];
+		SSCP_expandLowerCholeskyInverse (covi);
+		MATVU inverseFactor_component = inverseFactor (component);
+		if (covi -> numberOfRows == 1)
+			inverseFactor_component.row (1) <<= covi -> lowerCholeskyInverse.row (1);   // the inverse standard deviations
+		else
+			for (integer irow = 1; irow <= dimension; irow ++)
+				for (integer icol = 1; icol <= irow; icol ++)
+					inverseFactor_component [icol] [irow] = covi -> lowerCholeskyInverse [irow] [icol];
+	}
+
+	const integer numberOfBlocks = GaussianMixture_getNumberOfBlocks (numberOfRows);
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfBlocks, 4);
+	autoMAT differences = newMATraw (numberOfThreads * GaussianMixture_BLOCK_SIZE, dimension);
+	autoMAT transformed = newMATraw (numberOfThreads * GaussianMixture_BLOCK_SIZE, dimension);
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		const integer threadOffset = (ithread - 1) * GaussianMixture_BLOCK_SIZE;
+		integer firstBlock, lastBlock;
+		MelderThread_getRange (numberOfBlocks, numberOfThreads, ithread, & firstBlock, & lastBlock);
+		for (integer iblock = firstBlock; iblock <= lastBlock; iblock ++) {
+			integer firstRow, numberOfRowsInBlock;
+			GaussianMixture_getBlockRows (iblock, numberOfRows, & firstRow, & numberOfRowsInBlock);
+			MATVU blockDifferences = differences.horizontalBand (threadOffset + 1, threadOffset + numberOfRowsInBlock);
+			MATVU blockTransformed = transformed.horizontalBand (threadOffset + 1, threadOffset + numberOfRowsInBlock);
+			for (integer component = fromComponent; component <= toComponent; component ++) {
+				const Covariance covi = my covariances->at [component];
+				constMATVU inverseFactor_component = inverseFactor (component);
+				for (integer i = 1; i <= numberOfRowsInBlock; i ++)
+					blockDifferences.row (i) <<= data.row (firstRow - 1 + i)  -  covi -> centroid.get();
+				if (covi -> numberOfRows == 1) {
+					for (integer i = 1; i <= numberOfRowsInBlock; i ++)
+						blockTransformed.row (i) <<= blockDifferences.row (i)  *  inverseFactor_component.row (1);
+				} else
+					MATmul_fast (blockTransformed, blockDifferences, inverseFactor_component);
+				for (integer i = 1; i <= numberOfRowsInBlock; i ++) {
+					const double dsq = NUMsum2 (blockTransformed.row (i));
+					probabilities [firstRow - 1 + i] [component] = std::max (1e-300, exp (- 0.5 * (ln2pid + covi -> lnd + dsq))); // prevent probabilities from being zero
+				}
+			}
+		}
+	});
+}
+
+/*
+	The sum over the rows of the data of weight [irow] * (x [irow] - about), and,
+	if `weightedSquares` is not empty, of weight [irow] * (x [irow] - about) (x [irow] - about)',
+	or only of its diagonal if `weightedSquares` has a single row.
+	The squares of a block of rows are a single matrix product; the partial sums of the threads are added in thread order.
+*/
+static void GaussianMixture_getWeightedMoments (constMATVU const& data, constVECVU const& weights, constVECVU const& about,
+	VECVU const& weightedSum, MATVU const& weightedSquares)
+{
+	const integer numberOfRows = data.nrow, dimension = data.ncol;
+	Melder_assert (weights.size == numberOfRows && about.size == dimension && weightedSum.size == dimension);
+	const integer numberOfRowsOfSquares = weightedSquares.nrow;
+	Melder_assert (numberOfRowsOfSquares == 0 || numberOfRowsOfSquares == 1 || numberOfRowsOfSquares == dimension);
+
+	const integer numberOfBlocks = GaussianMixture_getNumberOfBlocks (numberOfRows);
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfBlocks, 4);
+	autoMAT differences = newMATraw (numberOfThreads * GaussianMixture_BLOCK_SIZE, dimension);
+	autoMAT weighted = newMATraw (numberOfThreads * GaussianMixture_BLOCK_SIZE, dimension);
+	autoMAT partialSums = newMATzero (numberOfThreads, dimension);
+	autoMAT partialSquares = newMATzero (numberOfThreads * numberOfRowsOfSquares, dimension);
+	autoMAT products = newMATraw (( numberOfRowsOfSquares > 1 ? numberOfThreads * dimension : 0 ), dimension);
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		const integer threadOffset = (ithread - 1) * GaussianMixture_BLOCK_SIZE;
+		VEC threadSum = partialSums.row (ithread);
+		integer firstBlock, lastBlock;
+		MelderThread_getRange (numberOfBlocks, numberOfThreads, ithread, & firstBlock, & lastBlock);
+		for (integer iblock = firstBlock; iblock <= lastBlock; iblock ++) {
+			integer firstRow, numberOfRowsInBlock;
+			GaussianMixture_getBlockRows (iblock, numberOfRows, & firstRow, & numberOfRowsInBlock);
+			MATVU blockDifferences = differences.horizontalBand (threadOffset + 1, threadOffset + numberOfRowsInBlock);
+			MATVU blockWeighted = weighted.horizontalBand (threadOffset + 1, threadOffset + numberOfRowsInBlock);
+			for (integer i = 1; i <= numberOfRowsInBlock; i ++) {
+				blockDifferences.row (i) <<= data.row (firstRow - 1 + i)  -  about;
+				blockWeighted.row (i) <<= blockDifferences.row (i)  *  weights [firstRow - 1 + i];
+				threadSum  +=  blockWeighted.row (i);
+			}
+			if (numberOfRowsOfSquares == 1) {
+				for (integer i = 1; i <= numberOfRowsInBlock; i ++)
+					partialSquares.row (ithread)  +=  blockWeighted.row (i)  *  blockDifferences.row (i);
+			} else if (numberOfRowsOfSquares > 1) {
+				MATVU product = products.horizontalBand ((ithread - 1) * dimension + 1, ithread * dimension);
+				MATmul_fast (product, blockWeighted.transpose(), blockDifferences);
+				partialSquares.horizontalBand ((ithread - 1) * dimension + 1, ithread * dimension)  +=  product;
+			}
+		}
+	});
+	weightedSum  <<=  0.0;
+	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+		weightedSum  +=  partialSums.row (ithread);
+	if (numberOfRowsOfSquares > 0) {
+		weightedSquares  <<=  0.0;
+		for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+			weightedSquares  +=  partialSquares.horizontalBand ((ithread - 1) * numberOfRowsOfSquares + 1, ithread * numberOfRowsOfSquares);
+	}
+}
+
 static void GaussianMixture_updateComponent (GaussianMixture me, integer component, MATVU const& data, MATVU const& responsibilities) {
 	integer numberOfData = data.nrow;
 	Melder_require (my dimension == data.ncol,
@@ -167,35 +299,18 @@ static void GaussianMixture_updateComponent (GaussianMixture me, integer compone
 		U"The component number should be in the range from 1 to ", my numberOfComponents, U".");
 	
 	const Covariance thee = my covariances->at [component];
+	const double totalComponentResponsibility = NUMsum (responsibilities.column (component));
 	/*
 		Update the means: Bishop eq. 9.24
 	*/
-	thy centroid.get() <<= 0.0;
-	for (integer irow = 1; irow <= numberOfData; irow ++)
-		thy centroid.get()  +=  responsibilities [irow] [component]  *  data.row (irow);
-	
-	const double totalComponentResponsibility = NUMsum (responsibilities.column (component));
+	autoVEC origin = newVECzero (thy numberOfColumns);
+	GaussianMixture_getWeightedMoments (data, responsibilities.column (component), origin.get(), thy centroid.get(), MATVU ());
 	thy centroid.get ()  /=  totalComponentResponsibility;
 	/*
 		update covariance with the new mean: Bishop eq. 9.25
 	*/
-	thy data.get() <<= 0.0;
-	autoVEC dif = newVECraw (thy numberOfColumns);
-	if (thy numberOfRows == 1) { // 1xn covariance
-		autoVEC variance = newVECraw (thy numberOfColumns);
-		for (integer irow = 1; irow <= numberOfData; irow ++) {
-			dif.get() <<= data.row (irow)  -  thy centroid.get();
-			variance.get() <<= dif.get()  *  dif.get();
-			thy data.row (1)  +=  responsibilities [irow] [component]  *  variance.get();
-		}
-	} else { // nxn covariance
-		autoMAT covar = newMATraw (thy numberOfColumns, thy numberOfColumns);
-		for (integer irow = 1; irow <= numberOfData; irow ++) {
-			dif.get() <<= data.row (irow)  -  thy centroid.get();
-			MATouter (covar.get(), dif.get(), dif.get());
-			thy data.get()  +=  responsibilities [irow] [component]  *  covar.get();
-		}
-	}
+	autoVEC weightedDifferenceSum = newVECraw (thy numberOfColumns);
+	GaussianMixture_getWeightedMoments (data, responsibilities.column (component), thy centroid.get(), weightedDifferenceSum.get(), thy data.get());
 	thy data.get()  /=  totalComponentResponsibility;
 	thy numberOfObservations = my mixingProbabilities [component] * numberOfData;
 }
@@ -798,20 +913,7 @@ void GaussianMixture_TableOfReal_getComponentProbabilities (GaussianMixture me,
 			U"The number of columns in the TableOfReal and the dimension of the GaussianMixture should be equal.");
 		Melder_require (componentToUpdate >= 0 && componentToUpdate <= my numberOfComponents,
 			U"The component number should be in the interval from 0 to ", my numberOfComponents);
-		const double ln2pid = my dimension * log (NUM2pi);
-
-		const integer fromComponent = componentToUpdate == 0 ? 1 : componentToUpdate;
-		const integer toComponent = componentToUpdate == 0 ? my numberOfComponents : componentToUpdate;
-		
-		for (integer component = fromComponent; component <= toComponent; component ++) {
-			const Covariance covi = my covariances->at [component];
-			SSCP_expandLowerCholeskyInverse (covi);
-
-			for (integer irow = 1; irow <= thy numberOfRows; irow++) {
-				const double dsq = NUMmahalanobisDistanceSquared (covi -> lowerCholeskyInverse.get(), thy data.row (irow), covi -> centroid.get());
-				probabilities [irow] [component] = std::max (1e-300, exp (- 0.5 * (ln2pid + covi -> lnd + dsq))); // prevent probabilities from being zero
-			}
-		}
+		GaussianMixture_getComponentProbabilities (me, thy data.get(), componentToUpdate, probabilities);
 	} catch (MelderError) {
 		Melder_throw (me, U" & ", thee, U": no component probabilies could be calculated.");
 	}
@@ -868,6 +970,15 @@ void GaussianMixture_unExpandPCA (GaussianMixture me) {
 	}
 }
 
+// During EM, covariances were underestimated by a factor of (n-1)/n. Correction now.
+static void GaussianMixture_correctCovariances (GaussianMixture me) {
+	for (integer component = 1; component <= my numberOfComponents; component ++) {
+		const Covariance cov = my covariances->at [component];
+		if (cov -> numberOfObservations > 1.5)
+			cov -> data.row (1)  *=  cov -> numberOfObservations / (cov -> numberOfObservations - 1.0);
+	}
+}
+
 void GaussianMixture_TableOfReal_improveLikelihood (GaussianMixture me, TableOfReal thee, double delta_lnp, integer maxNumberOfIterations, double lambda, kGaussianMixtureCriterion criterion) {
 	try {
 		Melder_require (thy numberOfColumns == my dimension,
@@ -924,20 +1035,101 @@ void GaussianMixture_TableOfReal_improveLikelihood (GaussianMixture me, TableOfR
 		} catch (MelderError) {
 			Melder_clearError ();
 		}
+		GaussianMixture_correctCovariances (me);
+	} catch (MelderError) {
+		Melder_throw (me, U" & ", thee, U": likelihood cannot be improved.");
+	}
+}
 
-		// During EM, covariances were underestimated by a factor of (n-1)/n. Correction now.
 
-		for (integer component = 1; component <= my numberOfComponents; component ++) {
-			const Covariance cov = my covariances->at [component];
-			if (cov -> numberOfObservations > 1.5)
-				cov -> data.row (1)  *=  cov -> numberOfObservations / (cov -> numberOfObservations - 1.0);
+void GaussianMixture_TableOfReal_improveLikelihood_miniBatch (GaussianMixture me, TableOfReal thee, integer batchSize, integer numberOfEpochs, double lambda) {
+	try {
+		Melder_require (thy numberOfColumns == my dimension,
+			U"The number of columns and the dimension of the model should agree.");
+		Melder_require (my numberOfComponents < thy numberOfRows / 2,
+			U"Not enough data points.");
+		Melder_require (batchSize > my numberOfComponents,
+			U"The batch size should be larger than the number of components.");
+		const integer numberOfRows = thy numberOfRows, dimension = my dimension;
+		batchSize = std::min (batchSize, numberOfRows);
+		const integer numberOfBatchesPerEpoch = numberOfRows / batchSize;   // a last incomplete batch is skipped
+		const integer numberOfRowsOfCovariance = my covariances->at [1] -> numberOfRows;
+
+		autoCovariance covg = TableOfReal_to_Covariance (thee);
+		autoINTVEC order = newINTVECraw (numberOfRows);
+		for (integer irow = 1; irow <= numberOfRows; irow ++)
+			order [irow] = irow;
+		autoMAT batch = newMATraw (batchSize, dimension);
+		autoMAT probabilities = newMATraw (batchSize, my numberOfComponents);
+		autoMAT responsibilities = newMATraw (batchSize, my numberOfComponents);
+		autoVEC origin = newVECzero (dimension);
+		/*
+			The sufficient statistics per datum: responsibility, responsibility * x, and responsibility * x x'.
+		*/
+		autoVEC s0 = newVECzero (my numberOfComponents);
+		autoMAT s1 = newMATzero (my numberOfComponents, dimension);
+		autoMAT s2 = newMATzero (my numberOfComponents * numberOfRowsOfCovariance, dimension);
+		autoVEC batchSum = newVECraw (dimension);
+		autoMAT batchSquares = newMATraw (numberOfRowsOfCovariance, dimension);
+
+		autoMelderProgress progress (U"Improve likelihood (mini-batch)...");
+		integer numberOfSteps = 0;
+		for (integer iepoch = 1; iepoch <= numberOfEpochs; iepoch ++) {
+			for (integer irow = numberOfRows; irow > 1; irow --)
+				std::swap (order [irow], order [NUMrandomInteger (1, irow)]);
+			for (integer ibatch = 1; ibatch <= numberOfBatchesPerEpoch; ibatch ++) {
+				for (integer i = 1; i <= batchSize; i ++)
+					batch.row (i) <<= thy data.row (order [(ibatch - 1) * batchSize + i]);
+				/*
+					E-step on the batch
+				*/
+				GaussianMixture_getComponentProbabilities (me, batch.get(), 0, probabilities.get());
+				GaussianMixture_getResponsibilities (me, probabilities.get(), 0, responsibilities.get());
+				/*
+					Interpolate the statistics with step size (t + 1)^-0.7 (the first batch replaces them).
+				*/
+				const double eta = pow (numberOfSteps + 1.0, -0.7);
+				numberOfSteps ++;
+				for (integer component = 1; component <= my numberOfComponents; component ++) {
+					GaussianMixture_getWeightedMoments (batch.get(), responsibilities.column (component), origin.get(),
+							batchSum.get(), batchSquares.get());
+					MATVU s2_component = s2.horizontalBand ((component - 1) * numberOfRowsOfCovariance + 1, component * numberOfRowsOfCovariance);
+					s0 [component] = (1.0 - eta) * s0 [component] + eta * NUMsum (responsibilities.column (component)) / batchSize;
+					s1.row (component)  *=  1.0 - eta;
+					s1.row (component)  +=  batchSum.get()  *  (eta / batchSize);
+					s2_component  *=  1.0 - eta;
+					s2_component  +=  batchSquares.get()  *  (eta / batchSize);
+				}
+				/*
+					M-step from the statistics. Components without support keep their parameters.
+				*/
+				for (integer component = 1; component <= my numberOfComponents; component ++) {
+					if (s0 [component] <= 0.0)
+						continue;
+					const Covariance cov = my covariances->at [component];
+					cov -> centroid.get() <<= s1.row (component)  *  (1.0 / s0 [component]);
+					constMATVU s2_component = s2.horizontalBand ((component - 1) * numberOfRowsOfCovariance + 1, component * numberOfRowsOfCovariance);
+					cov -> data.get() <<= s2_component  *  (1.0 / s0 [component]);
+					if (numberOfRowsOfCovariance == 1)
+						cov -> data.row (1)  -=  cov -> centroid.get()  *  cov -> centroid.get();
+					else
+						for (integer irow = 1; irow <= dimension; irow ++)
+							cov -> data.row (irow)  -=  cov -> centroid.get()  *  cov -> centroid [irow];
+					GaussianMixture_addCovarianceFraction (me, component, covg.get(), lambda);
+				}
+				my mixingProbabilities.get() <<= s0.get();
+				VECnormalize_inplace (my mixingProbabilities.get(), 1.0, 1.0);
+				for (integer component = 1; component <= my numberOfComponents; component ++)
+					my covariances->at [component] -> numberOfObservations = my mixingProbabilities [component] * numberOfRows;
+			}
+			Melder_progress ((double) iepoch / numberOfEpochs, U"Epoch ", iepoch, U" of ", numberOfEpochs);
 		}
+		GaussianMixture_correctCovariances (me);
 	} catch (MelderError) {
 		Melder_throw (me, U" & ", thee, U": likelihood cannot be improved.");
 	}
 }
 
-
 double GaussianMixture_TableOfReal_getLikelihoodValue (GaussianMixture me, TableOfReal thee, kGaussianMixtureCriterion criterion) {
 	autoMAT probabilities = newMATraw (thy numberOfRows, my numberOfComponents);
 	GaussianMixture_TableOfReal_getComponentProbabilities (me, thee, 0, probabilities.get());
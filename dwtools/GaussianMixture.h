@@ -96,6 +96,14 @@ autoGaussianMixture TableOfReal_to_GaussianMixture (TableOfReal me, integer numb
 
 void GaussianMixture_TableOfReal_improveLikelihood (GaussianMixture me, TableOfReal thee, double delta_lnp, integer maxNumberOfIterations, double lambda, kGaussianMixtureCriterion criterion);
 
+/*
+	Stepwise EM for tables that are too large for many passes of standard EM (Liang & Klein, 2009).
+	Each epoch visits the rows in a new random order, in batches of batchSize rows. After each batch the per-datum
+	sufficient statistics s are updated as s := (1 - eta) s + eta s_batch, with eta = (t + 1)^-0.7 for the t-th batch,
+	and the parameters are reestimated from s.
+*/
+void GaussianMixture_TableOfReal_improveLikelihood_miniBatch (GaussianMixture me, TableOfReal thee, integer batchSize, integer numberOfEpochs, double lambda);
+
 /*
 	Learn a GaussiamMixture from multivariate data (unsupervised).
 	1) it is capable of selecting the number of components and 
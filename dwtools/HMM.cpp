@@ -22,6 +22,7 @@
 #include "Distributions_and_Strings.h"
 #include "HMM.h"
 #include "Index.h"
+#include "MelderThread.h"
 #include "NUM2.h"
 #include "Strings_extensions.h"
 
@@ -81,7 +82,6 @@ autoHMMBaumWelch HMMBaumWelch_create (integer nstates, integer nsymbols, integer
 void HMMBaumWelch_getGamma (HMMBaumWelch me);
 autoHMMBaumWelch HMM_forward (HMM me, constINTVEC obs);
 void HMMBaumWelch_reInit (HMMBaumWelch me);
-void HMM_HMMBaumWelch_getXi (HMM me, HMMBaumWelch thee, constINTVEC obs);
 void HMM_HMMBaumWelch_reestimate (HMM me, HMMBaumWelch thee);
 void HMM_HMMBaumWelch_addEstimate (HMM me, HMMBaumWelch thee, constINTVEC obs);
 void HMM_HMMBaumWelch_forward (HMM me, HMMBaumWelch thee, constINTVEC obs);
@@ -243,17 +243,21 @@ autoHMMBaumWelch HMMBaumWelch_create (integer nstates, integer nsymbols, integer
 		my numberOfTimes = my capacity = capacity;
 		my numberOfStates = nstates;
 		my numberOfSymbols = nsymbols;
-		my alpha = newMATzero (nstates, capacity);
-		my beta = newMATzero (nstates, capacity);
+		my alpha = newMATzero (capacity, nstates);
+		my beta = newMATzero (capacity, nstates);
 		my scale = newVECzero (capacity);
-		my xi = newTEN3zero (capacity, nstates, nstates); // TEN3
+		my firstReachableState = newINTVECzero (nstates);
+		my lastReachableState = newINTVECzero (nstates);
+		my work = newVECzero (nstates);
+		my gammaSum = newVECzero (nstates);
+		my xiSum = newMATzero (nstates, nstates);
 		my aij_num_p0 = newVECzero (nstates + 1);
 		my aij_num = newMATzero (nstates, nstates + 1);
 		my aij_denom_p0 = newVECzero (nstates + 1);
 		my aij_denom =  newMATzero (nstates, nstates + 1);
 		my bik_num = newMATzero (nstates, nsymbols);
 		my bik_denom = newMATzero (nstates, nsymbols);
-		my gamma = newMATzero (nstates, capacity);
+		my gamma = newMATzero (capacity, nstates);
 		return me;
 	} catch (MelderError) {
 		Melder_throw (U"HMMBaumWelch not created.");
@@ -262,11 +266,27 @@ autoHMMBaumWelch HMMBaumWelch_create (integer nstates, integer nsymbols, integer
 
 void HMMBaumWelch_getGamma (HMMBaumWelch me) {
 	for (integer it = 1; it <= my numberOfTimes; it ++) {
-		my gamma.column (it) <<= my alpha.column (it)  *  my beta.column (it);
-		my gamma.column (it)  /=  NUMsum (my gamma.column (it));
+		my gamma.row (it) <<= my alpha.row (it)  *  my beta.row (it);
+		my gamma.row (it)  /=  NUMsum (my gamma.row (it));
 	}
 }
 
+/*
+	Add the accumulated estimates of thee to mine,
+	so that the E-step can be distributed over several HMMBaumWelch objects.
+*/
+static void HMMBaumWelch_addEstimates (HMMBaumWelch me, HMMBaumWelch thee) {
+	Melder_assert (thy numberOfStates == my numberOfStates && thy numberOfSymbols == my numberOfSymbols);
+	my totalNumberOfSequences += thy totalNumberOfSequences;
+	my lnProb += thy lnProb;
+	my aij_num_p0.get()  +=  thy aij_num_p0.get();
+	my aij_num.get()  +=  thy aij_num.get();
+	my aij_denom_p0.get()  +=  thy aij_denom_p0.get();
+	my aij_denom.get()  +=  thy aij_denom.get();
+	my bik_num.get()  +=  thy bik_num.get();
+	my bik_denom.get()  +=  thy bik_denom.get();
+}
+
 /**************** HMMViterbi ******************************/
 
 autoHMMViterbi HMMViterbi_create (integer nstates, integer ntimes) {
@@ -792,6 +812,7 @@ autoHMMObservationSequence HMM_to_HMMObservationSequence (HMM me, integer startS
 autoHMMBaumWelch HMM_forward (HMM me, constINTVEC obs) {
 	try {
 		autoHMMBaumWelch thee = HMMBaumWelch_create (my numberOfStates, my numberOfObservationSymbols, obs.size);
+		thy numberOfTimes = obs.size;
 		HMM_HMMBaumWelch_forward (me, thee.get(), obs);
 		return thee;
 	} catch (MelderError) {
@@ -816,7 +837,7 @@ void HMMBaumWelch_reInit (HMMBaumWelch me) {
 	/*
 		The _num and _denum matrices are asigned as += in the iteration loop and therefore need to be zeroed
 		at the start of each new iteration.
-		The elements of alpha, beta, scale, gamma & xi are always calculated directly and need not be
+		The elements of alpha, beta, scale, gamma & xiSum are always calculated directly and need not be
 		initialised.
 	*/
 	my aij_num_p0.get () <<= 0.0;
@@ -934,48 +955,77 @@ void HMM_HMMObservationSequenceBag_learn (HMM me, HMMObservationSequenceBag thee
 			HMM_HMMObservationSequenceBag_learn_notHidden (me, thee, minProb);
 			return;
 		}
-		// act as if all observation sequences are in memory
+		/*
+			Translate the observation sequences to symbol indices once.
+			Interpretation of unknowns: end of sequence.
+			The resulting subsequences are the independent pieces of work of the E-step.
+		*/
+		OrderedOf<structStringsIndex> indices;
+		integer numberOfSubsequences = 0;
+		for (integer iseq = 1; iseq <= thy size; iseq ++) {
+			autoStringsIndex si = HMM_HMMObservationSequence_to_StringsIndex (me, thy at [iseq]);
+			constINTVEC obs = si -> classIndex.get();
+			for (integer it = 1; it <= obs.size; it ++)
+				if (obs [it] != 0 && (it == 1 || obs [it - 1] == 0))
+					numberOfSubsequences ++;
+			indices. addItem_move (si.move());
+		}
+		Melder_require (numberOfSubsequences > 0,
+			U"There should be at least one known observation.");
+		autoINTVEC subsequenceIndex = newINTVECraw (numberOfSubsequences);
+		autoINTVEC subsequenceStart = newINTVECraw (numberOfSubsequences), subsequenceEnd = newINTVECraw (numberOfSubsequences);
+		integer isub = 0;
+		for (integer iseq = 1; iseq <= thy size; iseq ++) {
+			constINTVEC obs = indices.at [iseq] -> classIndex.get();
+			for (integer it = 1; it <= obs.size; it ++) {
+				if (obs [it] != 0 && (it == 1 || obs [it - 1] == 0)) {
+					subsequenceIndex [++ isub] = iseq;
+					subsequenceStart [isub] = it;
+				}
+				if (obs [it] != 0 && (it == obs.size || obs [it + 1] == 0))
+					subsequenceEnd [isub] = it;
+			}
+		}
+		/*
+			Each thread accumulates its subsequences in its own HMMBaumWelch;
+			these are added in thread order before the reestimation.
+		*/
 		const integer capacity = HMMObservationSequenceBag_getLongestSequence (thee);
-		autoHMMBaumWelch bw = HMMBaumWelch_create (my numberOfStates, my numberOfObservationSymbols, capacity);
-		bw -> minProb = minProb;
+		const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfSubsequences, 4);
+		OrderedOf<structHMMBaumWelch> threadBaumWelches;
+		for (integer ithread = 1; ithread <= numberOfThreads; ithread ++) {
+			autoHMMBaumWelch threadBaumWelch = HMMBaumWelch_create (my numberOfStates, my numberOfObservationSymbols, capacity);
+			threadBaumWelch -> minProb = minProb;
+			threadBaumWelches. addItem_move (threadBaumWelch.move());
+		}
+		const HMMBaumWelch bw = threadBaumWelches.at [1];
 		if (info)
 			MelderInfo_open (); 
 		integer iter = 0;
 		double lnp;
 		do {
 			lnp = bw -> lnProb;
-			HMMBaumWelch_reInit (bw.get());
-			for (integer iseq = 1; iseq <= thy size; iseq ++) {
-				const HMMObservationSequence hmm_os = thy at [iseq];
-				autoStringsIndex si = HMM_HMMObservationSequence_to_StringsIndex (me, hmm_os); // TODO outside the loop or more efficiently
-				INTVEC obs = si -> classIndex.get();
-				const integer nobs = si -> numberOfItems; // convenience
-
-				// Interpretation of unknowns: end of sequence
-
-				integer istart = 1, iend = nobs;
-				while (istart <= nobs) {
-					while (istart <= nobs && obs [istart] == 0)
-						istart ++;
-					if (istart > nobs) break;
-
-					iend = istart + 1;
-					while (iend <= nobs && obs [iend] != 0)
-						iend ++;
-					iend --;
-					bw -> numberOfTimes = iend - istart + 1;
-					bw -> totalNumberOfSequences ++;
-					HMM_HMMBaumWelch_forward (me, bw.get(), obs.part (istart, nobs)); // get new alphas
-					HMM_HMMBaumWelch_backward (me, bw.get(), obs.part (istart, nobs)); // get new betas
-					HMMBaumWelch_getGamma (bw.get());
-					HMM_HMMBaumWelch_getXi (me, bw.get(), obs.part (istart, nobs));
-					HMM_HMMBaumWelch_addEstimate (me, bw.get(), obs.part (istart, nobs));
-					istart = iend + 1;
+			for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+				HMMBaumWelch_reInit (threadBaumWelches.at [ithread]);
+			MelderThread_run (numberOfThreads, [&] (integer ithread) {
+				const HMMBaumWelch threadBaumWelch = threadBaumWelches.at [ithread];
+				integer firstSubsequence, lastSubsequence;
+				MelderThread_getRange (numberOfSubsequences, numberOfThreads, ithread, & firstSubsequence, & lastSubsequence);
+				for (integer jsub = firstSubsequence; jsub <= lastSubsequence; jsub ++) {
+					constINTVEC obs = indices.at [subsequenceIndex [jsub]] -> classIndex.part (subsequenceStart [jsub], subsequenceEnd [jsub]);
+					threadBaumWelch -> numberOfTimes = obs.size;
+					threadBaumWelch -> totalNumberOfSequences ++;
+					HMM_HMMBaumWelch_forward (me, threadBaumWelch, obs); // get new alphas
+					HMM_HMMBaumWelch_backward (me, threadBaumWelch, obs); // get new betas
+					HMMBaumWelch_getGamma (threadBaumWelch);
+					HMM_HMMBaumWelch_addEstimate (me, threadBaumWelch, obs);
 				}
-			}
+			});
+			for (integer ithread = 2; ithread <= numberOfThreads; ithread ++)
+				HMMBaumWelch_addEstimates (bw, threadBaumWelches.at [ithread]);
 			// we have processed all observation sequences, now it is time to estimate new probabilities.
 			iter ++;
-			HMM_HMMBaumWelch_reestimate (me, bw.get());
+			HMM_HMMBaumWelch_reestimate (me, bw);
 			if (info)
 				MelderInfo_writeLine (U"Iteration: ", iter, U" ln(prob): ", bw -> lnProb);
 		} while (fabs (lnp - bw -> lnProb) > std::max (fabs (delta_lnp * bw -> lnProb), NUMeps));
@@ -1197,70 +1247,97 @@ void HMM_drawForwardAndBackwardProbabilitiesIllustration (Graphics g, bool garni
 	}
 }
 
-void HMM_HMMBaumWelch_getXi (HMM me, HMMBaumWelch thee, constINTVEC obs) {
-	Melder_assert (obs.size == thy numberOfTimes);
-	for (integer it = 1; it <= thy numberOfTimes - 1; it ++) {
-		longdouble sum = 0.0;
-		MATVU xi_it = thy xi [it];
-		for (integer is = 1; is <= thy numberOfStates; is ++) {
-			for (integer js = 1; js <= thy numberOfStates; js ++) {
-				xi_it [is] [js] = thy alpha [is] [it] * thy beta [js] [it + 1] *
-					my transitionProbs [is] [js] * my emissionProbs [js] [ obs [it + 1] ];
-				sum += xi_it [is] [js];
-			}
-		}
-		xi_it  /=  double (sum);
+/*
+	For each state the first and last state that it can make a transition to.
+	Zero transition probabilities are never reestimated, so for a left-to-right model the rows of
+	the transition matrix are narrow bands, and the recursions below only visit these bands.
+	A state without any transitions gets an empty band.
+*/
+static void HMM_getReachableStates (HMM me, INTVEC const& firstReachableState, INTVEC const& lastReachableState) {
+	for (integer is = 1; is <= my numberOfStates; is ++) {
+		constVEC transitionProbs = my transitionProbs.row (is).part (1, my numberOfStates);
+		integer first = 1, last = my numberOfStates;
+		while (first <= last && transitionProbs [first] == 0.0)
+			first ++;
+		while (last >= first && transitionProbs [last] == 0.0)
+			last --;
+		firstReachableState [is] = first;
+		lastReachableState [is] = last;
 	}
 }
 
+/*
+	The transitions are accumulated as the sum over time of xi_t(i,j) = alpha_t(i) a(i,j) b(j,o_t+1) beta_t+1(j) / P_t,
+	without ever storing the numberOfTimes x numberOfStates x numberOfStates xi tensor.
+*/
 void HMM_HMMBaumWelch_addEstimate (HMM me, HMMBaumWelch thee, constINTVEC obs) {
 	Melder_assert (obs.size == thy numberOfTimes);
-	for (integer is = 1; is <= my numberOfStates; is ++) {
+	const integer numberOfStates = my numberOfStates, numberOfTimes = thy numberOfTimes;
+	HMM_getReachableStates (me, thy firstReachableState.get(), thy lastReachableState.get());
+	for (integer is = 1; is <= numberOfStates; is ++) {
 		// only for valid start states with p > 0
 		if (my initialStateProbs [is] > 0.0) {
-			thy aij_num_p0 [is] += thy gamma [is] [1];
+			thy aij_num_p0 [is] += thy gamma [1] [is];
 			thy aij_denom_p0 [is] += 1.0;
 		}
 	}
-
-	for (integer is = 1; is <= my numberOfStates; is ++) {
-		double gammasum = NUMsum (thy gamma.row (is).part (1, thy numberOfTimes - 1));
-
-		for (integer js = 1; js <= my numberOfStates; js ++) {
-			longdouble xisum = 0.0;
-			for (integer it = 1; it <= thy numberOfTimes - 1; it ++)
-				xisum += thy xi [it] [is] [js];
+	thy xiSum.get() <<= 0.0;
+	thy gammaSum.get() <<= 0.0;
+	for (integer it = 1; it <= numberOfTimes - 1; it ++) {
+		constVEC alpha_it = thy alpha.row (it);
+		for (integer js = 1; js <= numberOfStates; js ++)
+			thy work [js] = my emissionProbs [js] [obs [it + 1]] * thy beta [it + 1] [js];
+		longdouble sum = 0.0;
+		for (integer is = 1; is <= numberOfStates; is ++) {
+			const integer first = thy firstReachableState [is], last = thy lastReachableState [is];
+			if (alpha_it [is] != 0.0 && first <= last)
+				sum += alpha_it [is] * NUMinner (my transitionProbs.row (is).part (first, last), thy work.part (first, last));
+		}
+		for (integer is = 1; is <= numberOfStates; is ++) {
+			const integer first = thy firstReachableState [is], last = thy lastReachableState [is];
+			if (alpha_it [is] == 0.0 || first > last)
+				continue;
+			const double alpha_is = alpha_it [is] / double (sum);
+			VEC xiSum_is = thy xiSum.row (is);
+			constVEC transitionProbs_is = my transitionProbs.row (is);
+			for (integer js = first; js <= last; js ++)
+				xiSum_is [js] += alpha_is * transitionProbs_is [js] * thy work [js];
+		}
+		thy gammaSum.get()  +=  thy gamma.row (it);
+	}
+	for (integer is = 1; is <= numberOfStates; is ++) {
+		for (integer js = thy firstReachableState [is]; js <= thy lastReachableState [is]; js ++) {
 			// zero probs signal invalid connections, don't reestimate
 			if (my transitionProbs [is] [js] > 0.0) {
-				thy aij_num [is] [js] += double (xisum);
-				thy aij_denom [is] [js] += gammasum;
-			}
-		}
-
-		/*
-			Only reestimate the emissionProbs for a hidden markov model.
-			A not hidden model is emulated with fixed emissionProbs.
-		*/
-		if (! my notHidden) {
-			gammasum += thy gamma [is] [thy numberOfTimes];   // now sum all, add last term
-			for (integer k = 1; k <= my numberOfObservationSymbols; k ++) {
-				longdouble gammasum_k = 0.0;
-				for (integer it = 1; it <= thy numberOfTimes; it ++)
-					if (obs [it] == k)
-						gammasum_k += thy gamma [is] [it];
-				// only reestimate probs > 0 !
-				if (my emissionProbs [is] [k] > 0.0) {
-					thy bik_num [is] [k] += double (gammasum_k);
-					thy bik_denom [is] [k] += gammasum;
-				}
+				thy aij_num [is] [js] += thy xiSum [is] [js];
+				thy aij_denom [is] [js] += thy gammaSum [is];
 			}
 		}
 		// For a left-to-right model the final state determines the transition prob to go to the END state
 		if (my leftToRight) {
-			thy aij_num [is] [my numberOfStates + 1] += thy gamma [is] [thy numberOfTimes];
-			thy aij_denom [is] [my numberOfStates + 1] += 1.0;
+			thy aij_num [is] [numberOfStates + 1] += thy gamma [numberOfTimes] [is];
+			thy aij_denom [is] [numberOfStates + 1] += 1.0;
 		}
 	}
+	/*
+		Only reestimate the emissionProbs for a hidden markov model.
+		A not hidden model is emulated with fixed emissionProbs.
+	*/
+	if (! my notHidden) {
+		thy gammaSum.get()  +=  thy gamma.row (numberOfTimes);   // now sum all, add last term
+		for (integer it = 1; it <= numberOfTimes; it ++) {
+			const integer k = obs [it];
+			constVEC gamma_it = thy gamma.row (it);
+			for (integer is = 1; is <= numberOfStates; is ++)
+				// only reestimate probs > 0 !
+				if (my emissionProbs [is] [k] > 0.0)
+					thy bik_num [is] [k] += gamma_it [is];
+		}
+		for (integer is = 1; is <= numberOfStates; is ++)
+			for (integer k = 1; k <= my numberOfObservationSymbols; k ++)
+				if (my emissionProbs [is] [k] > 0.0)
+					thy bik_denom [is] [k] += thy gammaSum [is];
+	}
 }
 
 void HMM_HMMBaumWelch_reestimate (HMM me, HMMBaumWelch thee) {
@@ -1305,28 +1382,37 @@ void HMM_HMMBaumWelch_reestimate (HMM me, HMMBaumWelch thee) {
 	}
 }
 
+/*
+	The scaled recursions of Rabiner (1989), vectorised over the states:
+	alpha_t is accumulated row by row of the transition matrix, skipping the zero bands and the unreachable states.
+	Each alpha_t (j) still receives its terms in the order of the states i, as in the textbook formula.
+*/
 void HMM_HMMBaumWelch_forward (HMM me, HMMBaumWelch thee, constINTVEC obs) {
+	Melder_assert (obs.size == thy numberOfTimes);
+	const integer numberOfStates = my numberOfStates;
+	HMM_getReachableStates (me, thy firstReachableState.get(), thy lastReachableState.get());
 	// initialise at t = 1 & scale
-	for (integer js = 1; js <= my numberOfStates; js ++)
-		thy alpha [js] [1] = my initialStateProbs [js] * my emissionProbs [js] [obs [1]];
-	thy scale [1] = NUMsum (thy alpha.column (1));
-	thy alpha.column (1) /= thy scale [1];
+	VEC alpha_1 = thy alpha.row (1);
+	for (integer js = 1; js <= numberOfStates; js ++)
+		alpha_1 [js] = my initialStateProbs [js] * my emissionProbs [js] [obs [1]];
+	thy scale [1] = NUMsum (alpha_1);
+	alpha_1  /=  thy scale [1];
 	// recursion
 	for (integer it = 2; it <= thy numberOfTimes; it ++) {
-		thy scale [it] = 0.0;
-		for (integer js = 1; js <= my numberOfStates; js ++) {
-			double sum = 0.0;
-			for (integer is = 1; is <= my numberOfStates; is ++) {
-				sum += thy alpha [is] [it - 1] * my transitionProbs [is] [js];
-			}
-
-			thy alpha [js] [it] = sum * my emissionProbs [js] [obs [it]];
-			thy scale [it] += thy alpha [js] [it];
+		constVEC alpha_previous = thy alpha.row (it - 1);
+		VEC alpha_it = thy alpha.row (it);
+		alpha_it  <<=  0.0;
+		for (integer is = 1; is <= numberOfStates; is ++) {
+			const integer first = thy firstReachableState [is], last = thy lastReachableState [is];
+			if (alpha_previous [is] != 0.0 && first <= last)
+				alpha_it.part (first, last)  +=  my transitionProbs.row (is).part (first, last)  *  alpha_previous [is];
 		}
-
-		for (integer js = 1; js <= my numberOfStates; js ++) {
-			thy alpha [js] [it] /= thy scale [it];
+		thy scale [it] = 0.0;
+		for (integer js = 1; js <= numberOfStates; js ++) {
+			alpha_it [js] *= my emissionProbs [js] [obs [it]];
+			thy scale [it] += alpha_it [js];
 		}
+		alpha_it  /=  thy scale [it];
 	}
 
 	for (integer it = 1; it <= thy numberOfTimes; it ++) {
@@ -1336,53 +1422,78 @@ void HMM_HMMBaumWelch_forward (HMM me, HMMBaumWelch thee, constINTVEC obs) {
 
 void HMM_HMMBaumWelch_backward (HMM me, HMMBaumWelch thee, constINTVEC obs) {
 	Melder_assert (obs.size == thy numberOfTimes);
-	for (integer is = 1; is <= my numberOfStates; is ++) {
-		thy beta [is] [thy numberOfTimes] = 1.0 / thy scale [thy numberOfTimes];
-	}
+	const integer numberOfStates = my numberOfStates;
+	HMM_getReachableStates (me, thy firstReachableState.get(), thy lastReachableState.get());
+	thy beta.row (thy numberOfTimes)  <<=  1.0 / thy scale [thy numberOfTimes];
 	for (integer it = thy numberOfTimes - 1; it >= 1; it --) {
-		for (integer is = 1; is <= my numberOfStates; is ++) {
-			longdouble sum = 0.0;
-			for (integer js = 1; js <= my numberOfStates; js ++) {
-				sum += thy beta [js] [it + 1] * my transitionProbs [is] [js] * my emissionProbs [js] [obs [it + 1]];
-			}
-			thy beta [is] [it] = double (sum) / thy scale [it];
+		for (integer js = 1; js <= numberOfStates; js ++)
+			thy work [js] = thy beta [it + 1] [js] * my emissionProbs [js] [obs [it + 1]];
+		VEC beta_it = thy beta.row (it);
+		for (integer is = 1; is <= numberOfStates; is ++) {
+			const integer first = thy firstReachableState [is], last = thy lastReachableState [is];
+			const double sum = ( first <= last ?
+					NUMinner (my transitionProbs.row (is).part (first, last), thy work.part (first, last)) : 0.0 );
+			beta_it [is] = sum / thy scale [it];
 		}
 	}
 }
 
 /*************************** HMM decoding ***********************************/
 
-// precondition: valid symbols, i.e. 1 <= o [i] <= my numberOfSymbols for i=1..nt
+/*
+	The Viterbi recursion is done with log probabilities, so that the scores of long observation sequences
+	do not underflow. thy viterbi contains ln probabilities, thy prob the probability of the best path.
+	precondition: valid symbols, i.e. 1 <= o [i] <= my numberOfSymbols for i=1..nt
+*/
 void HMM_HMMViterbi_decode (HMM me, HMMViterbi thee, constINTVEC obs) {
 	Melder_assert (obs.size == thy numberOfTimes);
-	const integer numberOfTimes = thy numberOfTimes;
+	const integer numberOfTimes = thy numberOfTimes, numberOfStates = my numberOfStates;
+	autoINTVEC firstReachableState = newINTVECraw (numberOfStates), lastReachableState = newINTVECraw (numberOfStates);
+	HMM_getReachableStates (me, firstReachableState.get(), lastReachableState.get());
+	autoMAT lnTransitionProbs = newMATraw (numberOfStates, numberOfStates);
+	for (integer is = 1; is <= numberOfStates; is ++)
+		for (integer js = 1; js <= numberOfStates; js ++)
+			lnTransitionProbs [is] [js] = ( my transitionProbs [is] [js] > 0.0 ? log (my transitionProbs [is] [js]) : -INFINITY );
+	auto lnProbability = [] (double p) { return ( p > 0.0 ? log (p) : -INFINITY ); };
+	autoVEC previous = newVECraw (numberOfStates), current = newVECraw (numberOfStates);
 	// initialisation
-	for (integer is = 1; is <= my numberOfStates; is ++) {
-		thy viterbi [is] [1] = my initialStateProbs [is] * my emissionProbs [is] [obs [1]];
+	for (integer is = 1; is <= numberOfStates; is ++) {
+		current [is] = lnProbability (my initialStateProbs [is]) + lnProbability (my emissionProbs [is] [obs [1]]);
+		thy viterbi [is] [1] = current [is];
 		thy bp [is] [1] = 0;
 	}
-	// recursion
+	// recursion: all transitions isp -> is from previous time to current
 	for (integer it = 2; it <= numberOfTimes; it ++) {
-		for (integer is = 1; is <= my numberOfStates; is ++) {
-			// all transitions isp -> is from previous time to current
-			double max_score = -1; // any negative number is ok
-			for (integer isp = 1; isp <= my numberOfStates; isp ++) {
-				const double score = thy viterbi [isp] [it - 1] * my transitionProbs [isp] [is]; // * my emissionProbs [is] [obs [it]]
-				if (score > max_score) {
-					max_score = score;
+		std::swap (previous, current);
+		current.get()  <<=  -INFINITY;
+		for (integer is = 1; is <= numberOfStates; is ++)
+			thy bp [is] [it] = 1;   // for unreachable states
+		for (integer isp = 1; isp <= numberOfStates; isp ++) {
+			const double previousScore = previous [isp];
+			if (previousScore == -INFINITY)
+				continue;
+			constVEC lnTransitionProbs_isp = lnTransitionProbs.row (isp);
+			for (integer is = firstReachableState [isp]; is <= lastReachableState [isp]; is ++) {
+				const double score = previousScore + lnTransitionProbs_isp [is];
+				if (score > current [is]) {
+					current [is] = score;
 					thy bp [is] [it] = isp;
 				}
 			}
-			thy viterbi [is] [it] = max_score * my emissionProbs [is] [ obs [it] ];
+		}
+		for (integer is = 1; is <= numberOfStates; is ++) {
+			current [is] += lnProbability (my emissionProbs [is] [obs [it]]);
+			thy viterbi [is] [it] = current [is];
 		}
 	}
 	// path starts at state with best end probability
 	thy path [numberOfTimes] = 1;
-	thy prob = thy viterbi [1] [numberOfTimes];
-	for (integer is = 2; is <= my numberOfStates; is ++) {
-		if (thy viterbi [is] [numberOfTimes] > thy prob)
-			thy prob = thy viterbi [thy path [numberOfTimes] = is] [numberOfTimes];
+	double lnProb = thy viterbi [1] [numberOfTimes];
+	for (integer is = 2; is <= numberOfStates; is ++) {
+		if (thy viterbi [is] [numberOfTimes] > lnProb)
+			lnProb = thy viterbi [thy path [numberOfTimes] = is] [numberOfTimes];
 	}
+	thy prob = exp (lnProb);
 	// trace back and get path
 	for (integer it = numberOfTimes; it > 1; it --)
 		thy path [it - 1] = thy bp [thy path [it]] [it];
@@ -1492,16 +1603,19 @@ double HMM_getProbabilityOfObservations (HMM me, constINTVEC obs) {
 	
 	alpha_t.get()  /=  scale [1];
 
-	// recursion
+	// recursion, as in HMM_HMMBaumWelch_forward
+	autoINTVEC firstReachableState = newINTVECraw (my numberOfStates), lastReachableState = newINTVECraw (my numberOfStates);
+	HMM_getReachableStates (me, firstReachableState.get(), lastReachableState.get());
 	for (integer it = 2; it <= numberOfTimes; it ++) {
 		alpha_tm1.get() <<= alpha_t.get();
-
+		alpha_t.get() <<= 0.0;
+		for (integer is = 1; is <= my numberOfStates; is ++) {
+			const integer first = firstReachableState [is], last = lastReachableState [is];
+			if (alpha_tm1 [is] != 0.0 && first <= last)
+				alpha_t.part (first, last)  +=  my transitionProbs.row (is).part (first, last)  *  alpha_tm1 [is];
+		}
 		for (integer js = 1; js <= my numberOfStates; js ++) {
-			longdouble sum = 0.0;
-			for (integer is = 1; is <= my numberOfStates; is ++) {
-				sum += alpha_tm1 [is] * my transitionProbs [is] [js];
-			}
-			alpha_t [js] = sum * my emissionProbs [js] [obs [it]];
+			alpha_t [js] *= my emissionProbs [js] [obs [it]];
 			scale [it] += alpha_t [js];
 		}
 		if (scale [it] <= 0.0)
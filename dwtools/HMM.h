@@ -53,11 +53,15 @@ Thing_define (HMMBaumWelch, Daata) {
 	integer numberOfSymbols;
 	double lnProb;
 	double minProb;
-	autoMAT alpha;
+	autoMAT alpha;   // time by state, so that the recursions run along contiguous rows
 	autoMAT beta;
 	autoVEC scale;
 	autoMAT gamma;
-	autoTEN3 xi;
+	autoINTVEC firstReachableState;   // per state: the nonzero band of its row in the transition matrix
+	autoINTVEC lastReachableState;
+	autoVEC work;   // per state: scratch for the backward recursion and the transition estimates
+	autoVEC gammaSum;
+	autoMAT xiSum;   // the sum over time of xi, accumulated without storing xi itself
 	autoVEC aij_num_p0;
 	autoMAT aij_num;
 	autoVEC aij_denom_p0;
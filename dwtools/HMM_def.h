@@ -79,7 +79,9 @@ oo_DEFINE_CLASS (HMMViterbi, Daata)
 	oo_INTEGER (numberOfTimes)
 	oo_INTEGER (numberOfStates)
 	oo_DOUBLE (prob)
-	oo_MAT (viterbi, numberOfStates, numberOfTimes)
+	#if oo_DECLARING
+		oo_MAT (viterbi, numberOfStates, numberOfTimes)   // ln probabilities, with -INFINITY for impossible states; not saved or copied
+	#endif
 	oo_INTMAT (bp, numberOfStates, numberOfTimes)
 	oo_INTVEC (path, numberOfTimes)
 
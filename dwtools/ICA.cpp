@@ -23,6 +23,7 @@
 
 #include "ICA.h"
 #include "Interpreter.h"
+#include "MelderThread.h"
 #include "NUM2.h"
 #include "Sound_and_PCA.h"
 #include "SVD.h"
@@ -34,21 +35,15 @@ static void MATmul_VCVt_preallocated (MAT r, constMAT v, constMAT c, bool csym)
 	Melder_assert (v.nrow == r.ncol);
 	Melder_assert (c.nrow == c.ncol);
 	Melder_assert (v.ncol == c.ncol);
-	for (integer i = 1; i <= r.nrow; i ++) {
-		const integer jstart = ( csym ? i : 1 );
-		for (integer j = jstart; j <= r.nrow; j ++) {
-			// V_ik C_kl V'_lj = V_ik C_kl V_jl
-			longdouble vcv = 0.0;
-			for (integer k = 1; k <= c.nrow; k ++) {
-				for (integer l = 1; l <= c.nrow; l ++) {
-					vcv += v [i] [k] * c [k] [l] * v [j] [l];
-				}
-			}
-			r [i] [j] = vcv;
-			if (csym)
-				r [j] [i] = vcv;
-		}
-	}
+	/*
+		V_ik C_kl V'_lj as (V C) V', in order N^3 instead of N^4.
+	*/
+	autoMAT vc = newMATmul (v, c);
+	MATmul (r, vc.get(), v.transpose());
+	if (csym)
+		for (integer i = 1; i <= r.nrow; i ++)
+			for (integer j = i + 1; j <= r.nrow; j ++)
+				r [j] [i] = r [i] [j];
 }
 
 // D += scalef * M * M', M = nrm x ncm, D is nrm x nrm
@@ -459,6 +454,98 @@ autoCovariance Sound_to_Covariance_channels (Sound me, double startTime, double
     }
 }
 
+/*
+	The CrossCorrelationTables of Sound_to_CrossCorrelationTable () for all lags at once (lags in samples),
+	for the samples [i1, i2] that the lag-0 table would use.
+	The samples are cut into blocks; every centred channel is Fourier-transformed once for the block alone
+	(zero-padded) and once for the block extended by the maximum lag. For each pair of channels,
+	the products conj (block spectrum [i]) * extended spectrum [j] are summed over the blocks,
+	after which one inverse transform gives the cross-correlations of the pair for all lags up to the maximum lag.
+	The blocks are divided over threads, each thread with its own sums, which are added in thread order.
+*/
+static autoCrossCorrelationTableList Sound_to_CrossCorrelationTableList_fft (Sound me, integer i1, integer i2, constINTVEC const& lags) {
+	const integer numberOfChannels = my ny, numberOfPairs = numberOfChannels * (numberOfChannels + 1) / 2;
+	const integer numberOfSamples = i2 - i1 + 1;
+	integer maximumLag = 0;
+	for (integer ilag = 1; ilag <= lags.size; ilag ++) {
+		maximumLag = std::max (maximumLag, lags [ilag]);
+		Melder_require (numberOfSamples - lags [ilag] > numberOfChannels,
+			U"Not enough samples, choose a longer interval.");
+	}
+	integer fftLength = 4096;
+	while (fftLength < 2 * (maximumLag + 1))
+		fftLength *= 2;
+	const integer blockLength = fftLength - maximumLag;
+	const integer numberOfBlocks = (numberOfSamples - 1) / blockLength + 1;
+
+	autoVEC centroid = newVECraw (numberOfChannels);
+	for (integer ichan = 1; ichan <= numberOfChannels; ichan ++)
+		centroid [ichan] = NUMmean (my z.row (ichan).part (i1, i2));
+
+	constexpr integer maximumNumberOfThreads = 16;
+	const integer maximumNumberOfThreadsForMemory = std::max (1_integer, (integer (1) << 25) / (numberOfPairs * fftLength));   // 256 MB of sums
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfBlocks, 4,
+			std::min (maximumNumberOfThreads, maximumNumberOfThreadsForMemory));
+	autoNUMfft_Table fftTables [1 + maximumNumberOfThreads];
+	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+		NUMfft_Table_init (& fftTables [ithread], fftLength);
+	autoMAT blockSpectra = newMATraw (numberOfThreads * numberOfChannels, fftLength);
+	autoMAT extendedSpectra = newMATraw (numberOfThreads * numberOfChannels, fftLength);
+	autoMAT sums = newMATzero (numberOfThreads * numberOfPairs, fftLength);
+
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		const integer channelOffset = (ithread - 1) * numberOfChannels, pairOffset = (ithread - 1) * numberOfPairs;
+		integer firstBlock, lastBlock;
+		MelderThread_getRange (numberOfBlocks, numberOfThreads, ithread, & firstBlock, & lastBlock);
+		for (integer iblock = firstBlock; iblock <= lastBlock; iblock ++) {
+			const integer firstSample = i1 + (iblock - 1) * blockLength;
+			for (integer ichan = 1; ichan <= numberOfChannels; ichan ++) {
+				VEC block = blockSpectra.row (channelOffset + ichan), extended = extendedSpectra.row (channelOffset + ichan);
+				for (integer i = 1; i <= fftLength; i ++) {
+					const integer isample = firstSample - 1 + i;
+					const double value = ( isample <= i2 ? my z [ichan] [isample] - centroid [ichan] : 0.0 );
+					block [i] = ( i <= blockLength ? value : 0.0 );
+					extended [i] = value;
+				}
+				NUMfft_forward (& fftTables [ithread], block);
+				NUMfft_forward (& fftTables [ithread], extended);
+			}
+			integer ipair = 0;
+			for (integer ichan = 1; ichan <= numberOfChannels; ichan ++) {
+				const constVEC a = blockSpectra.row (channelOffset + ichan);
+				for (integer jchan = ichan; jchan <= numberOfChannels; jchan ++) {
+					const constVEC b = extendedSpectra.row (channelOffset + jchan);
+					VEC sum = sums.row (pairOffset + (++ ipair));
+					sum [1] += a [1] * b [1];
+					for (integer k = 2; k < fftLength; k += 2) {
+						sum [k] += a [k] * b [k] + a [k + 1] * b [k + 1];
+						sum [k + 1] += a [k] * b [k + 1] - a [k + 1] * b [k];
+					}
+					sum [fftLength] += a [fftLength] * b [fftLength];
+				}
+			}
+		}
+	});
+	for (integer ithread = 2; ithread <= numberOfThreads; ithread ++)
+		sums.horizontalBand (1, numberOfPairs)  +=  sums.horizontalBand ((ithread - 1) * numberOfPairs + 1, ithread * numberOfPairs);
+	for (integer ipair = 1; ipair <= numberOfPairs; ipair ++)
+		NUMfft_backward (& fftTables [1], sums.row (ipair));
+
+	autoCrossCorrelationTableList thee = CrossCorrelationTableList_create ();
+	const double scale = my dx / fftLength;
+	for (integer ilag = 1; ilag <= lags.size; ilag ++) {
+		autoCrossCorrelationTable table = CrossCorrelationTable_create (numberOfChannels);
+		table -> centroid.all() <<= centroid.all();
+		integer ipair = 0;
+		for (integer ichan = 1; ichan <= numberOfChannels; ichan ++)
+			for (integer jchan = ichan; jchan <= numberOfChannels; jchan ++)
+				table -> data [ichan] [jchan] = table -> data [jchan] [ichan] = sums [++ ipair] [lags [ilag] + 1] * scale;
+		table -> numberOfObservations = numberOfSamples - lags [ilag];
+		thy addItem_move (table.move());
+	}
+	return thee;
+}
+
 autoCrossCorrelationTableList Sound_to_CrossCorrelationTableList (Sound me,
 	double startTime, double endTime, integer numberOfCrossCorrelations, double lagStep)
 {
@@ -471,14 +558,25 @@ autoCrossCorrelationTableList Sound_to_CrossCorrelationTableList (Sound me,
 		}
 		Melder_require (startTime + numberOfCrossCorrelations * lagStep <= endTime,
 			U"Lag time is too large.");
-		
-		autoCrossCorrelationTableList thee = CrossCorrelationTableList_create ();
-		for (integer i = 1; i <= numberOfCrossCorrelations; i ++) {
-			const double lag = (i - 1) * lagStep;
-			autoCrossCorrelationTable ct = Sound_to_CrossCorrelationTable (me, startTime, endTime, lag);
-			thy addItem_move (ct.move());
+
+		if (Melder_debug == 63) {
+			autoCrossCorrelationTableList thee = CrossCorrelationTableList_create ();
+			for (integer i = 1; i <= numberOfCrossCorrelations; i ++) {
+				const double lag = (i - 1) * lagStep;
+				autoCrossCorrelationTable ct = Sound_to_CrossCorrelationTable (me, startTime, endTime, lag);
+				thy addItem_move (ct.move());
+			}
+			return thee;
 		}
-		return thee;
+		/*
+			The sample range and the lags (in samples) of Sound_to_CrossCorrelationTable ().
+		*/
+		const integer i1 = std::max (1_integer, Sampled_xToNearestIndex (me, startTime));
+		const integer i2 = std::min (my nx, Sampled_xToNearestIndex (me, endTime));
+		autoINTVEC lags = newINTVECraw (numberOfCrossCorrelations);
+		for (integer i = 1; i <= numberOfCrossCorrelations; i ++)
+			lags [i] = Melder_iround ((i - 1) * lagStep / my dx);
+		return Sound_to_CrossCorrelationTableList_fft (me, i1, i2, lags.get());
 	} catch (MelderError) {
 		Melder_throw (me, U": no CrossCorrelationTableList created.");
 	}
@@ -813,20 +911,180 @@ autoCrossCorrelationTableList CrossCorrelationTableList_createTestSet (integer d
 	}
 }
 
-#if 0
-static void Sound_MixingMatrix_improveUnmixing_fica (Sound me, MixingMatrix thee, integer maxNumberOfIterations, double /* tol */, int /* method */) {
+/******************** FastICA ********************************************/
+
+constexpr integer FastICA_BLOCK_SIZE = 1024;
+
+/*
+	tanh (x) as Lambert's continued fraction up to x^7, with x clipped to [-4.97, 4.97] where the fraction reaches 1.
+	The absolute error is below 1e-4.
+	There are no branches or calls, so that the compiler can evaluate a whole block with SIMD instructions.
+*/
+static void VECtanh_approximate_inplace (VEC const& x) noexcept {
+	double *p = & x [1];
+	for (integer i = 0; i < x.size; i ++) {
+		const double y = std::min (std::max (p [i], -4.97), 4.97), y2 = y * y;
+		p [i] = y * (135135.0 + y2 * (17325.0 + y2 * (378.0 + y2))) / (135135.0 + y2 * (62370.0 + y2 * (3150.0 + 28.0 * y2)));
+	}
+}
+
+/*
+	Over the samples i1 to i2: if `unmixing` is empty, the sums of squares and cross-products (x - mean)(x - mean)';
+	otherwise, for the FastICA step with the projections y = unmixing (x - mean),
+	the sums of tanh (y) (x - mean)' and of 1 - tanh (y)^2.
+	The samples are visited in blocks of FastICA_BLOCK_SIZE (transposed to samples x channels),
+	distributed over threads, and the partial sums are added in thread order.
+*/
+static void Sound_getFastICAsums (Sound me, integer i1, integer i2, constVEC const& mean, constMATVU const& unmixing,
+	MATVU const& out_sums, VECVU const& out_derivativeSums)
+{
+	const integer numberOfChannels = my ny, numberOfSamples = i2 - i1 + 1;
+	const integer numberOfBlocks = (numberOfSamples - 1) / FastICA_BLOCK_SIZE + 1;
+	const bool isCovariance = ( unmixing.nrow == 0 );
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfBlocks, 4);
+	autoMAT unmixingTransposed = newMATtranspose (unmixing);
+	autoMAT centred = newMATraw (numberOfThreads * FastICA_BLOCK_SIZE, numberOfChannels);
+	autoMAT projections = newMATraw (numberOfThreads * FastICA_BLOCK_SIZE, numberOfChannels);
+	autoMAT products = newMATraw (numberOfThreads * numberOfChannels, numberOfChannels);
+	autoMAT partialSums = newMATzero (numberOfThreads * numberOfChannels, numberOfChannels);
+	autoMAT partialDerivativeSums = newMATzero (numberOfThreads, numberOfChannels);
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		const integer rowOffset = (ithread - 1) * FastICA_BLOCK_SIZE, channelOffset = (ithread - 1) * numberOfChannels;
+		MATVU product = products.horizontalBand (channelOffset + 1, channelOffset + numberOfChannels);
+		MATVU partialSum = partialSums.horizontalBand (channelOffset + 1, channelOffset + numberOfChannels);
+		integer firstBlock, lastBlock;
+		MelderThread_getRange (numberOfBlocks, numberOfThreads, ithread, & firstBlock, & lastBlock);
+		for (integer iblock = firstBlock; iblock <= lastBlock; iblock ++) {
+			const integer firstSample = i1 + (iblock - 1) * FastICA_BLOCK_SIZE;
+			const integer numberOfSamplesInBlock = std::min (FastICA_BLOCK_SIZE, i2 - firstSample + 1);
+			MATVU x = centred.horizontalBand (rowOffset + 1, rowOffset + numberOfSamplesInBlock);
+			for (integer isample = 1; isample <= numberOfSamplesInBlock; isample ++)
+				for (integer ichan = 1; ichan <= numberOfChannels; ichan ++)
+					x [isample] [ichan] = my z [ichan] [firstSample - 1 + isample] - mean [ichan];
+			if (isCovariance) {
+				MATmul_fast (product, x.transpose(), x);
+			} else {
+				MATVU y = projections.horizontalBand (rowOffset + 1, rowOffset + numberOfSamplesInBlock);
+				MATmul_fast (y, x, unmixingTransposed.get());
+				for (integer isample = 1; isample <= numberOfSamplesInBlock; isample ++) {
+					VEC g = projections.row (rowOffset + isample);
+					VECtanh_approximate_inplace (g);
+					for (integer ichan = 1; ichan <= numberOfChannels; ichan ++)
+						partialDerivativeSums [ithread] [ichan] += 1.0 - g [ichan] * g [ichan];
+				}
+				MATmul_fast (product, y.transpose(), x);
+			}
+			partialSum  +=  product;
+		}
+	});
+	out_sums  <<=  0.0;
+	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+		out_sums  +=  partialSums.horizontalBand ((ithread - 1) * numberOfChannels + 1, ithread * numberOfChannels);
+	if (! isCovariance) {
+		out_derivativeSums  <<=  0.0;
+		for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+			out_derivativeSums  +=  partialDerivativeSums.row (ithread);
+	}
+}
+
+/*
+	W := (W W')^(-1/2) W
+*/
+static void MATdecorrelateRowsSymmetrically_inplace (MAT const& w, Eigen eigen, MAT const& work) {
+	const integer dimension = w.nrow;
+	MATmul (work, w, w.transpose());
+	Eigen_initFromSymmetricMatrix (eigen, work);
+	for (integer i = 1; i <= dimension; i ++)
+		for (integer j = 1; j <= dimension; j ++) {
+			longdouble sum = 0.0;
+			for (integer k = 1; k <= dimension; k ++)
+				sum += eigen -> eigenvectors [k] [i] * eigen -> eigenvectors [k] [j] / sqrt (eigen -> eigenvalues [k]);
+			work [i] [j] = double (sum);
+		}
+	autoMAT product = newMATmul (work, w);
+	w  <<=  product.all();
+}
+
+autoMixingMatrix Sound_to_MixingMatrix_fastICA (Sound me, double startTime, double endTime,
+	integer maxNumberOfIterations, double tol)
+{
 	try {
+		if (endTime <= startTime) {
+			startTime = my xmin;
+			endTime = my xmax;
+		}
+		const integer i1 = std::max (1_integer, Sampled_xToNearestIndex (me, startTime));
+		const integer i2 = std::min (my nx, Sampled_xToNearestIndex (me, endTime));
+		const integer numberOfChannels = my ny, numberOfSamples = i2 - i1 + 1;
+		Melder_require (numberOfSamples > numberOfChannels,
+			U"Not enough samples, choose a longer interval.");
+
+		autoVEC mean = newVECraw (numberOfChannels);
+		for (integer ichan = 1; ichan <= numberOfChannels; ichan ++)
+			mean [ichan] = NUMmean (my z.row (ichan).part (i1, i2));
+		/*
+			Whitening: the rows of V are the eigenvectors of the covariance, divided by the square roots of their eigenvalues.
+		*/
+		autoMAT covariance = newMATraw (numberOfChannels, numberOfChannels);
+		autoVEC derivativeSums = newVECraw (numberOfChannels);
+		Sound_getFastICAsums (me, i1, i2, mean.get(), MATVU (), covariance.get(), derivativeSums.get());
+		covariance.all()  *=  1.0 / numberOfSamples;
+		autoEigen eigen = Thing_new (Eigen);
+		Eigen_initFromSymmetricMatrix (eigen.get(), covariance.get());
+		autoMAT whitening = newMATraw (numberOfChannels, numberOfChannels);
+		for (integer i = 1; i <= numberOfChannels; i ++) {
+			Melder_require (eigen -> eigenvalues [i] > 0.0,
+				U"The channels should be linearly independent.");
+			whitening.row (i) <<= eigen -> eigenvectors.row (i)  *  (1.0 / sqrt (eigen -> eigenvalues [i]));
+		}
+		/*
+			A. Hyvärinen (1999): Fast and robust fixed-point algorithms for independent component analysis,
+			IEEE Transactions on Neural Networks 10: 626-634.
+			Symmetric version with g = tanh, on the whitened data z = V (x - mean):
+				W+ = E {g (W z) z'} - diag (E {g' (W z)}) W
+				W = (W+ W+')^(-1/2) W+
+			With U = W V, E {g (W z) z'} = E {g (U (x - mean)) (x - mean)'} V',
+			so that the whitened data need not be stored.
+		*/
+		autoMAT w = newMATrandomUniform (numberOfChannels, numberOfChannels, -1.0, 1.0);
+		autoMAT wold = newMATraw (numberOfChannels, numberOfChannels);
+		autoMAT unmixing = newMATraw (numberOfChannels, numberOfChannels);
+		autoMAT sums = newMATraw (numberOfChannels, numberOfChannels);
+		autoMAT work = newMATraw (numberOfChannels, numberOfChannels);
+		MATdecorrelateRowsSymmetrically_inplace (w.get(), eigen.get(), work.get());
+
 		integer iter = 0;
-		Melder_require (my ny == thy numberOfColumns, U"Dimensions should agree.");
-		
-		autoMAT x = newmatrixcopy (my z.get());
-		do {
-			iter ++;
-		} while (/*fabs((dm_old - dm_new) / dm_new) > tol &&*/ iter < maxNumberOfIterations);
+		double delta;
+		autoMelderProgress progress (U"FastICA...");
+		try {
+			do {
+				wold.all() <<= w.all();
+				MATmul (unmixing.get(), w.get(), whitening.get());
+				Sound_getFastICAsums (me, i1, i2, mean.get(), unmixing.get(), sums.get(), derivativeSums.get());
+				MATmul (w.get(), sums.get(), whitening.transpose());
+				w.all()  *=  1.0 / numberOfSamples;
+				for (integer i = 1; i <= numberOfChannels; i ++)
+					w.row (i)  -=  wold.row (i)  *  (derivativeSums [i] / numberOfSamples);
+				MATdecorrelateRowsSymmetrically_inplace (w.get(), eigen.get(), work.get());
+				/*
+					Converged if every new row points in the direction of its old version (or the opposite one).
+				*/
+				delta = 0.0;
+				for (integer i = 1; i <= numberOfChannels; i ++)
+					delta = std::max (delta, 1.0 - fabs (NUMinner (w.row (i), wold.row (i))));
+				iter ++;
+				Melder_progress ((double) iter / (double) (maxNumberOfIterations + 1), U"Iteration: ", iter, U", delta: ", delta);
+			} while (delta > tol && iter < maxNumberOfIterations);
+		} catch (MelderError) {
+			Melder_clearError ();
+		}
+		MATmul (unmixing.get(), w.get(), whitening.get());
+		autoMixingMatrix thee = MixingMatrix_create (numberOfChannels, numberOfChannels);
+		MATpseudoInverse (thy data.get(), unmixing.get(), 0.0);
+		return thee;
 	} catch (MelderError) {
-		Melder_throw (me, U" & ", thee, U" .");
+		Melder_throw (me, U": no MixingMatrix created by FastICA.");
 	}
 }
-#endif
 
 /* End of file ICA.cpp */
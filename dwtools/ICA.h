@@ -126,4 +126,11 @@ autoMixingMatrix Sound_to_MixingMatrix (Sound me,
 	double startTime, double endTime, integer numberOfCrossCorrelations, double lagStep,
 	integer maxNumberOfIterations, double tol, int method);
 
+/*
+	Symmetric FastICA with the tanh nonlinearity on the whitened channels (Hyvärinen 1999),
+	iterated until every unmixing vector changes its direction by less than tol (1 - |cos|).
+*/
+autoMixingMatrix Sound_to_MixingMatrix_fastICA (Sound me, double startTime, double endTime,
+	integer maxNumberOfIterations, double tol);
+
 #endif /*_ICA_h_ */
@@ -46,6 +46,129 @@ static void IntervalTier_addBoundaryUnsorted (IntervalTier me, integer iinterval
 	my intervals. addItem_unsorted_move (ti_new.move());
 }
 
+Thing_implement (SilenceDetector, Thing, 0);
+
+autoSilenceDetector SilenceDetector_create (double startTime, double silenceThreshold_dB,
+	double minSilenceDuration, double minSoundingDuration, double referenceIntensity_dB,
+	SilenceDetector_Callback callback, void *closure)
+{
+	try {
+		Melder_require (silenceThreshold_dB < 0.0,
+			U"The silence threshold w.r.t. the maximum intensity should be a negative number.");
+		Melder_require (isdefined (referenceIntensity_dB),
+			U"The reference intensity should be defined.");
+		autoSilenceDetector me = Thing_new (SilenceDetector);
+		my startTime = startTime;
+		my silenceThreshold_dB = silenceThreshold_dB;
+		my minSilenceDuration = minSilenceDuration;
+		my minSoundingDuration = minSoundingDuration;
+		my referenceIntensity_dB = referenceIntensity_dB;
+		my callback = callback;
+		my closure = closure;
+		my inPause = true;
+		my pauseStartTime = startTime;
+		return me;
+	} catch (MelderError) {
+		Melder_throw (U"SilenceDetector not created.");
+	}
+}
+
+static void SilenceDetector_report (SilenceDetector me, double time, bool silenceStarts) {
+	my callback (my closure, time, silenceStarts);
+	my numberOfBoundaries ++;
+}
+
+/*
+	The pause is silent if it lasts at least minSilenceDuration; it is known to last until `time`.
+*/
+static void SilenceDetector_checkPause (SilenceDetector me, double time) {
+	if (my inPause && ! my pauseIsLong && time > my pauseStartTime && time - my pauseStartTime >= my minSilenceDuration) {
+		my pauseIsLong = true;
+		SilenceDetector_report (me, my pauseStartTime, true);
+	}
+}
+
+/*
+	A run of sounding frames that lasts at least minSoundingDuration starts at `time` and ends the pause;
+	a pause that was too short to be silent belongs to the sounding interval before it (or after it, at the start).
+*/
+static void SilenceDetector_startSounding (SilenceDetector me, double time) {
+	SilenceDetector_checkPause (me, time);
+	if (my pauseIsLong)
+		SilenceDetector_report (me, time, false);
+	else if (my numberOfBoundaries == 0)
+		SilenceDetector_report (me, my startTime, false);
+	my inPause = false;
+	my runIsLong = true;
+}
+
+void SilenceDetector_processFrame (SilenceDetector me, double time, double intensity_dB) {
+	const double intensityThreshold = my referenceIntensity_dB - fabs (my silenceThreshold_dB);
+	const bool isSilent = ( intensity_dB < intensityThreshold );
+	if (my numberOfFrames == 0) {
+		my runIsSilent = isSilent;
+		my runIsLong = false;
+		my runStartTime = my startTime;
+	} else if (isSilent != my runIsSilent) {
+		if (! my runIsSilent) {
+			if (! my runIsLong && time - my runStartTime >= my minSoundingDuration)
+				SilenceDetector_startSounding (me, my runStartTime);
+			if (my runIsLong) {
+				my inPause = true;
+				my pauseIsLong = false;
+				my pauseStartTime = time;
+			}
+		}
+		my runIsSilent = isSilent;
+		my runIsLong = false;
+		my runStartTime = time;
+		my hasChanged = true;
+	}
+	my numberOfFrames ++;
+	if (my runIsSilent)
+		SilenceDetector_checkPause (me, time);
+	else if (! my runIsLong) {
+		if (time - my runStartTime >= my minSoundingDuration)
+			SilenceDetector_startSounding (me, my runStartTime);
+		else
+			SilenceDetector_checkPause (me, my runStartTime);
+	}
+}
+
+void SilenceDetector_flush (SilenceDetector me, double endTime) {
+	if (! my runIsSilent && ! my runIsLong) {
+		/*
+			As in Intensity_to_TextGrid_detectSilences (), a sound that never crosses the threshold is not cut.
+		*/
+		if (endTime - my runStartTime >= my minSoundingDuration || ! my hasChanged || my numberOfFrames == 0)
+			SilenceDetector_startSounding (me, my runStartTime);
+	}
+	SilenceDetector_checkPause (me, endTime);
+	if (my numberOfBoundaries == 0)
+		SilenceDetector_report (me, my startTime, false);
+	my numberOfFrames = 0;
+	my hasChanged = false;
+	my inPause = true;
+	my pauseIsLong = false;
+	my pauseStartTime = my startTime;
+	my numberOfBoundaries = 0;
+}
+
+struct SilenceBoundaries {
+	IntervalTier tier;
+	conststring32 silenceLabel, soundingLabel;
+	integer iinterval;
+};
+
+static void SilenceBoundaries_add (void *closure, double time, bool silenceStarts) {
+	SilenceBoundaries *me = (SilenceBoundaries *) closure;
+	if (my iinterval == 0)
+		my iinterval = 1;   // the start of the first interval
+	else
+		IntervalTier_addBoundaryUnsorted (my tier, my iinterval ++, time, silenceStarts ? my soundingLabel : my silenceLabel);
+	TextInterval_setText (my tier -> intervals.at [my iinterval], silenceStarts ? my silenceLabel : my soundingLabel);
+}
+
 autoTextGrid Intensity_to_TextGrid_detectSilences (Intensity me,
 	double silenceThreshold_dB, double minSilenceDuration, double minSoundingDuration,
 	conststring32 silenceLabel, conststring32 soundingLabel)
@@ -75,6 +198,20 @@ autoTextGrid Intensity_to_TextGrid_detectSilences (Intensity me,
 		if (minSilenceDuration > duration || intensityThreshold < intensity_min_db)
 			return thee;
 
+		if (Melder_debug != 64) {
+			/*
+				The same intervals in one pass over the frames.
+			*/
+			SilenceBoundaries boundaries { it, silenceLabel, soundingLabel, 0 };
+			autoSilenceDetector detector = SilenceDetector_create (my xmin, silenceThreshold_dB,
+					minSilenceDuration, minSoundingDuration, intensity_max_db, SilenceBoundaries_add, & boundaries);
+			for (integer i = 1; i <= my nx; i ++)
+				SilenceDetector_processFrame (detector.get(), my x1 + (i - 1) * my dx, my z [1] [i]);
+			SilenceDetector_flush (detector.get(), my xmax);
+			it -> intervals. sort ();
+			return thee;
+		}
+
 		bool inSilenceInterval = my z [1] [1] < intensityThreshold;
 		integer iinterval = 1;
 		conststring32 label;
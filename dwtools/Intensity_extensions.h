@@ -41,6 +41,50 @@ autoTextGrid Intensity_to_TextGrid_detectSilences (Intensity me, double silenceT
 	as silences in the IntervalTier.
 */
 
+/*
+	The interval logic of Intensity_to_TextGrid_detectSilences () as a processor that takes
+	intensity frames one by one, e.g. from a StreamingIntensity on microphone or synthesizer audio,
+	and reports the boundaries of the silent and sounding intervals as soon as they are certain.
+
+	A frame is silent if its intensity is more than |silenceThreshold_dB| below `referenceIntensity_dB`,
+	e.g. the maximum of an earlier pass.
+	As in Intensity_to_TextGrid_detectSilences (), a boundary lies at the time of the first frame after a change,
+	sounding stretches shorter than minSoundingDuration count as silent, and
+	silent intervals shorter than minSilenceDuration then count as sounding.
+
+	The callback reports the start of the first interval (at `startTime`) and every later boundary,
+	with whether a silent interval starts there. A boundary is reported after at most
+	max (minSilenceDuration, minSoundingDuration) plus one frame; SilenceDetector_flush () ends the input
+	at `endTime`, reports what is left, and prepares the processor for a new input starting at `startTime`.
+	With the maximum intensity of all frames as the reference, the intervals are those of Intensity_to_TextGrid_detectSilences ().
+*/
+typedef void (*SilenceDetector_Callback) (void *closure, double time, bool silenceStarts);
+
+Thing_define (SilenceDetector, Thing) {
+	double startTime, silenceThreshold_dB, minSilenceDuration, minSoundingDuration;
+	double referenceIntensity_dB;
+	SilenceDetector_Callback callback;
+	void *closure;
+	/*
+		The current run of frames on the same side of the threshold, and the current pause,
+		i.e. the stretch since the end of the last run of sounding frames of at least minSoundingDuration.
+	*/
+	integer numberOfFrames;
+	bool runIsSilent, runIsLong, hasChanged;
+	double runStartTime;
+	bool inPause, pauseIsLong;
+	double pauseStartTime;
+	integer numberOfBoundaries;
+};
+
+autoSilenceDetector SilenceDetector_create (double startTime, double silenceThreshold_dB,
+	double minSilenceDuration, double minSoundingDuration, double referenceIntensity_dB,
+	SilenceDetector_Callback callback, void *closure);
+
+void SilenceDetector_processFrame (SilenceDetector me, double time, double intensity_dB);
+
+void SilenceDetector_flush (SilenceDetector me, double endTime);
+
 autoIntensity IntensityTier_to_Intensity (IntensityTier me, double dt);
 
 autoTextGrid IntensityTier_to_TextGrid_detectSilences (IntensityTier me, double dt,
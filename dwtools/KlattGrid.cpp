@@ -480,6 +480,234 @@ static void draw_oneSection (Graphics g, double xmin, double xmax, double ymin,
 
 /************************ Sound & FormantGrid *********************************************/
 
+/*
+	Resonators and antiresonators whose frequencies, bandwidths and (in the parallel model) amplitudes follow tiers,
+	run as one loop over the samples with all the sections of a cascade inside it.
+	The coefficients are computed from the tiers only at every FormantFilter_CONTROL_INTERVAL-th sample
+	and at the samples around every point of the tiers (at every sample if Melder_debug is 65);
+	in between, where every tier is linear, a, b and c are interpolated linearly
+	and the amplitude factor geometrically, i.e. linearly in dB, like the amplitude tier itself.
+	The tiers are read with cursors that only move forward.
+	Coefficients as in Resonator.cpp; a section keeps its coefficients where its frequency is above the Nyquist frequency
+	or its bandwidth is undefined.
+*/
+constexpr integer FormantFilter_CONTROL_INTERVAL = 32;
+
+struct FormantFilterSection {
+	RealTier frequencies, bandwidths, amplitudes_dB;   // no amplitudes: 0 dB
+	bool isAntiResonator, normaliseAtDC;
+	integer frequencyCursor, bandwidthCursor, amplitudeCursor;
+	double a, b, c, gain, p1, p2;
+	double nextA, nextB, nextC, nextGain_dB, gain_dB;
+	double da, db, dc, gainFactor;
+};
+
+/*
+	RealTier_getValueAtTime () for times that do not decrease from call to call;
+	*inout_ileft is the point before the previous time.
+*/
+static double RealTier_getValueAtTime_cursor (RealTier me, double t, integer *inout_ileft) {
+	const integer n = my points.size;
+	if (n == 0)
+		return undefined;
+	const RealPoint first = my points.at [1];
+	if (t <= first -> number)
+		return first -> value;   // constant extrapolation
+	const RealPoint last = my points.at [n];
+	if (t >= last -> number)
+		return last -> value;   // constant extrapolation
+	integer ileft = std::max (1_integer, *inout_ileft);
+	while (my points.at [ileft + 1] -> number < t)
+		ileft ++;
+	*inout_ileft = ileft;
+	const RealPoint pointLeft = my points.at [ileft], pointRight = my points.at [ileft + 1];
+	const double tleft = pointLeft -> number, fleft = pointLeft -> value;
+	const double tright = pointRight -> number, fright = pointRight -> value;
+	return t == tright ? fright
+		: tleft == tright ? 0.5 * (fleft + fright)
+		: fleft + (t - tleft) * (fright - fleft) / (tright - tleft);
+}
+
+/*
+	The sections of a series of formant filters, with the sample grid and the control block they share.
+	FormantSections_filter_inplace () may be called for consecutive stretches of samples of any length;
+	the result does not depend on how the samples are divided.
+*/
+struct FormantSections {
+	FormantFilterSection *sections;
+	integer numberOfSections;
+	double x1, dx;
+	integer nx;
+	integer controlInterval, nextControlSample;   // the current control block ends before nextControlSample
+};
+
+/*
+	Shortens the control block that starts at sample `firstSample` and ends before sample `*inout_nextControlSample`
+	so that the next point of the tier does not fall inside it:
+	a block ends at the last sample before that point, and the sample after the point is the next control sample after that.
+*/
+static void RealTier_limitControlBlock_cursor (RealTier me, integer ileft, FormantSections *grid, integer firstSample, integer *inout_nextControlSample) {
+	const double firstTime = grid -> x1 + (firstSample - 1) * grid -> dx;
+	const integer n = my points.size;
+	integer ipoint = std::max (1_integer, ileft);
+	while (ipoint <= n && my points.at [ipoint] -> number <= firstTime)
+		ipoint ++;
+	if (ipoint > n)
+		return;
+	integer isample = Melder_ifloor ((my points.at [ipoint] -> number - grid -> x1) / grid -> dx + 1.0);
+	if (isample <= firstSample)
+		isample = firstSample + 1;
+	if (isample < *inout_nextControlSample)
+		*inout_nextControlSample = isample;
+}
+
+static void FormantFilterSection_computeNextCoefficients (FormantFilterSection *me, double t, double samplingPeriod) {
+	my nextA = my a;
+	my nextB = my b;
+	my nextC = my c;
+	my nextGain_dB = my gain_dB;
+	const double frequency = RealTier_getValueAtTime_cursor (my frequencies, t, & my frequencyCursor);
+	const double bandwidth = RealTier_getValueAtTime_cursor (my bandwidths, t, & my bandwidthCursor);
+	if (! (frequency <= 0.5 / samplingPeriod && isdefined (bandwidth)))
+		return;
+	if (my isAntiResonator && frequency <= 0.0 && bandwidth <= 0.0) {
+		my nextA = 1.0;
+		my nextB = -2.0;
+		my nextC = 1.0;
+		return;
+	}
+	const double r = exp (-NUMpi * samplingPeriod * bandwidth);
+	my nextC = - (r * r);
+	my nextB = 2.0 * r * cos (2.0 * NUMpi * frequency * samplingPeriod);
+	my nextA = 1.0 - my nextB - my nextC;
+	if (my isAntiResonator)
+		my nextA = 1.0 / (1.0 - my nextB - my nextC);
+	else if (! my normaliseAtDC)
+		my nextA = (1.0 + my nextC) * sin (2.0 * NUMpi * frequency * samplingPeriod);
+	if (my amplitudes_dB) {
+		const double amplitude_dB = RealTier_getValueAtTime_cursor (my amplitudes_dB, t, & my amplitudeCursor);
+		my nextGain_dB = ( isdefined (amplitude_dB) ? amplitude_dB : 0.0 );
+	}
+}
+
+static void FormantSections_init (FormantSections *me, FormantFilterSection *sections, integer numberOfSections,
+	double x1, double dx, integer nx)
+{
+	my sections = sections;
+	my numberOfSections = numberOfSections;
+	my x1 = x1;
+	my dx = dx;
+	my nx = nx;
+	my controlInterval = ( Melder_debug == 65 ? 1 : FormantFilter_CONTROL_INTERVAL );
+	my nextControlSample = 1;
+	for (integer isection = 0; isection < numberOfSections; isection ++) {
+		FormantFilterSection *section = & sections [isection];
+		section -> frequencyCursor = section -> bandwidthCursor = section -> amplitudeCursor = 1;
+		section -> a = 1.0;   // all-pass until the first coefficients are known
+		section -> b = section -> c = section -> p1 = section -> p2 = 0.0;
+		section -> gain_dB = 0.0;
+		FormantFilterSection_computeNextCoefficients (section, x1, dx);
+	}
+}
+
+/*
+	Starts the control block at sample `firstSample`, where the coefficients are those computed for it before.
+*/
+static void FormantSections_startControlBlock (FormantSections *me, integer firstSample) {
+	integer nextControlSample = firstSample + my controlInterval;
+	for (integer isection = 0; isection < my numberOfSections; isection ++) {
+		FormantFilterSection *section = & my sections [isection];
+		section -> a = section -> nextA;
+		section -> b = section -> nextB;
+		section -> c = section -> nextC;
+		section -> gain_dB = section -> nextGain_dB;
+		section -> gain = DB_to_A (section -> gain_dB);
+		if (my controlInterval > 1) {
+			RealTier_limitControlBlock_cursor (section -> frequencies, section -> frequencyCursor, me, firstSample, & nextControlSample);
+			RealTier_limitControlBlock_cursor (section -> bandwidths, section -> bandwidthCursor, me, firstSample, & nextControlSample);
+			if (section -> amplitudes_dB)
+				RealTier_limitControlBlock_cursor (section -> amplitudes_dB, section -> amplitudeCursor, me, firstSample, & nextControlSample);
+		}
+	}
+	/*
+		The coefficients move towards those at the next control sample (the last block keeps its coefficients).
+	*/
+	const integer blockSize = nextControlSample - firstSample;
+	for (integer isection = 0; isection < my numberOfSections; isection ++) {
+		FormantFilterSection *section = & my sections [isection];
+		if (nextControlSample <= my nx)
+			FormantFilterSection_computeNextCoefficients (section, my x1 + (nextControlSample - 1) * my dx, my dx);
+		section -> da = (section -> nextA - section -> a) / blockSize;
+		section -> db = (section -> nextB - section -> b) / blockSize;
+		section -> dc = (section -> nextC - section -> c) / blockSize;
+		section -> gainFactor = ( isfinite (section -> gain_dB) && isfinite (section -> nextGain_dB) ?
+				DB_to_A ((section -> nextGain_dB - section -> gain_dB) / blockSize) : 1.0 );
+	}
+	my nextControlSample = nextControlSample;
+}
+
+/*
+	Filters x, which holds the samples from `firstSample` on, and continues where the previous call stopped.
+*/
+static void FormantSections_filter_inplace (FormantSections *me, VEC const& x, integer firstSample) {
+	if (my numberOfSections == 0)
+		return;
+	double *z = & x [1] - firstSample;
+	const integer lastSample = firstSample + x.size - 1;
+	for (integer isample = firstSample; isample <= lastSample; ) {
+		if (isample == my nextControlSample)
+			FormantSections_startControlBlock (me, isample);
+		const integer lastSampleInBlock = std::min (my nextControlSample - 1, lastSample);
+		for (; isample <= lastSampleInBlock; isample ++) {
+			double value = z [isample];
+			for (integer isection = 0; isection < my numberOfSections; isection ++) {
+				FormantFilterSection *section = & my sections [isection];
+				if (section -> isAntiResonator) {
+					const double y = section -> a * (value - section -> b * section -> p1 - section -> c * section -> p2);
+					section -> p2 = section -> p1;
+					section -> p1 = value;
+					value = y;
+				} else {
+					const double y = section -> a * section -> gain * value + section -> b * section -> p1 + section -> c * section -> p2;
+					section -> p2 = section -> p1;
+					section -> p1 = y;
+					value = y;
+				}
+				section -> a += section -> da;
+				section -> b += section -> db;
+				section -> c += section -> dc;
+				section -> gain *= section -> gainFactor;
+			}
+			z [isample] = value;
+		}
+	}
+}
+
+static void Sound_filterWithFormantFilterSections_inplace (Sound me, FormantFilterSection *sections, integer numberOfSections) {
+	FormantSections series;
+	FormantSections_init (& series, sections, numberOfSections, my x1, my dx, my nx);
+	FormantSections_filter_inplace (& series, my z.row (1), 1);
+}
+
+static FormantFilterSection FormantFilterSection_init (RealTier frequencies, RealTier bandwidths, RealTier amplitudes_dB,
+	bool isAntiResonator, bool normaliseAtDC)
+{
+	FormantFilterSection section { };
+	section.frequencies = frequencies;
+	section.bandwidths = bandwidths;
+	section.amplitudes_dB = amplitudes_dB;
+	section.isAntiResonator = isAntiResonator;
+	section.normaliseAtDC = normaliseAtDC;
+	return section;
+}
+
+static void FormantGrid_appendFormantFilterSection (FormantGrid me, integer iformant, bool antiformant,
+	vector <FormantFilterSection> const& sections, integer *inout_numberOfSections)
+{
+	sections [++ *inout_numberOfSections] = FormantFilterSection_init (my formants.at [iformant], my bandwidths.at [iformant],
+			nullptr, antiformant, true);
+}
+
 static void _Sound_FormantGrid_filterWithOneFormant_inplace (Sound me, FormantGrid thee, integer iformant, bool antiformant) {
 	if (iformant < 1 || iformant > thy formants.size) {
 		Melder_warning (U"Formant ", iformant, U" does not exist.");
@@ -491,21 +719,8 @@ static void _Sound_FormantGrid_filterWithOneFormant_inplace (Sound me, FormantGr
 		return;
 	Melder_require (ftier -> points.size != 0 && btier -> points.size != 0,
 		U"Tier should not be empty,");
-	const double nyquist = 0.5 / my dx;
-	autoFilter r;
-	if (antiformant)
-		r = AntiResonator_create (my dx);
-	else
-		r = Resonator_create (my dx, true);
-
-	for (integer is = 1; is <= my nx; is ++) {
-		const double t = my x1 + (is - 1) * my dx;
-		const double f = RealTier_getValueAtTime (ftier, t);
-		const double b = RealTier_getValueAtTime (btier, t);
-		if (f <= nyquist && isdefined (b))
-			Filter_setCoefficients (r.get(), f, b);
-		my z [1] [is] = Filter_getOutput (r.get(), my z [1] [is]);
-	}
+	FormantFilterSection section = FormantFilterSection_init (ftier, btier, nullptr, antiformant, true);
+	Sound_filterWithFormantFilterSections_inplace (me, & section, 1);
 }
 
 void Sound_FormantGrid_filterWithOneAntiFormant_inplace (Sound me, FormantGrid thee, integer iformant) {
@@ -519,8 +734,6 @@ void Sound_FormantGrid_filterWithOneFormant_inplace (Sound me, FormantGrid thee,
 void Sound_FormantGrid_Intensities_filterWithOneFormant_inplace (Sound me, FormantGrid thee, OrderedOf<structIntensityTier>* amplitudes, integer iformant) {
 	try {
 		Melder_require (iformant > 0 && iformant <= thy formants.size, U"Formant ", iformant, U" not defined.");
-		
-		const double nyquist = 0.5 / my dx;
 
 		const RealTier ftier = thy formants.at [iformant];
 		const RealTier btier = thy bandwidths.at [iformant];
@@ -528,24 +741,12 @@ void Sound_FormantGrid_Intensities_filterWithOneFormant_inplace (Sound me, Forma
 
 		if (ftier -> points.size == 0 || btier -> points.size == 0 || atier -> points.size == 0)
 			return;    // nothing to do
-		autoResonator r = Resonator_create (my dx, false);
-		for (integer is = 1; is <= my nx; is ++) {
-			const double t = my x1 + (is - 1) * my dx;
-			const double f = RealTier_getValueAtTime (ftier, t);
-			const double b = RealTier_getValueAtTime (btier, t);
-			if (f <= nyquist && isdefined (b)) {
-				Filter_setCoefficients (r.get(), f, b);
-				const double a = RealTier_getValueAtTime (atier, t);
-				if (isdefined (a))
-					r -> a *= DB_to_A (a);
-			}
-			my z [1] [is] = Filter_getOutput (r.get(), my z [1] [is]);
-		}
+		FormantFilterSection section = FormantFilterSection_init (ftier, btier, atier, false, false);
+		Sound_filterWithFormantFilterSections_inplace (me, & section, 1);
 	} catch (MelderError) {
 		Melder_throw (me, U": not filtered with one formant filter.");
 	}
 }
-
 autoSound Sound_FormantGrid_Intensities_filter (Sound me, FormantGrid thee, OrderedOf<structIntensityTier>* amplitudes, integer iformantb, integer iformante, int alternatingSign) {
 	try {
 		if (iformantb > iformante) {
@@ -876,10 +1077,11 @@ static void Sound_PhonationGrid_spectralTilt_inplace (Sound thee, PhonationGrid
 
 		const double cosf = cos (NUM2pi * 3000.0 * thy dx); // samplingFrequency > 6000.0 !
 		double ynm1 = 0.0;
+		integer cursor = 1;
 
 		for (integer i = 1; i <= thy nx; i ++) {
 			const double t = thy x1 + (i - 1) * thy dx;
-			const double tilt_db = RealTier_getValueAtTime (my spectralTilt.get(), t);
+			const double tilt_db = RealTier_getValueAtTime_cursor (my spectralTilt.get(), t, & cursor);
 
 			if (tilt_db > 0) {
 				const double d = pow (10.0, -tilt_db / 10.0);
@@ -1037,6 +1239,55 @@ autoPhonationTier PhonationGrid_to_PhonationTier (PhonationGrid me) {
 	}
 }
 
+/*
+	The shape x^power1 - x^power2 (0 <= x <= 1) of the open phase of a glottal pulse, as a table of its values
+	and its derivatives (times the step) at GlottalFlowTable_NUMBER_OF_STEPS equal steps, for cubic Hermite interpolation.
+	For powers of at least 2 the error stays below 1e-6 of the peak flow (1e-10 for the default powers 3 and 4);
+	for smaller powers the shape is too sharp at x = 0, and the flow is computed directly, as it is with Melder_debug 66.
+	`normalization` makes the peak of the shape equal to 1.
+	Successive glottal pulses mostly have the same powers, so that the table is only rebuilt when they change.
+*/
+#define GlottalFlowTable_NUMBER_OF_STEPS  256
+
+struct GlottalFlowTable {
+	double power1, power2, normalization;
+	bool isTabulated;
+	double value [1 + GlottalFlowTable_NUMBER_OF_STEPS], slope [1 + GlottalFlowTable_NUMBER_OF_STEPS];
+};
+
+static void GlottalFlowTable_select (GlottalFlowTable *me, double power1, double power2) {
+	if (power1 == my power1 && power2 == my power2)
+		return;
+	my power1 = power1;
+	my power2 = power2;
+	/*
+		Maximum of U(x) = x^n - x^m is where the derivative U'(x) = n x^(n-1) - m x^(m-1) == 0,
+		i.e. (n/m) = x^(m-n), so xmax = (n/m)^(1/(m-n))
+		U(xmax) = x^n (1-x^(m-n)) = (n/m)^(n/(m-n))(1-n/m)
+	*/
+	my normalization = 1.0 / (pow (power1 / power2, 1.0 / (power2 / power1 - 1.0)) * (1.0 - power1 / power2));
+	my isTabulated = ( power1 >= 2.0 && Melder_debug != 66 );
+	if (! my isTabulated)
+		return;
+	constexpr double step = 1.0 / GlottalFlowTable_NUMBER_OF_STEPS;
+	my value [0] = my slope [0] = 0.0;
+	for (integer i = 1; i <= GlottalFlowTable_NUMBER_OF_STEPS; i ++) {
+		const double x = i * step, x1 = pow (x, power1), x2 = pow (x, power2);
+		my value [i] = x1 - x2;
+		my slope [i] = (power1 * x1 - power2 * x2) / x * step;
+	}
+}
+
+static inline double GlottalFlowTable_getShape (const GlottalFlowTable *me, double phase) {
+	if (! my isTabulated || phase > 1.0)
+		return pow (phase, my power1) - pow (phase, my power2);
+	const double position = phase * GlottalFlowTable_NUMBER_OF_STEPS;
+	const integer i = std::min (integer (position), integer (GlottalFlowTable_NUMBER_OF_STEPS - 1));
+	const double t = position - i, t2 = t * t, t3 = t2 * t;
+	return (2.0 * t3 - 3.0 * t2 + 1.0) * my value [i] + (t3 - 2.0 * t2 + t) * my slope [i] +
+			(3.0 * t2 - 2.0 * t3) * my value [i + 1] + (t3 - t2) * my slope [i + 1];
+}
+
 static autoSound PhonationGrid_PhonationTier_to_Sound_voiced (PhonationGrid me, PhonationTier thee, double samplingFrequency) {
 	try {
 		const PhonationGridPlayOptions p = my options.get();
@@ -1059,6 +1310,7 @@ static autoSound PhonationGrid_PhonationTier_to_Sound_voiced (PhonationGrid me,
 				Generate the period.
 		*/
 		VEC sound = his z.row (1);
+		GlottalFlowTable flowTable { };
 		for (integer it = 1; it <= thy points.size; it ++) {
 			PhonationPoint point = thy points.at [it];
 			const double t = point -> number;		// the glottis "closing" point
@@ -1074,14 +1326,12 @@ static autoSound PhonationGrid_PhonationTier_to_Sound_voiced (PhonationGrid me,
 			//- double amplitude = pulseScale * (power1 + power2 + 1.0) / (power2 - power1);
 			//- amplitude /= period * openPhase;
 
-			// Maximum of U(x) = x^n - x^m is where the derivative U'(x) = n x^(n-1) - m x^(m-1) == 0,
-			//	i.e. (n/m) = x^(m-n), so xmax = (n/m)^(1/(m-n))
-			//	U(xmax) = x^n (1-x^(m-n)) = (n/m)^(n/(m-n))(1-n/m)
-
-			const double amplitude = pulseScale / (pow (power1 / power2, 1.0 / (power2 / power1 - 1.0)) * (1.0 - power1 / power2));
+			GlottalFlowTable_select (& flowTable, power1, power2);
+			const double amplitude = pulseScale * flowTable.normalization;
 
 			// Fill in the samples to the left of the current point.
 
+			const double breathinessAmplitude = ( breathy ? DBSPL_to_A (RealTier_getValueAtTime (my breathinessAmplitude.get(), t)) : 0.0 );
 			integer midSample = Sampled_xToLowIndex (him.get(), t), beginSample;
 			beginSample = midSample - Melder_ifloor (te / his dx);
 			if (beginSample < 1)
@@ -1092,7 +1342,7 @@ static autoSound PhonationGrid_PhonationTier_to_Sound_voiced (PhonationGrid me,
 				const double tsamp = his x1 + (i - 1) * his dx;
 				phase = (tsamp - (t - te)) / (period * openPhase);
 				if (phase > 0.0) {
-					flow = amplitude * (pow (phase, power1) - pow (phase, power2));
+					flow = amplitude * GlottalFlowTable_getShape (& flowTable, phase);
 					if (i == 0) {
 						lastVal = flow;    // For the derivative
 						continue;
@@ -1102,8 +1352,7 @@ static autoSound PhonationGrid_PhonationTier_to_Sound_voiced (PhonationGrid me,
 					// Breathiness only during open part modulated by the flow
 					if (breathy) {
 						double val = flow * NUMrandomUniform (-1.0, 1.0);
-						double a = RealTier_getValueAtTime (my breathinessAmplitude.get(), t);
-						breathy -> z [1] [i] += val * DBSPL_to_A (a);
+						breathy -> z [1] [i] += val * breathinessAmplitude;
 					}
 				}
 			}
@@ -1114,7 +1363,7 @@ static autoSound PhonationGrid_PhonationTier_to_Sound_voiced (PhonationGrid me,
 
 			//- double flow = amplitude * (period * openPhase) * (pow (phase, power1) - pow (phase, power2));
 
-			flow = amplitude * (pow (phase, power1) - pow (phase, power2));
+			flow = amplitude * GlottalFlowTable_getShape (& flowTable, phase);
 
 			// Fill in the samples to the right of the current point.
 
@@ -1145,9 +1394,10 @@ static autoSound PhonationGrid_PhonationTier_to_Sound_voiced (PhonationGrid me,
 			Vector_scale (him.get(), extremum);
 		}
 
+		integer cursor = 1;
 		for (integer i = 1; i <= his nx; i ++) {
 			const double t = his x1 + (i - 1) * his dx;
-			his z [1] [i] *= DBSPL_to_A (RealTier_getValueAtTime (my voicingAmplitude.get(), t));
+			his z [1] [i] *= DBSPL_to_A (RealTier_getValueAtTime_cursor (my voicingAmplitude.get(), t, & cursor));
 			if (breathy)
 				his z [1] [i] += breathy -> z [1] [i];
 		}
@@ -1504,119 +1754,146 @@ static void VocalTractGrid_CouplingGrid_draw (VocalTractGrid me, CouplingGrid th
 	Graphics_unsetInner (g);
 }
 
-static autoSound Sound_VocalTractGrid_CouplingGrid_filter_cascade (Sound me, VocalTractGrid thee, CouplingGrid coupling) {
-	try {
-		const VocalTractGridPlayOptions pv = thy options.get();
-		const CouplingGridPlayOptions pc = coupling -> options.get();
-		const bool useOpenGlottisInfo = pc -> openglottis && coupling && coupling -> glottis && coupling -> glottis -> points.size > 0;
-		const FormantGrid oral_formants = thy oral_formants.get();
-		const FormantGrid nasal_formants = thy nasal_formants.get();
-		const FormantGrid nasal_antiformants = thy nasal_antiformants.get();
-		const FormantGrid tracheal_formants = coupling -> tracheal_formants.get();
-		const FormantGrid tracheal_antiformants = coupling -> tracheal_antiformants.get();
-
-		const integer numberOfFormants = oral_formants -> formants.size;
-		const integer numberOfTrachealFormants = tracheal_formants -> formants.size;
-		const integer numberOfTrachealAntiFormants = tracheal_antiformants -> formants.size;
-		const integer numberOfNasalFormants = nasal_formants -> formants.size;
-		const integer numberOfNasalAntiFormants = nasal_antiformants -> formants.size;
-		check_formants (numberOfFormants, & pv -> startOralFormant, & pv -> endOralFormant);
-		check_formants (numberOfNasalFormants, & pv -> startNasalFormant, & pv -> endNasalFormant);
-		check_formants (numberOfTrachealFormants, & pc -> startTrachealFormant, & pc -> endTrachealFormant);
-		check_formants (numberOfNasalAntiFormants, & pv -> startNasalAntiFormant, & pv -> endNasalAntiFormant);
-		check_formants (numberOfTrachealAntiFormants, & pc -> startTrachealAntiFormant, & pc -> endTrachealAntiFormant);
-
-		autoSound him = Data_copy (me);
-
-		autoFormantGrid formants;
-		if (useOpenGlottisInfo) {
-			formants = Data_copy (thy oral_formants.get());
-			FormantGrid_CouplingGrid_updateOpenPhases (formants.get(), coupling);
-		}
+/*
+	The oral formants of the cascade and parallel models: with the open-phase corrections if the coupling asks for them
+	(then a copy is returned), otherwise the oral formants themselves (then the returned object is empty).
+*/
+static autoFormantGrid VocalTractGrid_CouplingGrid_getOpenPhaseFormants (VocalTractGrid me, CouplingGrid coupling, FormantGrid *out_oralFormants) {
+	const CouplingGridPlayOptions pc = coupling -> options.get();
+	const bool useOpenGlottisInfo = pc -> openglottis && coupling -> glottis && coupling -> glottis -> points.size > 0;
+	autoFormantGrid formants;
+	if (useOpenGlottisInfo) {
+		formants = Data_copy (my oral_formants.get());
+		FormantGrid_CouplingGrid_updateOpenPhases (formants.get(), coupling);
+	}
+	*out_oralFormants = ( formants ? formants.get() : my oral_formants.get() );
+	return formants;
+}
 
-		integer nasal_formant_warning = 0, any_warning = 0;
-		if (pv -> endNasalFormant > 0) {   // nasal formants
-			for (integer iformant = pv -> startNasalFormant; iformant <= pv -> endNasalFormant; iformant ++) {
-				if (FormantGrid_isFormantDefined (thy nasal_formants.get(), iformant)) {
-					_Sound_FormantGrid_filterWithOneFormant_inplace (him.get(), thy nasal_formants.get(), iformant, false);
-				} else {
-					// Melder_warning ("Nasal formant", iformant, ": frequency and/or bandwidth missing.");
-					nasal_formant_warning ++;
-					any_warning ++;
-				}
+/*
+	All the resonators and antiresonators of the cascade model, in the order in which they filter.
+*/
+static autovector <FormantFilterSection> VocalTractGrid_CouplingGrid_getCascadeSections (VocalTractGrid me, CouplingGrid coupling,
+	FormantGrid oral_formants, integer *out_numberOfSections)
+{
+	const VocalTractGridPlayOptions pv = my options.get();
+	const CouplingGridPlayOptions pc = coupling -> options.get();
+	const FormantGrid nasal_formants = my nasal_formants.get();
+	const FormantGrid nasal_antiformants = my nasal_antiformants.get();
+	const FormantGrid tracheal_formants = coupling -> tracheal_formants.get();
+	const FormantGrid tracheal_antiformants = coupling -> tracheal_antiformants.get();
+
+	const integer numberOfFormants = oral_formants -> formants.size;
+	const integer numberOfTrachealFormants = tracheal_formants -> formants.size;
+	const integer numberOfTrachealAntiFormants = tracheal_antiformants -> formants.size;
+	const integer numberOfNasalFormants = nasal_formants -> formants.size;
+	const integer numberOfNasalAntiFormants = nasal_antiformants -> formants.size;
+	check_formants (numberOfFormants, & pv -> startOralFormant, & pv -> endOralFormant);
+	check_formants (numberOfNasalFormants, & pv -> startNasalFormant, & pv -> endNasalFormant);
+	check_formants (numberOfTrachealFormants, & pc -> startTrachealFormant, & pc -> endTrachealFormant);
+	check_formants (numberOfNasalAntiFormants, & pv -> startNasalAntiFormant, & pv -> endNasalAntiFormant);
+	check_formants (numberOfTrachealAntiFormants, & pc -> startTrachealAntiFormant, & pc -> endTrachealAntiFormant);
+
+	autovector <FormantFilterSection> sections = newvectorzero <FormantFilterSection> (numberOfNasalFormants +
+			numberOfNasalAntiFormants + numberOfTrachealFormants + numberOfTrachealAntiFormants + numberOfFormants);
+	integer numberOfSections = 0;
+
+	integer nasal_formant_warning = 0, any_warning = 0;
+	if (pv -> endNasalFormant > 0) {   // nasal formants
+		for (integer iformant = pv -> startNasalFormant; iformant <= pv -> endNasalFormant; iformant ++) {
+			if (FormantGrid_isFormantDefined (nasal_formants, iformant)) {
+				FormantGrid_appendFormantFilterSection (nasal_formants, iformant, false, sections.get(), & numberOfSections);
+			} else {
+				// Melder_warning ("Nasal formant", iformant, ": frequency and/or bandwidth missing.");
+				nasal_formant_warning ++;
+				any_warning ++;
 			}
 		}
+	}
 
-		integer nasal_antiformant_warning = 0;
-		if (pv -> endNasalAntiFormant > 0) {   // nasal antiformants
-			for (integer iformant = pv -> startNasalAntiFormant; iformant <= pv -> endNasalAntiFormant; iformant ++) {
-				if (FormantGrid_isFormantDefined (thy nasal_antiformants.get(), iformant)) {
-					_Sound_FormantGrid_filterWithOneFormant_inplace (him.get(), thy nasal_antiformants.get(), iformant, true);
-				} else {
-					// Melder_warning ("Nasal antiformant", iformant, ": frequency and/or bandwidth missing.");
-					nasal_antiformant_warning ++;
-					any_warning ++;
-				}
+	integer nasal_antiformant_warning = 0;
+	if (pv -> endNasalAntiFormant > 0) {   // nasal antiformants
+		for (integer iformant = pv -> startNasalAntiFormant; iformant <= pv -> endNasalAntiFormant; iformant ++) {
+			if (FormantGrid_isFormantDefined (nasal_antiformants, iformant)) {
+				FormantGrid_appendFormantFilterSection (nasal_antiformants, iformant, true, sections.get(), & numberOfSections);
+			} else {
+				// Melder_warning ("Nasal antiformant", iformant, ": frequency and/or bandwidth missing.");
+				nasal_antiformant_warning ++;
+				any_warning ++;
 			}
 		}
+	}
 
-		integer tracheal_formant_warning = 0;
-		if (pc -> endTrachealFormant > 0) {   // tracheal formants
-			for (integer iformant = pc -> startTrachealFormant; iformant <= pc -> endTrachealFormant; iformant ++) {
-				if (FormantGrid_isFormantDefined (tracheal_formants, iformant)) {
-					_Sound_FormantGrid_filterWithOneFormant_inplace (him.get(), tracheal_formants, iformant, false);
-				} else {
-					// Melder_warning ("Tracheal formant", iformant, ": frequency and/or bandwidth missing.");
-					tracheal_formant_warning ++;
-					any_warning ++;
-				}
+	integer tracheal_formant_warning = 0;
+	if (pc -> endTrachealFormant > 0) {   // tracheal formants
+		for (integer iformant = pc -> startTrachealFormant; iformant <= pc -> endTrachealFormant; iformant ++) {
+			if (FormantGrid_isFormantDefined (tracheal_formants, iformant)) {
+				FormantGrid_appendFormantFilterSection (tracheal_formants, iformant, false, sections.get(), & numberOfSections);
+			} else {
+				// Melder_warning ("Tracheal formant", iformant, ": frequency and/or bandwidth missing.");
+				tracheal_formant_warning ++;
+				any_warning ++;
 			}
 		}
+	}
 
-		integer tracheal_antiformant_warning = 0;
-		if (pc -> endTrachealAntiFormant > 0) {   // tracheal antiformants
-			for (integer iformant = pc -> startTrachealAntiFormant; iformant <= pc -> endTrachealAntiFormant; iformant ++) {
-				if (FormantGrid_isFormantDefined (tracheal_antiformants, iformant)) {
-					_Sound_FormantGrid_filterWithOneFormant_inplace (him.get(), tracheal_antiformants, iformant, true);
-				} else {
-					// Melder_warning ("Tracheal antiformant", iformant, ": frequency and/or bandwidth missing.");
-					tracheal_antiformant_warning ++;
-					any_warning ++;
-				}
+	integer tracheal_antiformant_warning = 0;
+	if (pc -> endTrachealAntiFormant > 0) {   // tracheal antiformants
+		for (integer iformant = pc -> startTrachealAntiFormant; iformant <= pc -> endTrachealAntiFormant; iformant ++) {
+			if (FormantGrid_isFormantDefined (tracheal_antiformants, iformant)) {
+				FormantGrid_appendFormantFilterSection (tracheal_antiformants, iformant, true, sections.get(), & numberOfSections);
+			} else {
+				// Melder_warning ("Tracheal antiformant", iformant, ": frequency and/or bandwidth missing.");
+				tracheal_antiformant_warning ++;
+				any_warning ++;
 			}
 		}
+	}
 
-		integer oral_formant_warning = 0;
-		if (pv -> endOralFormant > 0) {   // oral formants
-			if (! formants)
-				formants = Data_copy (thy oral_formants.get());
-
-			for (integer iformant = pv -> startOralFormant; iformant <= pv -> endOralFormant; iformant ++) {
-				if (FormantGrid_isFormantDefined (formants.get(), iformant)) {
-					_Sound_FormantGrid_filterWithOneFormant_inplace (him.get(), formants.get(), iformant, false);
-				} else {
-					// Melder_warning ("Oral formant", iformant, ": frequency and/or bandwidth missing.");
-					oral_formant_warning ++;
-					any_warning ++;
-				}
+	integer oral_formant_warning = 0;
+	if (pv -> endOralFormant > 0) {   // oral formants
+		for (integer iformant = pv -> startOralFormant; iformant <= pv -> endOralFormant; iformant ++) {
+			if (FormantGrid_isFormantDefined (oral_formants, iformant)) {
+				FormantGrid_appendFormantFilterSection (oral_formants, iformant, false, sections.get(), & numberOfSections);
+			} else {
+				// Melder_warning ("Oral formant", iformant, ": frequency and/or bandwidth missing.");
+				oral_formant_warning ++;
+				any_warning ++;
 			}
 		}
-		if (any_warning > 0)
-		{
-			autoMelderString warning;
-			if (nasal_formant_warning > 0)
-				MelderString_append (& warning, U"\tNasal formants: one or more are missing.\n");
-			if (nasal_antiformant_warning)
-				MelderString_append (& warning, U"\tNasal antiformants: one or more are missing.\n");
-			if (tracheal_formant_warning)
-				MelderString_append (& warning, U"\tTracheal formants: one or more are missing.\n");
-			if (tracheal_antiformant_warning)
-				MelderString_append (& warning, U"\tTracheal antiformants: one or more are missing.\n");
-			if (oral_formant_warning)
-				MelderString_append (& warning, U"\tOral formants: one or more are missing.\n");
-			MelderInfo_write (U"\nWarning:\n", warning.string);
-			MelderInfo_drain ();
-		}
+	}
+	if (any_warning > 0)
+	{
+		autoMelderString warning;
+		if (nasal_formant_warning > 0)
+			MelderString_append (& warning, U"\tNasal formants: one or more are missing.\n");
+		if (nasal_antiformant_warning)
+			MelderString_append (& warning, U"\tNasal antiformants: one or more are missing.\n");
+		if (tracheal_formant_warning)
+			MelderString_append (& warning, U"\tTracheal formants: one or more are missing.\n");
+		if (tracheal_antiformant_warning)
+			MelderString_append (& warning, U"\tTracheal antiformants: one or more are missing.\n");
+		if (oral_formant_warning)
+			MelderString_append (& warning, U"\tOral formants: one or more are missing.\n");
+		MelderInfo_write (U"\nWarning:\n", warning.string);
+		MelderInfo_drain ();
+	}
+	*out_numberOfSections = numberOfSections;
+	return sections;
+}
+
+static autoSound Sound_VocalTractGrid_CouplingGrid_filter_cascade (Sound me, VocalTractGrid thee, CouplingGrid coupling) {
+	try {
+		autoSound him = Data_copy (me);
+		FormantGrid oral_formants;
+		autoFormantGrid openPhaseFormants = VocalTractGrid_CouplingGrid_getOpenPhaseFormants (thee, coupling, & oral_formants);
+		/*
+			All the resonators and antiresonators of the cascade in one pass.
+		*/
+		integer numberOfSections;
+		autovector <FormantFilterSection> sections = VocalTractGrid_CouplingGrid_getCascadeSections (thee, coupling, oral_formants, & numberOfSections);
+		if (numberOfSections > 0)
+			Sound_filterWithFormantFilterSections_inplace (him.get(), & sections [1], numberOfSections);
 		return him;
 	} catch (MelderError) {
 		Melder_throw (me, U": not filtered by vocaltract and coupling grid.");
@@ -2793,6 +3070,519 @@ void KlattGrid_play (KlattGrid me) {
 	KlattGrid_playSpecial (me);
 }
 
+/************************* KlattGridRenderer **************************************************/
+
+/*
+	A glottal pulse of PhonationGrid_PhonationTier_to_Sound_voiced (), with the numbers that do not change from sample to sample.
+	The open phase runs from sample beginSample to sample midSample (neither clipped to the sound),
+	the return phase from sample midSample + 1 to sample endSample.
+*/
+struct GlottalPulse {
+	double time, te, openDuration, power1, power2, amplitude;
+	double returnValue, returnFactor;   // the flow at sample midSample + 1 and its decay per sample
+	double breathinessAmplitude;
+	integer beginSample, midSample, endSample;
+};
+
+Thing_define (KlattGridRenderer, Thing) {
+	autoKlattGrid klattGrid;   // a copy, with the glottal closures of its play options
+	autoFormantGrid openPhaseFormants;
+	double x1, dx;
+	integer nx, numberOfRenderedSamples, blockCapacity;
+	bool voicing, flowDerivative, breathiness, spectralTilt, aspiration, vocalTract, frication, fricationBypass;
+	/*
+		The source.
+	*/
+	autovector <GlottalPulse> pulses;
+	integer numberOfPulses, firstActivePulse, maximumOpenSamples;
+	double initialFlow, previousFlow, flowDerivativeScale;
+	GlottalFlowTable flowTable;
+	integer voicingAmplitudeCursor, spectralTiltCursor, aspirationCursor;
+	double spectralTiltMemory, aspirationMemory;
+	/*
+		The filters: the cascade, or the branches of the parallel model and of the frication filter,
+		each branch a single formant with its input and sign.
+	*/
+	bool isCascade, needsDifference;
+	autovector <FormantFilterSection> cascadeSections, branchSections;
+	FormantSections cascade;
+	autovector <FormantSections> branches;
+	autoINTVEC branchInputs;   // 1: source, 2: differentiated source, 3: frication noise
+	autoVEC branchSigns;
+	integer numberOfBranchSections, numberOfBranches;
+	double differenceScale, previousSource;
+	integer fricationAmplitudeCursor, bypassCursor;
+	double fricationMemory;
+	autoVEC source, breathy, difference, noise, branch;
+};
+
+Thing_implement (KlattGridRenderer, Thing, 0);
+
+static double GlottalPulse_getFlow (GlottalPulse *me, GlottalFlowTable *flowTable, integer isample, double x1, double dx) {
+	if (isample >= my beginSample && isample <= my midSample) {
+		const double phase = (x1 + (isample - 1) * dx - (my time - my te)) / my openDuration;
+		if (phase <= 0.0)
+			return 0.0;
+		GlottalFlowTable_select (flowTable, my power1, my power2);
+		return my amplitude * GlottalFlowTable_getShape (flowTable, phase);
+	}
+	if (isample > my midSample && isample <= my endSample)
+		return my returnValue * pow (my returnFactor, isample - my midSample - 1);
+	return 0.0;
+}
+
+static void KlattGridRenderer_initPulses (KlattGridRenderer me) {
+	const PhonationGrid phonation = my klattGrid -> phonation.get();
+	const PhonationTier glottis = my klattGrid -> coupling -> glottis.get();
+	Melder_require (phonation -> voicingAmplitude -> points.size > 0,
+		U"Voicing amplitude tier should not be empty.");
+	my pulses = newvectorzero <GlottalPulse> (glottis -> points.size);
+	my numberOfPulses = glottis -> points.size;
+	my initialFlow = undefined;
+	double maximumOpenDuration = 0.0;
+	for (integer ipulse = 1; ipulse <= my numberOfPulses; ipulse ++) {
+		const PhonationPoint point = glottis -> points.at [ipulse];
+		GlottalPulse *pulse = & my pulses [ipulse];
+		pulse -> time = point -> number;
+		pulse -> te = point -> te;
+		pulse -> openDuration = point -> period * point -> openPhase;
+		pulse -> power1 = point -> power1;
+		pulse -> power2 = point -> power2;
+		GlottalFlowTable_select (& my flowTable, pulse -> power1, pulse -> power2);
+		pulse -> amplitude = point -> pulseScale * my flowTable.normalization;
+		pulse -> midSample = Melder_ifloor ((pulse -> time - my x1) / my dx + 1.0);
+		pulse -> beginSample = std::max (0_integer, pulse -> midSample - Melder_ifloor (pulse -> te / my dx));
+		maximumOpenDuration = std::max (maximumOpenDuration, pulse -> te);
+		if (my breathiness)
+			pulse -> breathinessAmplitude = DBSPL_to_A (RealTier_getValueAtTime (phonation -> breathinessAmplitude.get(), pulse -> time));
+		/*
+			The return phase.
+		*/
+		pulse -> endSample = pulse -> midSample;
+		const double phase = pulse -> te / pulse -> openDuration;
+		const double flow = pulse -> amplitude * GlottalFlowTable_getShape (& my flowTable, phase);
+		if (flow > 0.0) {
+			const double ta = point -> collisionPhase * pulse -> openDuration;
+			pulse -> returnFactor = exp (- my dx / ta);
+			pulse -> returnValue = flow * exp (- (my x1 + pulse -> midSample * my dx - pulse -> time) / ta);
+			pulse -> endSample = pulse -> midSample + Melder_ifloor (20.0 * ta / my dx);
+		}
+		if (pulse -> beginSample == 0 && pulse -> midSample >= 0) {
+			const double phase0 = (my x1 - my dx - (pulse -> time - pulse -> te)) / pulse -> openDuration;
+			if (phase0 > 0.0)
+				my initialFlow = pulse -> amplitude * GlottalFlowTable_getShape (& my flowTable, phase0);   // for the derivative
+		}
+	}
+	my maximumOpenSamples = Melder_iceiling (maximumOpenDuration / my dx) + 1;
+	if (isundef (my initialFlow))
+		my initialFlow = 0.0;
+	/*
+		KlattGrid_to_Sound () scales the flow derivative to the peak of the whole flow,
+		which is not known before the end. Here the peaks of the flow and of its derivative are taken from every pulse separately,
+		at the samples where the flow of a pulse and its derivative have their extremes.
+	*/
+	my flowDerivativeScale = 1.0;
+	if (my flowDerivative) {
+		double flowExtremum = 0.0, derivativeExtremum = 0.0;
+		for (integer ipulse = 1; ipulse <= my numberOfPulses; ipulse ++) {
+			GlottalPulse *pulse = & my pulses [ipulse];
+			const double ratio = pulse -> power1 / pulse -> power2, difference = pulse -> power2 - pulse -> power1;
+			const double maximumFlowPhase = pow (ratio, 1.0 / difference);
+			const double inflectionPhase = pow (ratio * (pulse -> power1 - 1.0) / (pulse -> power2 - 1.0), 1.0 / difference);
+			const double startTime = pulse -> time - pulse -> te;
+			const integer candidates [] = {
+				Melder_ifloor ((startTime + maximumFlowPhase * pulse -> openDuration - my x1) / my dx + 1.0),
+				Melder_ifloor ((startTime + inflectionPhase * pulse -> openDuration - my x1) / my dx + 1.0),
+				pulse -> midSample
+			};
+			for (integer icandidate = 0; icandidate < 3; icandidate ++)
+				for (integer isample = candidates [icandidate] - 1; isample <= candidates [icandidate] + 2; isample ++) {
+					if (isample < 1 || isample > my nx)
+						continue;
+					const double flow = GlottalPulse_getFlow (pulse, & my flowTable, isample, my x1, my dx);
+					const double previousFlow = ( isample == 1 ? my initialFlow : GlottalPulse_getFlow (pulse, & my flowTable, isample - 1, my x1, my dx) );
+					flowExtremum = std::max (flowExtremum, fabs (flow));
+					derivativeExtremum = std::max (derivativeExtremum, fabs (flow - previousFlow));
+				}
+		}
+		if (derivativeExtremum > 0.0)
+			my flowDerivativeScale = flowExtremum / derivativeExtremum;
+	}
+}
+
+constexpr integer KlattGridRenderer_SOURCE_PASS_BLOCK_SIZE = 4096;
+
+static void KlattGridRenderer_reserve (KlattGridRenderer me, integer numberOfSamples) {
+	if (numberOfSamples <= my blockCapacity)
+		return;
+	my source = newVECraw (numberOfSamples);
+	my breathy = newVECraw (numberOfSamples);
+	my difference = newVECraw (numberOfSamples);
+	my noise = newVECraw (numberOfSamples);
+	my branch = newVECraw (numberOfSamples);
+	my blockCapacity = numberOfSamples;
+}
+
+static void KlattGridRenderer_resetSource (KlattGridRenderer me) {
+	my firstActivePulse = 1;
+	my previousFlow = my initialFlow;
+	my voicingAmplitudeCursor = my spectralTiltCursor = my aspirationCursor = 1;
+	my spectralTiltMemory = my aspirationMemory = 0.0;
+}
+
+/*
+	The samples from firstSample on of PhonationGrid_to_Sound (), before the vocal tract.
+	Without noise, breathiness and aspiration are left out and no random numbers are drawn.
+*/
+static void KlattGridRenderer_renderSource (KlattGridRenderer me, integer firstSample, VEC const& out, bool withNoise) {
+	const PhonationGrid phonation = my klattGrid -> phonation.get();
+	const bool breathiness = my breathiness && withNoise;
+	const integer lastSample = firstSample + out.size - 1;
+	double *z = & out [1] - firstSample;
+	out  <<=  0.0;
+	if (my voicing) {
+		VEC breathy = my breathy.part (1, out.size);
+		double *zb = & breathy [1] - firstSample;
+		if (breathiness)
+			breathy  <<=  0.0;
+		while (my firstActivePulse <= my numberOfPulses &&
+				std::max (my pulses [my firstActivePulse]. midSample, my pulses [my firstActivePulse]. endSample) < firstSample)
+			my firstActivePulse ++;
+		for (integer ipulse = my firstActivePulse; ipulse <= my numberOfPulses; ipulse ++) {
+			GlottalPulse *pulse = & my pulses [ipulse];
+			if (pulse -> midSample - my maximumOpenSamples > lastSample)
+				break;
+			const integer openStart = std::max (pulse -> beginSample, firstSample);
+			const integer openEnd = std::min (std::min (pulse -> midSample, my nx), lastSample);
+			if (openStart <= openEnd)
+				GlottalFlowTable_select (& my flowTable, pulse -> power1, pulse -> power2);
+			for (integer isample = openStart; isample <= openEnd; isample ++) {
+				const double phase = (my x1 + (isample - 1) * my dx - (pulse -> time - pulse -> te)) / pulse -> openDuration;
+				if (phase > 0.0) {
+					const double flow = pulse -> amplitude * GlottalFlowTable_getShape (& my flowTable, phase);
+					z [isample] += flow;
+					if (breathiness)
+						zb [isample] += flow * NUMrandomUniform (-1.0, 1.0) * pulse -> breathinessAmplitude;
+				}
+			}
+			if (pulse -> midSample < my nx) {
+				const integer returnStart = std::max (pulse -> midSample + 1, firstSample);
+				const integer returnEnd = std::min (std::min (pulse -> endSample, my nx), lastSample);
+				if (returnStart <= returnEnd) {
+					double value = pulse -> returnValue * pow (pulse -> returnFactor, returnStart - pulse -> midSample - 1);
+					for (integer isample = returnStart; isample <= returnEnd; isample ++) {
+						z [isample] += value;
+						value *= pulse -> returnFactor;
+					}
+				}
+			}
+		}
+		if (my flowDerivative)
+			for (integer isample = firstSample; isample <= lastSample; isample ++) {
+				const double flow = z [isample];
+				z [isample] = (flow - my previousFlow) * my flowDerivativeScale;
+				my previousFlow = flow;
+			}
+		for (integer isample = firstSample; isample <= lastSample; isample ++) {
+			const double t = my x1 + (isample - 1) * my dx;
+			z [isample] *= DBSPL_to_A (RealTier_getValueAtTime_cursor (phonation -> voicingAmplitude.get(), t, & my voicingAmplitudeCursor));
+			if (breathiness)
+				z [isample] += zb [isample];
+		}
+		if (my spectralTilt) {
+			const double cosf = cos (NUM2pi * 3000.0 * my dx);
+			for (integer isample = firstSample; isample <= lastSample; isample ++) {
+				const double t = my x1 + (isample - 1) * my dx;
+				const double tilt_db = RealTier_getValueAtTime_cursor (phonation -> spectralTilt.get(), t, & my spectralTiltCursor);
+				if (tilt_db > 0) {
+					const double d = pow (10.0, -tilt_db / 10.0);
+					const double q = (1.0 - d * cosf) / (1.0 - d);
+					const double b = q - sqrt (q * q - 1.0);
+					const double a = 1.0 - b;
+					z [isample] = a * z [isample] + b * my spectralTiltMemory;
+					my spectralTiltMemory = z [isample];
+				}
+			}
+		}
+	}
+	if (my aspiration && withNoise) {
+		for (integer isample = firstSample; isample <= lastSample; isample ++) {
+			const double t = my x1 + (isample - 1) * my dx;
+			double val = NUMrandomUniform (-1.0, 1.0);
+			const double a = DBSPL_to_A (RealTier_getValueAtTime_cursor (phonation -> aspirationAmplitude.get(), t, & my aspirationCursor));
+			if (isdefined (a)) {
+				my aspirationMemory = val + 0.75 * my aspirationMemory;
+				my aspirationMemory = (val += 0.75 * my aspirationMemory);   // soft low-pass, as in PhonationGrid_to_Sound_aspiration ()
+				z [isample] += val * a;
+			}
+		}
+	}
+}
+
+static void KlattGridRenderer_addBranch (KlattGridRenderer me, FormantGrid formants, OrderedOf<structIntensityTier>* amplitudes,
+	integer iformant, integer input, double sign)
+{
+	FormantFilterSection *section = nullptr;
+	if (iformant >= 1 && iformant <= formants -> formants.size) {
+		const RealTier ftier = formants -> formants.at [iformant];
+		const RealTier btier = formants -> bandwidths.at [iformant];
+		const IntensityTier atier = amplitudes -> at [iformant];
+		if (ftier -> points.size > 0 && btier -> points.size > 0 && atier -> points.size > 0) {
+			section = & my branchSections [++ my numberOfBranchSections];
+			*section = FormantFilterSection_init (ftier, btier, atier, false, false);
+		}
+	}
+	const integer ibranch = ++ my numberOfBranches;
+	FormantSections_init (& my branches [ibranch], section, section ? 1 : 0, my x1, my dx, my nx);
+	my branchInputs [ibranch] = input;
+	my branchSigns [ibranch] = sign;
+}
+
+/*
+	The branches of Sound_VocalTractGrid_CouplingGrid_filter_parallel () and Sound_FricationGrid_filter (), in their order.
+*/
+static void KlattGridRenderer_initBranches (KlattGridRenderer me, FormantGrid oral_formants) {
+	const VocalTractGrid vocalTract = my klattGrid -> vocalTract.get();
+	const CouplingGrid coupling = my klattGrid -> coupling.get();
+	const FricationGrid frication = my klattGrid -> frication.get();
+	const VocalTractGridPlayOptions pv = vocalTract -> options.get();
+	const CouplingGridPlayOptions pc = coupling -> options.get();
+	const FricationGridPlayOptions pf = frication -> options.get();
+	const integer maximumNumberOfBranches = oral_formants -> formants.size + vocalTract -> nasal_formants -> formants.size +
+			coupling -> tracheal_formants -> formants.size + frication -> frication_formants -> formants.size + 2;
+	my branchSections = newvectorzero <FormantFilterSection> (maximumNumberOfBranches);
+	my numberOfBranchSections = 0;
+	my branches = newvectorzero <FormantSections> (maximumNumberOfBranches);
+	my branchInputs = newINTVECzero (maximumNumberOfBranches);
+	my branchSigns = newVECzero (maximumNumberOfBranches);
+	my numberOfBranches = 0;
+	if (my vocalTract && ! my isCascade) {
+		check_formants (oral_formants -> formants.size, & pv -> startOralFormant, & pv -> endOralFormant);
+		check_formants (vocalTract -> nasal_formants -> formants.size, & pv -> startNasalFormant, & pv -> endNasalFormant);
+		check_formants (coupling -> tracheal_formants -> formants.size, & pc -> startTrachealFormant, & pc -> endTrachealFormant);
+		bool hasOutput = false;
+		if (pv -> endOralFormant > 0 && pv -> startOralFormant == 1) {
+			KlattGridRenderer_addBranch (me, oral_formants, & vocalTract -> oral_formants_amplitudes, 1, 1, 1.0);
+			hasOutput = true;
+		}
+		if (pv -> endNasalFormant > 0) {
+			for (integer iformant = pv -> startNasalFormant; iformant <= pv -> endNasalFormant; iformant ++)
+				if (FormantGrid_Intensities_isFormantDefined (vocalTract -> nasal_formants.get(), & vocalTract -> nasal_formants_amplitudes, iformant))
+					KlattGridRenderer_addBranch (me, vocalTract -> nasal_formants.get(), & vocalTract -> nasal_formants_amplitudes, iformant, 1, 1.0);
+			hasOutput = true;
+		}
+		if (pv -> endOralFormant >= 2) {
+			const integer startOralFormant2 = std::max (pv -> startOralFormant, 2_integer);
+			double sign = ( startOralFormant2 % 2 == 0 ? -1.0 : 1.0 );   // 2 starts with negative sign
+			if (startOralFormant2 <= oral_formants -> formants.size) {
+				for (integer iformant = startOralFormant2; iformant <= pv -> endOralFormant; iformant ++)
+					if (FormantGrid_Intensities_isFormantDefined (oral_formants, & vocalTract -> oral_formants_amplitudes, iformant)) {
+						KlattGridRenderer_addBranch (me, oral_formants, & vocalTract -> oral_formants_amplitudes, iformant, 2, sign);
+						sign = - sign;
+					}
+				hasOutput = true;
+			}
+		}
+		if (pc -> endTrachealFormant > 0) {
+			for (integer iformant = pc -> startTrachealFormant; iformant <= pc -> endTrachealFormant; iformant ++)
+				if (FormantGrid_Intensities_isFormantDefined (coupling -> tracheal_formants.get(), & coupling -> tracheal_formants_amplitudes, iformant))
+					KlattGridRenderer_addBranch (me, coupling -> tracheal_formants.get(), & coupling -> tracheal_formants_amplitudes, iformant, 2, 1.0);
+			hasOutput = true;
+		}
+		if (! hasOutput)
+			KlattGridRenderer_addBranch (me, oral_formants, & vocalTract -> oral_formants_amplitudes, 0, 1, 1.0);   // no filter
+	}
+	if (my frication) {
+		check_formants (frication -> frication_formants -> formants.size, & pf -> startFricationFormant, & pf -> endFricationFormant);
+		bool hasOutput = false;
+		if (pf -> endFricationFormant > 1) {
+			const integer startFricationFormant2 = std::max (pf -> startFricationFormant, 2_integer);
+			double sign = ( startFricationFormant2 % 2 == 0 ? 1.0 : -1.0 );   // 2 starts with positive sign
+			for (integer iformant = startFricationFormant2; iformant <= pf -> endFricationFormant; iformant ++)
+				if (FormantGrid_Intensities_isFormantDefined (frication -> frication_formants.get(), & frication -> frication_formants_amplitudes, iformant)) {
+					KlattGridRenderer_addBranch (me, frication -> frication_formants.get(), & frication -> frication_formants_amplitudes, iformant, 3, sign);
+					sign = - sign;
+				}
+			hasOutput = true;
+		}
+		if (! hasOutput)
+			KlattGridRenderer_addBranch (me, frication -> frication_formants.get(), & frication -> frication_formants_amplitudes, 0, 3, 1.0);   // no filter
+	}
+}
+
+autoKlattGridRenderer KlattGridRenderer_create (KlattGrid me) {
+	try {
+		autoKlattGridRenderer thee = Thing_new (KlattGridRenderer);
+		thy klattGrid = Data_copy (me);
+		const KlattGrid klattGrid = thy klattGrid.get();
+		const PhonationGridPlayOptions pp = klattGrid -> phonation -> options.get();
+		const FricationGridPlayOptions pf = klattGrid -> frication -> options.get();
+		const double samplingFrequency = klattGrid -> options -> samplingFrequency;
+		/*
+			The samples of Sound_createEmptyMono ().
+		*/
+		thy nx = Melder_iceiling ((my xmax - my xmin) * samplingFrequency);
+		thy dx = 1.0 / samplingFrequency;
+		thy x1 = 0.5 * (my xmin + my xmax) - 0.5 * (thy nx - 1) * thy dx;
+		thy blockCapacity = 0;
+
+		thy voicing = pp -> voicing;
+		thy flowDerivative = pp -> voicing && pp -> flowDerivative;
+		thy breathiness = pp -> voicing && pp -> breathiness && klattGrid -> phonation -> breathinessAmplitude -> points.size > 0;
+		thy spectralTilt = pp -> voicing && pp -> spectralTilt && klattGrid -> phonation -> spectralTilt -> points.size > 0;
+		thy aspiration = pp -> aspiration && klattGrid -> phonation -> aspirationAmplitude -> points.size > 0;
+		thy vocalTract = pp -> voicing || pp -> aspiration;
+		thy frication = pf -> endFricationFormant > 0 || pf -> bypass;
+		thy fricationBypass = pf -> bypass;
+		if (thy voicing) {
+			KlattGrid_setGlottisCoupling (klattGrid);
+			KlattGridRenderer_initPulses (thee.get());
+		}
+
+		FormantGrid oral_formants;
+		thy openPhaseFormants = VocalTractGrid_CouplingGrid_getOpenPhaseFormants (klattGrid -> vocalTract.get(), klattGrid -> coupling.get(), & oral_formants);
+		thy isCascade = thy vocalTract && klattGrid -> vocalTract -> options -> filterModel == kKlattGridFilterModel::CASCADE;
+		integer numberOfCascadeSections = 0;
+		if (thy isCascade)
+			thy cascadeSections = VocalTractGrid_CouplingGrid_getCascadeSections (klattGrid -> vocalTract.get(), klattGrid -> coupling.get(),
+					oral_formants, & numberOfCascadeSections);
+		FormantSections_init (& thy cascade, numberOfCascadeSections > 0 ? & thy cascadeSections [1] : nullptr, numberOfCascadeSections,
+				thy x1, thy dx, thy nx);
+		KlattGridRenderer_initBranches (thee.get(), oral_formants);
+
+		/*
+			Sound_VocalTractGrid_CouplingGrid_filter_parallel () scales the differentiated source so that its peak
+			equals that of the source. The peaks are taken from the voiced source without its noise,
+			which goes through once, in blocks that are not kept, so that no random numbers are drawn here.
+		*/
+		thy differenceScale = 1.0;
+		thy needsDifference = false;
+		for (integer ibranch = 1; ibranch <= thy numberOfBranches; ibranch ++)
+			if (thy branchInputs [ibranch] == 2)
+				thy needsDifference = true;
+		KlattGridRenderer_reserve (thee.get(), KlattGridRenderer_SOURCE_PASS_BLOCK_SIZE);
+		if (thy needsDifference && thy voicing) {
+			KlattGridRenderer_resetSource (thee.get());
+			double sourceExtremum = 0.0, differenceExtremum = 0.0, previous = 0.0;
+			for (integer firstSample = 1; firstSample <= thy nx; firstSample += KlattGridRenderer_SOURCE_PASS_BLOCK_SIZE) {
+				VEC block = thy source.part (1, std::min (KlattGridRenderer_SOURCE_PASS_BLOCK_SIZE, thy nx - firstSample + 1));
+				KlattGridRenderer_renderSource (thee.get(), firstSample, block, false);
+				for (integer i = 1; i <= block.size; i ++) {
+					sourceExtremum = std::max (sourceExtremum, fabs (block [i]));
+					differenceExtremum = std::max (differenceExtremum, fabs (block [i] - previous));
+					previous = block [i];
+				}
+			}
+			if (differenceExtremum > 0.0)
+				thy differenceScale = sourceExtremum / differenceExtremum;
+		}
+		KlattGridRenderer_resetSource (thee.get());
+		thy previousSource = 0.0;
+		thy fricationAmplitudeCursor = thy bypassCursor = 1;
+		thy fricationMemory = 0.0;
+		thy numberOfRenderedSamples = 0;
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": no KlattGridRenderer created.");
+	}
+}
+
+integer KlattGridRenderer_getNumberOfSamples (KlattGridRenderer me) {
+	return my nx;
+}
+
+integer KlattGridRenderer_renderBlock (KlattGridRenderer me, VEC const& out) {
+	const integer firstSample = my numberOfRenderedSamples + 1;
+	const integer numberOfSamples = std::min (out.size, my nx - my numberOfRenderedSamples);
+	if (numberOfSamples <= 0)
+		return 0;
+	KlattGridRenderer_reserve (me, numberOfSamples);
+	VEC result = out.part (1, numberOfSamples);
+	VEC source = my source.part (1, numberOfSamples);
+	VEC difference = my difference.part (1, numberOfSamples);
+	VEC noise = my noise.part (1, numberOfSamples);
+	VEC branch = my branch.part (1, numberOfSamples);
+	result  <<=  0.0;
+	if (my vocalTract) {
+		KlattGridRenderer_renderSource (me, firstSample, source, true);
+		if (my isCascade) {
+			result  <<=  source;
+			FormantSections_filter_inplace (& my cascade, result, firstSample);
+		}
+		if (my needsDifference)
+			for (integer i = 1; i <= numberOfSamples; i ++) {
+				difference [i] = (source [i] - my previousSource) * my differenceScale;
+				my previousSource = source [i];
+			}
+	}
+	if (my frication) {
+		const FricationGrid frication = my klattGrid -> frication.get();
+		for (integer i = 1; i <= numberOfSamples; i ++) {
+			const double t = my x1 + (firstSample + i - 2) * my dx;
+			double val = NUMrandomUniform (-1.0, 1.0);
+			double a = 0.0;
+			if (frication -> fricationAmplitude -> points.size > 0) {
+				const double dba = RealTier_getValueAtTime_cursor (frication -> fricationAmplitude.get(), t, & my fricationAmplitudeCursor);
+				a = ( isdefined (dba) ? DBSPL_to_A (dba) : 0.0 );
+			}
+			my fricationMemory = (val += 0.75 * my fricationMemory);
+			noise [i] = val * a;
+		}
+	}
+	for (integer ibranch = 1; ibranch <= my numberOfBranches; ibranch ++) {
+		const integer input = my branchInputs [ibranch];
+		branch  <<=  ( input == 1 ? source : input == 2 ? difference : noise );
+		FormantSections_filter_inplace (& my branches [ibranch], branch, firstSample);
+		const double sign = my branchSigns [ibranch];
+		for (integer i = 1; i <= numberOfSamples; i ++)
+			result [i] += sign * branch [i];
+	}
+	if (my fricationBypass) {
+		const FricationGrid frication = my klattGrid -> frication.get();
+		if (frication -> bypass -> points.size > 0)
+			for (integer i = 1; i <= numberOfSamples; i ++) {
+				const double t = my x1 + (firstSample + i - 2) * my dx;
+				const double val = RealTier_getValueAtTime_cursor (frication -> bypass.get(), t, & my bypassCursor);
+				result [i] += noise [i] * ( isundef (val) ? 0.0 : DB_to_A (val) );
+			}
+	}
+	my numberOfRenderedSamples += numberOfSamples;
+	return numberOfSamples;
+}
+
+void KlattGrid_render (KlattGrid me, integer blockSize, KlattGrid_RenderCallback callback, void *closure) {
+	try {
+		Melder_require (blockSize > 0,
+			U"The block size should be positive.");
+		autoKlattGridRenderer renderer = KlattGridRenderer_create (me);
+		autoVEC block = newVECraw (blockSize);
+		integer numberOfSamples;
+		while ((numberOfSamples = KlattGridRenderer_renderBlock (renderer.get(), block.get())) > 0)
+			callback (closure, block.part (1, numberOfSamples));
+	} catch (MelderError) {
+		Melder_throw (me, U": not rendered.");
+	}
+}
+
+autoSound KlattGrid_to_Sound_blockwise (KlattGrid me, integer blockSize) {
+	try {
+		Melder_require (blockSize > 0,
+			U"The block size should be positive.");
+		autoSound thee = Sound_createEmptyMono (my xmin, my xmax, my options -> samplingFrequency);
+		autoKlattGridRenderer renderer = KlattGridRenderer_create (me);
+		Melder_assert (KlattGridRenderer_getNumberOfSamples (renderer.get()) == thy nx);
+		for (integer firstSample = 1; firstSample <= thy nx; firstSample += blockSize) {
+			const integer numberOfSamples = std::min (blockSize, thy nx - firstSample + 1);
+			KlattGridRenderer_renderBlock (renderer.get(), thy z.row (1).part (firstSample, firstSample + numberOfSamples - 1));
+		}
+		if (my options -> scalePeak)
+			Vector_scale (thee.get(), 0.99);
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": no Sound created.");
+	}
+}
+
 /************************* Sound(s) & KlattGrid **************************************************/
 
 autoSound Sound_KlattGrid_filter_frication (Sound me, KlattGrid thee) {
@@ -216,6 +216,35 @@ autoSound KlattGrid_to_Sound (KlattGrid me);
 
 autoSound KlattGrid_to_Sound_phonation (KlattGrid me);
 
+/*
+	Rendering in blocks of samples, with the play options of the KlattGrid.
+	The renderer works on a copy of the KlattGrid and keeps the state of the source and of every filter
+	between blocks, so that the memory does not grow with the duration and the first block is ready
+	long before the last one is computed. The sample grid is that of KlattGrid_to_Sound (), and
+	without noise sources the result does not depend on the block sizes. Differences with KlattGrid_to_Sound ():
+	- no peak scaling;
+	- the flow derivative is scaled to the peaks of the separate glottal pulses instead of the peak of the whole flow;
+	- the noise sources draw their random numbers in a different order;
+	- for the parallel filter model, the derivative of the source is scaled to the peaks of the voiced source
+	  without breathiness and aspiration noise, and not scaled at all without voicing; KlattGridRenderer_create ()
+	  computes that noise-free source once, so that its duration does grow with the duration of the KlattGrid.
+	KlattGridRenderer_renderBlock () fills `out` with the next samples and returns their number,
+	which is less than out.size at the end and 0 after it.
+*/
+Thing_declare (KlattGridRenderer);
+
+autoKlattGridRenderer KlattGridRenderer_create (KlattGrid me);
+
+integer KlattGridRenderer_getNumberOfSamples (KlattGridRenderer me);
+
+integer KlattGridRenderer_renderBlock (KlattGridRenderer me, VEC const& out);
+
+typedef void (*KlattGrid_RenderCallback) (void *closure, constVEC const& block);
+
+void KlattGrid_render (KlattGrid me, integer blockSize, KlattGrid_RenderCallback callback, void *closure);
+
+autoSound KlattGrid_to_Sound_blockwise (KlattGrid me, integer blockSize);   // with peak scaling if the play options say so
+
 int KlattGrid_synthesize (KlattGrid me, double t1, double t2, double samplingFrequency, double maximumPeriod);
 
 /*
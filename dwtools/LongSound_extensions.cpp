@@ -43,6 +43,8 @@
 #endif
 
 #include "NUM2.h"
+#include "Intensity_extensions.h"
+#include "Sound_extensions.h"
 #include <errno.h>
 
 /*
@@ -246,4 +248,33 @@ void LongSounds_appendToExistingSoundFile (OrderedOf<structSampled>* me, MelderF
 	}
 }
 
+autoTextGrid LongSound_to_TextGrid_detectSilences (LongSound me, double minPitch, double timeStep,
+	double silenceThreshold, double minSilenceDuration, double minSoundingDuration,
+	conststring32 silentLabel, conststring32 soundingLabel)
+{
+	try {
+		autoStreamingIntensity analyser = StreamingIntensity_createForSampled (me, my numberOfChannels, minPitch, timeStep);
+		autoVEC intensities = newVECraw (0);
+		constexpr integer blockSize = 65536;
+		autoMAT block = newMATraw (my numberOfChannels, blockSize);
+		autoMelderProgress progress (U"Detecting silences...");
+		for (integer firstSample = 1; firstSample <= my nx; firstSample += blockSize) {
+			const integer numberOfSamples = std::min (blockSize, my nx - firstSample + 1);
+			if (numberOfSamples < blockSize)
+				block = newMATraw (my numberOfChannels, numberOfSamples);
+			LongSound_readAudioToFloat (me, block.get(), firstSample);
+			StreamingIntensity_processBlock (analyser.get(), block.get(), intensities);
+			Melder_progress ((double) firstSample / my nx, U"Analysed ", Melder_fixed ((firstSample - 1) * my dx, 1), U" of ",
+					Melder_fixed (my nx * my dx, 1), U" seconds");
+		}
+		StreamingIntensity_flush (analyser.get(), intensities);
+		Melder_assert (intensities.size == analyser -> numberOfFrames);
+		autoIntensity intensity = Intensity_create (my xmin, my xmax, analyser -> numberOfFrames, analyser -> timeStep, analyser -> firstFrameTime);
+		intensity -> z.row (1)  <<=  intensities.all();
+		return Intensity_to_TextGrid_detectSilences (intensity.get(), silenceThreshold, minSilenceDuration, minSoundingDuration, silentLabel, soundingLabel);
+	} catch (MelderError) {
+		Melder_throw (me, U": no TextGrid with silences created.");
+	}
+}
+
 /* End of file LongSound_extensions.cpp */
@@ -25,9 +25,18 @@
 */
 
 #include "LongSound.h"
+#include "TextGrid.h"
 
 void LongSounds_writeToStereoAudioFile16 (LongSound me, LongSound thee, int audioFileType, MelderFile file);
 
 void LongSounds_appendToExistingSoundFile (OrderedOf<structSampled>* me, MelderFile file);
 
+autoTextGrid LongSound_to_TextGrid_detectSilences (LongSound me, double minPitch, double timeStep,
+	double silenceThreshold, double minSilenceDuration, double minSoundingDuration,
+	conststring32 silentLabel, conststring32 soundingLabel);
+/*
+	The intervals of Sound_to_TextGrid_detectSilences () on the whole LongSound,
+	with the intensity analysed block by block as the samples are read from the file.
+*/
+
 #endif /* _LongSound_extensions_h_ */
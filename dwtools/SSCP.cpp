@@ -780,8 +780,9 @@ void SSCP_unExpand (SSCP me) {
 }
 
 void SSCP_expandLowerCholeskyInverse (SSCP me) {
-	if (NUMisEmpty (my lowerCholeskyInverse.get()))
-		my lowerCholeskyInverse = newMATraw (my numberOfColumns, my numberOfColumns);
+	const integer numberOfRowsOfInverse = ( my numberOfRows == 1 ? 1 : my numberOfColumns );   // a diagonal inverse is one row, see NUMmahalanobisDistanceSquared
+	if (my lowerCholeskyInverse.nrow != numberOfRowsOfInverse || my lowerCholeskyInverse.ncol != my numberOfColumns)
+		my lowerCholeskyInverse = newMATraw (numberOfRowsOfInverse, my numberOfColumns);
 	if (my numberOfRows == 1) {   // diagonal
 		my lnd = 0.0;
 		for (integer j = 1; j <= my numberOfColumns; j ++) {
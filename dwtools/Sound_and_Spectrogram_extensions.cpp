@@ -31,6 +31,8 @@
 #include "Sound_to_Pitch.h"
 #include "Vector.h"
 #include "NUM2.h"
+#include "LongSound.h"
+#include "MelderThread.h"
 
 autoSound BandFilterSpectrogram_as_Sound (BandFilterSpectrogram me, int to_dB);
 
@@ -43,7 +45,7 @@ autoSound BandFilterSpectrogram_as_Sound (BandFilterSpectrogram me, int to_dB);
 	where erf(x) = 1 - erfc(x) and n is the windowLength in samples.
 	To compare with the rectangular window we need to divide this by the window width (n -1) x 1^2.
 */
-static void _Spectrogram_windowCorrection (Spectrogram me, integer numberOfSamples_window) {
+static double _Spectrogram_windowCorrectionFactor (integer numberOfSamples_window) {
 	double windowFactor = 1.0;
 	if (numberOfSamples_window > 1) {
 		const double e12 = exp (-12);
@@ -54,7 +56,11 @@ static void _Spectrogram_windowCorrection (Spectrogram me, integer numberOfSampl
 		const double p1 = 4 * NUMsqrtpi * NUMsqrt3 * e12 * (1 - NUMerfcc (arg1)) * (numberOfSamples_window + 1);
 		windowFactor =  (p2 - p1 + 24 * (numberOfSamples_window - 1) * e12 * e12) / denum;
 	}
-	my z.get()  /=  windowFactor;
+	return windowFactor;
+}
+
+static void _Spectrogram_windowCorrection (Spectrogram me, integer numberOfSamples_window) {
+	my z.get()  /=  _Spectrogram_windowCorrectionFactor (numberOfSamples_window);
 }
 
 static autoSpectrum Sound_to_Spectrum_power (Sound me) {
@@ -83,6 +89,193 @@ static autoSpectrum Sound_to_Spectrum_power (Sound me) {
 	}
 }
 
+/*
+	The filter-bank analyses below (Bark, Mel, and Mel followed by the cepstrum) share one engine.
+	The power spectrum of every frame is that of Sound_to_Spectrum_power () applied to the windowed frame,
+	but computed without any objects, with one FFT table per thread.
+	The filter bank is a sparse matrix in compressed-row form that is computed once:
+	filter `ifilter` has the weights `weight [k]` on the frequency bins `bin [k]`,
+	for k from `firstWeight [ifilter]` to `firstWeight [ifilter + 1] - 1`.
+	The frames are independent and are analysed in parallel, a block of frames at a time,
+	so that only the samples of one block have to be in memory; this is how a LongSound is analysed.
+	Melder_debug 59 selects the original frame-by-frame analysis via a Spectrum object per frame.
+*/
+struct FilterBankWeights {
+	autoINTVEC firstWeight, bin;
+	autoVEC weight;
+};
+
+static void Sampled_getFrameSpectrumSize (Sampled me, double windowDuration,
+	integer *out_numberOfSamples_window, integer *out_fftLength, integer *out_numberOfBins, double *out_binWidth)
+{
+	const double samplingFrequency = 1.0 / my dx;
+	const integer numberOfSamples_window = Melder_iround (windowDuration * samplingFrequency);   // as in Sound_createSimple ()
+	integer fftLength = 2;   // as in Sound_to_Spectrum (fast)
+	while (fftLength < numberOfSamples_window)
+		fftLength *= 2;
+	const double samplingPeriod = 1.0 / samplingFrequency;   // the `dx` of the frame
+	*out_numberOfSamples_window = numberOfSamples_window;
+	*out_fftLength = fftLength;
+	*out_numberOfBins = fftLength / 2 + 1;
+	*out_binWidth = 1.0 / (samplingPeriod * fftLength);
+}
+
+/*
+	`getWeight (ifilter, ibin)` is called for the bins from `binRange (ifilter) .first` to `.second`;
+	only the nonzero weights are kept.
+*/
+template <typename BinRangeFunction, typename WeightFunction>
+static FilterBankWeights FilterBankWeights_create (integer numberOfFilters,
+	BinRangeFunction const& getBinRange, WeightFunction const& getWeight)
+{
+	FilterBankWeights result;
+	result.firstWeight = newINTVECraw (numberOfFilters + 1);
+	integer numberOfWeights = 0;
+	for (integer ifilter = 1; ifilter <= numberOfFilters; ifilter ++) {
+		const std::pair <integer, integer> range = getBinRange (ifilter);
+		for (integer ibin = range.first; ibin <= range.second; ibin ++)
+			if (getWeight (ifilter, ibin) != 0.0)
+				numberOfWeights ++;
+	}
+	result.bin = newINTVECraw (numberOfWeights);
+	result.weight = newVECraw (numberOfWeights);
+	integer iweight = 0;
+	for (integer ifilter = 1; ifilter <= numberOfFilters; ifilter ++) {
+		result.firstWeight [ifilter] = iweight + 1;
+		const std::pair <integer, integer> range = getBinRange (ifilter);
+		for (integer ibin = range.first; ibin <= range.second; ibin ++) {
+			const double weight = getWeight (ifilter, ibin);
+			if (weight != 0.0) {
+				iweight ++;
+				result.bin [iweight] = ibin;
+				result.weight [iweight] = weight;
+			}
+		}
+	}
+	Melder_assert (iweight == numberOfWeights);
+	result.firstWeight [numberOfFilters + 1] = numberOfWeights + 1;
+	return result;
+}
+
+/*
+	Analyses the frames of the first channel of `me` (a Sound or a LongSound), frame `iframe` being centred at
+	`t1 + (iframe - 1) * dt`, as Sampled_indexToX () would give for the target.
+	`getSamples (firstSample, lastSample)` should return those samples of the first channel (1 <= firstSample <= lastSample <= my nx);
+	it is called once per block, and the samples it returns have to stay valid until the next call.
+	`emitFrames (firstFrame, powers, cepstra)` receives the results of a block of frames:
+	the window-corrected filter-bank powers (filter by frame) and, if `wantCepstra`, the cosine transforms
+	of their dB values (frame by coefficient, as in BandFilterSpectrogram_into_CC (), with c0 first).
+*/
+template <typename GetSamplesFunction, typename EmitFramesFunction>
+static void Sampled_analyseFilterBank (Sampled me, double windowDuration, integer numberOfFrames, double t1, double dt,
+	FilterBankWeights const& filterBank, bool wantCepstra,
+	GetSamplesFunction const& getSamples, EmitFramesFunction const& emitFrames)
+{
+	integer numberOfSamples_window, fftLength, numberOfBins;
+	double binWidth;
+	Sampled_getFrameSpectrumSize (me, windowDuration, & numberOfSamples_window, & fftLength, & numberOfBins, & binWidth);
+	const double samplingFrequency = 1.0 / my dx;
+	autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
+	Melder_assert (window -> nx == numberOfSamples_window);
+	const double samplingPeriod = window -> dx;
+	const double powerScale = 2.0 * binWidth / (window -> xmax - window -> xmin);   // as in Sound_to_Spectrum_power ()
+	const double windowFactor = _Spectrogram_windowCorrectionFactor (numberOfSamples_window);
+	const integer numberOfFilters = filterBank.firstWeight.size - 1;
+	autoMAT cosinesTable;
+	if (wantCepstra)
+		cosinesTable = MATcosinesTable (numberOfFilters);
+	/*
+		At most 10 seconds of frames per block, and no more than 4096 frames.
+	*/
+	const integer numberOfFramesPerBlock = Melder_clipped (1_integer, Melder_ifloor (10.0 / dt), std::min (numberOfFrames, 4096_integer));
+	autoMAT powers = newMATraw (numberOfFilters, numberOfFramesPerBlock);
+	autoMAT cepstra = newMATraw (wantCepstra ? numberOfFramesPerBlock : 0, numberOfFilters);
+	/*
+		Per-thread work space: an FFT table (whose first part is scratch for the FFT), a frame, a power spectrum,
+		and a dB spectrum.
+	*/
+	constexpr integer maximumNumberOfThreads = 16;
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfFramesPerBlock, 20, maximumNumberOfThreads);
+	autoNUMfft_Table fftTables [1 + maximumNumberOfThreads];
+	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+		NUMfft_Table_init (& fftTables [ithread], fftLength);
+	autoMAT frames = newMATraw (numberOfThreads, fftLength);
+	autoMAT powerSpectra = newMATraw (numberOfThreads, numberOfBins);
+	autoMAT dBSpectra = newMATraw (numberOfThreads, numberOfFilters);
+
+	auto getStartSample = [&] (integer iframe) {   // as in Sound_into_Sound ()
+		return Sampled_xToNearestIndex (me, t1 + (iframe - 1) * dt - windowDuration / 2.0);
+	};
+	for (integer firstFrameOfBlock = 1; firstFrameOfBlock <= numberOfFrames; firstFrameOfBlock += numberOfFramesPerBlock) {
+		const integer lastFrameOfBlock = std::min (firstFrameOfBlock + numberOfFramesPerBlock - 1, numberOfFrames);
+		const integer numberOfFramesInBlock = lastFrameOfBlock - firstFrameOfBlock + 1;
+		/*
+			The frames start at nondecreasing samples, so the samples of the block are all those that its frames need.
+		*/
+		const integer firstSample = std::max (1_integer, getStartSample (firstFrameOfBlock));
+		const integer lastSample = std::min (my nx, getStartSample (lastFrameOfBlock) + numberOfSamples_window - 1);
+		const constVEC samples = ( firstSample <= lastSample ? getSamples (firstSample, lastSample) : constVEC () );
+		Melder_assert (samples.size == std::max (0_integer, lastSample - firstSample + 1));
+
+		MelderThread_run (numberOfThreads, [&] (integer ithread) {
+			integer firstFrame, lastFrame;
+			MelderThread_getRange (numberOfFramesInBlock, numberOfThreads, ithread, & firstFrame, & lastFrame);
+			VEC frame = frames.row (ithread), power = powerSpectra.row (ithread);
+			for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
+				const integer offset = getStartSample (firstFrameOfBlock - 1 + iframe) - 1;
+				for (integer i = 1; i <= numberOfSamples_window; i ++) {
+					const integer j = offset + i;
+					frame [i] = ( j < firstSample || j > lastSample ? 0.0 : samples [j - firstSample + 1] ) * window -> z [1] [i];
+				}
+				frame.part (numberOfSamples_window + 1, fftLength) <<= 0.0;
+				NUMfft_forward (& fftTables [ithread], frame);
+				for (integer ibin = 1; ibin <= numberOfBins; ibin ++) {
+					const double re = ( ibin == 1 ? frame [1] : ibin == numberOfBins ? frame [fftLength] : frame [ibin + ibin - 2] ) * samplingPeriod;
+					const double im = ( ibin == 1 || ibin == numberOfBins ? 0.0 : frame [ibin + ibin - 1] * samplingPeriod );
+					power [ibin] = powerScale * (re * re + im * im);
+				}
+				power [1] *= 0.5;
+				power [numberOfBins] *= 0.5;   // bins at 0 Hz and Nyquist don't count for two
+				for (integer ifilter = 1; ifilter <= numberOfFilters; ifilter ++) {
+					longdouble p = 0.0;
+					for (integer k = filterBank.firstWeight [ifilter]; k < filterBank.firstWeight [ifilter + 1]; k ++)
+						p += filterBank.weight [k] * power [filterBank.bin [k]];
+					powers [ifilter] [iframe] = double (p) / windowFactor;
+				}
+				if (wantCepstra) {
+					VEC dB = dBSpectra.row (ithread);
+					for (integer ifilter = 1; ifilter <= numberOfFilters; ifilter ++) {
+						const double value = powers [ifilter] [iframe];
+						dB [ifilter] = ( value > 0.0 ? 10.0 * log10 (value / 4e-10) : -300.0 );   // as BandFilterSpectrogram :: v_getValueAtSample ()
+					}
+					VECcosineTransform_preallocated (cepstra.row (iframe), dB, cosinesTable.get());
+				}
+			}
+		});
+		emitFrames (firstFrameOfBlock, powers.part (1, numberOfFilters, 1, numberOfFramesInBlock),
+				cepstra.part (1, wantCepstra ? numberOfFramesInBlock : 0, 1, numberOfFilters));
+	}
+}
+
+/*
+	Copies a block of filter-bank powers into `thee` and a block of cepstra into `cc`; either can be null.
+*/
+static void BandFilterSpectrogram_CC_receiveFrames (BandFilterSpectrogram thee, CC cc, integer firstFrame,
+	constMATVU const& powers, constMATVU const& cepstra)
+{
+	if (thee)
+		for (integer ifilter = 1; ifilter <= powers.nrow; ifilter ++)
+			for (integer iframe = 1; iframe <= powers.ncol; iframe ++)
+				thy z [ifilter] [firstFrame - 1 + iframe] = powers [ifilter] [iframe];
+	if (cc)
+		for (integer iframe = 1; iframe <= cepstra.nrow; iframe ++) {
+			const CC_Frame ccframe = & cc -> frame [firstFrame - 1 + iframe];
+			for (integer i = 1; i <= ccframe -> numberOfCoefficients; i ++)
+				ccframe -> c [i] = cepstra [iframe] [i + 1];
+			ccframe -> c0 = cepstra [iframe] [1];
+		}
+}
+
 static void Sound_into_BarkSpectrogram_frame (Sound me, BarkSpectrogram thee, integer frame) {
 	autoSpectrum him = Sound_to_Spectrum_power (me);
 	integer numberOfFrequencies = his nx;
@@ -134,10 +327,36 @@ autoBarkSpectrogram Sound_to_BarkSpectrogram (Sound me, double analysisWidth, do
 		integer numberOfFrames;
 		double t1;
 		Sampled_shortTermAnalysis (me, windowDuration, dt, & numberOfFrames, & t1);
-		autoSound sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
-		autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
 		autoBarkSpectrogram thee = BarkSpectrogram_create (my xmin, my xmax, numberOfFrames, dt, t1, fmin_bark, fmax_bark, numberOfFilters, df_bark, f1_bark);
 
+		if (Melder_debug != 59) {
+			integer numberOfSamples_window, fftLength, numberOfBins;
+			double binWidth;
+			Sampled_getFrameSpectrumSize (me, windowDuration, & numberOfSamples_window, & fftLength, & numberOfBins, & binWidth);
+			autoVEC z = newVECraw (numberOfBins);
+			for (integer ibin = 1; ibin <= numberOfBins; ibin ++)
+				z [ibin] = thy v_hertzToFrequency ((ibin - 1) * binWidth);
+			/*
+				The Sekey & Hanson filters have no zeroes, so this "sparse" matrix is full.
+			*/
+			FilterBankWeights filterBank = FilterBankWeights_create (numberOfFilters,
+				[&] (integer) { return std::pair <integer, integer> (1, numberOfBins); },
+				[&] (integer ifilter, integer ibin) {
+					const double z0 = thy y1 + (ifilter - 1) * thy dy;
+					return NUMsekeyhansonfilter_amplitude (z0, z [ibin]);
+				}
+			);
+			Sampled_analyseFilterBank (me, windowDuration, numberOfFrames, t1, dt, filterBank, false,
+				[&] (integer firstSample, integer lastSample) { return my z.row (1).part (firstSample, lastSample); },
+				[&] (integer firstFrame, constMATVU const& powers, constMATVU const& cepstra) {
+					BandFilterSpectrogram_CC_receiveFrames (thee.get(), nullptr, firstFrame, powers, cepstra);
+				}
+			);
+			return thee;
+		}
+
+		autoSound sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
+		autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
 		autoMelderProgress progess (U"BarkSpectrogram analysis");
 
 		for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
@@ -183,38 +402,121 @@ static void Sound_into_MelSpectrogram_frame (Sound me, MelSpectrogram thee, inte
 	}
 }
 
-autoMelSpectrogram Sound_to_MelSpectrogram (Sound me, double analysisWidth, double dt, double f1_mel, double fmax_mel, double df_mel) {
-	try {
-		const double samplingFrequency = 1.0 / my dx, nyquist = 0.5 * samplingFrequency;
-		const double windowDuration = 2.0 * analysisWidth;   // Gaussian window
-		double fmin_mel = 0.0;
-		const double fbottom = NUMhertzToMel2 (100.0), fceiling = NUMhertzToMel2 (nyquist);
-
-		// Check defaults.
+/*
+	The defaults and the number of filters of a Mel filter bank, as in Sound_to_MelSpectrogram ().
+*/
+static integer getMelFilterBankParameters (double samplingFrequency, double *inout_f1_mel, double *inout_fmax_mel, double *inout_df_mel) {
+	const double nyquist = 0.5 * samplingFrequency;
+	double f1_mel = *inout_f1_mel, fmax_mel = *inout_fmax_mel, df_mel = *inout_df_mel;
+	const double fbottom = NUMhertzToMel2 (100.0), fceiling = NUMhertzToMel2 (nyquist);
+
+	// Check defaults.
+
+	if (fmax_mel <= 0.0 || fmax_mel > fceiling)
+		fmax_mel = fceiling;
+	if (fmax_mel <= f1_mel) {
+		f1_mel = fbottom;
+		fmax_mel = fceiling;
+	}
+	if (f1_mel <= 0.0)
+		f1_mel = fbottom;
+	if (df_mel <= 0.0)
+		df_mel = 100.0;
+
+	// Determine the number of filters.
+
+	const integer numberOfFilters = Melder_iround ((fmax_mel - f1_mel) / df_mel);
+	fmax_mel = f1_mel + numberOfFilters * df_mel;
+	*inout_f1_mel = f1_mel;
+	*inout_fmax_mel = fmax_mel;
+	*inout_df_mel = df_mel;
+	return numberOfFilters;
+}
 
-		if (fmax_mel <= 0.0 || fmax_mel > fceiling)
-			fmax_mel = fceiling;
-		if (fmax_mel <= f1_mel) {
-			f1_mel = fbottom;
-			fmax_mel = fceiling;
+/*
+	The triangular filters of a MelSpectrogram whose first filter is at `f1_mel`, with the same bins
+	as Sampled_getWindowSamples () would give on the power Spectrum of a frame.
+*/
+static FilterBankWeights MelFilterBankWeights_create (double f1_mel, double df_mel, integer numberOfFilters,
+	integer numberOfBins, double binWidth)
+{
+	autoVEC fl_hz = newVECraw (numberOfFilters), fc_hz = newVECraw (numberOfFilters), fh_hz = newVECraw (numberOfFilters);
+	for (integer ifilter = 1; ifilter <= numberOfFilters; ifilter ++) {
+		const double fc_mel = f1_mel + (ifilter - 1) * df_mel;   // as `thy y1 + (ifilter - 1) * thy dy`
+		fc_hz [ifilter] = NUMmelToHertz2 (fc_mel);
+		fl_hz [ifilter] = NUMmelToHertz2 (fc_mel - df_mel);
+		fh_hz [ifilter] = NUMmelToHertz2 (fc_mel + df_mel);
+	}
+	return FilterBankWeights_create (numberOfFilters,
+		[&] (integer ifilter) {
+			const double ifrom_real = 1.0 + Melder_roundUp (fl_hz [ifilter] / binWidth);
+			const double ito_real = 1.0 + Melder_roundDown (fh_hz [ifilter] / binWidth);
+			return std::pair <integer, integer> (
+				ifrom_real < 1.0 ? 1 : (integer) ifrom_real,
+				ito_real > (double) numberOfBins ? numberOfBins : (integer) ito_real
+			);
+		},
+		[&] (integer ifilter, integer ibin) {
+			return NUMtriangularfilter_amplitude (fl_hz [ifilter], fc_hz [ifilter], fh_hz [ifilter], (ibin - 1) * binWidth);
 		}
-		if (f1_mel <= 0.0)
-			f1_mel = fbottom;
-		if (df_mel <= 0.0)
-			df_mel = 100.0;
-
-		// Determine the number of filters.
+	);
+}
 
-		const integer numberOfFilters = Melder_iround ((fmax_mel - f1_mel) / df_mel);
-		fmax_mel = f1_mel + numberOfFilters * df_mel;
+/*
+	The Mel analysis of a Sound or LongSound, with in-memory results.
+*/
+template <typename GetSamplesFunction>
+static void Sampled_to_MelSpectrogram_and_MFCC (Sampled me, GetSamplesFunction const& getSamples,
+	double analysisWidth, double dt, double f1_mel, double fmax_mel, double df_mel,
+	integer numberOfCoefficients, autoMelSpectrogram *out_melSpectrogram, autoMFCC *out_mfcc)
+{
+	const double windowDuration = 2.0 * analysisWidth;   // Gaussian window
+	const double fmin_mel = 0.0;
+	const integer numberOfFilters = getMelFilterBankParameters (1.0 / my dx, & f1_mel, & fmax_mel, & df_mel);
+	integer numberOfFrames;
+	double t1;
+	Sampled_shortTermAnalysis (me, windowDuration, dt, & numberOfFrames, & t1);
+	autoMelSpectrogram thee;
+	if (out_melSpectrogram)
+		thee = MelSpectrogram_create (my xmin, my xmax, numberOfFrames, dt, t1, fmin_mel, fmax_mel, numberOfFilters, df_mel, f1_mel);
+	autoMFCC mfcc;
+	if (out_mfcc) {
+		if (numberOfCoefficients <= 0 || numberOfCoefficients > numberOfFilters - 1)
+			numberOfCoefficients = numberOfFilters - 1;   // as in MelSpectrogram_to_MFCC ()
+		Melder_assert (numberOfCoefficients > 0);
+		mfcc = MFCC_create (my xmin, my xmax, numberOfFrames, dt, t1, numberOfFilters - 1, fmin_mel, fmax_mel);
+		for (integer iframe = 1; iframe <= numberOfFrames; iframe ++)
+			CC_Frame_init (& mfcc -> frame [iframe], numberOfCoefficients);
+	}
+	integer numberOfSamples_window, fftLength, numberOfBins;
+	double binWidth;
+	Sampled_getFrameSpectrumSize (me, windowDuration, & numberOfSamples_window, & fftLength, & numberOfBins, & binWidth);
+	FilterBankWeights filterBank = MelFilterBankWeights_create (f1_mel, df_mel, numberOfFilters, numberOfBins, binWidth);
+	Sampled_analyseFilterBank (me, windowDuration, numberOfFrames, t1, dt, filterBank, !! mfcc, getSamples,
+		[&] (integer firstFrame, constMATVU const& powers, constMATVU const& cepstra) {
+			BandFilterSpectrogram_CC_receiveFrames (thee.get(), mfcc.get(), firstFrame, powers, cepstra);
+		}
+	);
+	if (out_mfcc)
+		*out_mfcc = mfcc.move();
+	if (out_melSpectrogram)
+		*out_melSpectrogram = thee.move();
+}
 
+void Sound_to_MelSpectrogram_and_MFCC (Sound me, double analysisWidth, double dt, double f1_mel, double fmax_mel, double df_mel,
+	integer numberOfCoefficients, autoMelSpectrogram *out_melSpectrogram, autoMFCC *out_mfcc)
+{
+	if (Melder_debug == 59) {
+		const double samplingFrequency = 1.0 / my dx;
+		const double windowDuration = 2.0 * analysisWidth;   // Gaussian window
+		const double fmin_mel = 0.0;
+		const integer numberOfFilters = getMelFilterBankParameters (samplingFrequency, & f1_mel, & fmax_mel, & df_mel);
 		integer numberOfFrames;
 		double t1;
 		Sampled_shortTermAnalysis (me, windowDuration, dt, & numberOfFrames, & t1);
+		autoMelSpectrogram thee = MelSpectrogram_create (my xmin, my xmax, numberOfFrames, dt, t1, fmin_mel, fmax_mel, numberOfFilters, df_mel, f1_mel);
 		autoSound sframe = Sound_createSimple (1, windowDuration, samplingFrequency);
 		autoSound window = Sound_createGaussian (windowDuration, samplingFrequency);
-		autoMelSpectrogram thee = MelSpectrogram_create (my xmin, my xmax, numberOfFrames, dt, t1, fmin_mel, fmax_mel, numberOfFilters, df_mel, f1_mel);
-
 		autoMelderProgress progress (U"MelSpectrograms analysis");
 
 		for (integer iframe = 1; iframe <= numberOfFrames; iframe ++) {
@@ -228,13 +530,116 @@ autoMelSpectrogram Sound_to_MelSpectrogram (Sound me, double analysisWidth, doub
 		}
 		
 		_Spectrogram_windowCorrection ((Spectrogram) thee.get(), window -> nx);
+		if (out_mfcc)
+			*out_mfcc = MelSpectrogram_to_MFCC (thee.get(), numberOfCoefficients);
+		if (out_melSpectrogram)
+			*out_melSpectrogram = thee.move();
+		return;
+	}
+	Sampled_to_MelSpectrogram_and_MFCC (me,
+		[&] (integer firstSample, integer lastSample) { return my z.row (1).part (firstSample, lastSample); },
+		analysisWidth, dt, f1_mel, fmax_mel, df_mel, numberOfCoefficients, out_melSpectrogram, out_mfcc
+	);
+}
 
+autoMelSpectrogram Sound_to_MelSpectrogram (Sound me, double analysisWidth, double dt, double f1_mel, double fmax_mel, double df_mel) {
+	try {
+		autoMelSpectrogram thee;
+		Sound_to_MelSpectrogram_and_MFCC (me, analysisWidth, dt, f1_mel, fmax_mel, df_mel, 0, & thee, nullptr);
 		return thee;
 	} catch (MelderError) {
 		Melder_throw (me, U": no MelSpectrogram created.");
 	}
 }
 
+/*
+	Reads a block of samples of the first channel of a LongSound into `*buffer`.
+*/
+static constVEC LongSound_readFirstChannel (LongSound me, autoMAT *buffer, integer firstSample, integer lastSample) {
+	*buffer = newMATraw (my numberOfChannels, lastSample - firstSample + 1);
+	LongSound_readAudioToFloat (me, buffer -> get(), firstSample);
+	return buffer -> row (1);
+}
+
+autoMelSpectrogram LongSound_to_MelSpectrogram (LongSound me, double analysisWidth, double dt, double f1_mel, double fmax_mel, double df_mel) {
+	try {
+		autoMelSpectrogram thee;
+		autoMAT buffer;
+		Sampled_to_MelSpectrogram_and_MFCC (me,
+			[&] (integer firstSample, integer lastSample) { return LongSound_readFirstChannel (me, & buffer, firstSample, lastSample); },
+			analysisWidth, dt, f1_mel, fmax_mel, df_mel, 0, & thee, nullptr);
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": no MelSpectrogram created.");
+	}
+}
+
+autoMFCC LongSound_to_MFCC (LongSound me, integer numberOfCoefficients, double analysisWidth, double dt, double f1_mel, double fmax_mel, double df_mel) {
+	try {
+		autoMFCC thee;
+		autoMAT buffer;
+		Sampled_to_MelSpectrogram_and_MFCC (me,
+			[&] (integer firstSample, integer lastSample) { return LongSound_readFirstChannel (me, & buffer, firstSample, lastSample); },
+			analysisWidth, dt, f1_mel, fmax_mel, df_mel, numberOfCoefficients, nullptr, & thee);
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": no MFCC created.");
+	}
+}
+
+void LongSound_saveMFCCAsBinaryFile (LongSound me, MelderFile file, integer numberOfCoefficients,
+	double analysisWidth, double dt, double f1_mel, double fmax_mel, double df_mel)
+{
+	try {
+		const double windowDuration = 2.0 * analysisWidth;   // Gaussian window
+		const double fmin_mel = 0.0;
+		const integer numberOfFilters = getMelFilterBankParameters (1.0 / my dx, & f1_mel, & fmax_mel, & df_mel);
+		if (numberOfCoefficients <= 0 || numberOfCoefficients > numberOfFilters - 1)
+			numberOfCoefficients = numberOfFilters - 1;   // as in MelSpectrogram_to_MFCC ()
+		Melder_require (numberOfCoefficients > 0,
+			U"There should be at least two filters.");
+		integer numberOfFrames;
+		double t1;
+		Sampled_shortTermAnalysis (me, windowDuration, dt, & numberOfFrames, & t1);
+		integer numberOfSamples_window, fftLength, numberOfBins;
+		double binWidth;
+		Sampled_getFrameSpectrumSize (me, windowDuration, & numberOfSamples_window, & fftLength, & numberOfBins, & binWidth);
+		FilterBankWeights filterBank = MelFilterBankWeights_create (f1_mel, df_mel, numberOfFilters, numberOfBins, binWidth);
+		/*
+			The file is what Data_writeToBinaryFile () would write for the MFCC that LongSound_to_MFCC () would create
+			(see CC_def.h), but frame by frame, so that the MFCC never has to be in memory as a whole.
+		*/
+		autoMelderFile mfile = MelderFile_create (file);
+		FILE *f = file -> filePointer;
+		if (fprintf (f, "ooBinaryFile") < 0)
+			Melder_throw (U"Cannot write first bytes of file.");
+		binputw8 (Melder_cat (classMFCC -> className, U" ", classMFCC -> version), f);
+		binputr64 (my xmin, f);
+		binputr64 (my xmax, f);
+		binputinteger32BE (numberOfFrames, f);
+		binputr64 (dt, f);
+		binputr64 (t1, f);
+		binputr64 (fmin_mel, f);
+		binputr64 (fmax_mel, f);
+		binputinteger32BE (numberOfFilters - 1, f);
+		autoMAT buffer;
+		Sampled_analyseFilterBank (me, windowDuration, numberOfFrames, t1, dt, filterBank, true,
+			[&] (integer firstSample, integer lastSample) { return LongSound_readFirstChannel (me, & buffer, firstSample, lastSample); },
+			[&] (integer /* firstFrame */, constMATVU const& /* powers */, constMATVU const& cepstra) {
+				for (integer iframe = 1; iframe <= cepstra.nrow; iframe ++) {
+					binputinteger32BE (numberOfCoefficients, f);
+					binputr64 (cepstra [iframe] [1], f);   // c0
+					for (integer i = 1; i <= numberOfCoefficients; i ++)
+						binputr64 (cepstra [iframe] [i + 1], f);
+				}
+			}
+		);
+		mfile.close ();
+	} catch (MelderError) {
+		Melder_throw (me, U": MFCC not saved to binary file ", file, U".");
+	}
+}
+
 /*
 	Analog formant filter response :
 	H(f) = i f B / (f1^2 - f^2 + i f B)
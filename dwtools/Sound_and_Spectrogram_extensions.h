@@ -23,6 +23,7 @@
 */
 
 #include "Spectrogram_extensions.h"
+#include "LongSound.h"
 #include "Pitch.h"
 #include "Sound.h"
 
@@ -40,6 +41,28 @@ autoBarkSpectrogram Sound_to_BarkSpectrogram (Sound me, double analysisWidth, do
 autoMelSpectrogram Sound_to_MelSpectrogram (Sound me, double analysisWidth, double dt,
 	double f1_mel, double fmax_mel, double df_mel);
 
+void Sound_to_MelSpectrogram_and_MFCC (Sound me, double analysisWidth, double dt,
+	double f1_mel, double fmax_mel, double df_mel, integer numberOfCoefficients,
+	autoMelSpectrogram *out_melSpectrogram, autoMFCC *out_mfcc);
+/*
+	As Sound_to_MelSpectrogram followed by MelSpectrogram_to_MFCC, but in a single pass over the frames.
+	Either of the outputs can be null.
+*/
+
+/*
+	The same analyses on the first channel of a LongSound, which is read a block of frames at a time.
+	LongSound_saveMFCCAsBinaryFile () also writes the MFCC a block at a time, in the format of "Save as binary file",
+	so that the memory used depends only on the window length and the block size, not on the duration of the sound.
+*/
+autoMelSpectrogram LongSound_to_MelSpectrogram (LongSound me, double analysisWidth, double dt,
+	double f1_mel, double fmax_mel, double df_mel);
+
+autoMFCC LongSound_to_MFCC (LongSound me, integer numberOfCoefficients, double analysisWidth, double dt,
+	double f1_mel, double fmax_mel, double df_mel);
+
+void LongSound_saveMFCCAsBinaryFile (LongSound me, MelderFile file, integer numberOfCoefficients,
+	double analysisWidth, double dt, double f1_mel, double fmax_mel, double df_mel);
+
 autoSpectrogram Sound_to_Spectrogram_pitchDependent (Sound me, double analysisWidth,
 	double dt, double f1_hz, double fmax_hz, double df_hz, double relative_bw,
 	double minimumPitch, double maximumPitch);
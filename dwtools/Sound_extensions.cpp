@@ -66,6 +66,7 @@
 #include "Ltas.h"
 #include "Manipulation.h"
 #include "NUMcomplex.h"
+#include "MelderThread.h"
 
 #include "enums_getText.h"
 #include "Sound_extensions_enums.h"
@@ -1262,9 +1263,23 @@ autoTextGrid Sound_to_TextGrid_detectSilences (Sound me, double minPitch, double
 	double silenceThreshold, double minSilenceDuration, double minSoundingDuration,
 	conststring32 silentLabel, conststring32 soundingLabel) {
 	try {
-		const bool subtractMeanPressure = true;
-		autoSound filtered = Sound_filter_passHannBand (me, 80.0, 8000.0, 80.0);
-		autoIntensity thee = Sound_to_Intensity (filtered.get(), minPitch, timeStep, subtractMeanPressure);
+		autoIntensity thee;
+		if (Melder_debug == 64) {
+			const bool subtractMeanPressure = true;
+			autoSound filtered = Sound_filter_passHannBand (me, 80.0, 8000.0, 80.0);
+			thee = Sound_to_Intensity (filtered.get(), minPitch, timeStep, subtractMeanPressure);
+		} else {
+			/*
+				The same frames, without a filtered copy of the sound.
+			*/
+			autoStreamingIntensity analyser = StreamingIntensity_createForSampled (me, my ny, minPitch, timeStep);
+			autoVEC intensities = newVECraw (0);
+			StreamingIntensity_processBlock (analyser.get(), my z.get(), intensities);
+			StreamingIntensity_flush (analyser.get(), intensities);
+			Melder_assert (intensities.size == analyser -> numberOfFrames);
+			thee = Intensity_create (my xmin, my xmax, analyser -> numberOfFrames, analyser -> timeStep, analyser -> firstFrameTime);
+			thy z.row (1)  <<=  intensities.all();
+		}
 		autoTextGrid him = Intensity_to_TextGrid_detectSilences (thee.get(), silenceThreshold, minSilenceDuration, minSoundingDuration, silentLabel, soundingLabel);
 		return him;
 	} catch (MelderError) {
@@ -2036,6 +2051,371 @@ autoSound Sound_copyChannelRanges (Sound me, conststring32 ranges) {
 }
 
 /* After a script by Ton Wempe */
+
+Thing_implement (SpectralSubtraction, Thing, 0);
+
+autoVEC Sound_to_noiseAmplitudesForSpectralSubtraction (Sound noise, integer windowLength) {
+	try {
+		autoSound const noise_copy = Sound_extractChannel (noise, 1);
+		Sound_multiplyByWindow (noise_copy.get(), kSound_windowShape::HANNING);
+		const double bandwidth = (1.0 / noise -> dx) / windowLength;
+		autoLtas const noiseLtas = Sound_to_Ltas (noise_copy.get(), bandwidth);
+		autoVEC noiseAmplitudes = newVECraw (windowLength / 2 + 1);
+		for (integer ifreq = 1; ifreq <= noiseAmplitudes.size; ifreq ++) {
+			const integer iband = std::min (ifreq, noiseLtas -> nx);   // the Ltas may lack the Nyquist frequency
+			const double powerDensity = 4e-10 * pow (10.0, noiseLtas -> z [1] [iband] / 10.0);
+			noiseAmplitudes [ifreq] = sqrt (0.5 * powerDensity);
+		}
+		return noiseAmplitudes;
+	} catch (MelderError) {
+		Melder_throw (noise, U": no noise amplitudes computed.");
+	}
+}
+
+autoSpectralSubtraction SpectralSubtraction_create (integer windowLength, double samplingPeriod, double noiseReduction_dB,
+	constVEC const& noiseAmplitudes, double noiseAdaptationTime)
+{
+	try {
+		Melder_require (windowLength >= 4,
+			U"The window should be at least 4 samples long.");
+		Melder_require (noiseAmplitudes.size == 0 || noiseAmplitudes.size == windowLength / 2 + 1,
+			U"The number of noise amplitudes should be ", windowLength / 2 + 1, U".");
+		Melder_require (noiseAmplitudes.size > 0 || noiseAdaptationTime > 0.0,
+			U"Without noise amplitudes, the noise adaptation time should be positive.");
+		autoSpectralSubtraction me = Thing_new (SpectralSubtraction);
+		my windowLength = windowLength;
+		my stepSize = windowLength / 4;
+		my numberOfFrequencies = windowLength / 2 + 1;
+		my samplingPeriod = samplingPeriod;
+		my subtractionScaleFactor = 1.0 - pow (10.0, noiseReduction_dB / 20.0);
+		my adaptationFactor = ( noiseAdaptationTime > 0.0 ? 1.0 - exp (- my stepSize * samplingPeriod / noiseAdaptationTime) : 0.0 );
+		/*
+			The noise amplitudes are those of Hann-windowed noise with a power density of 2 * amplitude^2,
+			and a frame of white noise with a variance of sigma^2 has an expected squared amplitude of
+			windowLength * sigma^2 * samplingPeriod^2 (it is not windowed); hence:
+		*/
+		my frameToNoisePower = 0.375 / (windowLength * samplingPeriod);
+		NUMfft_Table_init (& my fourierTable, windowLength);
+		my window = newVECraw (windowLength);
+		for (integer i = 1; i <= windowLength; i ++) {
+			const double phase = (double) i / windowLength;
+			my window [i] = 0.5 * (1.0 - cos (2.0 * NUMpi * phase));   // as in Sound_multiplyByWindow
+		}
+		my noiseAmplitudes = newVECzero (my numberOfFrequencies);
+		my noisePowers = newVECzero (my numberOfFrequencies);
+		my noiseIsKnown = ( noiseAmplitudes.size > 0 );
+		if (my noiseIsKnown) {
+			my noiseAmplitudes.all() <<= noiseAmplitudes;
+			for (integer ifreq = 1; ifreq <= my numberOfFrequencies; ifreq ++)
+				my noisePowers [ifreq] = noiseAmplitudes [ifreq] * noiseAmplitudes [ifreq];
+		}
+		my frame = newVECzero (windowLength);
+		my spectrum = newVECraw (windowLength);
+		my overlapAdd = newVECzero (windowLength);
+		return me;
+	} catch (MelderError) {
+		Melder_throw (U"SpectralSubtraction not created.");
+	}
+}
+
+static void SpectralSubtraction_adaptNoise (SpectralSubtraction me, integer ifreq, double amplitude, double floorPower) {
+	const double power = amplitude * amplitude * my frameToNoisePower;
+	double& noisePower = my noisePowers [ifreq];
+	if (my noiseIsKnown)
+		noisePower += my adaptationFactor * (std::min (power, std::max (4.0 * noisePower, floorPower)) - noisePower);
+	else
+		noisePower = power;
+	my noiseAmplitudes [ifreq] = sqrt (noisePower);
+}
+
+/*
+	Subtract the noise from the buffered frame, and add the result to the overlap-add buffer.
+	The spectrum is in the layout of NUMfft_forward (), with the scalings of Sound_to_Spectrum () and Spectrum_to_Sound (),
+	so that Sound_reduceNoise computes exactly what it did with a Spectrum and a Sound object per frame.
+*/
+static void SpectralSubtraction_processFrame (SpectralSubtraction me) {
+	VEC const data = my spectrum.get();
+	data <<= my frame.all();
+	NUMfft_forward (& my fourierTable, data);
+	const double scaling = my samplingPeriod, inverseScaling = 1.0 / (my samplingPeriod * my windowLength);
+	/*
+		A hundredth of the power of the frame averaged over the frequencies (by Parseval's theorem),
+		so that a noise power of (almost) zero, e.g. after a noise stretch of digital silence, can still rise.
+	*/
+	const double floorPower = ( my adaptationFactor > 0.0 ?
+			0.01 * NUMsum2 (my frame.all()) * scaling * scaling * my frameToNoisePower : 0.0 );
+	for (integer ifreq = 1; ifreq <= my numberOfFrequencies; ifreq ++) {
+		const integer ire = ( ifreq == 1 ? 1 : ifreq + ifreq - 2 ), iim = ( ifreq == 1 ? 0 : ifreq + ifreq - 1 );
+		const bool hasImaginaryPart = ( iim > 0 && iim <= my windowLength );   // not at 0 Hz, nor at the Nyquist frequency
+		double re = data [ire] * scaling, im = ( hasImaginaryPart ? data [iim] * scaling : 0.0 );
+		const double amp = sqrt (re * re + im * im);
+		if (amp > 0.0) {
+			const double factor = std::max (1.0 - my subtractionScaleFactor * my noiseAmplitudes [ifreq] / amp, 1e-6);
+			re *= factor;
+			im *= factor;
+		}
+		if (my adaptationFactor > 0.0)
+			SpectralSubtraction_adaptNoise (me, ifreq, amp, floorPower);
+		data [ire] = re * inverseScaling;
+		if (hasImaginaryPart)
+			data [iim] = im * inverseScaling;
+	}
+	my noiseIsKnown = true;
+	NUMfft_backward (& my fourierTable, data);
+	for (integer i = 1; i <= my windowLength; i ++)
+		my overlapAdd [i] += 0.5 * (data [i] * my window [i]);   // 0.5 because of 2-fold
+}
+
+integer SpectralSubtraction_processBlock (SpectralSubtraction me, constVECVU const& input, VECVU const& output) {
+	integer numberOfOutputSamples = 0;
+	const integer overlap = my windowLength - my stepSize;
+	for (integer inputSample = 1; inputSample <= input.size; ) {
+		const integer numberOfSamplesToBuffer = std::min (input.size - inputSample + 1, my windowLength - my numberOfBufferedSamples);
+		my frame.part (my numberOfBufferedSamples + 1, my numberOfBufferedSamples + numberOfSamplesToBuffer) <<=
+				input.part (inputSample, inputSample + numberOfSamplesToBuffer - 1);
+		my numberOfBufferedSamples += numberOfSamplesToBuffer;
+		inputSample += numberOfSamplesToBuffer;
+		if (my numberOfBufferedSamples < my windowLength)
+			break;   // the rest comes with the next block
+		SpectralSubtraction_processFrame (me);
+		/*
+			The first stepSize samples are finished; shift the frame and the overlap-add buffer.
+		*/
+		Melder_assert (numberOfOutputSamples + my stepSize <= output.size);
+		output.part (numberOfOutputSamples + 1, numberOfOutputSamples + my stepSize) <<= my overlapAdd.part (1, my stepSize);
+		numberOfOutputSamples += my stepSize;
+		for (integer i = 1; i <= overlap; i ++) {
+			my frame [i] = my frame [i + my stepSize];
+			my overlapAdd [i] = my overlapAdd [i + my stepSize];
+		}
+		my overlapAdd.part (overlap + 1, my windowLength) <<= 0.0;
+		my numberOfBufferedSamples = overlap;
+	}
+	return numberOfOutputSamples;
+}
+
+integer SpectralSubtraction_flush (SpectralSubtraction me, VECVU const& output) {
+	const integer numberOfOutputSamples = my numberOfBufferedSamples;   // so that the output is as long as the input
+	Melder_assert (output.size >= numberOfOutputSamples);
+	output.part (1, numberOfOutputSamples) <<= my overlapAdd.part (1, numberOfOutputSamples);
+	my overlapAdd.all() <<= 0.0;
+	my numberOfBufferedSamples = 0;
+	return numberOfOutputSamples;
+}
+
+Thing_implement (StreamingIntensity, Thing, 0);
+
+/*
+	Prepare for a new input; the samples before the first one are zero.
+*/
+static void StreamingIntensity_reset (StreamingIntensity me) {
+	my filterInput.all()  <<=  0.0;
+	my firstFilterInputSample = 1 - my filterHalfLength;
+	my numberOfFilterInputSamples = my filterHalfLength;
+	my firstFilteredSample = 1;
+	my numberOfFilteredSamples = 0;
+	my numberOfInputSamples = 0;
+	my numberOfFramesDone = 0;
+}
+
+autoStreamingIntensity StreamingIntensity_create (integer numberOfChannels, double samplingPeriod, double firstSampleTime,
+	double minimumPitch, double timeStep, double firstFrameTime, integer numberOfFrames)
+{
+	try {
+		Melder_require (numberOfChannels >= 1,
+			U"The number of channels should be at least 1.");
+		Melder_require (samplingPeriod > 0.0,
+			U"The sampling period should be positive.");
+		Melder_require (minimumPitch > 0.0,
+			U"Minimum pitch should be positive, instead of ", minimumPitch, U" Hz.");
+		Melder_require (timeStep > 0.0,
+			U"The time step should be positive.");
+		autoStreamingIntensity me = Thing_new (StreamingIntensity);
+		my numberOfChannels = numberOfChannels;
+		my samplingPeriod = samplingPeriod;
+		my firstSampleTime = firstSampleTime;
+		my timeStep = timeStep;
+		my firstFrameTime = firstFrameTime;
+		my numberOfFrames = numberOfFrames;
+		/*
+			The response of Spectrum_passHannBand (80, 8000, 80) at the frequencies of the FFT,
+			as a zero-phase impulse response that is cut off at filterHalfLength samples on either side.
+			The scalings of both transforms go into the filter spectrum.
+		*/
+		constexpr double fmin = 80.0, fmax = 8000.0, smooth = 80.0;
+		const double f1 = fmin - smooth, f2 = fmin + smooth, f3 = fmax - smooth, f4 = fmax + smooth;
+		const double halfpibysmooth = NUMpi / (2.0 * smooth), nyquistFrequency = 0.5 / samplingPeriod;
+		my filterHalfLength = Melder_iceiling (0.05 / samplingPeriod);
+		my fftLength = 256;
+		while (my fftLength < 4 * my filterHalfLength)
+			my fftLength *= 2;
+		NUMfft_Table_init (& my fourierTable, my fftLength);
+		my filterSpectrum = newVECzero (my fftLength);
+		for (integer k = 0; k <= my fftLength / 2; k ++) {
+			const double frequency = k / (my fftLength * samplingPeriod);
+			double response = ( frequency < f1 || frequency > f4 ? 0.0 : 1.0 );
+			if (frequency < f2)
+				response *= 0.5 - 0.5 * cos (halfpibysmooth * (frequency - f1));
+			else if (frequency > f3 && fmax < nyquistFrequency)
+				response *= 0.5 + 0.5 * cos (halfpibysmooth * (frequency - f3));
+			my filterSpectrum [k == 0 ? 1 : k == my fftLength / 2 ? my fftLength : 2 * k] = response;
+		}
+		NUMfft_backward (& my fourierTable, my filterSpectrum.get());
+		my filterSpectrum.part (my filterHalfLength + 2, my fftLength - my filterHalfLength)  <<=  0.0;
+		NUMfft_forward (& my fourierTable, my filterSpectrum.get());
+		my filterSpectrum.all()  *=  1.0 / ((double) my fftLength * my fftLength);
+		my spectrum = newVECraw (my fftLength);
+		my filterInput = newMATzero (numberOfChannels, my fftLength);
+		/*
+			The frames, as in Sound_to_Intensity ().
+		*/
+		const double logicalWindowDuration = 3.2 * (1.0 / minimumPitch);
+		const double halfWindowDuration = 0.5 * (2.0 * logicalWindowDuration);
+		my halfWindowSamples = Melder_ifloor (halfWindowDuration / samplingPeriod);
+		const integer windowNumberOfSamples = 2 * my halfWindowSamples + 1;
+		my window = newVECraw (windowNumberOfSamples);
+		for (integer i = 1; i <= windowNumberOfSamples; i ++) {
+			const double x = (i - (my halfWindowSamples + 1)) * samplingPeriod / halfWindowDuration;
+			const double root = sqrt (Melder_clippedLeft (0.0, 1.0 - sqr (x)));
+			my window [i] = NUMbessel_i0_f ((2.0 * NUMpi * NUMpi + 0.5) * root);
+		}
+		my amplitude = newVECraw (windowNumberOfSamples);
+		my filtered = newMATraw (numberOfChannels, windowNumberOfSamples + my fftLength - 2 * my filterHalfLength);
+		StreamingIntensity_reset (me.get());
+		return me;
+	} catch (MelderError) {
+		Melder_throw (U"StreamingIntensity not created.");
+	}
+}
+
+autoStreamingIntensity StreamingIntensity_createForSampled (Sampled me, integer numberOfChannels, double minimumPitch, double timeStep) {
+	try {
+		Melder_require (minimumPitch > 0.0,
+			U"Minimum pitch should be positive, instead of ", minimumPitch, U" Hz.");
+		const double logicalWindowDuration = 3.2 * (1.0 / minimumPitch);
+		if (timeStep == 0.0)
+			timeStep = logicalWindowDuration / 4.0;
+		integer numberOfFrames;
+		double firstFrameTime;
+		Sampled_shortTermAnalysis (me, 2.0 * logicalWindowDuration, timeStep, & numberOfFrames, & firstFrameTime);
+		return StreamingIntensity_create (numberOfChannels, my dx, my x1, minimumPitch, timeStep, firstFrameTime, numberOfFrames);
+	} catch (MelderError) {
+		Melder_throw (me, U": no streaming intensity analysis.");
+	}
+}
+
+/*
+	Compute the frames whose windows lie within the filtered samples (or, at the end, as much of them as there is),
+	and discard the filtered samples that the remaining frames will not need.
+*/
+static void StreamingIntensity_computeFrames (StreamingIntensity me, autoVEC& intensities, bool isLast) {
+	const integer lastFilteredSample = my firstFilteredSample + my numberOfFilteredSamples - 1;
+	integer firstNeededSample = lastFilteredSample + 1;
+	while (my numberOfFrames == 0 || my numberOfFramesDone < my numberOfFrames) {
+		const double midTime = my firstFrameTime + my numberOfFramesDone * my timeStep;
+		const integer centreSample = Melder_iround ((midTime - my firstSampleTime) / my samplingPeriod + 1.0);
+		integer leftSample = centreSample - my halfWindowSamples;
+		integer rightSample = centreSample + my halfWindowSamples;
+		Melder_clipLeft (1_integer, & leftSample);
+		if (rightSample > lastFilteredSample) {
+			if (! isLast || my numberOfFrames == 0) {
+				firstNeededSample = leftSample;
+				break;
+			}
+			rightSample = lastFilteredSample;
+		}
+		Melder_require (rightSample >= leftSample,
+			U"Unexpected edge case: right sample (", rightSample, U") less than left sample (", leftSample, U").");
+		Melder_assert (leftSample >= my firstFilteredSample);
+		const integer windowFromSoundOffset = my halfWindowSamples + 1 - centreSample;
+		const integer filteredFromSoundOffset = 1 - my firstFilteredSample;
+		VEC amplitudePart = my amplitude.part (windowFromSoundOffset + leftSample, windowFromSoundOffset + rightSample);
+		constVEC windowPart = my window.part (windowFromSoundOffset + leftSample, windowFromSoundOffset + rightSample);
+		longdouble sumxw = 0.0, sumw = 0.0;
+		for (integer ichan = 1; ichan <= my numberOfChannels; ichan ++) {
+			amplitudePart <<= my filtered.row (ichan).part (filteredFromSoundOffset + leftSample, filteredFromSoundOffset + rightSample);
+			VECcentre_inplace (amplitudePart);
+			for (integer isamp = 1; isamp <= amplitudePart.size; isamp ++) {
+				sumxw += sqr (amplitudePart [isamp]) * windowPart [isamp];
+				sumw += windowPart [isamp];
+			}
+		}
+		const double intensity_re_hearingThreshold = double (sumxw / sumw) / sqr (2.0e-5);
+		* intensities.append () = ( intensity_re_hearingThreshold < 1.0e-30 ? -300.0 : 10.0 * log10 (intensity_re_hearingThreshold) );
+		my numberOfFramesDone ++;
+	}
+	const integer numberOfSamplesToDiscard = std::min (my numberOfFilteredSamples, firstNeededSample - my firstFilteredSample);
+	if (numberOfSamplesToDiscard > 0) {
+		for (integer ichan = 1; ichan <= my numberOfChannels; ichan ++) {
+			VEC row = my filtered.row (ichan);
+			for (integer i = numberOfSamplesToDiscard + 1; i <= my numberOfFilteredSamples; i ++)
+				row [i - numberOfSamplesToDiscard] = row [i];
+		}
+		my firstFilteredSample += numberOfSamplesToDiscard;
+		my numberOfFilteredSamples -= numberOfSamplesToDiscard;
+	}
+}
+
+/*
+	Filter the full input buffer (at the end, padded with zeroes), and keep its last 2 * filterHalfLength samples for the next block.
+*/
+static void StreamingIntensity_filterBlock (StreamingIntensity me, autoVEC& intensities, bool isLast) {
+	const integer halfLength = my filterHalfLength, blockLength = my fftLength - 2 * halfLength;
+	const integer firstOutputSample = my firstFilterInputSample + halfLength;
+	Melder_assert (firstOutputSample == my firstFilteredSample + my numberOfFilteredSamples);
+	const integer numberOfOutputSamples = ( isLast ? std::min (blockLength, my numberOfInputSamples - firstOutputSample + 1) : blockLength );
+	VEC const data = my spectrum.get();
+	const constVEC filter = my filterSpectrum.get();
+	const integer n = my fftLength;
+	for (integer ichan = 1; ichan <= my numberOfChannels; ichan ++) {
+		data <<= my filterInput.row (ichan);
+		NUMfft_forward (& my fourierTable, data);
+		data [1] *= filter [1];
+		for (integer k = 2; k < n; k += 2) {
+			const double re = data [k] * filter [k] - data [k + 1] * filter [k + 1];
+			data [k + 1] = data [k] * filter [k + 1] + data [k + 1] * filter [k];
+			data [k] = re;
+		}
+		data [n] *= filter [n];
+		NUMfft_backward (& my fourierTable, data);
+		my filtered.row (ichan).part (my numberOfFilteredSamples + 1, my numberOfFilteredSamples + numberOfOutputSamples)  <<=
+				data.part (halfLength + 1, halfLength + numberOfOutputSamples);
+		my filterInput.row (ichan).part (1, 2 * halfLength)  <<=  my filterInput.row (ichan).part (blockLength + 1, n);
+	}
+	my numberOfFilteredSamples += numberOfOutputSamples;
+	my firstFilterInputSample += blockLength;
+	my numberOfFilterInputSamples = 2 * halfLength;
+	StreamingIntensity_computeFrames (me, intensities, false);
+}
+
+void StreamingIntensity_processBlock (StreamingIntensity me, constMATVU const& input, autoVEC& intensities) {
+	Melder_require (input.nrow == my numberOfChannels,
+		U"The number of channels should be ", my numberOfChannels, U", instead of ", input.nrow, U".");
+	for (integer inputSample = 1; inputSample <= input.ncol; ) {
+		const integer numberOfSamplesToBuffer = std::min (input.ncol - inputSample + 1, my fftLength - my numberOfFilterInputSamples);
+		my filterInput.verticalBand (my numberOfFilterInputSamples + 1, my numberOfFilterInputSamples + numberOfSamplesToBuffer)  <<=
+				input.verticalBand (inputSample, inputSample + numberOfSamplesToBuffer - 1);
+		my numberOfFilterInputSamples += numberOfSamplesToBuffer;
+		my numberOfInputSamples += numberOfSamplesToBuffer;
+		inputSample += numberOfSamplesToBuffer;
+		if (my numberOfFilterInputSamples == my fftLength)
+			StreamingIntensity_filterBlock (me, intensities, false);
+	}
+}
+
+void StreamingIntensity_flush (StreamingIntensity me, autoVEC& intensities) {
+	while (my firstFilteredSample + my numberOfFilteredSamples - 1 < my numberOfInputSamples) {
+		my filterInput.verticalBand (my numberOfFilterInputSamples + 1, my fftLength)  <<=  0.0;
+		StreamingIntensity_filterBlock (me, intensities, true);
+	}
+	if (my numberOfInputSamples > 0)
+		StreamingIntensity_computeFrames (me, intensities, true);
+	StreamingIntensity_reset (me);
+}
+
+/*
+	The same with a Spectrum and a Sound object per frame; for checking (Debug 60).
+*/
 static autoSound Sound_reduceNoiseBySpectralSubtraction_mono (Sound me, Sound noise, double windowLength, double noiseReduction_dB) {
 	try {
 		Melder_require (my dx == noise -> dx,
@@ -2081,7 +2461,8 @@ static autoSound Sound_reduceNoiseBySpectralSubtraction_mono (Sound me, Sound no
 			VEC const re = analysisSpectrum -> z.row (1), im = analysisSpectrum -> z.row (2);
 			for (integer ifreq = 1; ifreq <= analysisSpectrum -> nx; ifreq ++) {
 				const double amp = sqrt (re [ifreq] * re [ifreq] + im [ifreq] * im [ifreq]);
-				const double factor = std::max (1.0 - noiseAmplitudeSubtractionScaleFactor * noiseAmplitudes [ifreq] / amp, 1e-6);
+				const double noiseAmplitude = noiseAmplitudes [std::min (ifreq, noiseAmplitudes.size)];   // the Ltas may lack the Nyquist frequency
+				const double factor = std::max (1.0 - noiseAmplitudeSubtractionScaleFactor * noiseAmplitude / amp, 1e-6);
 				re [ifreq] *= factor;
 				im [ifreq] *= factor;
 			}
@@ -2125,27 +2506,73 @@ static void Sound_findNoise (Sound me, double minimumNoiseDuration, double *nois
 }
 
 autoSound Sound_removeNoise (Sound me, double noiseStart, double noiseEnd, double windowLength, double minBandFilterFrequency, double maxBandFilterFrequency, double smoothing, kSoundNoiseReductionMethod method) {
-	return Sound_reduceNoise (me, noiseStart, noiseEnd, windowLength, minBandFilterFrequency, maxBandFilterFrequency, smoothing, 0.0, method);
+	return Sound_reduceNoise (me, noiseStart, noiseEnd, windowLength, minBandFilterFrequency, maxBandFilterFrequency, smoothing, 0.0, method, 0.0);
 }
 
-autoSound Sound_reduceNoise (Sound me, double noiseStart, double noiseEnd, double windowLength, double minBandFilterFrequency, double maxBandFilterFrequency, double smoothing, double noiseReduction_dB, kSoundNoiseReductionMethod method) {
+autoSound Sound_reduceNoise (Sound me, double noiseStart, double noiseEnd, double windowLength, double minBandFilterFrequency, double maxBandFilterFrequency, double smoothing, double noiseReduction_dB, kSoundNoiseReductionMethod method, double noiseAdaptationTime) {
 	try {
+		if (method != kSoundNoiseReductionMethod::SPECTRAL_SUBTRACTION)
+			Melder_fatal (U"Unknown method in Sound_reduceNoise.");
+		Melder_require (noiseAdaptationTime >= 0.0,
+			U"The noise adaptation time should not be negative.");
 		autoSound const filtered = Sound_filter_passHannBand (me, minBandFilterFrequency, maxBandFilterFrequency, smoothing);
 		autoSound denoised = Sound_create (my ny, my xmin, my xmax, my nx, my dx, my x1);
 		const bool findNoise = ( noiseEnd <= noiseStart );
 		const double minimumNoiseDuration = 2.0 * windowLength;
+		if (Melder_debug == 60 && noiseAdaptationTime == 0.0) {
+			for (integer ichannel = 1; ichannel <= my ny; ichannel ++) {
+				autoSound channeli = Sound_extractChannel (filtered.get(), ichannel);
+				if (findNoise)
+					Sound_findNoise (channeli.get(), minimumNoiseDuration, & noiseStart, & noiseEnd);
+				autoSound noise = Sound_extractPart (channeli.get(), noiseStart, noiseEnd, kSound_windowShape::RECTANGULAR, 1.0, false);
+				autoSound denoisedi = Sound_reduceNoiseBySpectralSubtraction_mono (channeli.get(), noise.get(), windowLength, noiseReduction_dB);
+				denoised -> z.row (ichannel) <<= denoisedi -> z.row (1);
+			}
+			return denoised;
+		}
+		const integer windowSamples = Melder_iround (windowLength * (1.0 / my dx));
+		const integer stepSize = windowSamples / 4;
+		Melder_require (stepSize > 0,
+			U"The window length should be at least 4 samples.");
+		/*
+			The frames start at every stepSize samples, but not beyond the last sample but one
+			(and not beyond my nx / stepSize frames, as before).
+		*/
+		const integer numberOfFrames = ( my nx < 2 ? 0 : std::min (my nx / stepSize, (my nx - 2) / stepSize + 1) );
+		if (numberOfFrames == 0)
+			return denoised;   // silence
+		const integer numberOfInputSamples = (numberOfFrames - 1) * stepSize + windowSamples;   // up to the end of the last frame, zero-padded
+		Melder_assert (numberOfInputSamples >= my nx && numberOfInputSamples - my nx < windowSamples);
+
+		OrderedOf <structSpectralSubtraction> processors;
 		for (integer ichannel = 1; ichannel <= my ny; ichannel ++) {
-			autoSound denoisedi, channeli = Sound_extractChannel (filtered.get(), ichannel);
+			autoSound channeli = Sound_extractChannel (filtered.get(), ichannel);
 			if (findNoise)
 				Sound_findNoise (channeli.get(), minimumNoiseDuration, & noiseStart, & noiseEnd);
 			autoSound noise = Sound_extractPart (channeli.get(), noiseStart, noiseEnd, kSound_windowShape::RECTANGULAR, 1.0, false);
-			if (method == kSoundNoiseReductionMethod::SPECTRAL_SUBTRACTION) {   // spectral subtraction
-				denoisedi = Sound_reduceNoiseBySpectralSubtraction_mono (filtered.get(), noise.get(), windowLength, noiseReduction_dB);
-			} else {
-				Melder_fatal (U"Unknown method in Sound_reduceNoise.");
-			}
-			denoised -> z.row (ichannel) <<= denoisedi -> z.row (1);
+			autoVEC noiseAmplitudes = Sound_to_noiseAmplitudesForSpectralSubtraction (noise.get(), windowSamples);
+			processors. addItem_move (SpectralSubtraction_create (windowSamples, my dx, noiseReduction_dB, noiseAmplitudes.get(), noiseAdaptationTime));
 		}
+		autoMAT outputs = newMATraw (my ny, numberOfInputSamples + stepSize);
+		autoVEC const zeroes = newVECzero (windowSamples);
+		/*
+			The channels are independent.
+		*/
+		const integer numberOfThreads = MelderThread_getNumberOfThreads (my ny, 1);
+		MelderThread_run (numberOfThreads, [&] (integer ithread) {
+			integer firstChannel, lastChannel;
+			MelderThread_getRange (my ny, numberOfThreads, ithread, & firstChannel, & lastChannel);
+			for (integer ichannel = firstChannel; ichannel <= lastChannel; ichannel ++) {
+				SpectralSubtraction processor = processors.at [ichannel];
+				VEC const output = outputs.row (ichannel);
+				integer numberOfOutputSamples = SpectralSubtraction_processBlock (processor, filtered -> z.row (ichannel), output);
+				numberOfOutputSamples += SpectralSubtraction_processBlock (processor, zeroes.part (1, numberOfInputSamples - my nx),
+						output.part (numberOfOutputSamples + 1, output.size));
+				numberOfOutputSamples += SpectralSubtraction_flush (processor, output.part (numberOfOutputSamples + 1, output.size));
+				Melder_assert (numberOfOutputSamples == numberOfInputSamples);
+				denoised -> z.row (ichannel) <<= output.part (1, my nx);
+			}
+		});
 		return denoised;
 	} catch (MelderError) {
 		Melder_throw (me, U": not denoised.");
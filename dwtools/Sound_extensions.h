@@ -23,6 +23,7 @@
 #include "Collection.h"
 #include "PointProcess.h"
 #include "TextGrid.h"
+#include "NUM2.h"
 #include "Sound_extensions_enums.h"
 
 Thing_declare (Interpreter);
@@ -181,6 +182,11 @@ autoSound Sound_changeGender_old (Sound me, double fmin, double fmax, double for
 autoTextGrid Sound_to_TextGrid_detectSilences (Sound me, double minPitch, double timeStep,
 	double silenceThreshold, double minSilenceDuration, double minSoundingDuration,
 	conststring32 silentLabel, conststring32 soundingLabel);
+/*
+	The intensities come from a StreamingIntensity, whose band filter has a truncated impulse response;
+	compared with filtering the whole sound (as before 2026, and with Melder_debug 64),
+	a boundary can move by one frame.
+*/
 
 void Sound_getStartAndEndTimesOfSounding (Sound me, double minPitch, double timeStep,
 	double silenceThreshold, double minSilenceDuration, double minSoundingDuration, double *out_t1, double *out_t2);
@@ -201,7 +207,102 @@ autoSound Sound_copyChannelRanges (Sound me, conststring32 ranges);
 
 autoSound Sound_removeNoise (Sound me, double noiseStart, double noiseEnd, double windowLength, double minBandFilterFrequency, double maxBandFilterFrequency, double smoothing, kSoundNoiseReductionMethod method);
 
-autoSound Sound_reduceNoise (Sound me, double noiseStart, double noiseEnd, double windowLength, double minBandFilterFrequency, double maxBandFilterFrequency, double smoothing, double noiseReduction_dB, kSoundNoiseReductionMethod method);
+autoSound Sound_reduceNoise (Sound me, double noiseStart, double noiseEnd, double windowLength, double minBandFilterFrequency, double maxBandFilterFrequency, double smoothing, double noiseReduction_dB, kSoundNoiseReductionMethod method, double noiseAdaptationTime);
+/*
+	With a positive noise adaptation time (s), the noise estimate from the noise stretch is only the starting point:
+	it follows the slowly changing noise of the rest of the sound, as described for SpectralSubtraction below.
+*/
+
+/*
+	Noise reduction by spectral subtraction (after a script by Ton Wempe) for one channel,
+	as a processor that can run block after block, e.g. on incoming microphone or synthesizer audio.
+	Frames of `windowLength` samples follow each other at steps of windowLength / 4 samples;
+	the amplitude spectrum of each frame is lowered by the noise amplitudes,
+	and the Hann-windowed inverse transforms are added together.
+	
+	SpectralSubtraction_processBlock () takes the next block of input samples, of any size,
+	writes the output samples that are finished (they lag windowLength - stepSize samples behind the input),
+	and returns their number; `output` should have room for input.size + stepSize samples.
+	SpectralSubtraction_flush () writes the samples that are still unfinished at the end of the input
+	(with the earlier output, as many as came in), returns their number, and prepares the processor for a new input;
+	samples that came in after the last full frame are included in no frame and come out as silence,
+	unless the caller appends `windowLength` zeroes to the input.
+	
+	The noise amplitudes (for the windowLength / 2 + 1 frequencies) come from a noise stretch,
+	with Sound_to_noiseAmplitudesForSpectralSubtraction (), or can be left empty.
+	With a positive noise adaptation time, the noise amplitudes follow the input:
+	every frame moves the noise power at each frequency towards that of the frame, with this time constant,
+	but by no more than the distance to four times the noise power, so that loud speech hardly raises it
+	(or to a hundredth of the frame's power averaged over the frequencies, if that is more,
+	so that a noise power of zero, e.g. from a noise stretch of digital silence, can rise).
+	An empty noise estimate is taken from the first frame.
+*/
+Thing_define (SpectralSubtraction, Thing) {
+	integer windowLength, stepSize, numberOfFrequencies;
+	double samplingPeriod;
+	double subtractionScaleFactor;
+	double adaptationFactor;   // 0.0 if the noise does not adapt
+	double frameToNoisePower;   // the noise power of a frame's squared amplitudes
+	bool noiseIsKnown;
+	autoNUMfft_Table fourierTable;
+	autoVEC window, noiseAmplitudes, noisePowers;
+	autoVEC frame, spectrum, overlapAdd;
+	integer numberOfBufferedSamples;
+};
+
+autoSpectralSubtraction SpectralSubtraction_create (integer windowLength, double samplingPeriod, double noiseReduction_dB,
+	constVEC const& noiseAmplitudes, double noiseAdaptationTime);
+
+autoVEC Sound_to_noiseAmplitudesForSpectralSubtraction (Sound noise, integer windowLength);   // from the first channel
+
+integer SpectralSubtraction_processBlock (SpectralSubtraction me, constVECVU const& input, VECVU const& output);
+
+integer SpectralSubtraction_flush (SpectralSubtraction me, VECVU const& output);
+
+/*
+	The intensity contour that Sound_to_TextGrid_detectSilences () uses, as a processor that can run block after block,
+	e.g. on a LongSound or on incoming microphone or synthesizer audio, with memory that does not grow with the input.
+	The samples (numberOfChannels x numberOfSamples per block, of any size) are band-filtered between 80 and 8000 Hz
+	with the response of Sound_filter_passHannBand (), by FFT convolution with an impulse response of 0.1 s;
+	the frames are those of Sound_to_Intensity () with subtraction of the mean,
+	at times firstFrameTime + (iframe - 1) * timeStep, for the samples at times firstSampleTime + (isample - 1) * samplingPeriod.
+
+	StreamingIntensity_processBlock () appends the intensities (in dB) of the frames that are finished to `intensities`;
+	these lag 0.05 s plus half a window plus at most one filter block behind the input.
+	StreamingIntensity_flush () appends the frames that are left (all of them if numberOfFrames is not 0,
+	otherwise only those whose window fits in the input).
+	StreamingIntensity_createForSampled () takes the frames of Sound_to_Intensity () on the whole of `me`.
+*/
+Thing_define (StreamingIntensity, Thing) {
+	integer numberOfChannels;
+	double samplingPeriod, firstSampleTime, timeStep, firstFrameTime;
+	integer numberOfFrames;   // 0 if unknown
+	integer numberOfInputSamples, numberOfFramesDone;
+	/*
+		The band filter: overlap-save with blocks of fftLength - 2 * filterHalfLength samples.
+	*/
+	integer filterHalfLength, fftLength;
+	autoNUMfft_Table fourierTable;
+	autoVEC filterSpectrum, spectrum;
+	autoMAT filterInput;
+	integer firstFilterInputSample, numberOfFilterInputSamples;
+	/*
+		The filtered samples that the coming frames need.
+	*/
+	autoMAT filtered;
+	integer firstFilteredSample, numberOfFilteredSamples;
+	integer halfWindowSamples;
+	autoVEC window, amplitude;
+};
+
+autoStreamingIntensity StreamingIntensity_create (integer numberOfChannels, double samplingPeriod, double firstSampleTime,
+	double minimumPitch, double timeStep, double firstFrameTime, integer numberOfFrames);
+
+autoStreamingIntensity StreamingIntensity_createForSampled (Sampled me, integer numberOfChannels, double minimumPitch, double timeStep);
+
+void StreamingIntensity_processBlock (StreamingIntensity me, constMATVU const& input, autoVEC& intensities);
+
+void StreamingIntensity_flush (StreamingIntensity me, autoVEC& intensities);
 
 void Sound_playAsFrequencyShifted (Sound me, double shiftBy, double newSamplingFrequency, integer precision);
 
@@ -26,8 +26,8 @@
 
 autoMFCC Sound_to_MFCC (Sound me, integer numberOfCoefficients, double analysisWidth, double dt, double f1_mel, double fmax_mel, double df_mel) {
 	try {
-		autoMelSpectrogram mf = Sound_to_MelSpectrogram (me, analysisWidth, dt, f1_mel, fmax_mel, df_mel);
-		autoMFCC mfcc = MelSpectrogram_to_MFCC (mf.get(), numberOfCoefficients);
+		autoMFCC mfcc;
+		Sound_to_MelSpectrogram_and_MFCC (me, analysisWidth, dt, f1_mel, fmax_mel, df_mel, numberOfCoefficients, nullptr, & mfcc);
 		return mfcc;
 	} catch (MelderError) {
 		Melder_throw (me, U": no MFCC created.");
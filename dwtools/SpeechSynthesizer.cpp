@@ -32,6 +32,7 @@
 #include "encoding.h"
 #include "string.h"
 #include "translate.h"
+#include <mutex>
 
 #include "oo_DESTROY.h"
 #include "SpeechSynthesizer_def.h"
@@ -198,9 +199,13 @@ void structSpeechSynthesizer :: v_info () {
 	);
 }
 
+/*
+	eSpeak calls synthCallback () from its C code, through which no exception should travel.
+	An error in here (e.g. in the stream callback) is therefore caught and remembered,
+	and the return value 1 makes eSpeak stop; SpeechSynthesizer_synthesize () throws it again when eSpeak has returned.
+*/
 static int synthCallback (short *wav, int numsamples, espeak_EVENT *events)
 {
-	char phoneme_name[9];
 	if (wav == 0) return 1;
 	
 	// It is essential that the SpeechSynthesizer is identified here by the user_data,
@@ -208,39 +213,54 @@ static int synthCallback (short *wav, int numsamples, espeak_EVENT *events)
 	// a piece of audio data!!
 	
 	SpeechSynthesizer me = (SpeechSynthesizer) (events -> user_data);
-	while (events -> type != espeakEVENT_LIST_TERMINATED) {
-		if (events -> type == espeakEVENT_SAMPLERATE) {
-			my d_internalSamplingFrequency = events -> id.number;
-		} else {
-			//my events = Table "time type type-t t-pos length a-pos sample id uniq";
-			//                    1    2     3      4     5     6     7      8   9
-			Table_appendRow (my d_events.get());
-			const integer irow = my d_events -> rows.size;
-			const double time = events -> audio_position * 0.001;
-			Table_setNumericValue (my d_events.get(), irow, 1, time);
-			Table_setNumericValue (my d_events.get(), irow, 2, events -> type);
-			// Column 3 will be filled afterwards
-			Table_setNumericValue (my d_events.get(), irow, 4, events -> text_position);
-			Table_setNumericValue (my d_events.get(), irow, 5, events -> length);
-			Table_setNumericValue (my d_events.get(), irow, 6, events -> audio_position);
-			Table_setNumericValue (my d_events.get(), irow, 7, events -> sample);
-			if (events -> type == espeakEVENT_MARK || events -> type == espeakEVENT_PLAY) {
-				Table_setStringValue (my d_events.get(), irow, 8, Melder_peek8to32 (events -> id.name));
+	try {
+		while (events -> type != espeakEVENT_LIST_TERMINATED) {
+			if (events -> type == espeakEVENT_SAMPLERATE) {
+				my d_internalSamplingFrequency = events -> id.number;
 			} else {
-				// Ugly hack because id.string is not 0-terminated if 8 chars long!
-				memcpy (phoneme_name, events -> id.string, 8);
-				phoneme_name[8] = 0;
-				Table_setStringValue (my d_events.get(), irow, 8, Melder_peek8to32 (phoneme_name));
+				/*
+					Just copy the event; no Table cells, so no conversion of numbers to strings.
+				*/
+				const bool isMark = ( events -> type == espeakEVENT_MARK || events -> type == espeakEVENT_PLAY );
+				const char *id = ( isMark ? events -> id.name : events -> id.string );
+				integer idLength = 0;
+				while (id [idLength] != '\0' && (isMark || idLength < 8))   // because id.string is not 0-terminated if 8 chars long!
+					idLength ++;
+				my d_eventList.resize (my d_eventList.size + 1, MelderArray::kInitializationType::RAW);
+				SpeechSynthesizerEvent event = & my d_eventList [my d_eventList.size];
+				event -> time = events -> audio_position * 0.001;
+				event -> type = events -> type;
+				event -> textPosition = events -> text_position;
+				event -> length = events -> length;
+				event -> audioPosition = events -> audio_position;
+				event -> sample = events -> sample;
+				event -> uniqueIdentifier = events -> unique_identifier;
+				event -> idOffset = my d_eventIds.size + 1;
+				my d_eventIds.resize (my d_eventIds.size + idLength + 1, MelderArray::kInitializationType::RAW);
+				memcpy (& my d_eventIds [event -> idOffset], id, idLength);
+				my d_eventIds [event -> idOffset + idLength] = '\0';
 			}
-			Table_setNumericValue (my d_events.get(), irow, 9, events -> unique_identifier);
+			events++;
 		}
-		events++;
-	}
-	if (me) {
-		my d_wav.resize (my d_numberOfSamples + numsamples);
-		for (integer i = 1; i <= numsamples; i++)
-			my d_wav [my d_numberOfSamples + i] = wav [i - 1];
-		my d_numberOfSamples += numsamples;
+		if (me && numsamples > 0) {
+			if (my d_streamCallback) {
+				if (my d_streamBlock.size < numsamples)
+					my d_streamBlock = newVECraw (numsamples);
+				VEC block = my d_streamBlock.part (1, numsamples);
+				for (integer i = 1; i <= numsamples; i ++)
+					block [i] = wav [i - 1] / 32768.0;
+				my d_streamCallback (my d_streamClosure, block, my d_internalSamplingFrequency);
+			} else {
+				my d_wav.resize (my d_numberOfSamples + numsamples, MelderArray::kInitializationType::RAW);
+				integer *to = & my d_wav [my d_numberOfSamples + 1];
+				for (integer i = 0; i < numsamples; i ++)
+					to [i] = wav [i];
+				my d_numberOfSamples += numsamples;
+			}
+		}
+	} catch (MelderError) {
+		my d_callbackFailed = true;
+		return 1;
 	}
 	return 0;
 }
@@ -362,29 +382,37 @@ static void IntervalTier_addBoundaryUnsorted (IntervalTier me, integer iinterval
 	my intervals. addItem_unsorted_move (ti_new.move());
 }
 
-static void Table_setEventTypeString (Table me) {
+static conststring32 eventTypeString (int type) {
+	return
+		type == espeakEVENT_WORD ? U"word" :
+		type == espeakEVENT_SENTENCE ? U"sent" :
+		type == espeakEVENT_MARK ? U"mark" :
+		type == espeakEVENT_PLAY ? U"play" :
+		type == espeakEVENT_END ? U"s-end" :
+		type == espeakEVENT_MSG_TERMINATED ? U"msg_term" :
+		type == espeakEVENT_PHONEME ? U"phoneme" : U"0";
+}
+
+autoTable SpeechSynthesizer_getEventsAsTable (SpeechSynthesizer me) {
 	try {
-		for (integer i = 1; i <= my rows.size; i ++) {
-			const int type = Table_getNumericValue_Assert (me, i, 2);
-			conststring32 label = U"0";
-			if (type == espeakEVENT_WORD)
-				label = U"word";
-			else if (type == espeakEVENT_SENTENCE)
-				label = U"sent";
-			else if (type == espeakEVENT_MARK)
-				label = U"mark";
-			else if (type == espeakEVENT_PLAY)
-				label = U"play";
-			else if (type == espeakEVENT_END)
-				label = U"s-end";
-			else if (type == espeakEVENT_MSG_TERMINATED)
-				label = U"msg_term";
-			else if (type == espeakEVENT_PHONEME)
-				label = U"phoneme";
-			Table_setStringValue (me, i, 3, label);
+		const integer numberOfEvents = my d_eventList.size;
+		autoTable thee = Table_createWithColumnNames (numberOfEvents, U"time type type-t t-pos length a-pos sample id uniq");
+		for (integer irow = 1; irow <= numberOfEvents; irow ++) {
+			const SpeechSynthesizerEvent event = & my d_eventList [irow];
+			Table_setNumericValue (thee.get(), irow, 1, event -> time);
+			Table_setNumericValue (thee.get(), irow, 2, event -> type);
+			Table_setStringValue (thee.get(), irow, 3, eventTypeString (event -> type));
+			Table_setNumericValue (thee.get(), irow, 4, event -> textPosition);
+			Table_setNumericValue (thee.get(), irow, 5, event -> length);
+			Table_setNumericValue (thee.get(), irow, 6, event -> audioPosition);
+			Table_setNumericValue (thee.get(), irow, 7, event -> sample);
+			autostring32 id = Melder_8to32 (& my d_eventIds [event -> idOffset]);
+			Table_setStringValue (thee.get(), irow, 8, id.get());
+			Table_setNumericValue (thee.get(), irow, 9, event -> uniqueIdentifier);
 		}
+		return thee;
 	} catch (MelderError) {
-		Melder_throw (U"Event types not set.");
+		Melder_throw (me, U": no Table with events created.");
 	}
 }
 
@@ -487,15 +515,10 @@ static void IntervalTier_removeVeryShortIntervals (IntervalTier me) {
 	}
 }
 
-static autoTextGrid Table_to_TextGrid (Table me, conststring32 text, double xmin, double xmax) {
-	//Table_createWithColumnNames (0, L"time type type-t t-pos length a-pos sample id uniq");
+autoTextGrid SpeechSynthesizer_getEventsAsTextGrid (SpeechSynthesizer me, conststring32 text, double xmin, double xmax) {
 	try {
 		const integer textLength = str32len (text);
-		const integer numberOfRows = my rows.size;
-		const integer timeColumnIndex = Table_getColumnIndexFromColumnLabel (me, U"time");
-		const integer typeColumnIndex = Table_getColumnIndexFromColumnLabel (me, U"type");
-		const integer tposColumnIndex = Table_getColumnIndexFromColumnLabel (me, U"t-pos");
-		const integer   idColumnIndex = Table_getColumnIndexFromColumnLabel (me, U"id");
+		const integer numberOfEvents = my d_eventList.size;
 		autoTextGrid thee = TextGrid_create (xmin, xmax, U"sentence clause word phoneme", U"");
 
 		TextGrid_setIntervalText (thee.get(), 1, 1, text);
@@ -508,10 +531,11 @@ static autoTextGrid Table_to_TextGrid (Table me, conststring32 text, double xmin
 		const IntervalTier clauses = (IntervalTier) thy tiers->at [2];
 		const IntervalTier words = (IntervalTier) thy tiers->at [3];
 		const IntervalTier phonemes = (IntervalTier) thy tiers->at [4];
-		for (integer i = 1; i <= numberOfRows; i++) {
-			const double time = Table_getNumericValue_Assert (me, i, timeColumnIndex);
-			const int type = Table_getNumericValue_Assert (me, i, typeColumnIndex);
-			const integer pos = Table_getNumericValue_Assert (me, i, tposColumnIndex);
+		for (integer i = 1; i <= numberOfEvents; i++) {
+			const SpeechSynthesizerEvent event = & my d_eventList [i];
+			const double time = event -> time;
+			const int type = event -> type;
+			const integer pos = event -> textPosition;
 			integer length;
 			if (type == espeakEVENT_SENTENCE) {
 				/*
@@ -563,7 +587,7 @@ static autoTextGrid Table_to_TextGrid (Table me, conststring32 text, double xmin
 				wordEnd = true;
 				p1w = pos;
 			} else if (type == espeakEVENT_PHONEME) {
-				const conststring32 id = Table_getStringValue_Assert (me, i, idColumnIndex);
+				autostring32 id = Melder_8to32 (& my d_eventIds [event -> idOffset]);
 				if (time > time_phon_p) {
 					/*
 						Insert new boudary and label interval with the id
@@ -571,12 +595,12 @@ static autoTextGrid Table_to_TextGrid (Table me, conststring32 text, double xmin
 					*/
 					TextInterval ti = phonemes -> intervals.at [phonemes -> intervals.size];
 					if (time > ti -> xmin && time < ti -> xmax)
-						IntervalTier_addBoundaryUnsorted (phonemes, phonemes -> intervals.size, time, id, false);
+						IntervalTier_addBoundaryUnsorted (phonemes, phonemes -> intervals.size, time, id.get(), false);
 				} else {
 					/*
 						Just in case the phoneme starts at xmin we only need to set interval text
 					*/
-					TextGrid_setIntervalText (thee.get(), 4, phonemes -> intervals.size, id);
+					TextGrid_setIntervalText (thee.get(), 4, phonemes -> intervals.size, id.get());
 				}
 				time_phon_p = time;
 			}
@@ -597,10 +621,23 @@ static autoTextGrid Table_to_TextGrid (Table me, conststring32 text, double xmin
 
 		return thee;
 	} catch (MelderError) {
-		Melder_throw (U"TextGrid not created from Table with events.");
+		Melder_throw (me, U": no TextGrid with events created.");
 	}
 }
 
+/*
+	The TextGrid of the events, over the time domain of the synthesized sound.
+*/
+static autoTextGrid SpeechSynthesizer_eventsToTextGrid_part (SpeechSynthesizer me, conststring32 text, Sound sound) {
+	double xmin = sound -> xmin, xmax = sound -> xmax;
+	if (my d_eventList.size > 0) {
+		xmin = std::min (xmin, my d_eventList [1]. time);
+		xmax = std::max (xmax, my d_eventList [my d_eventList.size]. time);
+	}
+	autoTextGrid tg = SpeechSynthesizer_getEventsAsTextGrid (me, text, xmin, xmax);
+	return TextGrid_extractPart (tg.get(), sound -> xmin, sound -> xmax, 0);
+}
+
 static void espeakdata_SetVoiceByName (conststring32 languageName, conststring32 voiceName)
 {
 	espeak_VOICE voice_selector;
@@ -615,13 +652,49 @@ static void espeakdata_SetVoiceByName (conststring32 languageName, conststring32
 	}
 }
 
-autoSound SpeechSynthesizer_to_Sound (SpeechSynthesizer me, conststring32 text, autoTextGrid *tg, autoTable *events) {
+/*
+	eSpeak keeps its state in global variables, so that only one text can be synthesized at a time.
+	Between syntheses eSpeak stays initialized with the voice of the last synthesis,
+	so that a series of texts with the same language, voice and phoneme set
+	does not load the phoneme data and the dictionary again for every text.
+*/
+static std::mutex theEspeakMutex;
+static bool theEspeakIsInitialized = false;
+static autostring32 theEspeakVoiceKey;   // language, voice variant and phoneme set of the loaded voice
+
+/*
+	Called at exit, so that eSpeak can release its data and close its files.
+*/
+static void espeak_terminateAtExit () {
+	std::lock_guard <std::mutex> lock (theEspeakMutex);
+	if (theEspeakIsInitialized) {
+		espeak_ng_Terminate ();
+		theEspeakIsInitialized = false;
+	}
+}
+
+/*
+	Synthesizes the text with eSpeak, which hands the audio to synthCallback () in pieces of at most bufferLength_ms.
+	The strings for eSpeak are built in local buffers rather than in Melder's shared circular buffers,
+	which other threads may be using.
+*/
+static void SpeechSynthesizer_synthesize (SpeechSynthesizer me, conststring32 text, int bufferLength_ms) {
+	std::lock_guard <std::mutex> lock (theEspeakMutex);
 	try {
-		espeak_ng_InitializePath (nullptr); // PATH_ESPEAK_DATA
-		espeak_ng_ERROR_CONTEXT context = { 0 };
-		espeak_ng_STATUS status = espeak_ng_Initialize (& context);
-		Melder_require (status == ENS_OK,
-			U"Internal espeak error.", status);
+		if (! theEspeakIsInitialized) {
+			espeak_ng_InitializePath (nullptr); // PATH_ESPEAK_DATA
+			espeak_ng_ERROR_CONTEXT context = { 0 };
+			const espeak_ng_STATUS status = espeak_ng_Initialize (& context);
+			Melder_require (status == ENS_OK,
+				U"Internal espeak error.", status);
+			static bool theExitFunctionIsRegistered = false;
+			if (! theExitFunctionIsRegistered) {
+				atexit (espeak_terminateAtExit);
+				theExitFunctionIsRegistered = true;
+			}
+			theEspeakIsInitialized = true;
+			theEspeakVoiceKey. reset ();
+		}
 		int synth_flags = espeakCHARS_WCHAR;
 		if (my d_inputTextFormat == SpeechSynthesizer_INPUT_TAGGEDTEXT)
 			synth_flags |= espeakSSML;
@@ -644,59 +717,122 @@ autoSound SpeechSynthesizer_to_Sound (SpeechSynthesizer me, conststring32 text,
 		espeak_ng_SetParameter (espeakRANGE, pitchRange_0_99, 0);
 		const conststring32 languageCode = SpeechSynthesizer_getLanguageCode (me);
 		const conststring32 voiceCode = SpeechSynthesizer_getVoiceCode (me);
-		
-		espeak_ng_SetVoiceByName (Melder_peek32to8 (Melder_cat (languageCode, U"+", voiceCode)));
+		const bool phonemeSetIsOwn = Melder_equ (my d_phonemeSet.get(), my d_languageName.get());
+		const conststring32 phonemeCode = ( phonemeSetIsOwn ? U"" : SpeechSynthesizer_getPhonemeCode (me) );
+		autoMelderString voiceKey;
+		MelderString_copy (& voiceKey, languageCode, U"+", voiceCode, U" ", phonemeCode);
+		if (! theEspeakVoiceKey || ! Melder_equ (voiceKey.string, theEspeakVoiceKey.get())) {
+			theEspeakVoiceKey. reset ();   // in case the voice change fails halfway
+			autoMelderString voiceName;
+			MelderString_copy (& voiceName, languageCode, U"+", voiceCode);
+			autostring8 voiceName8 = Melder_32to8 (voiceName.string);
+			espeak_ng_SetVoiceByName (voiceName8.get());
+			if (! phonemeSetIsOwn) {
+				autostring8 phonemeCode8 = Melder_32to8 (phonemeCode);
+				const int index_phon_table_list = LookupPhonemeTable (phonemeCode8.get());
+				if (index_phon_table_list > 0) {
+					voice -> phoneme_tab_ix = index_phon_table_list;
+					DoVoiceChange(voice);
+				}
+			}
+			theEspeakVoiceKey = Melder_dup (voiceKey.string);
+		}
 		const int wordgap_10ms = my d_wordgap * 100; // espeak wordgap is in units of 10 ms
 		espeak_ng_SetParameter (espeakWORDGAP, wordgap_10ms, 0);
 		espeak_ng_SetParameter (espeakCAPITALS, 0, 0);
 		espeak_ng_SetParameter (espeakPUNCTUATION, espeakPUNCT_NONE, 0);
 		
-		status = espeak_ng_InitializeOutput (ENOUTPUT_MODE_SYNCHRONOUS, 2048, nullptr);
+		espeak_ng_InitializeOutput (ENOUTPUT_MODE_SYNCHRONOUS, bufferLength_ms, nullptr);
 		espeak_SetSynthCallback (synthCallback);
-		if (! Melder_equ (my d_phonemeSet.get(), my d_languageName.get())) {
-			const conststring32 phonemeCode = SpeechSynthesizer_getPhonemeCode (me);
-			const int index_phon_table_list = LookupPhonemeTable (Melder_peek32to8 (phonemeCode));
-			if (index_phon_table_list > 0) {
-				voice -> phoneme_tab_ix = index_phon_table_list;
-				DoVoiceChange(voice);
-			}
-		}
 
-		my d_events = Table_createWithColumnNames (0, U"time type type-t t-pos length a-pos sample id uniq");
+		my d_eventList.resize (0);
+		my d_eventIds.resize (0);
+		my d_numberOfSamples = 0;
+		my d_callbackFailed = false;
 
 		#ifdef _WIN32
-			conststringW textW = Melder_peek32toW (text);
-			espeak_ng_Synthesize (textW, wcslen (textW) + 1, 0, POS_CHARACTER, 0, synth_flags, nullptr, me);
+			autostringW textW = Melder_32toW (text);
+			espeak_ng_Synthesize (textW.get(), wcslen (textW.get()) + 1, 0, POS_CHARACTER, 0, synth_flags, nullptr, me);
 		#else
 			espeak_ng_Synthesize (text, str32len (text) + 1, 0, POS_CHARACTER, 0, synth_flags, nullptr, me);
 		#endif
-				
+		if (my d_callbackFailed)
+			throw MelderError ();   // with the message of the error that stopped eSpeak
+	} catch (MelderError) {
 		espeak_ng_Terminate ();
-		autoSound thee = buffer_to_Sound (my d_wav.get(), my d_internalSamplingFrequency);
+		theEspeakIsInitialized = false;
+		theEspeakVoiceKey. reset ();
+		throw;
+	}
+}
+
+autoSound SpeechSynthesizer_to_Sound (SpeechSynthesizer me, conststring32 text, autoTextGrid *tg, autoTable *events) {
+	try {
+		SpeechSynthesizer_synthesize (me, text, 2048);
+		autoSound thee = buffer_to_Sound (my d_wav.part (1, my d_numberOfSamples), my d_internalSamplingFrequency);
 
 		if (my d_samplingFrequency != my d_internalSamplingFrequency)
 			thee = Sound_resample (thee.get(), my d_samplingFrequency, 50);
 		my d_numberOfSamples = 0; // re-use the wav-buffer
-		if (tg) {
-			double xmin = Table_getNumericValue_Assert (my d_events.get(), 1, 1);
-			if (xmin > thy xmin)
-				xmin = thy xmin;
-			double xmax = Table_getNumericValue_Assert (my d_events.get(), my d_events -> rows.size, 1);
-			if (xmax < thy xmax)
-				xmax = thy xmax;
-			autoTextGrid tg1 = Table_to_TextGrid (my d_events.get(), text, xmin, xmax);
-			*tg = TextGrid_extractPart (tg1.get(), thy xmin, thy xmax, 0);
-		}
-		if (events) {
-			Table_setEventTypeString (my d_events.get());
-			*events = my d_events.move();
-		}
-		my d_events.reset();
+		if (tg)
+			*tg = SpeechSynthesizer_eventsToTextGrid_part (me, text, thee.get());
+		if (events)
+			*events = SpeechSynthesizer_getEventsAsTable (me);
 		return thee;
 	} catch (MelderError) {
-		espeak_Terminate ();
 		Melder_throw (U"SpeechSynthesizer: text not converted to Sound.");
 	}
 }
 
+void SpeechSynthesizer_stream (SpeechSynthesizer me, conststring32 text, double blockDuration,
+	SpeechSynthesizer_StreamCallback callback, void *closure)
+{
+	try {
+		Melder_require (blockDuration > 0.0,
+			U"The block duration should be positive.");
+		my d_streamCallback = callback;
+		my d_streamClosure = closure;
+		SpeechSynthesizer_synthesize (me, text, std::max (1, (int) Melder_iround (1000.0 * blockDuration)));
+		my d_streamCallback = nullptr;
+		my d_streamClosure = nullptr;
+	} catch (MelderError) {
+		my d_streamCallback = nullptr;
+		my d_streamClosure = nullptr;
+		Melder_throw (U"SpeechSynthesizer: text not streamed.");
+	}
+}
+
+struct SoundCollector {
+	autoVEC samples;
+	integer numberOfSamples;
+	double samplingFrequency;
+};
+
+static void SoundCollector_addBlock (void *closure, constVEC const& block, double samplingFrequency) {
+	SoundCollector *me = (SoundCollector *) closure;
+	my samples.resize (my numberOfSamples + block.size, MelderArray::kInitializationType::RAW);
+	my samples.part (my numberOfSamples + 1, my numberOfSamples + block.size)  <<=  block;
+	my numberOfSamples += block.size;
+	my samplingFrequency = samplingFrequency;
+}
+
+autoSound SpeechSynthesizer_to_Sound_streaming (SpeechSynthesizer me, conststring32 text, double blockDuration, autoTextGrid *tg) {
+	try {
+		SoundCollector collector { };
+		SpeechSynthesizer_stream (me, text, blockDuration, SoundCollector_addBlock, & collector);
+		Melder_require (collector.numberOfSamples > 0,
+			U"No audio was synthesized.");
+		const double dx = 1.0 / collector.samplingFrequency;
+		autoSound thee = Sound_create (1, 0.0, collector.numberOfSamples * dx, collector.numberOfSamples, dx, dx / 2.0);
+		thy z.row (1)  <<=  collector.samples.part (1, collector.numberOfSamples);
+		if (my d_samplingFrequency != collector.samplingFrequency)
+			thee = Sound_resample (thee.get(), my d_samplingFrequency, 50);
+		if (tg)
+			*tg = SpeechSynthesizer_eventsToTextGrid_part (me, text, thee.get());
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": text not converted to Sound.");
+	}
+}
+
 /* End of file SpeechSynthesizer.cpp */
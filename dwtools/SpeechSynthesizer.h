@@ -36,6 +36,19 @@
 #define SpeechSynthesizer_INPUT_PHONEMESONLY 2
 #define SpeechSynthesizer_INPUT_TAGGEDTEXT 3
 
+/*
+	An event as reported by eSpeak during synthesis. The events are collected in this form
+	and are converted to a Table or TextGrid only if these are asked for.
+*/
+typedef struct structSpeechSynthesizerEvent {
+	double time;   // in seconds
+	int type;   // espeakEVENT_WORD, espeakEVENT_PHONEME, ...
+	integer textPosition, length, audioPosition, sample, uniqueIdentifier;
+	integer idOffset;   // where the 0-terminated UTF-8 name of the mark or phoneme starts in d_eventIds
+} *SpeechSynthesizerEvent;
+
+typedef void (*SpeechSynthesizer_StreamCallback) (void *closure, constVEC const& block, double samplingFrequency);
+
 #include "SpeechSynthesizer_def.h"
 
 autoEspeakVoice EspeakVoice_create ();
@@ -65,5 +78,23 @@ autoSound SpeechSynthesizer_to_Sound (SpeechSynthesizer me, conststring32 text,
 
 void SpeechSynthesizer_playText (SpeechSynthesizer me, conststring32 text);
 
+/*
+	SpeechSynthesizer_stream () hands every piece of audio to the callback as soon as eSpeak has synthesized it,
+	in blocks of at most blockDuration seconds, at eSpeak's internal sampling frequency (no resampling).
+	The events stay available for SpeechSynthesizer_getEventsAsTable () and SpeechSynthesizer_getEventsAsTextGrid ()
+	until the next synthesis.
+	Syntheses are serialized over the whole program, because eSpeak has global state;
+	the callback is called while eSpeak is in use, so it should not start another synthesis.
+	The callback may throw a MelderError; eSpeak then stops, and SpeechSynthesizer_stream () throws the error on.
+*/
+void SpeechSynthesizer_stream (SpeechSynthesizer me, conststring32 text, double blockDuration,
+	SpeechSynthesizer_StreamCallback callback, void *closure);
+
+autoTable SpeechSynthesizer_getEventsAsTable (SpeechSynthesizer me);
+
+autoTextGrid SpeechSynthesizer_getEventsAsTextGrid (SpeechSynthesizer me, conststring32 text, double xmin, double xmax);
+
+autoSound SpeechSynthesizer_to_Sound_streaming (SpeechSynthesizer me, conststring32 text, double blockDuration, autoTextGrid *tg);   // the same as SpeechSynthesizer_to_Sound, block by block
+
 /* End of file SpeechSynthesizer.h */
 #endif
@@ -115,7 +115,6 @@ oo_DEFINE_CLASS (SpeechSynthesizer, Daata)
 
 	#if ! oo_READING && ! oo_WRITING
 		// Filled by the callback
-		oo_OBJECT (Table, 0, d_events)
 		oo_DOUBLE (d_internalSamplingFrequency)
 		oo_INTEGER (d_numberOfSamples)
 		oo_INTEGER (d_wavCapacity)
@@ -123,6 +122,13 @@ oo_DEFINE_CLASS (SpeechSynthesizer, Daata)
 	#endif
 
 	#if oo_DECLARING
+		autovector <structSpeechSynthesizerEvent> d_eventList;
+		autovector <char> d_eventIds;
+		SpeechSynthesizer_StreamCallback d_streamCallback;
+		void *d_streamClosure;
+		autoVEC d_streamBlock;
+		bool d_callbackFailed;   // the error message is waiting in Melder's error buffer
+
 		void v_info ()
 			override;
 	#endif
@@ -257,13 +257,22 @@ autoStringsIndex Table_to_StringsIndex_column (Table me, integer column) {
 		Melder_require (column > 0 && column <= my numberOfColumns,
 			U"Invalid column number.");
 		const integer numberOfRows = my rows.size;
-		Table_numericize_Assert (me, column);
-		autoSTRVEC groupLabels (numberOfRows);
-		for (integer irow = 1; irow <= numberOfRows; irow ++)
-			groupLabels [irow] = Melder_dup(my rows.at [irow] -> cells [column]. string.get()); //TODO no dup
-
-		autoStrings thee = Strings_createFromSTRVEC (groupLabels.get(), 1, numberOfRows);
-		autoStringsIndex him = Strings_to_StringsIndex (thee.get());
+		/*
+			The ranks of the strings in the column are the class indices, in the same order as in Strings_to_StringsIndex.
+		*/
+		integer numberOfClasses;
+		autoINTVEC ranks = Table_getStringRanks (me, column, & numberOfClasses);
+		autoStringsIndex him = StringsIndex_create (numberOfRows);
+		autoINTVEC firstRowOfClass = newINTVECzero (numberOfClasses);
+		for (integer irow = 1; irow <= numberOfRows; irow ++) {
+			his classIndex [irow] = ranks [irow];
+			if (firstRowOfClass [ranks [irow]] == 0)
+				firstRowOfClass [ranks [irow]] = irow;
+		}
+		for (integer iclass = 1; iclass <= numberOfClasses; iclass ++) {
+			autoSimpleString label = SimpleString_create (my rows.at [firstRowOfClass [iclass]] -> cells [column]. string.get());
+			his classes -> addItem_move (label.move());
+		}
 		return him;
 	} catch (MelderError) {
 		Melder_throw (me, U"No StringsIndex created from column ", column, U".");
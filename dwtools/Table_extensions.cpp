@@ -4281,21 +4281,25 @@ integer Table_getNumberOfRowsWhere (Table me, conststring32 formula, Interpreter
 	return numberOfRows;
 }
 
+static autoINTVEC Table_findRowsWhere (Table me, conststring32 formula, Interpreter interpreter) {
+	Formula_compile (interpreter, me, formula, kFormula_EXPRESSION_TYPE_NUMERIC, true);
+	Formula_Result result;
+	autoINTVEC selectedRows = newINTVECraw (my rows.size);
+	integer numberOfMatches = 0;
+	for (integer irow = 1; irow <= my rows.size; irow ++) {
+		Formula_run (irow, 1, & result);
+		if (result. numericResult != 0.0)
+			selectedRows [++ numberOfMatches] = irow;
+	}
+	selectedRows. resize (numberOfMatches);
+	return selectedRows;
+}
+
 autoINTVEC Table_findRowsMatchingCriterion (Table me, conststring32 formula, Interpreter interpreter) {
 	try {
-		const integer numberOfMatches = Table_getNumberOfRowsWhere (me, formula, interpreter);
-		Melder_require (numberOfMatches > 0,
+		autoINTVEC selectedRows = Table_findRowsWhere (me, formula, interpreter);
+		Melder_require (selectedRows.size > 0,
 			U"No rows selected.");
-		Formula_compile (interpreter, me, formula, kFormula_EXPRESSION_TYPE_NUMERIC, true);
-		Formula_Result result;
-		autoINTVEC selectedRows = newINTVECzero (numberOfMatches);
-		integer n = 0;
-		for (integer irow = 1; irow <= my rows.size; irow ++) {
-			Formula_run (irow, 1, & result);
-			if (result. numericResult != 0.0)
-				selectedRows [ ++ n] = irow;
-		}
-		Melder_assert (n == numberOfMatches);
 		return selectedRows;
 	} catch (MelderError) {
 		Melder_throw (me, U": cannot find matches.");
@@ -4539,19 +4543,8 @@ void Table_lagPlotWhere (Table me, Graphics g, integer column, integer lag, doub
 
 autoTable Table_extractRowsWhere (Table me, conststring32 formula, Interpreter interpreter) {
 	try {
-		Formula_compile (interpreter, me, formula, kFormula_EXPRESSION_TYPE_NUMERIC, true);
-		Formula_Result result;
-		autoTable thee = Table_create (0, my numberOfColumns);
-		for (integer icol = 1; icol <= my numberOfColumns; icol ++)
-			thy columnHeaders [icol]. label = Melder_dup (my columnHeaders [icol]. label.get());
-		for (integer irow = 1; irow <= my rows.size; irow ++) {
-			Formula_run (irow, 1, & result);
-			if (result. numericResult != 0.0) {
-				const TableRow row = my rows.at [irow];
-				autoTableRow newRow = Data_copy (row);
-				thy rows. addItem_move (newRow.move());
-			}
-		}
+		autoINTVEC selectedRows = Table_findRowsWhere (me, formula, interpreter);
+		autoTable thee = Table_extractRows (me, selectedRows.get());
 		if (thy rows.size == 0)
 			Melder_warning (U"No row matches criterion.");
 		return thee;
@@ -4613,9 +4606,8 @@ static autoTable Table_SSCPList_extractMahalanobisWhere (Table me, SSCPList thee
 		autoINTVEC selectedRows = Table_findRowsMatchingCriterion (me, formula, interpreter);
 		for (integer icol = 1; icol <= numberOfColumns; icol ++)
 			columnIndex [icol] = Table_getColumnIndexFromColumnLabel (me, sscp -> columnLabels [icol].get()); // throw if not present
-		autoTable him = Table_create (0, my numberOfColumns);
-		for (integer icol = 1; icol <= my numberOfColumns; icol ++)
-			his columnHeaders [icol].label = Melder_dup (my columnHeaders [icol]. label.get());
+		autoINTVEC extractedRows = newINTVECraw (selectedRows.size);
+		integer numberOfExtractedRows = 0;
 		OrderedOf<structCovariance> covs;
 		for (integer igroup = 1; igroup <= numberOfGroups; igroup ++) {
 			autoCovariance cov = SSCP_to_Covariance (thy at [igroup], 1);
@@ -4635,12 +4627,10 @@ static autoTable Table_SSCPList_extractMahalanobisWhere (Table me, SSCPList thee
 			for (integer icol = 1; icol <= numberOfColumns; icol ++)
 				vector [icol] = Table_getNumericValue_Assert (me, irow, columnIndex [icol]);
 			const double dm2 = NUMmahalanobisDistanceSquared (covi -> lowerCholeskyInverse.get(), vector.get(), covi -> centroid.get());
-			if (Melder_numberMatchesCriterion (sqrt (dm2), which, numberOfSigmas)) {
-				const TableRow row = my rows.at [irow];
-				autoTableRow newRow = Data_copy (row);
-				his rows. addItem_move (newRow.move());
-			}
+			if (Melder_numberMatchesCriterion (sqrt (dm2), which, numberOfSigmas))
+				extractedRows [++ numberOfExtractedRows] = irow;
 		}
+		autoTable him = Table_extractRows (me, extractedRows.part (1, numberOfExtractedRows));
 		return him;
 	} catch (MelderError) {
 		Melder_throw (me, U"Table (mahalanobis) not extracted.");
@@ -4361,15 +4361,27 @@ DEFINITION (U"determines the label for a silent interval in the TextGrid.") \
 TAG (U"##Sounding interval label") \
 DEFINITION (U"determines the label for a sounding interval in the TextGrid.")
 
-MAN_BEGIN (U"Sound: To TextGrid (silences)...", U"djmw", 20160406)
+MAN_BEGIN (U"Sound: To TextGrid (silences)...", U"djmw", 20261019)
 INTRO (U"A command that creates a @TextGrid in which the silent and sounding intervals of the selected @Sound are marked.")
 ENTRY (U"Settings")
 xxx_to_TextGrid_detectSilences_COMMON_PARAMETERS_HELP
 ENTRY (U"Algorithm")
-NORMAL (U"First a copy of the sound is @@Sound: Filter (pass Hann band)...|bandpass filtered@ between 80 and 8000 Hz to "
+NORMAL (U"First the sound is @@Sound: Filter (pass Hann band)...|bandpass filtered@ between 80 and 8000 Hz to "
 	"remove especially the low frequency noise that can have a significant influence on the intensity measurement but does not "
 	"really contribute to the sound. Next the @@Sound: To Intensity...|intensity of the filtered sound@ is determined. "
 	"Finally the silent and sounding intervals are determined @@Intensity: To TextGrid (silences)...|from the intensity curve@.")
+NORMAL (U"The filtering and the intensity analysis are done block by block, without a filtered copy of the sound; "
+	"the filter is the same Hann band, applied with an impulse response of 0.1 s. "
+	"Because that impulse response is cut off, the intensities differ slightly from those of Praat versions before 2026, "
+	"which filtered the whole sound at once, and a boundary can lie one ##Time step# earlier or later than it did in those versions.")
+MAN_END
+
+MAN_BEGIN (U"LongSound: To TextGrid (silences)...", U"djmw", 20261019)
+INTRO (U"A command that creates a @TextGrid in which the silent and sounding intervals of the selected @LongSound are marked.")
+NORMAL (U"The result is the same as that of @@Sound: To TextGrid (silences)...@ on the whole sound, "
+	"but the sound is read from the file block by block, so that only the intensity contour has to be in memory.")
+ENTRY (U"Settings")
+xxx_to_TextGrid_detectSilences_COMMON_PARAMETERS_HELP
 MAN_END
 
 MAN_BEGIN (U"Intensity: To TextGrid (silences)...", U"djmw", 20061201)
@@ -395,6 +395,18 @@ DO
 	CONVERT_EACH_END (my name.get())
 }
 
+FORM (NEW_Sound_to_MixingMatrix_fastICA, U"Sound: To MixingMatrix (FastICA)", nullptr) {
+	praat_TimeFunction_RANGE (fromTime, toTime)
+	LABEL (U"Iteration parameters")
+	NATURAL (maximumNumberOfIterations, U"Maximum number of iterations", U"200")
+	POSITIVE (tolerance, U"Tolerance", U"1e-6")
+	OK
+DO
+	CONVERT_EACH (Sound)
+		autoMixingMatrix result = Sound_to_MixingMatrix_fastICA (me, fromTime, toTime, maximumNumberOfIterations, tolerance);
+	CONVERT_EACH_END (my name.get())
+}
+
 FORM (MODIFY_Sound_MixingMatrix_improveUnmixing, U"", nullptr) {
 	praat_TimeFunction_RANGE (fromTime, toTime)
 	NATURAL (numberOfCrossCorrelations, U"Number of cross-correlations", U"40")
@@ -539,6 +551,7 @@ void praat_BSS_init () {
 	praat_addAction1 (classMixingMatrix, 0, U"To Diagonalizer", U"To Matrix", praat_DEPTH_1, NEW1_MixingMatrix_to_Diagonalizer);
 
 	praat_addAction1 (classSound, 0, U"To MixingMatrix...",  U"Resample...", praat_HIDDEN + praat_DEPTH_1, NEW_Sound_to_MixingMatrix);
+	praat_addAction1 (classSound, 0, U"To MixingMatrix (FastICA)...",  U"Resample...", praat_HIDDEN + praat_DEPTH_1, NEW_Sound_to_MixingMatrix_fastICA);
     praat_addAction1 (classSound, 0, U"To CrossCorrelationTable...",  U"Resample...", 1, NEW_Sound_to_CrossCorrelationTable);
     praat_addAction1 (classSound, 0, U"To Covariance (channels)...",  U"Resample...", praat_HIDDEN + praat_DEPTH_1, NEW_Sound_to_Covariance_channels);
 	praat_addAction1 (classSound, 0, U"To CrossCorrelationTables...",  U"Resample...", praat_HIDDEN + praat_DEPTH_1, NEW_Sound_to_CrossCorrelationTableList);
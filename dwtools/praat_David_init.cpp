@@ -3548,6 +3548,72 @@ FORM_SAVE (SAVE_LongSounds_saveAsStereoNISTFile, U"LongSound: Save as NIST file"
 	END
 }
 
+FORM (NEW_LongSound_to_MelSpectrogram, U"LongSound: To MelSpectrogram", U"Sound: To MelSpectrogram...") {
+	POSITIVE (windowLength, U"Window length (s)", U"0.015")
+	POSITIVE (timeStep, U"Time step (s)", U"0.005")
+	LABEL (U"Filter bank parameters")
+	POSITIVE (firstFrequency, U"Position of first filter (mel)", U"100.0")
+	POSITIVE (deltaFrequency, U"Distance between filters (mel)", U"100.0")
+	REAL (maximumFrequency, U"Maximum frequency (mel)", U"0.0");
+	OK
+DO
+	CONVERT_EACH (LongSound)
+		autoMelSpectrogram result = LongSound_to_MelSpectrogram (me, windowLength, timeStep, firstFrequency, maximumFrequency, deltaFrequency);
+	CONVERT_EACH_END (my name.get())
+}
+
+FORM (NEW_LongSound_to_TextGrid_detectSilences, U"LongSound: To TextGrid (silences)", U"LongSound: To TextGrid (silences)...") {
+	LABEL (U"Parameters for the intensity analysis")
+	POSITIVE (minimumPitch, U"Minimum pitch (Hz)", U"100")
+	REAL (timeStep, U"Time step (s)", U"0.0 (= auto)")
+	LABEL (U"Silent intervals detection")
+	REAL (silenceThreshold, U"Silence threshold (dB)", U"-25.0")
+	POSITIVE (minimumSilenceDuration, U"Minimum silent interval duration (s)", U"0.1")
+	POSITIVE (minimumSoundingDuration, U"Minimum sounding interval duration (s)", U"0.1")
+	WORD (silenceLabel, U"Silent interval label", U"silent")
+	WORD (soundingLabel, U"Sounding interval label", U"sounding")
+	OK
+DO
+	CONVERT_EACH (LongSound)
+		autoTextGrid result = LongSound_to_TextGrid_detectSilences (me, minimumPitch, timeStep, silenceThreshold, minimumSilenceDuration, minimumSoundingDuration, silenceLabel, soundingLabel);
+	CONVERT_EACH_END (my name.get())
+}
+
+FORM (NEW_LongSound_to_MFCC, U"LongSound: To MFCC", U"Sound: To MFCC...") {
+	NATURAL (numberOfCoefficients, U"Number of coefficients", U"12")
+	POSITIVE (windowLength, U"Window length (s)", U"0.015")
+	POSITIVE (timeStep, U"Time step (s)", U"0.005")
+	LABEL (U"Filter bank parameters")
+	POSITIVE (firstFilterFrequency, U"First filter frequency (mel)", U"100.0")
+	POSITIVE (distancBetweenFilters, U"Distance between filters (mel)", U"100.0")
+	REAL (maximumFrequency, U"Maximum frequency (mel)", U"0.0");
+	OK
+DO
+	Melder_require (numberOfCoefficients < 25, U"The number of coefficients should be less than 25.");
+	CONVERT_EACH (LongSound)
+		autoMFCC result = LongSound_to_MFCC (me, numberOfCoefficients, windowLength, timeStep, firstFilterFrequency, maximumFrequency, distancBetweenFilters);
+	CONVERT_EACH_END (my name.get())
+}
+
+FORM (SAVE_LongSound_saveMFCCAsBinaryFile, U"LongSound: Save MFCC as binary file", U"Sound: To MFCC...") {
+	TEXTFIELD (mfccFile, U"MFCC file:", U"")
+	NATURAL (numberOfCoefficients, U"Number of coefficients", U"12")
+	POSITIVE (windowLength, U"Window length (s)", U"0.015")
+	POSITIVE (timeStep, U"Time step (s)", U"0.005")
+	LABEL (U"Filter bank parameters")
+	POSITIVE (firstFilterFrequency, U"First filter frequency (mel)", U"100.0")
+	POSITIVE (distancBetweenFilters, U"Distance between filters (mel)", U"100.0")
+	REAL (maximumFrequency, U"Maximum frequency (mel)", U"0.0");
+	OK
+DO
+	Melder_require (numberOfCoefficients < 25, U"The number of coefficients should be less than 25.");
+	SAVE_ONE (LongSound)
+		structMelderFile file { };
+		Melder_relativePathToFile (mfccFile, & file);
+		LongSound_saveMFCCAsBinaryFile (me, & file, numberOfCoefficients, windowLength, timeStep, firstFilterFrequency, maximumFrequency, distancBetweenFilters);
+	SAVE_ONE_END
+}
+
 /******************* Matrix **************************************************/
 
 FORM (GRAPHICS_Matrix_drawAsSquares, U"Matrix: Draw as squares", U"Matrix: Draw as squares...") {
@@ -3856,6 +3922,43 @@ DO
 	CONVERT_COUPLE_END (my name.get(), U"_", your name.get())
 }
 
+FORM (REAL_Matrices_getDTWDistance, U"Matrices: Get DTW distance", nullptr) {
+	REAL (distanceMetric, U"Distance metric", U"2.0")
+	REAL (sakoeChibaBand, U"Sakoe-Chiba band (s)", U"0.05")
+	RADIO (slopeConstraint, U"Slope constraint", 1)
+		RADIOBUTTON (U"no restriction")
+		RADIOBUTTON (U"1/3 < slope < 3")
+		RADIOBUTTON (U"1/2 < slope < 2")
+		RADIOBUTTON (U"2/3 < slope < 3/2")
+	REAL (abandonAbove, U"Abandon above (0 = never)", U"0.0")
+	OK
+DO
+	NUMBER_COUPLE (Matrix)
+		double result = Matrices_getDTWDistance (me, you, sakoeChibaBand, slopeConstraint, distanceMetric,
+				abandonAbove > 0.0 ? abandonAbove : undefined);
+	NUMBER_COUPLE_END (U" (weighted distance)")
+}
+
+FORM (NEW1_Matrices_searchDTW, U"Matrices: Search DTW", nullptr) {
+	LABEL (U"The first selected Matrix is the query, the others are the references.")
+	REAL (distanceMetric, U"Distance metric", U"2.0")
+	REAL (sakoeChibaBand, U"Sakoe-Chiba band (s)", U"0.05")
+	RADIO (slopeConstraint, U"Slope constraint", 1)
+		RADIOBUTTON (U"no restriction")
+		RADIOBUTTON (U"1/3 < slope < 3")
+		RADIOBUTTON (U"1/2 < slope < 2")
+		RADIOBUTTON (U"2/3 < slope < 3/2")
+	INTEGER (numberOfBestMatches, U"Number of best matches (0 = all)", U"10")
+	OK
+DO
+	CONVERT_LIST (Matrix)
+		Melder_require (list.size > 1,
+			U"Select a query and at least one reference.");
+		Matrix query = list.subtractItem_ref (1);
+		autoTable result = Matrices_searchDTW (query, & list, sakoeChibaBand, slopeConstraint, distanceMetric, numberOfBestMatches);
+	CONVERT_LIST_END (query -> name.get(), U"_search")
+}
+
 FORM (NEW_Matrix_to_PatternList, U"Matrix: To PatternList", nullptr) {
 	NATURAL (join, U"Join", U"1")
 	OK
@@ -5851,7 +5954,25 @@ FORM (NEW_Sound_reduceNoise, U"Sound: Reduce noise", U"Sound: Reduce noise...")
 	OK
 DO
 	CONVERT_EACH (Sound)
-		autoSound result = Sound_reduceNoise (me, fromTime, toTime, windowLength, fromFrequency, toFrequency, smoothingBandwidth, noiseReduction_dB, noiseReductionMethod);
+		autoSound result = Sound_reduceNoise (me, fromTime, toTime, windowLength, fromFrequency, toFrequency, smoothingBandwidth, noiseReduction_dB, noiseReductionMethod, 0.0);
+	CONVERT_EACH_END (my name.get(), U"_denoised")
+}
+
+FORM (NEW_Sound_reduceNoise_adaptive, U"Sound: Reduce noise (adaptive)", U"Sound: Reduce noise...") {
+	REAL (fromTime, U"left Noise time range (s)", U"0.0")
+	REAL (toTime, U"right Noise time range (s)", U"0.0")
+	POSITIVE (windowLength, U"Window length (s)", U"0.025")
+	LABEL (U"Filter")
+	REAL (fromFrequency, U"left Filter frequency range (Hz)", U"80.0")
+	REAL (toFrequency, U"right Filter frequency range (Hz)", U"10000.0")
+	POSITIVE (smoothingBandwidth, U"Smoothing bandwidth, (Hz)", U"40.0")
+	REAL (noiseReduction_dB, U"Noise reduction (dB)", U"-20.0")
+	OPTIONMENU_ENUM (kSoundNoiseReductionMethod, noiseReductionMethod, U"Noise reduction method", kSoundNoiseReductionMethod::DEFAULT)
+	REAL (noiseAdaptationTime, U"Noise adaptation time (s)", U"1.0 (0 = fixed noise)")
+	OK
+DO
+	CONVERT_EACH (Sound)
+		autoSound result = Sound_reduceNoise (me, fromTime, toTime, windowLength, fromFrequency, toFrequency, smoothingBandwidth, noiseReduction_dB, noiseReductionMethod, noiseAdaptationTime);
 	CONVERT_EACH_END (my name.get(), U"_denoised")
 }
 
@@ -6157,6 +6278,20 @@ DO
 	CONVERT_EACH_END (my name.get())
 }
 
+FORM (NEWMANY_SpeechSynthesizer_to_Sound_streaming, U"SpeechSynthesizer: To Sound (streaming)", nullptr) {
+	TEXTFIELD (text, U"Text:", U"This is some text.")
+	POSITIVE (blockDuration, U"Block duration (s)", U"0.05")
+	BOOLEAN (wantTextGrid, U"Create TextGrid with annotations", false);
+	OK
+DO
+	CONVERT_EACH (SpeechSynthesizer)
+		autoTextGrid tg;
+		autoSound result = SpeechSynthesizer_to_Sound_streaming (me, text, blockDuration, (wantTextGrid ? & tg : nullptr));
+		if (wantTextGrid)
+			praat_new (tg.move(), my name.get());
+	CONVERT_EACH_END (my name.get())
+}
+
 DIRECT (INFO_SpeechSynthesizer_getLanguageName) {
 	STRING_ONE (SpeechSynthesizer)
 		conststring32 result = my d_languageName.get();
@@ -8436,6 +8571,10 @@ void praat_uvafon_David_init () {
 	praat_addAction1 (classLongSound, 2, U"Write to stereo NeXt/Sun file...", U"Write to stereo WAV file...", praat_HIDDEN + praat_DEPTH_1, SAVE_LongSounds_saveAsStereoNeXtSunFile);
 	praat_addAction1 (classLongSound, 2, U"Save as stereo NIST file...", U"Save as stereo NeXt/Sun file...", 1, SAVE_LongSounds_saveAsStereoNISTFile);
 	praat_addAction1 (classLongSound, 2, U"Write to stereo NIST file...", U"Write to stereo NeXt/Sun file...", praat_HIDDEN + praat_DEPTH_1, SAVE_LongSounds_saveAsStereoNISTFile);
+	praat_addAction1 (classLongSound, 0, U"To MelSpectrogram...", nullptr, 0, NEW_LongSound_to_MelSpectrogram);
+	praat_addAction1 (classLongSound, 0, U"To MFCC...", nullptr, 0, NEW_LongSound_to_MFCC);
+	praat_addAction1 (classLongSound, 0, U"To TextGrid (silences)...", nullptr, 0, NEW_LongSound_to_TextGrid_detectSilences);
+	praat_addAction1 (classLongSound, 1, U"Save MFCC as binary file...", nullptr, 0, SAVE_LongSound_saveMFCCAsBinaryFile);
 
 	praat_addAction1 (classLtas, 0, U"Report spectral trend...", U"Get slope...", 1, INFO_Ltas_reportSpectralTrend);
 	praat_addAction1 (classLtas, 0, U"Report spectral tilt...", U"Get slope...", praat_DEPTH_1 + praat_HIDDEN, INFO_Ltas_reportSpectralTrend);
@@ -8466,6 +8605,8 @@ void praat_uvafon_David_init () {
 	praat_addAction1 (classMatrix, 0, U"To NMF (IS)...", U"To SVD", praat_HIDDEN, NEW_Matrix_to_NMF_is);
 	praat_addAction1 (classMatrix, 0, U"Eigen (complex)", U"Eigen", praat_HIDDEN, NEWTIMES2_Matrix_eigen_complex);
 	praat_addAction1 (classMatrix, 2, U"To DTW...", U"To ParamCurve", 1, NEW1_Matrices_to_DTW);
+	praat_addAction1 (classMatrix, 2, U"Get DTW distance...", U"To DTW...", 1, REAL_Matrices_getDTWDistance);
+	praat_addAction1 (classMatrix, 0, U"Search DTW...", U"Get DTW distance...", 1, NEW1_Matrices_searchDTW);
 
 	praat_addAction2 (classMatrix, 1, classCategories, 1, U"To TableOfReal", nullptr, 0, NEW1_Matrix_Categories_to_TableOfReal);
 
@@ -8688,7 +8829,8 @@ void praat_uvafon_David_init () {
 
 	praat_addAction1 (classSound, 1, U"Filter (gammatone)...", U"Filter (de-emphasis)...", 1, NEW_Sound_filterByGammaToneFilter4);
 	praat_addAction1 (classSound, 0, U"Remove noise...", U"Filter (formula)...", praat_DEPTH_1 | praat_HIDDEN, NEW_Sound_removeNoise);
-	praat_addAction1 (classSound, 0, U"Reduce noise...", U"Filter (formula)...", praat_DEPTH_1, NEW_Sound_reduceNoise);
+	praat_addAction1 (classSound, 0, U"Reduce noise...", U"Filter (formula)...", praat_DEPTH_1 | praat_HIDDEN, NEW_Sound_reduceNoise);
+	praat_addAction1 (classSound, 0, U"Reduce noise (adaptive)...", U"Filter (formula)...", praat_DEPTH_1, NEW_Sound_reduceNoise_adaptive);
 
 	praat_addAction1 (classSound, 0, U"Change gender...", U"Deepen band modulation...", 1, NEW_Sound_changeGender);
 
@@ -8720,6 +8862,7 @@ void praat_uvafon_David_init () {
 	praat_addAction1 (classSpeechSynthesizer, 0, U"SpeechSynthesizer help", nullptr, 0, HELP_SpeechSynthesizer_help);
 	praat_addAction1 (classSpeechSynthesizer, 0, U"Play text...", nullptr, 0, PLAY_SpeechSynthesizer_playText);
 	praat_addAction1 (classSpeechSynthesizer, 0, U"To Sound...", nullptr, 0, NEWMANY_SpeechSynthesizer_to_Sound);
+	praat_addAction1 (classSpeechSynthesizer, 0, U"To Sound (streaming)...", nullptr, praat_HIDDEN, NEWMANY_SpeechSynthesizer_to_Sound_streaming);
 	praat_addAction1 (classSpeechSynthesizer, 0, QUERY_BUTTON, nullptr, 0, 0);
 		praat_addAction1 (classSpeechSynthesizer, 1, U"Get language name", nullptr, 1, INFO_SpeechSynthesizer_getLanguageName);
 		praat_addAction1 (classSpeechSynthesizer, 1, U"Get voice name", nullptr, 1, INFO_SpeechSynthesizer_getVoiceName);
@@ -609,6 +609,18 @@ DO
 	MODIFY_FIRST_OF_TWO_END
 }
 
+FORM (MODIFY_GaussianMixture_TableOfReal_improveLikelihood_miniBatch, U"GaussianMixture & TableOfReal: Improve likelihood (mini-batch)", U"GaussianMixture & TableOfReal: Improve likelihood (mini-batch)...") {
+	NATURAL (batchSize, U"Batch size", U"1000")
+	NATURAL (numberOfEpochs, U"Number of epochs", U"10")
+	REAL (lambda, U"Stability coefficient lambda", U"0.001")
+	OK
+DO
+	Melder_require (lambda >= 0.0 && lambda < 1.0, U"Lambda should be in the interval [0, 1).");
+	MODIFY_FIRST_OF_TWO (GaussianMixture, TableOfReal)
+		GaussianMixture_TableOfReal_improveLikelihood_miniBatch (me, you, batchSize, numberOfEpochs, lambda);
+	MODIFY_FIRST_OF_TWO_END
+}
+
 FORM (NEW1_GaussianMixture_TableOfReal_to_GaussianMixture_CEMM, U"GaussianMixture & TableOfReal: To GaussianMixture (CEMM)", U"GaussianMixture & TableOfReal: To GaussianMixture (CEMM)...") {
 	INTEGER (minimumNumberOfComponents, U"Minimum number of components", U"1")
 	POSITIVE (tolerance, U"Tolerance of minimizer", U"0.001")
@@ -688,6 +700,7 @@ void praat_HMM_init () {
 
 	praat_addAction2 (classGaussianMixture, 1, classTableOfReal, 1, U"Get likelihood value...", nullptr, 0, REAL_GaussianMixture_TableOfReal_getLikelihoodValue);
 	praat_addAction2 (classGaussianMixture, 1, classTableOfReal, 1, U"Improve likelihood...", nullptr, 0, MODIFY_GaussianMixture_TableOfReal_improveLikelihood);
+	praat_addAction2 (classGaussianMixture, 1, classTableOfReal, 1, U"Improve likelihood (mini-batch)...", nullptr, 0, MODIFY_GaussianMixture_TableOfReal_improveLikelihood_miniBatch);
 	praat_addAction2 (classGaussianMixture, 1, classTableOfReal, 1, U"To GaussianMixture (CEMM)...", nullptr, 0, NEW1_GaussianMixture_TableOfReal_to_GaussianMixture_CEMM);
 	praat_addAction2 (classGaussianMixture, 1, classTableOfReal, 1, U"To TableOfReal (probabilities)", nullptr, 0, NEW1_GaussianMixture_TableOfReal_to_TableOfReal_probabilities);
 	praat_addAction2 (classGaussianMixture, 1, classTableOfReal, 1, U"To TableOfReal (responsibilities)", nullptr, 0, NEW1_GaussianMixture_TableOfReal_to_TableOfReal_responsibilities);
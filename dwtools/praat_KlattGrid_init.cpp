@@ -790,6 +790,29 @@ DIRECT (NEW_KlattGrid_to_Sound) {
 	CONVERT_EACH_END (my name.get())
 }
 
+FORM (NEW_KlattGrid_to_Sound_blockwise, U"KlattGrid: To Sound (blockwise)", nullptr) {
+	POSITIVE (samplingFrequency, U"Sampling frequency (Hz)", U"44100.0")
+	BOOLEAN (scalePeak, U"Scale peak", true)
+	KlattGrid_PhonationGridPlayOptions_addCommonFields (useVoicing, useFlutter, useDoublePulsing, useCollisionPhase, useSpectralTilt, flowFunctionType, useFlowDerivative, useAspiration, useBreathiness)
+	KlattGrid_formantSelection_vocalTract_commonFields (filtersStructure, fromOralFormant, toOralFormant, fromNasalFormant, toNasalFormant, fromNasalAntiFormant, toNasalAntiFormant)
+	KlattGrid_formantSelection_coupling_commonFields (fromTrachealFormant, toTrachealFormant, fromTrachealAntiFormant, toTrachealAntiFormant, fromDeltaFormant, toDeltaFormant, fromDeltaBandwidth, toDeltaBandwidth)
+	KlattGrid_formantSelection_frication_commonFields(fromFricationFormant,toFricationFormant,useFricationBypass)
+	NATURAL (blockSize, U"Block size (samples)", U"256")
+	OK
+DO
+	CONVERT_EACH (KlattGrid)
+		KlattGrid_setDefaultPlayOptions (me);
+		KlattGridPlayOptions pk = my options.get();
+		pk -> samplingFrequency = samplingFrequency;
+		pk -> scalePeak = scalePeak;
+		KlattGrid_PhonationGridPlayOptions (me, useVoicing, useFlutter, useDoublePulsing, useCollisionPhase, useSpectralTilt, flowFunctionType, useFlowDerivative, useAspiration, useBreathiness);
+		KlattGrid_formantSelection_vocalTract (me, filtersStructure, fromOralFormant, toOralFormant, fromNasalFormant, toNasalFormant, fromNasalAntiFormant, toNasalAntiFormant);
+		KlattGrid_formantSelection_coupling (me, fromTrachealFormant, toTrachealFormant, fromTrachealAntiFormant, toTrachealAntiFormant, fromDeltaFormant, toDeltaFormant, fromDeltaBandwidth, toDeltaBandwidth);
+		KlattGrid_formantSelection_frication (me, fromFricationFormant, toFricationFormant, useFricationBypass);
+		autoSound result = KlattGrid_to_Sound_blockwise (me, blockSize);
+	CONVERT_EACH_END (my name.get())
+}
+
 FORM (PLAY_KlattGrid_playSpecial, U"KlattGrid: Play special", U"KlattGrid: Play special...") {
 	REAL (fromTime, U"left Time range (s)", U"0")
 	REAL (toTime, U"right Time range (s)", U"0")
@@ -964,6 +987,7 @@ void praat_KlattGrid_init () {
 	praat_addAction1 (classKlattGrid, 0, U"Play special...", nullptr, 0, PLAY_KlattGrid_playSpecial);
 	praat_addAction1 (classKlattGrid, 0, U"To Sound", nullptr, 0, NEW_KlattGrid_to_Sound);
 	praat_addAction1 (classKlattGrid, 0, U"To Sound (special)...", nullptr, 0, NEW_KlattGrid_to_Sound_special);
+	praat_addAction1 (classKlattGrid, 0, U"To Sound (blockwise)...", nullptr, praat_HIDDEN, NEW_KlattGrid_to_Sound_blockwise);
 	praat_addAction1 (classKlattGrid, 0, U"To Sound (phonation)...", nullptr, 0, NEW_KlattGrid_to_Sound_phonation);
 
 	praat_addAction1 (classKlattGrid, 0, U"Draw -", nullptr, 0, nullptr);
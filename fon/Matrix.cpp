@@ -659,9 +659,14 @@ void Matrix_writeToHeaderlessSpreadsheetFile (Matrix me, MelderFile file) {
 void Matrix_formula (Matrix me, conststring32 expression, Interpreter interpreter, Matrix target) {
 	try {
 		Formula_compile (interpreter, me, expression, kFormula_EXPRESSION_TYPE_NUMERIC, true);
-		Formula_Result result;
 		if (! target)
 			target = me;
+		if (Formula_isVectorizable ()) {
+			for (integer irow = 1; irow <= my ny; irow ++)
+				Formula_runVectorized (irow, 1, my nx, my z.row (irow), target -> z.row (irow));
+			return;
+		}
+		Formula_Result result;
 		for (integer irow = 1; irow <= my ny; irow ++) {
 			for (integer icol = 1; icol <= my nx; icol ++) {
 				Formula_run (irow, icol, & result);
@@ -686,9 +691,14 @@ void Matrix_formula_part (Matrix me, double xmin, double xmax, double ymin, doub
 		(void) Matrix_getWindowSamplesX (me, xmin, xmax, & ixmin, & ixmax);
 		(void) Matrix_getWindowSamplesY (me, ymin, ymax, & iymin, & iymax);
 		Formula_compile (interpreter, me, expression, kFormula_EXPRESSION_TYPE_NUMERIC, true);
-		Formula_Result result;
 		if (! target)
 			target = me;
+		if (Formula_isVectorizable ()) {
+			for (integer irow = iymin; irow <= iymax; irow ++)
+				Formula_runVectorized (irow, ixmin, ixmax, my z.row (irow), target -> z.row (irow));
+			return;
+		}
+		Formula_Result result;
 		for (integer irow = iymin; irow <= iymax; irow ++) {
 			for (integer icol = ixmin; icol <= ixmax; icol ++) {
 				Formula_run (irow, icol, & result);
@@ -31,6 +31,167 @@
 #include "Sound_to_Cochleagram.h"
 #include "Sound_and_Spectrum.h"
 #include "Spectrum_to_Excitation.h"
+#include "MelderThread.h"
+#include "NUM2.h"
+
+/*
+	The original frame-by-frame version, which creates a Spectrum and an Excitation for every frame.
+	Kept as a reference for the batched version below (Melder_debug 57).
+*/
+static void Sound_into_Cochleagram_frameByFrame (Sound me, Cochleagram thee, integer nsamp_window, integer halfnsamp_window, double dampingFactor) {
+	const integer nFrames = thy nx, nf = thy ny;
+	const double df = thy dy;
+	autoSound window = Sound_createSimple (1, nsamp_window * my dx, 1.0 / my dx);
+	for (integer iframe = 1; iframe <= nFrames; iframe ++) {
+		double t = Sampled_indexToX (thee, iframe);
+		integer leftSample = Sampled_xToLowIndex (me, t);
+		integer rightSample = leftSample + 1;
+		integer startSample = rightSample - halfnsamp_window;
+		integer endSample = rightSample + halfnsamp_window;
+		if (startSample < 1) {
+			Melder_casual (U"Start sample too small: ", startSample,
+				U" instead of 1.");
+			startSample = 1;
+		}
+		if (endSample > my nx) {
+			Melder_casual (U"End sample too small: ", endSample,
+				U" instead of ", my nx,
+				U".");
+			endSample = my nx;
+		}
+
+		/* Copy a window to a frame. */
+		for (integer i = 1; i <= nsamp_window; i ++)
+			window -> z [1] [i] =
+				( my ny == 1 ? my z[1][i+startSample-1] : 0.5 * (my z[1][i+startSample-1] + my z[2][i+startSample-1]) ) *
+				(0.5 - 0.5 * cos (2.0 * NUMpi * i / (nsamp_window + 1)));
+		autoSpectrum spec = Sound_to_Spectrum (window.get(), true);
+		autoExcitation excitation = Spectrum_to_Excitation (spec.get(), df);
+		for (integer ifreq = 1; ifreq <= nf; ifreq ++)
+			thy z [ifreq] [iframe] = excitation -> z [1] [ifreq] + ( iframe > 1 ? dampingFactor * thy z [ifreq] [iframe - 1] : 0 );
+	}
+}
+
+/*
+	The batched version: the same computation as Sound_to_Spectrum () followed by Spectrum_to_Excitation (),
+	but with the window, the spectral bands of the Bark filters and the masking filter computed once,
+	one FFT table per thread, and the frames divided among threads.
+	The excitations go straight into the cochleagram; forward masking is a second pass.
+*/
+static void Sound_into_Cochleagram_batched (Sound me, Cochleagram thee, integer nsamp_window, integer halfnsamp_window, double dampingFactor) {
+	const integer nFrames = thy nx, nf = thy ny;
+	const double df = thy dy;
+	/*
+		The first sample of each frame. Rounding problems are reported here, before the threads start.
+	*/
+	autoINTVEC startSamples = newINTVECraw (nFrames);
+	for (integer iframe = 1; iframe <= nFrames; iframe ++) {
+		const double t = Sampled_indexToX (thee, iframe);
+		const integer rightSample = Sampled_xToLowIndex (me, t) + 1;
+		integer startSample = rightSample - halfnsamp_window;
+		const integer endSample = rightSample + halfnsamp_window;
+		if (startSample < 1) {
+			Melder_casual (U"Start sample too small: ", startSample,
+				U" instead of 1.");
+			startSample = 1;
+		}
+		if (endSample > my nx)
+			Melder_casual (U"End sample too small: ", endSample,
+				U" instead of ", my nx,
+				U".");
+		startSamples [iframe] = startSample;
+	}
+	/*
+		The Hann window, and the spectrum as Sound_to_Spectrum (fast) would compute it.
+	*/
+	autoVEC window = newVECraw (nsamp_window);
+	for (integer i = 1; i <= nsamp_window; i ++)
+		window [i] = 0.5 - 0.5 * cos (2.0 * NUMpi * i / (nsamp_window + 1));
+	integer fftLength = 2;
+	while (fftLength < nsamp_window)
+		fftLength *= 2;
+	const integer numberOfFrequencies = fftLength / 2 + 1;
+	const double samplingPeriod = 1.0 / (1.0 / my dx);   // as in the Sound that Sound_createSimple () would create
+	const double binWidth = 1.0 / (samplingPeriod * fftLength);
+	/*
+		For each filter, the band of FFT bins whose power it sums, and the anti-undersampling correction,
+		exactly as in Spectrum_to_Excitation ().
+	*/
+	autoINTVEC lowBin = newINTVECraw (nf), highBin = newINTVECraw (nf);
+	autoVEC bandCorrection = newVECraw (nf);
+	for (integer ifreq = 1; ifreq <= nf; ifreq ++) {
+		const double lowFrequency = Excitation_barkToHertz (df * (ifreq - 1));
+		const double highFrequency = Excitation_barkToHertz (df * ifreq);
+		lowBin [ifreq] = std::max (1_integer, Melder_iround (lowFrequency / binWidth + 1.0));
+		highBin [ifreq] = std::min (Melder_iround (highFrequency / binWidth + 1.0) - 1, numberOfFrequencies);
+		bandCorrection [ifreq] = ( highBin [ifreq] >= lowBin [ifreq] ?
+				2.0 * (highFrequency - lowFrequency) / (highBin [ifreq] - lowBin [ifreq] + 1) * binWidth : 1.0 );
+	}
+	/*
+		The masking filter, and the centre of each filter in Bark.
+	*/
+	autoVEC auditoryFilter = newVECraw (nf);
+	for (integer i = 1; i <= nf; i ++) {
+		const double bark = df * (i - nf/2) + 0.474;
+		auditoryFilter [i] = pow (10, (1.581 + 0.75 * bark - 1.75 * sqrt (1 + bark * bark)));
+	}
+	autoVEC bark = newVECraw (nf);
+	for (integer ifreq = 1; ifreq <= nf; ifreq ++)
+		bark [ifreq] = thy y1 + (ifreq - 1) * df;
+	/*
+		Per-thread work space: an FFT table (whose first third is scratch for the FFT), a frame, and the band powers.
+	*/
+	constexpr integer maximumNumberOfThreads = 16;
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (nFrames, 20, maximumNumberOfThreads);
+	autoNUMfft_Table fftTables [1 + maximumNumberOfThreads];
+	for (integer ithread = 1; ithread <= numberOfThreads; ithread ++)
+		NUMfft_Table_init (& fftTables [ithread], fftLength);
+	autoMAT frames = newMATraw (numberOfThreads, fftLength);
+	autoMAT bandPowers = newMATraw (numberOfThreads, nf);
+
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		integer firstFrame, lastFrame;
+		MelderThread_getRange (nFrames, numberOfThreads, ithread, & firstFrame, & lastFrame);
+		VEC frame = frames.row (ithread), bandPower = bandPowers.row (ithread);
+		for (integer iframe = firstFrame; iframe <= lastFrame; iframe ++) {
+			const integer offset = startSamples [iframe] - 1;
+			for (integer i = 1; i <= nsamp_window; i ++)
+				frame [i] = ( my ny == 1 ? my z [1] [i + offset] : 0.5 * (my z [1] [i + offset] + my z [2] [i + offset]) ) * window [i];
+			frame.part (nsamp_window + 1, fftLength) <<= 0.0;
+			NUMfft_forward (& fftTables [ithread], frame);
+			for (integer ifreq = 1; ifreq <= nf; ifreq ++) {
+				double power = 0.0;   // Pa2 s2
+				for (integer ibin = lowBin [ifreq]; ibin <= highBin [ifreq]; ibin ++) {
+					const double re = ( ibin == 1 ? frame [1] : ibin == numberOfFrequencies ? frame [fftLength] : frame [ibin + ibin - 2] ) * samplingPeriod;
+					const double im = ( ibin == 1 || ibin == numberOfFrequencies ? 0.0 : frame [ibin + ibin - 1] * samplingPeriod );
+					power += re * re + im * im;
+				}
+				if (highBin [ifreq] >= lowBin [ifreq])
+					power *= bandCorrection [ifreq];   // Pa2: power density in this band
+				bandPower [ifreq] = power;
+			}
+			/*
+				Convolution with the masking filter, of which Spectrum_to_Excitation () keeps the centre part.
+			*/
+			for (integer ifreq = 1; ifreq <= nf; ifreq ++) {
+				const integer k = ifreq + nf/2;
+				double pressureSquared = 0.0;
+				for (integer i = std::max (1_integer, k - nf); i <= std::min (nf, k - 1); i ++)
+					pressureSquared += bandPower [i] * auditoryFilter [k - i];
+				thy z [ifreq] [iframe] = Excitation_soundPressureToPhon (sqrt (pressureSquared), bark [ifreq]);
+			}
+		}
+	});
+	/*
+		Forward masking.
+	*/
+	if (dampingFactor != 0.0)
+		for (integer ifreq = 1; ifreq <= nf; ifreq ++) {
+			double *excitation = & thy z [ifreq] [0];
+			for (integer iframe = 2; iframe <= nFrames; iframe ++)
+				excitation [iframe] = excitation [iframe] + dampingFactor * excitation [iframe - 1];
+		}
+}
 
 autoCochleagram Sound_to_Cochleagram (Sound me, double dt, double df, double dt_window, double forwardMaskingTime) {
 	try {
@@ -45,35 +206,10 @@ autoCochleagram Sound_to_Cochleagram (Sound me, double dt, double df, double dt_
 		if (nFrames < 2) return autoCochleagram ();
 		double t1 = my x1 + 0.5 * (duration - my dx - (nFrames - 1) * dt);   // centre of first frame
 		autoCochleagram thee = Cochleagram_create (my xmin, my xmax, nFrames, dt, t1, df, nf);
-		autoSound window = Sound_createSimple (1, nsamp_window * my dx, 1.0 / my dx);
-		for (integer iframe = 1; iframe <= nFrames; iframe ++) {
-			double t = Sampled_indexToX (thee.get(), iframe);
-			integer leftSample = Sampled_xToLowIndex (me, t);
-			integer rightSample = leftSample + 1;
-			integer startSample = rightSample - halfnsamp_window;
-			integer endSample = rightSample + halfnsamp_window;
-			if (startSample < 1) {
-				Melder_casual (U"Start sample too small: ", startSample,
-					U" instead of 1.");
-				startSample = 1;
-			}
-			if (endSample > my nx) {
-				Melder_casual (U"End sample too small: ", endSample,
-					U" instead of ", my nx,
-					U".");
-				endSample = my nx;
-			}
-
-			/* Copy a window to a frame. */
-			for (integer i = 1; i <= nsamp_window; i ++)
-				window -> z [1] [i] =
-					( my ny == 1 ? my z[1][i+startSample-1] : 0.5 * (my z[1][i+startSample-1] + my z[2][i+startSample-1]) ) *
-					(0.5 - 0.5 * cos (2.0 * NUMpi * i / (nsamp_window + 1)));
-			autoSpectrum spec = Sound_to_Spectrum (window.get(), true);
-			autoExcitation excitation = Spectrum_to_Excitation (spec.get(), df);
-			for (integer ifreq = 1; ifreq <= nf; ifreq ++)
-				thy z [ifreq] [iframe] = excitation -> z [1] [ifreq] + ( iframe > 1 ? dampingFactor * thy z [ifreq] [iframe - 1] : 0 );
-		}
+		if (Melder_debug == 57)
+			Sound_into_Cochleagram_frameByFrame (me, thee.get(), nsamp_window, halfnsamp_window, dampingFactor);
+		else
+			Sound_into_Cochleagram_batched (me, thee.get(), nsamp_window, halfnsamp_window, dampingFactor);
 		for (integer iframe = 1; iframe <= nFrames; iframe ++)
 			for (integer ifreq = 1; ifreq <= nf; ifreq ++)
 				thy z [ifreq] [iframe] *= integrationCorrection;
@@ -104,6 +240,162 @@ static autoSound createGammatone (double midFrequency_Hertz, double samplingFreq
 	return gammatone;
 }
 
+void structGammatoneFilter_edb :: init (double midFrequency_Hertz, double samplingFrequency) {
+	/* EdB's alfa1: */
+	const double latency = 1.95e-3 * pow (midFrequency_Hertz / 1000, -0.725) + 0.6e-3;
+	/* EdB's beta: */
+	const double decayTime = 1e-3 * pow (midFrequency_Hertz / 1000, -0.663);
+	/* EdB's omega: */
+	const double midFrequency_radPerSecond = 2 * NUMpi * midFrequency_Hertz;
+	const double dt = 1.0 / samplingFrequency;
+	/*
+		createGammatone () samples the gammatone at the times (itime - 0.5) * dt,
+		the first nonzero value being at the first such time after the latency.
+	*/
+	integer firstSample = 1;
+	while ((firstSample - 0.5) / samplingFrequency <= latency)
+		firstSample += 1;
+	our numberOfLatencySamples = firstSample - 1;
+	const double firstTimeAfterLatency = (firstSample - 0.5) / samplingFrequency - latency;
+	/*
+		From there on, sample k (k = 0, 1, 2...) of the gammatone is
+			((k + kappa) dt / beta)^3 exp (- (k + kappa) dt / beta) cos (omega (k + kappa) dt)
+			= Re [gain (k + kappa)^3 pole^k],
+		with kappa = firstTimeAfterLatency / dt. Because (k + kappa)^3 is a third-degree polynomial in k,
+		the z-transform of this is a fourth-order pole at `pole`, with a third-degree numerator, whose coefficients
+		are the fourth-order differences of (k + kappa)^3.
+	*/
+	our pole = std::exp (dcomplex (- dt / decayTime, midFrequency_radPerSecond * dt));
+	const dcomplex gain = pow (dt / decayTime, 3.0) *
+			std::exp (dcomplex (- firstTimeAfterLatency / decayTime, midFrequency_radPerSecond * firstTimeAfterLatency));
+	const double kappa = firstTimeAfterLatency / dt;
+	const double binomial [5] = { 1.0, -4.0, 6.0, -4.0, 1.0 };
+	dcomplex polePower = 1.0;
+	for (integer j = 0; j <= 3; j ++) {
+		double difference = 0.0;
+		for (integer i = 0; i <= j; i ++) {
+			const double k = j - i + kappa;
+			difference += binomial [i] * k * k * k;
+		}
+		our numerator [j] = gain * difference * polePower;
+		polePower *= our pole;
+	}
+	our reset ();
+}
+
+void structGammatoneFilter_edb :: reset () {
+	for (integer i = 0; i < 4; i ++)
+		our state [i] = 0.0;
+	for (integer i = 0; i < 3; i ++)
+		our previousInput [i] = 0.0;
+}
+
+void structGammatoneFilter_edb :: filterBlock (constVECVU const& input, VECVU const& output) {
+	Melder_assert (output.size == input.size);
+	const dcomplex p = our pole;
+	dcomplex s0 = our state [0], s1 = our state [1], s2 = our state [2], s3 = our state [3];
+	double x1 = our previousInput [0], x2 = our previousInput [1], x3 = our previousInput [2];
+	for (integer i = 1; i <= input.size; i ++) {
+		const double x0 = input [i];   // read before writing, so that input and output can be the same
+		s0 = our numerator [0] * x0 + our numerator [1] * x1 + our numerator [2] * x2 + our numerator [3] * x3 + p * s0;
+		s1 = s0 + p * s1;
+		s2 = s1 + p * s2;
+		s3 = s2 + p * s3;
+		output [i] = s3.real();
+		x3 = x2;
+		x2 = x1;
+		x1 = x0;
+	}
+	our state [0] = s0, our state [1] = s1, our state [2] = s2, our state [3] = s3;
+	our previousInput [0] = x1, our previousInput [1] = x2, our previousInput [2] = x3;
+}
+
+/*
+	Stage 4: detection = rectify + integrate + low-pass 500 Hz.
+	From basilar membrane response to firing rate.
+*/
+static void synapse_inplace (VEC const& basil, double dt, double replenishmentRate,
+	double lossRate, double returnRate, double reprocessingRate)
+{
+	double M = 1.0;   // maximum free transmitter
+	double A = 5.0, B = 300.0, g = 2000.0;   // determine permeability
+	double y = replenishmentRate;            // Meddis: 5.05
+	double l = lossRate, r = returnRate;     // Meddis: 2500, 6580
+	double x = reprocessingRate;             // Meddis: 66.31
+	double h = 50000;   // convert cleft contents to firing rate
+	double gdt = 1.0 - exp (- g * dt);
+	double ydt = 1.0 - exp (- y * dt);
+	double ldt = (1.0 - exp (- (l + r) * dt)) * l / (l + r);
+	double rdt = (1.0 - exp (- (l + r) * dt)) * r / (l + r);
+	double xdt = 1.0 - exp (- x * dt);
+	double kt = g * A / (A + B);   // membrane permeability
+	double c = M * y * kt / (l * kt + y * (l + r));   // cleft contents
+	double q = c * (l + r) / kt;   // free transmitter
+	double w = c * r / x;   // reprocessing store
+	for (integer itime = 1; itime <= basil.size; itime ++) {
+		double splusA = basil [itime] * 10.0 + A;
+		double replenish = ( M > q ? ydt * (M - q) : 0.0 );
+		kt = ( splusA > 0.0 ? gdt * splusA / (splusA + B) : 0.0 );
+		double eject = kt * q;
+		double loss = ldt * c;
+		double reuptake = rdt * c;
+		double reprocess = xdt * w;
+		q = q + replenish - eject + reprocess;
+		c = c + eject - loss - reuptake;
+		w = w + reuptake - reprocess;
+		basil [itime] = h * c;
+	}
+}
+
+/*
+	From the firing rate, sampled at `dt` from `x1` on, to one row of the cochleagram, sampled at `dtime`.
+*/
+static void firingRateToResponse (constVEC const& basil, double x1, double dt, double dtime, VEC const& response) {
+	if (dtime == dt) {
+		for (integer itime = 1; itime <= response.size; itime ++)
+			response [itime] = basil [itime];
+		return;
+	}
+	double d = dtime / dt / 2.0;
+	double factor = -6 / d / d;
+	double area = d * sqrt (NUMpi / 6);
+	double expmin6 = exp (-6), onebyoneminexpmin6 = 1 / (1 - expmin6);
+	const integer dint = Melder_ifloor (d);
+	constexpr integer maximumWindowHalfLength = 1000;
+	double weights [1 + 2 * maximumWindowHalfLength];   // the Gaussian window, from -dint to +dint
+	const integer windowHalfLength = std::min (dint, maximumWindowHalfLength);
+	for (integer i = - windowHalfLength; i <= windowHalfLength; i ++)
+		weights [maximumWindowHalfLength + i] = onebyoneminexpmin6 * (exp (factor * i * i) - expmin6);
+	for (integer itime = 1; itime <= response.size; itime ++) {
+		double t1 = (itime - 1) * dtime;
+		double t2 = t1 + dtime;
+		double mean = 0.0;
+		/*
+			As Matrix_getWindowSamplesX ().
+		*/
+		const integer i1 = std::max (1_integer, 1 + Melder_iceiling ((t1 - x1) / dt));
+		const integer i2 = std::min (basil.size, 1 + Melder_ifloor ((t2 - x1) / dt));
+		const integer n = i2 - i1 + 1;
+		Melder_assert (n >= 1);
+		if (n <= 2) {
+			for (integer isamp = i1; isamp <= i2; isamp ++)
+				mean += basil [isamp];
+			mean /= n;
+		} else {
+			integer muint = Melder_ifloor ((i1 + i2) / 2.0);
+			for (integer isamp = muint - dint; isamp <= muint + dint; isamp ++) {
+				if (isamp < 1 || isamp > basil.size)
+					continue;
+				const integer offset = isamp - muint;
+				mean += basil [isamp] * ( offset >= - maximumWindowHalfLength && offset <= maximumWindowHalfLength ?
+						weights [maximumWindowHalfLength + offset] : onebyoneminexpmin6 * (exp (factor * offset * offset) - expmin6) );
+			}
+			mean /= area;
+		}
+		response [itime] = mean;
+	}
+}
+
 autoCochleagram Sound_to_Cochleagram_edb
 	(Sound me, double dtime, double dfreq, int hasSynapse, double replenishmentRate,
 	 double lossRate, double returnRate, double reprocessingRate)
@@ -120,88 +412,62 @@ autoCochleagram Sound_to_Cochleagram_edb
 		/* Stages 1 and 2: outer- and middle-ear filtering. */
 		/* From acoustic sound to oval window. */
 
-		for (integer ifreq = 1; ifreq <= nfreq; ifreq ++) {
-			double *response = & thy z [ifreq] [0];
-
-			/* Stage 3: basilar membrane filtering by gammatones. */
-			/* From oval window to basilar membrane response. */
+		/*
+			Stage 3: basilar membrane filtering by gammatones.
+			From oval window to basilar membrane response.
 
+			The basilar membrane response has the time domain of the convolution of the sound
+			with the gammatone of createGammatone (), which is 50 periods long.
+		*/
+		const double samplingFrequency = 1.0 / my dx;
+		const double basilX1 = my x1 + 0.5 / samplingFrequency;
+		autoINTVEC basilLength = newINTVECraw (nfreq);
+		autovector <structGammatoneFilter_edb> gammatones = newvectorzero <structGammatoneFilter_edb> (nfreq);
+		for (integer ifreq = 1; ifreq <= nfreq; ifreq ++) {
 			double midFrequency_Bark = (ifreq - 0.5) * dfreq;
 			double midFrequency_Hertz = Excitation_barkToHertz (midFrequency_Bark);
-			autoSound gammatone = createGammatone (midFrequency_Hertz, 1.0 / my dx);
-			autoSound basil = Sounds_convolve (me, gammatone.get(), kSounds_convolve_scaling::SUM, kSounds_convolve_signalOutsideTimeDomain::ZERO);
-
-			/* Stage 4: detection = rectify + integrate + low-pass 500 Hz. */
-			/* From basilar membrane response to firing rate. */
-
-			if (hasSynapse) {
-				double dt = my dx;
-				double M = 1.0;   // maximum free transmitter
-				double A = 5.0, B = 300.0, g = 2000.0;   // determine permeability
-				double y = replenishmentRate;            // Meddis: 5.05
-				double l = lossRate, r = returnRate;     // Meddis: 2500, 6580
-				double x = reprocessingRate;             // Meddis: 66.31
-				double h = 50000;   // convert cleft contents to firing rate
-				double gdt = 1.0 - exp (- g * dt);
-				double ydt = 1.0 - exp (- y * dt);
-				double ldt = (1.0 - exp (- (l + r) * dt)) * l / (l + r);
-				double rdt = (1.0 - exp (- (l + r) * dt)) * r / (l + r);
-				double xdt = 1.0 - exp (- x * dt);
-				double kt = g * A / (A + B);   // membrane permeability
-				double c = M * y * kt / (l * kt + y * (l + r));   // cleft contents
-				double q = c * (l + r) / kt;   // free transmitter
-				double w = c * r / x;   // reprocessing store
-				for (integer itime = 1; itime <= basil -> nx; itime ++) {
-					double splusA = basil -> z [1] [itime] * 10.0 + A;
-					double replenish = ( M > q ? ydt * (M - q) : 0.0 );
-					kt = ( splusA > 0.0 ? gdt * splusA / (splusA + B) : 0.0 );
-					double eject = kt * q;
-					double loss = ldt * c;
-					double reuptake = rdt * c;
-					double reprocess = xdt * w;
-					q = q + replenish - eject + reprocess;
-					c = c + eject - loss - reuptake;
-					w = w + reuptake - reprocess;
-					basil -> z [1] [itime] = h * c;
-				}
-			}
-			
-			if (dtime == my dx) {
-				for (integer itime = 1; itime <= ntime; itime ++)
-					response [itime] = basil -> z [1] [itime];
-			} else {
-				double d = dtime / basil -> dx / 2.0;
-				double factor = -6 / d / d;
-				double area = d * sqrt (NUMpi / 6);
-				double expmin6 = exp (-6), onebyoneminexpmin6 = 1 / (1 - expmin6);
-				for (integer itime = 1; itime <= ntime; itime ++) {
-					double t1 = (itime - 1) * dtime;
-					double t2 = t1 + dtime;
-					double mean = 0.0;
-					integer i1, i2;
-					integer n = Matrix_getWindowSamplesX (basil.get(), t1, t2, & i1, & i2);
-					Melder_assert (n >= 1);
-					if (n <= 2) {
-						for (integer isamp = i1; isamp <= i2; isamp ++)
-							mean += basil -> z [1] [isamp];
-						mean /= n;
-					} else {
-						integer muint = Melder_ifloor ((i1 + i2) / 2.0), dint = Melder_ifloor (d);
-						for (integer isamp = muint - dint; isamp <= muint + dint; isamp ++) {
-							double y = 0;
-							if (isamp < 1 || isamp > basil -> nx)
-								Melder_casual (U"isamp ", isamp);
-							else
-								y = basil -> z [1] [isamp];
-							mean += y * onebyoneminexpmin6 * (exp (factor * (isamp - muint) *
-								(isamp - muint)) - expmin6);
-						}
-						mean /= area;
-					}
-					response [itime] = mean;
-				}
+			const integer lengthOfGammatone_samples = (integer) round (50.0 / midFrequency_Hertz * samplingFrequency);   // as in Sound_createSimple ()
+			basilLength [ifreq] = my nx + lengthOfGammatone_samples - 1;
+			gammatones [ifreq]. init (midFrequency_Hertz, samplingFrequency);
+		}
+		if (Melder_debug == 58) {
+			/*
+				Reference version: convolution with the sampled gammatone.
+			*/
+			for (integer ifreq = 1; ifreq <= nfreq; ifreq ++) {
+				double midFrequency_Hertz = Excitation_barkToHertz ((ifreq - 0.5) * dfreq);
+				autoSound gammatone = createGammatone (midFrequency_Hertz, samplingFrequency);
+				autoSound basil = Sounds_convolve (me, gammatone.get(), kSounds_convolve_scaling::SUM, kSounds_convolve_signalOutsideTimeDomain::ZERO);
+				VEC firingRate = basil -> z.row (1);
+				if (hasSynapse)
+					synapse_inplace (firingRate, my dx, replenishmentRate, lossRate, returnRate, reprocessingRate);
+				firingRateToResponse (firingRate, basil -> x1, basil -> dx, dtime, thy z.row (ifreq));
 			}
+			return thee;
 		}
+		/*
+			The bands are independent, so they can be computed in parallel,
+			each with the recursive version of its gammatone.
+		*/
+		const integer numberOfThreads = MelderThread_getNumberOfThreads (nfreq, 4);
+		autoMAT basilae = newMATraw (numberOfThreads, NUMmax (basilLength.get()));
+		MelderThread_run (numberOfThreads, [&] (integer ithread) {
+			integer firstBand, lastBand;
+			MelderThread_getRange (nfreq, numberOfThreads, ithread, & firstBand, & lastBand);
+			for (integer ifreq = firstBand; ifreq <= lastBand; ifreq ++) {
+				VEC basil = basilae.row (ithread).part (1, basilLength [ifreq]);
+				const integer latency = std::min (gammatones [ifreq]. numberOfLatencySamples, basil.size);
+				basil.part (1, latency) <<= 0.0;
+				VEC afterLatency = basil.part (latency + 1, basil.size);
+				const integer numberOfSamplesToCopy = std::min (my nx, afterLatency.size);
+				afterLatency.part (1, numberOfSamplesToCopy) <<= my z.row (1).part (1, numberOfSamplesToCopy);
+				afterLatency.part (numberOfSamplesToCopy + 1, afterLatency.size) <<= 0.0;
+				gammatones [ifreq]. filterBlock (afterLatency, afterLatency);
+				if (hasSynapse)
+					synapse_inplace (basil, my dx, replenishmentRate, lossRate, returnRate, reprocessingRate);
+				firingRateToResponse (basil, basilX1, my dx, dtime, thy z.row (ifreq));
+			}
+		});
 		return thee;
 	} catch (MelderError) {
 		Melder_throw (me, U": not converted to Cochleagram (edb).");
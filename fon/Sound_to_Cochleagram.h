@@ -25,4 +25,24 @@ autoCochleagram Sound_to_Cochleagram_edb
 	(Sound me, double dtime, double dfreq, int hasSynapse, double replenishmentRate,
 	 double lossRate, double returnRate, double reprocessingRate);
 
+/*
+	The fourth-order gammatone of Sound_to_Cochleagram_edb (De Boer's basilar membrane filter),
+	as a recursive filter: a fourth-order complex pole with a third-degree numerator,
+	whose impulse response equals the sampled gammatone from its first sample after the latency on.
+	The latency itself (a pure delay of `numberOfLatencySamples`) is left to the caller.
+
+	Being recursive, the filter can be run block after block, e.g. on the incoming audio
+	of a real-time auditory front end; input and output can be the same block.
+*/
+struct structGammatoneFilter_edb {
+	integer numberOfLatencySamples;
+	dcomplex pole, numerator [4];
+	dcomplex state [4];
+	double previousInput [3];
+
+	void init (double midFrequency_Hertz, double samplingFrequency);
+	void reset ();   // silence
+	void filterBlock (constVECVU const& input, VECVU const& output);
+};
+
 /* End of file Sound_to_Cochleagram.h */
@@ -33,15 +33,20 @@
 #include "Polynomial.h"
 #include "Roots.h"
 
+/*
+	The polynomial, the roots and the workspace (see Polynomial_into_Roots) are created once by the caller,
+	so that no frame has to allocate anything except its formants.
+*/
 static void burg (constVEC samples, VEC coefficients,
-	Formant_Frame frame, double nyquistFrequency, double safetyMargin)
+	Formant_Frame frame, double nyquistFrequency, double safetyMargin,
+	Polynomial polynomial, Roots roots, VEC const& workspace)
 {
 	double a0 = VECburg (coefficients, samples);
 	(void) a0;
 	/*
 		Convert LP coefficients to polynomial.
 	 */
-	autoPolynomial polynomial = Polynomial_create (-1, 1, coefficients.size);
+	Melder_assert (polynomial -> numberOfCoefficients == coefficients.size + 1);
 	for (integer i = 1; i <= coefficients.size; i ++)
 		polynomial -> coefficients [i] = - coefficients [coefficients.size - i + 1];
 	polynomial -> coefficients [coefficients.size + 1] = 1.0;
@@ -49,8 +54,8 @@ static void burg (constVEC samples, VEC coefficients,
 	/*
 		Find the roots of the polynomial.
 	 */
-	autoRoots roots = Polynomial_to_Roots (polynomial.get());
-	Roots_fixIntoUnitCircle (roots.get());
+	Polynomial_into_Roots (polynomial, roots, workspace);
+	Roots_fixIntoUnitCircle (roots);
 
 	Melder_assert (frame -> numberOfFormants == 0 && NUMisEmpty (frame -> formant.get()));
 
@@ -328,6 +333,9 @@ static autoFormant Sound_to_Formant_any_inplace (Sound me, double dt_in, integer
 	integer maximumFrameLength = nsamp_window;
 	auto frameBuffer = newVECraw (maximumFrameLength);
 	auto coefficients = newVECraw (numberOfPoles);   // superfluous if which==2, but nobody uses that anyway
+	autoPolynomial polynomial = Polynomial_create (-1.0, 1.0, numberOfPoles);
+	autoRoots roots = Roots_create (numberOfPoles);
+	autoVEC rootsWorkspace = newVECraw ((numberOfPoles + 1) * (numberOfPoles + 10));   // as in LPC_to_Formant
 	for (integer iframe = 1; iframe <= nFrames; iframe ++) {
 		const double t = Sampled_indexToX (thee.get(), iframe);
 		const integer leftSample = Sampled_xToLowIndex (me, t);
@@ -354,7 +362,8 @@ static autoFormant Sound_to_Formant_any_inplace (Sound me, double dt_in, integer
 			frame [isamp] = Sampled_getValueAtSample (me, offset + isamp, Sound_LEVEL_MONO, 0) * window [isamp];
 
 		if (which == 1) {
-			burg (frame, coefficients.get(), & thy frames [iframe], 0.5 / my dx, safetyMargin);
+			burg (frame, coefficients.get(), & thy frames [iframe], 0.5 / my dx, safetyMargin,
+					polynomial.get(), roots.get(), rootsWorkspace.get());
 		} else if (which == 2) {
 			if (! splitLevinson (frame, numberOfPoles, & thy frames [iframe], 0.5 / my dx)) {
 				Melder_clearError ();
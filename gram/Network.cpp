@@ -30,6 +30,7 @@
 #include "Network.h"
 #include "Matrix.h"
 #include "Formula.h"
+#include "MelderThread.h"
 
 #include "oo_DESTROY.h"
 #include "Network_def.h"
@@ -190,7 +191,29 @@ void Network_setClamping (Network me, integer nodeNumber, bool clamped) {
 	}
 }
 
-void Network_spreadActivities (Network me, integer numberOfSteps) {
+static double Network_activityFromExcitation (Network me, double excitation, double activity) {
+	switch (my activityClippingRule) {
+		case kNetwork_activityClippingRule::SIGMOID:
+			return my minimumActivity +
+				(my maximumActivity - my minimumActivity) * NUMsigmoid (excitation - 0.5 * (my minimumActivity + my maximumActivity));
+		case kNetwork_activityClippingRule::LINEAR:
+			if (excitation < my minimumActivity)
+				return my minimumActivity;
+			if (excitation > my maximumActivity)
+				return my maximumActivity;
+			return excitation;
+		case kNetwork_activityClippingRule::TOP_SIGMOID:
+			if (excitation <= my minimumActivity)
+				return my minimumActivity;
+			return my minimumActivity +
+				(my maximumActivity - my minimumActivity) * (2.0 * NUMsigmoid (2.0 * (excitation - my minimumActivity) / (my maximumActivity - my minimumActivity)) - 1.0);
+		case kNetwork_activityClippingRule::UNDEFINED:
+			return activity;
+	}
+	return activity;
+}
+
+static void Network_spreadActivities_byConnection (Network me, integer numberOfSteps) {
 	for (integer istep = 1; istep <= numberOfSteps; istep ++) {
 		for (integer inode = 1; inode <= my numberOfNodes; inode ++) {
 			NetworkNode node = & my nodes [inode];
@@ -211,35 +234,169 @@ void Network_spreadActivities (Network me, integer numberOfSteps) {
 		}
 		for (integer inode = 1; inode <= my numberOfNodes; inode ++) {
 			NetworkNode node = & my nodes [inode];
-			if (! node -> clamped) {
-				switch (my activityClippingRule) {
-					case kNetwork_activityClippingRule::SIGMOID:
-						node -> activity = my minimumActivity +
-							(my maximumActivity - my minimumActivity) * NUMsigmoid (node -> excitation - 0.5 * (my minimumActivity + my maximumActivity));
-					break;
-					case kNetwork_activityClippingRule::LINEAR:
-						if (node -> excitation < my minimumActivity) {
-							node -> activity = my minimumActivity;
-						} else if (node -> excitation > my maximumActivity) {
-							node -> activity = my maximumActivity;
-						} else {
-							node -> activity = node -> excitation;
-						}
-					break;
-					case kNetwork_activityClippingRule::TOP_SIGMOID:
-						if (node -> excitation <= my minimumActivity) {
-							node -> activity = my minimumActivity;
-						} else {
-							node -> activity = my minimumActivity +
-								(my maximumActivity - my minimumActivity) * (2.0 * NUMsigmoid (2.0 * (node -> excitation - my minimumActivity) / (my maximumActivity - my minimumActivity)) - 1.0);
-							trace (U"excitation ", node -> excitation, U", activity ", node -> activity);
-						}
-					break;
-					case kNetwork_activityClippingRule::UNDEFINED:
-					break;
-				}
+			if (! node -> clamped)
+				node -> activity = Network_activityFromExcitation (me, node -> excitation, node -> activity);
+		}
+	}
+}
+
+/*
+	Spreading node by node.
+	In a step, the connection-by-connection loop above changes the excitation of a node only
+	with the activities from before the step, so every node can go through its own adjacency list;
+	with shunting, the excitation then changes by the same terms, in the same order, as in that loop.
+	Without shunting, the terms of a node are summed first, which is a dot product of the weights with gathered activities.
+	The activities of a step are computed into a separate vector, so the nodes can be divided over threads.
+	Melder_debug 68 switches back to the connection-by-connection loop.
+*/
+static void Network_buildAdjacency (Network me) {
+	if (my adjacencyStart.size == my numberOfNodes + 1 && my adjacencyNumberOfConnections == my numberOfConnections)
+		return;
+	autoINTVEC start = newINTVECzero (my numberOfNodes + 1);
+	for (integer iconn = 1; iconn <= my numberOfConnections; iconn ++) {
+		const NetworkConnection connection = & my connections [iconn];
+		Melder_require (connection -> nodeFrom >= 1 && connection -> nodeFrom <= my numberOfNodes &&
+				connection -> nodeTo >= 1 && connection -> nodeTo <= my numberOfNodes,
+			U"Connection ", iconn, U" does not connect two existing nodes.");
+		start [connection -> nodeFrom] += 1;
+		start [connection -> nodeTo] += 1;
+	}
+	integer nextEntry = 1;
+	for (integer inode = 1; inode <= my numberOfNodes; inode ++) {
+		const integer numberOfEntries = start [inode];
+		start [inode] = nextEntry;
+		nextEntry += numberOfEntries;
+	}
+	start [my numberOfNodes + 1] = nextEntry;
+	autoINTVEC node = newINTVECraw (2 * my numberOfConnections);
+	autoINTVEC connection = newINTVECraw (2 * my numberOfConnections);
+	autoINTVEC fill = newINTVECcopy (start.part (1, my numberOfNodes));
+	for (integer iconn = 1; iconn <= my numberOfConnections; iconn ++) {
+		const integer nodeFrom = my connections [iconn]. nodeFrom, nodeTo = my connections [iconn]. nodeTo;
+		const integer fromEntry = fill [nodeFrom] ++;
+		node [fromEntry] = nodeTo;
+		connection [fromEntry] = iconn;
+		const integer toEntry = fill [nodeTo] ++;
+		node [toEntry] = nodeFrom;
+		connection [toEntry] = iconn;
+	}
+	my adjacencyStart = start.move();
+	my adjacentNode = node.move();
+	my adjacentConnection = connection.move();
+	my adjacencyNumberOfConnections = my numberOfConnections;
+}
+
+static autoVEC Network_getAdjacentWeights (Network me) {
+	autoVEC result = newVECraw (my adjacentConnection.size);
+	for (integer ientry = 1; ientry <= result.size; ientry ++)
+		result [ientry] = my connections [my adjacentConnection [ientry]]. weight;
+	return result;
+}
+
+/*
+	One step for the nodes `fromNode` to `toNode`, from `activity` into `newActivity`.
+*/
+static void Network_spreadActivities_nodes (Network me, constVEC const& adjacentWeight,
+	constVEC const& activity, VEC const& excitation, VEC const& newActivity, integer fromNode, integer toNode)
+{
+	for (integer inode = fromNode; inode <= toNode; inode ++) {
+		if (my nodes [inode]. clamped) {
+			newActivity [inode] = activity [inode];
+			continue;
+		}
+		double nodeExcitation = excitation [inode];
+		nodeExcitation -= my spreadingRate * my activityLeak * nodeExcitation;
+		const integer firstEntry = my adjacencyStart [inode], lastEntry = my adjacencyStart [inode + 1] - 1;
+		if (my shunting == 0.0) {
+			double sum = 0.0;
+			for (integer ientry = firstEntry; ientry <= lastEntry; ientry ++)
+				sum += activity [my adjacentNode [ientry]] * adjacentWeight [ientry];
+			nodeExcitation += my spreadingRate * sum;
+		} else {
+			for (integer ientry = firstEntry; ientry <= lastEntry; ientry ++) {
+				const double weight = adjacentWeight [ientry];
+				const double shunting = ( weight >= 0.0 ? my shunting : 0.0 );   // only for excitatory connections
+				nodeExcitation += my spreadingRate * activity [my adjacentNode [ientry]] * (weight - shunting * nodeExcitation);
 			}
 		}
+		excitation [inode] = nodeExcitation;
+		newActivity [inode] = Network_activityFromExcitation (me, nodeExcitation, activity [inode]);
+	}
+}
+
+void Network_spreadActivities (Network me, integer numberOfSteps) {
+	try {
+		if (Melder_debug == 68) {
+			Network_spreadActivities_byConnection (me, numberOfSteps);
+			return;
+		}
+		Network_buildAdjacency (me);
+		autoVEC adjacentWeight = Network_getAdjacentWeights (me);
+		autoVEC activityBuffer = newVECraw (my numberOfNodes), newActivityBuffer = newVECraw (my numberOfNodes);
+		autoVEC excitation = newVECraw (my numberOfNodes);
+		for (integer inode = 1; inode <= my numberOfNodes; inode ++) {
+			activityBuffer [inode] = my nodes [inode]. activity;
+			excitation [inode] = my nodes [inode]. excitation;
+		}
+		VEC activity = activityBuffer.get(), newActivity = newActivityBuffer.get();
+		/*
+			The threads are started anew in every step, so they pay off only for large networks.
+		*/
+		const integer numberOfThreads = MelderThread_getNumberOfThreads (adjacentWeight.size + my numberOfNodes, 100'000);
+		for (integer istep = 1; istep <= numberOfSteps; istep ++) {
+			MelderThread_run (numberOfThreads, [&] (integer ithread) {
+				integer fromNode, toNode;
+				MelderThread_getRange (my numberOfNodes, numberOfThreads, ithread, & fromNode, & toNode);
+				Network_spreadActivities_nodes (me, adjacentWeight.get(), activity, excitation.get(), newActivity, fromNode, toNode);
+			});
+			std::swap (activity, newActivity);
+		}
+		for (integer inode = 1; inode <= my numberOfNodes; inode ++) {
+			my nodes [inode]. activity = activity [inode];
+			my nodes [inode]. excitation = excitation [inode];
+		}
+	} catch (MelderError) {
+		Melder_throw (me, U": activities not spread.");
+	}
+}
+
+autoActivationList Network_PatternList_to_ActivationList (Network me, PatternList thee, integer fromNode, integer numberOfSteps) {
+	try {
+		Melder_require (fromNode >= 1 && fromNode - 1 + thy nx <= my numberOfNodes,
+			U"The ", thy nx, U" columns of the PatternList should fit on the nodes from ", fromNode,
+			U" on, but the Network has only ", my numberOfNodes, U" nodes.");
+		Network_buildAdjacency (me);
+		autoVEC adjacentWeight = Network_getAdjacentWeights (me);
+		const integer numberOfPatterns = thy ny;
+		autoActivationList him = ActivationList_create (numberOfPatterns, my numberOfNodes);
+		const double workPerPattern = double (numberOfSteps) * double (adjacentWeight.size + my numberOfNodes);
+		const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfPatterns, integer (1e5 / workPerPattern) + 1);
+		autoMAT excitations = newMATraw (numberOfThreads, my numberOfNodes);
+		autoMAT otherActivities = newMATraw (numberOfThreads, my numberOfNodes);
+		MelderThread_run (numberOfThreads, [&] (integer ithread) {
+			const VEC excitation = excitations.row (ithread);
+			integer firstPattern, lastPattern;
+			MelderThread_getRange (numberOfPatterns, numberOfThreads, ithread, & firstPattern, & lastPattern);
+			for (integer ipattern = firstPattern; ipattern <= lastPattern; ipattern ++) {
+				const VEC result = his z.row (ipattern);
+				for (integer inode = 1; inode <= my numberOfNodes; inode ++) {
+					result [inode] = my nodes [inode]. activity;
+					excitation [inode] = my nodes [inode]. excitation;
+				}
+				for (integer icol = 1; icol <= thy nx; icol ++)
+					result [fromNode - 1 + icol] = excitation [fromNode - 1 + icol] = thy z [ipattern] [icol];
+				VEC activity = result, newActivity = otherActivities.row (ithread);
+				for (integer istep = 1; istep <= numberOfSteps; istep ++) {
+					Network_spreadActivities_nodes (me, adjacentWeight.get(), activity, excitation, newActivity, 1, my numberOfNodes);
+					std::swap (activity, newActivity);
+				}
+				if (activity.cells != result.cells)
+					result  <<=  activity;
+			}
+		});
+		return him;
+	} catch (MelderError) {
+		Melder_throw (me, U" & ", thee, U": no ActivationList created.");
 	}
 }
 
@@ -264,15 +421,23 @@ void Network_normalizeActivities (Network me, integer fromNode, integer toNode)
 }
 
 void Network_updateWeights (Network me) {
-	for (integer iconn = 1; iconn <= my numberOfConnections; iconn ++) {
-		NetworkConnection connection = & my connections [iconn];
-		NetworkNode nodeFrom = & my nodes [connection -> nodeFrom];
-		NetworkNode nodeTo = & my nodes [connection -> nodeTo];
-		connection -> weight += connection -> plasticity * my learningRate *
-				(nodeFrom -> activity * nodeTo -> activity -
-				 (my instar * nodeTo -> activity + my outstar * nodeFrom -> activity + my weightLeak) * connection -> weight);
-		Melder_clip (my minimumWeight, & connection -> weight, my maximumWeight);
-	}
+	/*
+		Every connection changes independently of the others, so the connections can be divided over threads.
+	*/
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (my numberOfConnections, 100'000);
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		integer firstConnection, lastConnection;
+		MelderThread_getRange (my numberOfConnections, numberOfThreads, ithread, & firstConnection, & lastConnection);
+		for (integer iconn = firstConnection; iconn <= lastConnection; iconn ++) {
+			NetworkConnection connection = & my connections [iconn];
+			NetworkNode nodeFrom = & my nodes [connection -> nodeFrom];
+			NetworkNode nodeTo = & my nodes [connection -> nodeTo];
+			connection -> weight += connection -> plasticity * my learningRate *
+					(nodeFrom -> activity * nodeTo -> activity -
+					 (my instar * nodeTo -> activity + my outstar * nodeFrom -> activity + my weightLeak) * connection -> weight);
+			Melder_clip (my minimumWeight, & connection -> weight, my maximumWeight);
+		}
+	});
 }
 
 void Network_normalizeWeights (Network me, integer fromNode, integer toNode, integer nodeFromMin, integer nodeFromMax, double newSum) {
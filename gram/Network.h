@@ -19,6 +19,8 @@
  */
 
 #include "Table.h"
+#include "PatternList.h"
+#include "ActivationList.h"
 
 #include "Network_enums.h"
 
@@ -60,6 +62,12 @@ void Network_setClamping (Network me, integer nodeNumber, bool clamped);
 void Network_zeroActivities (Network me, integer fromNodeNumber, integer toNodeNumber);
 void Network_normalizeActivities (Network me, integer fromNodeNumber, integer toNodeNumber);
 void Network_spreadActivities (Network me, integer numberOfSteps);
+autoActivationList Network_PatternList_to_ActivationList (Network me, PatternList thee, integer fromNode, integer numberOfSteps);
+/*
+	Every row of the PatternList is an independent input: starting from the current state of the Network,
+	the row's values are put on the nodes from fromNode on (as by Network_setActivity), and the activities are spread.
+	Row i of the result holds the activities of all nodes after numberOfSteps steps; the Network itself does not change.
+*/
 void Network_updateWeights (Network me);
 void Network_normalizeWeights (Network me, integer nodeMin, integer nodeMax, integer nodeFromMin, integer nodeFromMax, double newSum);
 void Network_setInstar (Network me, double instar);
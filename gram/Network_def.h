@@ -128,6 +128,14 @@ oo_DEFINE_CLASS (Network, Daata)
 				this, U": to-node number (", *p_toNode, U") out of the range 1..", our numberOfNodes, U".");
 			return *p_toNode - *p_fromNode + 1;
 		}
+		/*
+			The connections by node, in compressed form: for node `inode`, the entries
+			adjacencyStart [inode] .. adjacencyStart [inode + 1] - 1 of adjacentNode and adjacentConnection
+			are the connections at either end of which the node lies, in the order of the connections,
+			with the node at the other end. Built by Network_spreadActivities () when the connections have changed.
+		*/
+		autoINTVEC adjacencyStart, adjacentNode, adjacentConnection;
+		integer adjacencyNumberOfConnections;
 	#endif
 
 oo_END_CLASS (Network)
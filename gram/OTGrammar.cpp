@@ -73,6 +73,7 @@
  */
 
 #include "OTGrammar.h"
+#include "MelderThread.h"
 
 #include "oo_DESTROY.h"
 #include "OTGrammar_def.h"
@@ -548,6 +549,386 @@ integer OTGrammar_getNumberOfOptimalCandidates (OTGrammar me, integer itab) {
 	return numberOfBestCandidates;
 }
 
+/*
+	Evaluating many data.
+
+	Learning and measuring a grammar means evaluating millions of data. For every datum,
+	OTGrammar_getWinner () compares each candidate with the best one found so far, constraint by constraint,
+	through the marks of the candidates, which lie scattered over the heap.
+	For these situations we first compile the tableaus: the marks of all candidates of all tableaus
+	go into a single violation matrix, one row per candidate, tableau after tableau.
+	In OT we also drop beforehand every candidate that is harmonically bounded by an earlier candidate
+	of the same tableau: when such a candidate comes up, the best candidate found so far is at least as good
+	as the bounding candidate, so the comparison is always lost, and no random number is used to break a tie.
+	The winners, and the random numbers drawn, are therefore exactly the same as with OTGrammar_getWinner ().
+
+	Each evaluation then works on the disharmonies, the constraint order and the harmonies
+	in an OTGrammar_Evaluator of its own, rather than in the grammar itself.
+	An evaluator draws its random numbers from one of the random streams of NUMrandom:
+	stream 0 is the ordinary stream, so that sequential learning gives the same results as before,
+	and streams 1 through 16 are for evaluating data in parallel.
+	The data are always divided over all 16 streams, whatever the number of threads,
+	so that the results depend only on the random seed, not on the number of processors.
+
+	Melder_debug 69 evaluates the data one by one in the grammar itself, as before.
+*/
+struct OTGrammar_CompiledTableaus {
+	autoINTMAT violations;   // the marks of all candidates of all tableaus, one row per candidate
+	autoINTVEC firstRow;   // for each tableau, the row of its first candidate (and one more element for the end)
+	autoINTVEC contenders;   // for each tableau, the candidate numbers that could win, in their original order
+	autoINTVEC firstContender;   // for each tableau, its first element in `contenders` (and one more element for the end)
+	integer maximumNumberOfCandidates;
+};
+
+static bool OTGrammar_CompiledTableaus_isBounded (OTGrammar_CompiledTableaus *compiled, integer row, integer boundingRow) {
+	const constINTVEC marks = compiled -> violations [row], boundingMarks = compiled -> violations [boundingRow];
+	bool isBetterSomewhere = false;
+	for (integer icons = 1; icons <= marks.size; icons ++) {
+		if (boundingMarks [icons] > marks [icons])
+			return false;
+		if (boundingMarks [icons] < marks [icons])
+			isBetterSomewhere = true;
+	}
+	return isBetterSomewhere;
+}
+
+static void OTGrammar_compileTableaus (OTGrammar me, OTGrammar_CompiledTableaus *compiled) {
+	integer totalNumberOfCandidates = 0;
+	compiled -> maximumNumberOfCandidates = 0;
+	for (integer itab = 1; itab <= my numberOfTableaus; itab ++) {
+		totalNumberOfCandidates += my tableaus [itab]. numberOfCandidates;
+		compiled -> maximumNumberOfCandidates = std::max (compiled -> maximumNumberOfCandidates, my tableaus [itab]. numberOfCandidates);
+	}
+	compiled -> violations = newINTMATraw (totalNumberOfCandidates, my numberOfConstraints);
+	compiled -> firstRow = newINTVECraw (my numberOfTableaus + 1);
+	compiled -> contenders = newINTVECraw (totalNumberOfCandidates);
+	compiled -> firstContender = newINTVECraw (my numberOfTableaus + 1);
+	const bool mayDropBoundedCandidates = ( my decisionStrategy == kOTGrammar_decisionStrategy::OPTIMALITY_THEORY );
+	integer row = 0, numberOfContenders = 0;
+	for (integer itab = 1; itab <= my numberOfTableaus; itab ++) {
+		const OTGrammarTableau tableau = & my tableaus [itab];
+		compiled -> firstRow [itab] = row + 1;
+		compiled -> firstContender [itab] = numberOfContenders + 1;
+		for (integer icand = 1; icand <= tableau -> numberOfCandidates; icand ++)
+			compiled -> violations [row + icand] <<= tableau -> candidates [icand]. marks.get();
+		for (integer icand = 1; icand <= tableau -> numberOfCandidates; icand ++) {
+			bool isBounded = false;
+			if (mayDropBoundedCandidates)
+				for (integer jcand = 1; jcand < icand && ! isBounded; jcand ++)
+					isBounded = OTGrammar_CompiledTableaus_isBounded (compiled, row + icand, row + jcand);
+			if (! isBounded)
+				compiled -> contenders [++ numberOfContenders] = icand;
+		}
+		row += tableau -> numberOfCandidates;
+	}
+	compiled -> firstRow [my numberOfTableaus + 1] = row + 1;
+	compiled -> firstContender [my numberOfTableaus + 1] = numberOfContenders + 1;
+}
+
+struct OTGrammar_Evaluator {
+	int randomStream;
+	autoVEC disharmonies;   // by constraint number
+	autoINTVEC index;   // constraint numbers, from the highest to the lowest disharmony
+	autoBOOLVEC tiedToTheRight;   // by constraint number
+	autoVEC weights;   // by constraint number: what a mark costs in the harmonic decision strategies
+	autoVEC harmonies, probabilities;   // by candidate number
+};
+
+static void OTGrammar_initEvaluator (OTGrammar me, OTGrammar_CompiledTableaus *compiled, OTGrammar_Evaluator *evaluator, int randomStream) {
+	evaluator -> randomStream = randomStream;
+	evaluator -> disharmonies = newVECraw (my numberOfConstraints);
+	evaluator -> index = newINTVECraw (my numberOfConstraints);
+	evaluator -> tiedToTheRight = newBOOLVECzero (my numberOfConstraints);
+	evaluator -> weights = newVECraw (my numberOfConstraints);
+	evaluator -> harmonies = newVECraw (compiled -> maximumNumberOfCandidates);
+	evaluator -> probabilities = newVECraw (compiled -> maximumNumberOfCandidates);
+}
+
+static void OTGrammar_Evaluator_computeWeights (OTGrammar me, OTGrammar_Evaluator *evaluator) {
+	for (integer icons = 1; icons <= my numberOfConstraints; icons ++) {
+		const double disharmony = evaluator -> disharmonies [icons];
+		double weight = disharmony;
+		if (my decisionStrategy == kOTGrammar_decisionStrategy::EXPONENTIAL_HG ||
+			my decisionStrategy == kOTGrammar_decisionStrategy::EXPONENTIAL_MAXIMUM_ENTROPY)
+			weight = exp (disharmony);
+		else if (my decisionStrategy == kOTGrammar_decisionStrategy::LINEAR_OT)
+			weight = ( disharmony > 0.0 ? disharmony : 0.0 );   // adding zero instead of skipping the constraint does not change the sum
+		else if (my decisionStrategy == kOTGrammar_decisionStrategy::POSITIVE_HG)
+			weight = std::max (disharmony, 1.0);
+		evaluator -> weights [icons] = weight;
+	}
+}
+
+/*
+	Take over the disharmonies that OTGrammar_newDisharmonies () has just drawn into the grammar.
+*/
+static void OTGrammar_Evaluator_takeDisharmonies (OTGrammar me, OTGrammar_Evaluator *evaluator) {
+	for (integer icons = 1; icons <= my numberOfConstraints; icons ++) {
+		evaluator -> disharmonies [icons] = my constraints [icons]. disharmony;
+		evaluator -> index [icons] = my index [icons];
+		evaluator -> tiedToTheRight [icons] = my constraints [icons]. tiedToTheRight;
+	}
+	OTGrammar_Evaluator_computeWeights (me, evaluator);
+}
+
+/*
+	Like OTGrammar_newDisharmonies (), but in the evaluator, with the evaluator's own random stream.
+	The grammar is only read, so this can run in several threads at a time.
+*/
+static void OTGrammar_Evaluator_newDisharmonies (OTGrammar me, OTGrammar_Evaluator *evaluator, double spreading) noexcept {
+	for (integer icons = 1; icons <= my numberOfConstraints; icons ++) {
+		evaluator -> disharmonies [icons] = my constraints [icons]. ranking +
+				NUMrandomGauss_mt (evaluator -> randomStream, 0.0, spreading);
+		evaluator -> index [icons] = icons;
+	}
+	/*
+		Sort as OTGrammar_sort () does. There are seldom more than a few dozen constraints,
+		and an insertion sort does not need a global variable for the grammar, as qsort () would.
+	*/
+	const constVEC disharmonies = evaluator -> disharmonies.get();
+	INTVEC index = evaluator -> index.get();
+	for (integer icons = 2; icons <= my numberOfConstraints; icons ++) {
+		const integer constraint = index [icons];
+		integer position = icons;
+		while (position > 1) {
+			const integer previous = index [position - 1];
+			const bool isHigher = ( disharmonies [constraint] != disharmonies [previous] ?
+				disharmonies [constraint] > disharmonies [previous] :
+				str32cmp (my constraints [constraint]. name.get(), my constraints [previous]. name.get()) < 0
+			);
+			if (! isHigher)
+				break;
+			index [position] = previous;
+			position --;
+		}
+		index [position] = constraint;
+	}
+	for (integer icons = 1; icons <= my numberOfConstraints; icons ++)
+		evaluator -> tiedToTheRight [evaluator -> index [icons]] = ( icons < my numberOfConstraints &&
+				disharmonies [evaluator -> index [icons + 1]] == disharmonies [evaluator -> index [icons]] );
+	OTGrammar_Evaluator_computeWeights (me, evaluator);
+}
+
+static int OTGrammar_Evaluator_compareInOT (OTGrammar_Evaluator *evaluator, constINTVEC const& marks1, constINTVEC const& marks2) noexcept {
+	const integer numberOfConstraints = evaluator -> index.size;
+	for (integer icons = 1; icons <= numberOfConstraints; icons ++) {
+		integer numberOfMarks1 = marks1 [evaluator -> index [icons]];
+		integer numberOfMarks2 = marks2 [evaluator -> index [icons]];
+		while (evaluator -> tiedToTheRight [evaluator -> index [icons]]) {
+			icons ++;
+			numberOfMarks1 += marks1 [evaluator -> index [icons]];
+			numberOfMarks2 += marks2 [evaluator -> index [icons]];
+		}
+		if (numberOfMarks1 < numberOfMarks2)
+			return -1;
+		if (numberOfMarks1 > numberOfMarks2)
+			return +1;
+	}
+	return 0;
+}
+
+/*
+	The same winner as OTGrammar_getWinner (), with the same random numbers, but from the compiled tableaus
+	and the disharmonies in the evaluator.
+*/
+static integer OTGrammar_Evaluator_getWinner (OTGrammar me, OTGrammar_CompiledTableaus *compiled,
+	OTGrammar_Evaluator *evaluator, integer itab) noexcept
+{
+	const integer firstRow = compiled -> firstRow [itab];
+	const integer numberOfCandidates = compiled -> firstRow [itab + 1] - firstRow;
+	const integer firstContender = compiled -> firstContender [itab], lastContender = compiled -> firstContender [itab + 1] - 1;
+	const integer numberOfConstraints = my numberOfConstraints;
+	integer icand_best = 1;
+	if (my decisionStrategy == kOTGrammar_decisionStrategy::MAXIMUM_ENTROPY ||
+		my decisionStrategy == kOTGrammar_decisionStrategy::EXPONENTIAL_MAXIMUM_ENTROPY)
+	{
+		/*
+			As in _OTGrammar_fillInHarmonies () and _OTGrammar_fillInProbabilities ().
+		*/
+		VEC harmonies = evaluator -> harmonies.part (1, numberOfCandidates);
+		VEC probabilities = evaluator -> probabilities.part (1, numberOfCandidates);
+		for (integer icand = 1; icand <= numberOfCandidates; icand ++) {
+			const constINTVEC marks = compiled -> violations [firstRow - 1 + icand];
+			longdouble disharmony = 0.0;
+			for (integer icons = 1; icons <= numberOfConstraints; icons ++)
+				disharmony += evaluator -> weights [icons] * marks [icons];
+			harmonies [icand] = - (double) disharmony;
+		}
+		double maximumHarmony = harmonies [1];
+		for (integer icand = 2; icand <= numberOfCandidates; icand ++)
+			if (harmonies [icand] > maximumHarmony)
+				maximumHarmony = harmonies [icand];
+		longdouble sumOfProbabilities = 0.0;
+		for (integer icand = 1; icand <= numberOfCandidates; icand ++) {
+			probabilities [icand] = exp (harmonies [icand] - maximumHarmony);
+			sumOfProbabilities += probabilities [icand];
+		}
+		for (integer icand = 1; icand <= numberOfCandidates; icand ++)
+			probabilities [icand] /= double (sumOfProbabilities);
+		const double cutOff = NUMrandomFraction_mt (evaluator -> randomStream);
+		sumOfProbabilities = 0.0;
+		for (integer icand = 1; icand <= numberOfCandidates; icand ++) {
+			sumOfProbabilities += probabilities [icand];
+			if (sumOfProbabilities > cutOff) {
+				icand_best = icand;
+				break;
+			}
+		}
+		return icand_best;
+	}
+	const bool isOT = ( my decisionStrategy == kOTGrammar_decisionStrategy::OPTIMALITY_THEORY );
+	if (! isOT) {
+		/*
+			The harmonic decision strategies: compute each disharmony once,
+			in the same order as OTGrammar_compareCandidates () does.
+		*/
+		for (integer icontender = firstContender; icontender <= lastContender; icontender ++) {
+			const integer icand = compiled -> contenders [icontender];
+			const constINTVEC marks = compiled -> violations [firstRow - 1 + icand];
+			double disharmony = 0.0;
+			for (integer icons = 1; icons <= numberOfConstraints; icons ++)
+				disharmony += evaluator -> weights [icons] * marks [icons];
+			evaluator -> harmonies [icand] = disharmony;
+		}
+	}
+	integer numberOfBestCandidates = 1;
+	for (integer icontender = firstContender + 1; icontender <= lastContender; icontender ++) {
+		const integer icand = compiled -> contenders [icontender];
+		int comparison;
+		if (isOT) {
+			comparison = OTGrammar_Evaluator_compareInOT (evaluator,
+					compiled -> violations [firstRow - 1 + icand], compiled -> violations [firstRow - 1 + icand_best]);
+		} else {
+			const double disharmony = evaluator -> harmonies [icand], bestDisharmony = evaluator -> harmonies [icand_best];
+			comparison = ( disharmony < bestDisharmony ? -1 : disharmony > bestDisharmony ? +1 : 0 );
+		}
+		if (comparison == -1) {
+			icand_best = icand;
+			numberOfBestCandidates = 1;
+		} else if (comparison == 0) {
+			numberOfBestCandidates += 1;
+			if (Melder_debug == 41) {
+				;   // keep first
+			} else if (Melder_debug == 42) {
+				icand_best = icand;   // take last
+			} else if (numberOfBestCandidates * NUMrandomFraction_mt (evaluator -> randomStream) < 1.0) {
+				icand_best = icand;
+			}
+		}
+	}
+	return icand_best;
+}
+
+/*
+	Draws pairs with the same random numbers as PairDistribution_peekPair (),
+	but with a binary search in the cumulative weights,
+	and with the tableau and the adult candidate of every pair looked up beforehand.
+*/
+struct OTGrammar_PairSampler {
+	autovector <longdouble> cumulativeWeights;
+	double totalWeight;
+	autoINTVEC tableau;   // for each pair
+	autoINTVEC adultCandidate;   // for each pair; 0 if the grammar cannot generate the adult output
+};
+
+static void OTGrammar_PairDistribution_initSampler (OTGrammar me, PairDistribution thee, OTGrammar_PairSampler *sampler) {
+	const integer numberOfPairs = thy pairs.size;
+	Melder_require (numberOfPairs >= 1,
+		thee, U": no candidates.");
+	sampler -> cumulativeWeights = newvectorraw <longdouble> (numberOfPairs);
+	sampler -> tableau = newINTVECzero (numberOfPairs);
+	sampler -> adultCandidate = newINTVECzero (numberOfPairs);
+	longdouble sum = 0.0;
+	for (integer ipair = 1; ipair <= numberOfPairs; ipair ++) {
+		const PairProbability pair = thy pairs.at [ipair];
+		Melder_require (pair -> weight >= 0.0,
+			thee, U": the weight of pair ", ipair, U" should not be negative.");
+		Melder_require (pair -> string1 && pair -> string2,
+			thee, U": no string in probability pair ", ipair, U".");
+		sampler -> cumulativeWeights [ipair] = ( sum += pair -> weight );
+		if (pair -> weight == 0.0)
+			continue;   // will not be drawn
+		const integer itab = OTGrammar_getTableau (me, pair -> string1.get());
+		sampler -> tableau [ipair] = itab;
+		const OTGrammarTableau tableau = & my tableaus [itab];
+		for (integer icand = 1; icand <= tableau -> numberOfCandidates; icand ++) {
+			if (str32equ (tableau -> candidates [icand]. output.get(), pair -> string2.get())) {
+				sampler -> adultCandidate [ipair] = icand;
+				break;
+			}
+		}
+	}
+	sampler -> totalWeight = double (sum);
+	Melder_require (sampler -> totalWeight > 0.0,
+		thee, U": the total weight should be positive.");
+}
+
+static integer OTGrammar_PairSampler_draw (OTGrammar_PairSampler *sampler, int randomStream) noexcept {
+	const integer numberOfPairs = sampler -> cumulativeWeights.size;
+	for (;;) {
+		const double rand = sampler -> totalWeight * NUMrandomFraction_mt (randomStream);
+		if (rand > sampler -> cumulativeWeights [numberOfPairs])
+			continue;   // guard against rounding errors, as in PairDistribution_peekPair ()
+		/*
+			The first pair whose cumulative weight reaches `rand`.
+		*/
+		integer low = 1, high = numberOfPairs;
+		while (low < high) {
+			const integer mid = (low + high) / 2;
+			if (rand <= sampler -> cumulativeWeights [mid])
+				high = mid;
+			else
+				low = mid + 1;
+		}
+		while (sampler -> tableau [low] == 0)   // only a pair with zero weight at the start, if `rand` is exactly zero
+			low ++;
+		return low;
+	}
+}
+
+constexpr integer OTGrammar_NUMBER_OF_RANDOM_STREAMS = 16;
+
+/*
+	Calls `func (istream)` for every random stream 1 through 16, in several threads if there are enough data.
+*/
+template <typename Function>
+static void OTGrammar_runOnRandomStreams (integer numberOfData, Function const& func) {
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfData, 10'000, OTGrammar_NUMBER_OF_RANDOM_STREAMS);
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		integer firstStream, lastStream;
+		MelderThread_getRange (OTGrammar_NUMBER_OF_RANDOM_STREAMS, numberOfThreads, ithread, & firstStream, & lastStream);
+		for (integer istream = firstStream; istream <= lastStream; istream ++)
+			func (istream);
+	});
+}
+
+static void OTGrammar_initEvaluators (OTGrammar me, OTGrammar_CompiledTableaus *compiled, OTGrammar_Evaluator evaluators []) {
+	for (integer istream = 1; istream <= OTGrammar_NUMBER_OF_RANDOM_STREAMS; istream ++)
+		OTGrammar_initEvaluator (me, compiled, & evaluators [istream], int (istream));
+}
+
+/*
+	Adds to `counts` how often each candidate of tableau `itab` wins in `numberOfTrials` evaluations.
+*/
+static void OTGrammar_countWinners (OTGrammar me, OTGrammar_CompiledTableaus *compiled, OTGrammar_Evaluator evaluators [],
+	integer itab, integer numberOfTrials, double evaluationNoise, VECVU const& counts)
+{
+	const integer numberOfCandidates = my tableaus [itab]. numberOfCandidates;
+	autoINTMAT streamCounts = newINTMATzero (OTGrammar_NUMBER_OF_RANDOM_STREAMS, numberOfCandidates);
+	OTGrammar_runOnRandomStreams (numberOfTrials, [&] (integer istream) {
+		OTGrammar_Evaluator *evaluator = & evaluators [istream];
+		integer firstTrial, lastTrial;
+		MelderThread_getRange (numberOfTrials, OTGrammar_NUMBER_OF_RANDOM_STREAMS, istream, & firstTrial, & lastTrial);
+		for (integer itrial = firstTrial; itrial <= lastTrial; itrial ++) {
+			OTGrammar_Evaluator_newDisharmonies (me, evaluator, evaluationNoise);
+			streamCounts [istream] [OTGrammar_Evaluator_getWinner (me, compiled, evaluator, itab)] += 1;
+		}
+	});
+	for (integer istream = 1; istream <= OTGrammar_NUMBER_OF_RANDOM_STREAMS; istream ++)
+		for (integer icand = 1; icand <= numberOfCandidates; icand ++)
+			counts [icand] += streamCounts [istream] [icand];
+}
+
 bool OTGrammar_isCandidateGrammatical (OTGrammar me, integer itab, integer icand) {
 	for (integer jcand = 1; jcand <= my tableaus [itab]. numberOfCandidates; jcand ++)
 		if (jcand != icand && OTGrammar_compareCandidates (me, itab, jcand, itab, icand) < 0)
@@ -1079,6 +1460,13 @@ autoDistributions OTGrammar_to_Distribution (OTGrammar me, integer trialsPerInpu
 			Create the distribution. One row for every output form.
 		*/
 		autoDistributions thee = Distributions_create (totalNumberOfOutputs, 1);
+		const bool evaluateInGrammar = ( Melder_debug == 69 );
+		OTGrammar_CompiledTableaus compiled;
+		OTGrammar_Evaluator evaluators [1 + OTGrammar_NUMBER_OF_RANDOM_STREAMS];
+		if (! evaluateInGrammar) {
+			OTGrammar_compileTableaus (me, & compiled);
+			OTGrammar_initEvaluators (me, & compiled, evaluators);
+		}
 		/*
 			Measure every input form.
 		*/
@@ -1097,10 +1485,15 @@ autoDistributions OTGrammar_to_Distribution (OTGrammar me, integer trialsPerInpu
 			/*
 				Compute a number of outputs and store the results.
 			*/
-			for (integer itrial = 1; itrial <= trialsPerInput; itrial ++) {
-				OTGrammar_newDisharmonies (me, noise);
-				integer iwinner = OTGrammar_getWinner (me, itab);
-				thy data [nout + iwinner] [1] += 1;
+			if (evaluateInGrammar) {
+				for (integer itrial = 1; itrial <= trialsPerInput; itrial ++) {
+					OTGrammar_newDisharmonies (me, noise);
+					integer iwinner = OTGrammar_getWinner (me, itab);
+					thy data [nout + iwinner] [1] += 1;
+				}
+			} else {
+				OTGrammar_countWinners (me, & compiled, evaluators, itab, trialsPerInput, noise,
+						thy data.column (1). part (nout + 1, nout + tableau -> numberOfCandidates));
 			}
 			/*
 				Update the offset.
@@ -1120,6 +1513,15 @@ autoPairDistribution OTGrammar_to_PairDistribution (OTGrammar me, integer trials
 			Create the distribution. One row for every output form.
 		*/
 		autoPairDistribution thee = PairDistribution_create ();
+		const bool evaluateInGrammar = ( Melder_debug == 69 );
+		OTGrammar_CompiledTableaus compiled;
+		OTGrammar_Evaluator evaluators [1 + OTGrammar_NUMBER_OF_RANDOM_STREAMS];
+		autoVEC counts;
+		if (! evaluateInGrammar) {
+			OTGrammar_compileTableaus (me, & compiled);
+			OTGrammar_initEvaluators (me, & compiled, evaluators);
+			counts = newVECraw (compiled. maximumNumberOfCandidates);
+		}
 		/*
 			Measure every input form.
 		*/
@@ -1136,10 +1538,18 @@ autoPairDistribution OTGrammar_to_PairDistribution (OTGrammar me, integer trials
 			/*
 				Compute a number of outputs and store the results.
 			*/
-			for (integer itrial = 1; itrial <= trialsPerInput; itrial ++) {
-				OTGrammar_newDisharmonies (me, noise);
-				integer iwinner = OTGrammar_getWinner (me, itab);
-				thy pairs.at [nout + iwinner] -> weight += 1.0;
+			if (evaluateInGrammar) {
+				for (integer itrial = 1; itrial <= trialsPerInput; itrial ++) {
+					OTGrammar_newDisharmonies (me, noise);
+					integer iwinner = OTGrammar_getWinner (me, itab);
+					thy pairs.at [nout + iwinner] -> weight += 1.0;
+				}
+			} else {
+				VEC tableauCounts = counts.part (1, tableau -> numberOfCandidates);
+				tableauCounts <<= 0.0;
+				OTGrammar_countWinners (me, & compiled, evaluators, itab, trialsPerInput, noise, tableauCounts);
+				for (integer icand = 1; icand <= tableau -> numberOfCandidates; icand ++)
+					thy pairs.at [nout + icand] -> weight += tableauCounts [icand];
 			}
 			/*
 				Update the offset.
@@ -1760,6 +2170,30 @@ void OTGrammar_learnOne (OTGrammar me, conststring32 input, conststring32 adultO
 	}
 }
 
+/*
+	OTGrammar_learnOne () for a datum whose tableau and adult candidate have been looked up beforehand,
+	evaluated through the compiled tableaus.
+*/
+static void OTGrammar_learnOne_compiled (OTGrammar me, OTGrammar_CompiledTableaus *compiled, OTGrammar_Evaluator *evaluator,
+	integer itab, integer iadult, conststring32 adultOutput,
+	double evaluationNoise, enum kOTGrammar_rerankingStrategy updateRule, bool honourLocalRankings,
+	double plasticity, double relativePlasticityNoise)
+{
+	try {
+		OTGrammar_newDisharmonies (me, evaluationNoise);
+		OTGrammar_Evaluator_takeDisharmonies (me, evaluator);
+		const integer iwinner = OTGrammar_Evaluator_getWinner (me, compiled, evaluator, itab);
+		if (str32equ (my tableaus [itab]. candidates [iwinner]. output.get(), adultOutput))
+			return;
+		if (iadult == 0)
+			Melder_throw (U"Cannot generate adult output \"", adultOutput, U"\".");
+		OTGrammar_modifyRankings (me, itab, iwinner, iadult, updateRule, honourLocalRankings,
+			plasticity, relativePlasticityNoise, true, nullptr);
+	} catch (MelderError) {
+		Melder_throw (me, U": not learned from input \"", my tableaus [itab]. input.get(), U"\" and adult output \"", adultOutput, U"\".");
+	}
+}
+
 void OTGrammar_learn (OTGrammar me, Strings inputs, Strings outputs,
 	double evaluationNoise, enum kOTGrammar_rerankingStrategy updateRule, bool honourLocalRankings,
 	double plasticity, double relativePlasticityNoise, integer numberOfChews)
@@ -1788,6 +2222,15 @@ void OTGrammar_PairDistribution_learn (OTGrammar me, PairDistribution thee,
 {
 	integer idatum = 0, numberOfData = numberOfPlasticities * replicationsPerPlasticity;
 	try {
+		const bool evaluateInGrammar = ( Melder_debug == 69 );
+		OTGrammar_CompiledTableaus compiled;
+		OTGrammar_Evaluator evaluator;
+		OTGrammar_PairSampler sampler;
+		if (! evaluateInGrammar) {
+			OTGrammar_compileTableaus (me, & compiled);
+			OTGrammar_initEvaluator (me, & compiled, & evaluator, 0);
+			OTGrammar_PairDistribution_initSampler (me, thee, & sampler);
+		}
 		double plasticity = initialPlasticity;
 		autoMelderMonitor monitor (U"Learning with full knowledge...");
 		if (monitor.graphics())
@@ -1795,7 +2238,14 @@ void OTGrammar_PairDistribution_learn (OTGrammar me, PairDistribution thee,
 		for (integer iplasticity = 1; iplasticity <= numberOfPlasticities; iplasticity ++) {
 			for (integer ireplication = 1; ireplication <= replicationsPerPlasticity; ireplication ++) {
 				conststring32 input, output;
-				PairDistribution_peekPair (thee, & input, & output);
+				integer ipair = 0;
+				if (evaluateInGrammar) {
+					PairDistribution_peekPair (thee, & input, & output);
+				} else {
+					ipair = OTGrammar_PairSampler_draw (& sampler, 0);
+					input = thy pairs.at [ipair] -> string1.get();
+					output = thy pairs.at [ipair] -> string2.get();
+				}
 				++ idatum;
 				if (monitor.graphics() && idatum % (numberOfData / 400 + 1) == 0) {
 					Graphics_beginMovieFrame (monitor.graphics(), nullptr);
@@ -1812,10 +2262,86 @@ void OTGrammar_PairDistribution_learn (OTGrammar me, PairDistribution thee,
 					U"Processing input-output pair ", idatum,
 					U" out of ", numberOfData, U": ", input, U" -> ", output);
 				for (integer ichew = 1; ichew <= numberOfChews; ichew ++) {
-					OTGrammar_learnOne (me, input, output,
-							evaluationNoise, updateRule, honourLocalRankings,
-							plasticity, relativePlasticityNoise, true, true, nullptr);
+					if (evaluateInGrammar)
+						OTGrammar_learnOne (me, input, output,
+								evaluationNoise, updateRule, honourLocalRankings,
+								plasticity, relativePlasticityNoise, true, true, nullptr);
+					else
+						OTGrammar_learnOne_compiled (me, & compiled, & evaluator,
+								sampler. tableau [ipair], sampler. adultCandidate [ipair], output,
+								evaluationNoise, updateRule, honourLocalRankings,
+								plasticity, relativePlasticityNoise);
+				}
+			}
+			plasticity *= plasticityDecrement;
+		}
+	} catch (MelderError) {
+		if (idatum > 1)
+			Melder_appendError (U"Only ", idatum - 1, U" input-output pairs out of ", numberOfData, U" were processed.");
+		Melder_throw (me, U": did not complete learning from ", thee, U".");
+	}
+}
+
+void OTGrammar_PairDistribution_learnInBatches (OTGrammar me, PairDistribution thee,
+	double evaluationNoise, enum kOTGrammar_rerankingStrategy updateRule, bool honourLocalRankings,
+	double initialPlasticity, integer replicationsPerPlasticity, double plasticityDecrement,
+	integer numberOfPlasticities, double relativePlasticityNoise, integer batchSize)
+{
+	integer idatum = 0, numberOfData = numberOfPlasticities * replicationsPerPlasticity;
+	try {
+		Melder_require (batchSize >= 1,
+			U"The batch size should be positive.");
+		OTGrammar_CompiledTableaus compiled;
+		OTGrammar_compileTableaus (me, & compiled);
+		OTGrammar_Evaluator evaluators [1 + OTGrammar_NUMBER_OF_RANDOM_STREAMS];
+		OTGrammar_initEvaluators (me, & compiled, evaluators);
+		OTGrammar_PairSampler sampler;
+		OTGrammar_PairDistribution_initSampler (me, thee, & sampler);
+		batchSize = std::min (batchSize, replicationsPerPlasticity);
+		autoINTVEC pairs = newINTVECraw (batchSize), winners = newINTVECraw (batchSize);
+		autoMAT disharmonies = newMATraw (batchSize, my numberOfConstraints);
+		double plasticity = initialPlasticity;
+		autoMelderMonitor monitor (U"Learning with full knowledge, in batches...");
+		for (integer iplasticity = 1; iplasticity <= numberOfPlasticities; iplasticity ++) {
+			for (integer firstReplication = 1; firstReplication <= replicationsPerPlasticity; firstReplication += batchSize) {
+				const integer numberOfDataInBatch = std::min (batchSize, replicationsPerPlasticity - firstReplication + 1);
+				for (integer ibatch = 1; ibatch <= numberOfDataInBatch; ibatch ++)
+					pairs [ibatch] = OTGrammar_PairSampler_draw (& sampler, 0);
+				/*
+					Evaluate all the data of the batch with the rankings as they are at the start of the batch.
+				*/
+				OTGrammar_runOnRandomStreams (numberOfDataInBatch, [&] (integer istream) {
+					OTGrammar_Evaluator *evaluator = & evaluators [istream];
+					integer firstDatum, lastDatum;
+					MelderThread_getRange (numberOfDataInBatch, OTGrammar_NUMBER_OF_RANDOM_STREAMS, istream, & firstDatum, & lastDatum);
+					for (integer ibatch = firstDatum; ibatch <= lastDatum; ibatch ++) {
+						OTGrammar_Evaluator_newDisharmonies (me, evaluator, evaluationNoise);
+						winners [ibatch] = OTGrammar_Evaluator_getWinner (me, & compiled, evaluator, sampler. tableau [pairs [ibatch]]);
+						disharmonies [ibatch] <<= evaluator -> disharmonies.all();
+					}
+				});
+				/*
+					Learn from the errors, in the order of the data.
+				*/
+				for (integer ibatch = 1; ibatch <= numberOfDataInBatch; ibatch ++) {
+					++ idatum;
+					const integer ipair = pairs [ibatch], itab = sampler. tableau [ipair];
+					const conststring32 adultOutput = thy pairs.at [ipair] -> string2.get();
+					if (str32equ (my tableaus [itab]. candidates [winners [ibatch]]. output.get(), adultOutput))
+						continue;
+					if (sampler. adultCandidate [ipair] == 0)
+						Melder_throw (U"Input \"", my tableaus [itab]. input.get(), U"\": cannot generate adult output \"", adultOutput, U"\".");
+					/*
+						Some update rules look at the constraint order in which the datum was evaluated.
+					*/
+					for (integer icons = 1; icons <= my numberOfConstraints; icons ++)
+						my constraints [icons]. disharmony = disharmonies [ibatch] [icons];
+					OTGrammar_sort (me);
+					OTGrammar_modifyRankings (me, itab, winners [ibatch], sampler. adultCandidate [ipair], updateRule, honourLocalRankings,
+						plasticity, relativePlasticityNoise, true, nullptr);
 				}
+				Melder_monitor ((double) idatum / numberOfData,
+					U"Processed input-output pair ", idatum, U" out of ", numberOfData, U".");
 			}
 			plasticity *= plasticityDecrement;
 		}
@@ -2339,16 +2865,41 @@ double OTGrammar_PairDistribution_getFractionCorrect (OTGrammar me, PairDistribu
 {
 	try {
 		integer numberOfCorrect = 0;
-		for (integer ireplication = 1; ireplication <= numberOfInputs; ireplication ++) {
-			conststring32 input, adultOutput;
-			PairDistribution_peekPair (thee, & input, & adultOutput);
-			OTGrammar_newDisharmonies (me, evaluationNoise);
-			integer inputTableau = OTGrammar_getTableau (me, input);
-			const integer ilearnerCandidate = OTGrammar_getWinner (me, inputTableau);
-			OTGrammarCandidate learnerCandidate = & my tableaus [inputTableau]. candidates [ilearnerCandidate];
-			if (str32equ (learnerCandidate -> output.get(), adultOutput))
-				numberOfCorrect ++;
-		}
+		if (Melder_debug == 69) {
+			for (integer ireplication = 1; ireplication <= numberOfInputs; ireplication ++) {
+				conststring32 input, adultOutput;
+				PairDistribution_peekPair (thee, & input, & adultOutput);
+				OTGrammar_newDisharmonies (me, evaluationNoise);
+				integer inputTableau = OTGrammar_getTableau (me, input);
+				const integer ilearnerCandidate = OTGrammar_getWinner (me, inputTableau);
+				OTGrammarCandidate learnerCandidate = & my tableaus [inputTableau]. candidates [ilearnerCandidate];
+				if (str32equ (learnerCandidate -> output.get(), adultOutput))
+					numberOfCorrect ++;
+			}
+			return (double) numberOfCorrect / numberOfInputs;
+		}
+		OTGrammar_CompiledTableaus compiled;
+		OTGrammar_compileTableaus (me, & compiled);
+		OTGrammar_Evaluator evaluators [1 + OTGrammar_NUMBER_OF_RANDOM_STREAMS];
+		OTGrammar_initEvaluators (me, & compiled, evaluators);
+		OTGrammar_PairSampler sampler;
+		OTGrammar_PairDistribution_initSampler (me, thee, & sampler);
+		autoINTVEC numbersOfCorrect = newINTVECzero (OTGrammar_NUMBER_OF_RANDOM_STREAMS);
+		OTGrammar_runOnRandomStreams (numberOfInputs, [&] (integer istream) {
+			OTGrammar_Evaluator *evaluator = & evaluators [istream];
+			integer firstReplication, lastReplication;
+			MelderThread_getRange (numberOfInputs, OTGrammar_NUMBER_OF_RANDOM_STREAMS, istream, & firstReplication, & lastReplication);
+			for (integer ireplication = firstReplication; ireplication <= lastReplication; ireplication ++) {
+				const integer ipair = OTGrammar_PairSampler_draw (& sampler, int (istream));
+				const integer inputTableau = sampler. tableau [ipair];
+				OTGrammar_Evaluator_newDisharmonies (me, evaluator, evaluationNoise);
+				const integer ilearnerCandidate = OTGrammar_Evaluator_getWinner (me, & compiled, evaluator, inputTableau);
+				if (str32equ (my tableaus [inputTableau]. candidates [ilearnerCandidate]. output.get(), thy pairs.at [ipair] -> string2.get()))
+					numbersOfCorrect [istream] ++;
+			}
+		});
+		for (integer istream = 1; istream <= OTGrammar_NUMBER_OF_RANDOM_STREAMS; istream ++)
+			numberOfCorrect += numbersOfCorrect [istream];
 		return (double) numberOfCorrect / numberOfInputs;
 	} catch (MelderError) {
 		Melder_throw (me, U" & ", thee, U": fraction correct not computed.");
@@ -2360,6 +2911,43 @@ integer OTGrammar_PairDistribution_getMinimumNumberCorrect (OTGrammar me, PairDi
 {
 	try {
 		integer minimumNumberCorrect = numberOfReplications;
+		if (Melder_debug != 69) {
+			OTGrammar_CompiledTableaus compiled;
+			OTGrammar_compileTableaus (me, & compiled);
+			OTGrammar_Evaluator evaluators [1 + OTGrammar_NUMBER_OF_RANDOM_STREAMS];
+			OTGrammar_initEvaluators (me, & compiled, evaluators);
+			OTGrammar_PairSampler sampler;
+			OTGrammar_PairDistribution_initSampler (me, thee, & sampler);
+			const integer numberOfPairs = thy pairs.size;
+			autoINTMAT numbersOfCorrect = newINTMATzero (OTGrammar_NUMBER_OF_RANDOM_STREAMS, numberOfPairs);
+			OTGrammar_runOnRandomStreams (numberOfPairs * numberOfReplications, [&] (integer istream) {
+				OTGrammar_Evaluator *evaluator = & evaluators [istream];
+				integer firstReplication, lastReplication;
+				MelderThread_getRange (numberOfReplications, OTGrammar_NUMBER_OF_RANDOM_STREAMS, istream, & firstReplication, & lastReplication);
+				for (integer ipair = 1; ipair <= numberOfPairs; ipair ++) {
+					const integer inputTableau = sampler. tableau [ipair];
+					if (inputTableau == 0)
+						continue;   // zero weight
+					const conststring32 adultOutput = thy pairs.at [ipair] -> string2.get();
+					for (integer ireplication = firstReplication; ireplication <= lastReplication; ireplication ++) {
+						OTGrammar_Evaluator_newDisharmonies (me, evaluator, evaluationNoise);
+						const integer ilearnerCandidate = OTGrammar_Evaluator_getWinner (me, & compiled, evaluator, inputTableau);
+						if (str32equ (my tableaus [inputTableau]. candidates [ilearnerCandidate]. output.get(), adultOutput))
+							numbersOfCorrect [istream] [ipair] ++;
+					}
+				}
+			});
+			for (integer ipair = 1; ipair <= numberOfPairs; ipair ++) {
+				if (sampler. tableau [ipair] == 0)
+					continue;
+				integer numberOfCorrect = 0;
+				for (integer istream = 1; istream <= OTGrammar_NUMBER_OF_RANDOM_STREAMS; istream ++)
+					numberOfCorrect += numbersOfCorrect [istream] [ipair];
+				if (numberOfCorrect < minimumNumberCorrect)
+					minimumNumberCorrect = numberOfCorrect;
+			}
+			return minimumNumberCorrect;
+		}
 		for (integer ipair = 1; ipair <= thy pairs.size; ipair ++) {
 			PairProbability prob = thy pairs.at [ipair];
 			if (prob -> weight > 0.0) {
@@ -100,6 +100,16 @@ void OTGrammar_PairDistribution_learn (OTGrammar me, PairDistribution thee,
 	double evaluationNoise, enum kOTGrammar_rerankingStrategy updateRule, bool honourLocalRankings,
 	double initialPlasticity, integer replicationsPerPlasticity, double plasticityDecrement,
 	integer numberOfPlasticities, double relativePlasticityNoise, integer numberOfChews);
+void OTGrammar_PairDistribution_learnInBatches (OTGrammar me, PairDistribution thee,
+	double evaluationNoise, enum kOTGrammar_rerankingStrategy updateRule, bool honourLocalRankings,
+	double initialPlasticity, integer replicationsPerPlasticity, double plasticityDecrement,
+	integer numberOfPlasticities, double relativePlasticityNoise, integer batchSize);
+	/*
+		Like OTGrammar_PairDistribution_learn () with one chew, except that the data come in batches
+		that are evaluated in parallel, each with the rankings as they were at the start of the batch;
+		the rankings are then updated from the errors, in the order of the data.
+		With a batch size of 1, this is ordinary on-line learning.
+	*/
 bool OTGrammar_PairDistribution_findPositiveWeights (OTGrammar me, PairDistribution thee, double weightFloor, double marginOfSeparation);
 void OTGrammar_learnOneFromPartialOutput (OTGrammar me, conststring32 partialAdultOutput,
 	double rankingSpreading, enum kOTGrammar_rerankingStrategy updateRule, bool honourLocalRankings,
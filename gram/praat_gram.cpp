@@ -345,6 +345,16 @@ DO
 	MODIFY_EACH_END
 }
 
+FORM (NEW1_Network_PatternList_to_ActivationList, U"Network & PatternList: To ActivationList", nullptr) {
+	NATURAL (fromNode, U"From node", U"1")
+	NATURAL (numberOfSteps, U"Number of steps", U"20")
+	OK
+DO
+	CONVERT_TWO (Network, PatternList)
+		autoActivationList result = Network_PatternList_to_ActivationList (me, you, fromNode, numberOfSteps);
+	CONVERT_TWO_END (my name.get(), U"_", your name.get())
+}
+
 DIRECT (MODIFY_Network_updateWeights) {
 	MODIFY_EACH (Network)
 		Network_updateWeights (me);
@@ -1198,6 +1208,27 @@ DO
 	MODIFY_FIRST_OF_TWO_WEAK_END
 }
 
+FORM (MODIFY_OTGrammar_PairDistribution_learnInBatches, U"OTGrammar & PairDistribution: Learn in batches", U"OT learning 6. Shortcut to grammar learning") {
+	REAL (evaluationNoise, U"Evaluation noise", U"2.0")
+	OPTIONMENU_ENUM (kOTGrammar_rerankingStrategy, updateRule,
+			U"Update rule", kOTGrammar_rerankingStrategy::SYMMETRIC_ALL)
+	POSITIVE (initialPlasticity, U"Initial plasticity", U"1.0")
+	NATURAL (replicationsPerPlasticity, U"Replications per plasticity", U"100000")
+	REAL (plasticityDecrement, U"Plasticity decrement", U"0.1")
+	NATURAL (numberOfPlasticities, U"Number of plasticities", U"4")
+	REAL (relativePlasticitySpreading, U"Rel. plasticity spreading", U"0.1")
+	BOOLEAN (honourLocalRankings, U"Honour local rankings", true)
+	NATURAL (batchSize, U"Batch size", U"1000")
+	OK
+DO
+	MODIFY_FIRST_OF_TWO_WEAK (OTGrammar, PairDistribution)
+		OTGrammar_PairDistribution_learnInBatches (me, you,
+			evaluationNoise, updateRule, honourLocalRankings,
+			initialPlasticity, replicationsPerPlasticity,
+			plasticityDecrement, numberOfPlasticities, relativePlasticitySpreading, batchSize);
+	MODIFY_FIRST_OF_TWO_WEAK_END
+}
+
 DIRECT (LIST_OTGrammar_PairDistribution_listObligatoryRankings) {
 	FIND_TWO (OTGrammar, PairDistribution)
 		OTGrammar_PairDistribution_listObligatoryRankings (me, you);
@@ -1878,6 +1909,7 @@ void praat_uvafon_gram_init () {
 	praat_addAction2 (classOTGrammar, 1, classDistributions, 1, U"Get fraction correct...", nullptr, 0, REAL_MODIFY_OTGrammar_Distributions_getFractionCorrect);
 	praat_addAction2 (classOTGrammar, 1, classDistributions, 1, U"List obligatory rankings...", nullptr, praat_HIDDEN, LIST_OTGrammar_Distributions_listObligatoryRankings);
 	praat_addAction2 (classOTGrammar, 1, classPairDistribution, 1, U"Learn...", nullptr, 0, MODIFY_OTGrammar_PairDistribution_learn);
+	praat_addAction2 (classOTGrammar, 1, classPairDistribution, 1, U"Learn in batches...", nullptr, 0, MODIFY_OTGrammar_PairDistribution_learnInBatches);
 	praat_addAction2 (classOTGrammar, 1, classPairDistribution, 1, U"Find positive weights...", nullptr, 0, MODIFY_OTGrammar_PairDistribution_findPositiveWeights);
 	praat_addAction2 (classOTGrammar, 1, classPairDistribution, 1, U"Get fraction correct...", nullptr, 0, REAL_MODIFY_OTGrammar_PairDistribution_getFractionCorrect);
 	praat_addAction2 (classOTGrammar, 1, classPairDistribution, 1, U"Get minimum number correct...", nullptr, 0, INTEGER_MODIFY_OTGrammar_PairDistribution_getMinimumNumberCorrect);
@@ -1945,6 +1977,7 @@ void praat_uvafon_gram_init () {
 	praat_addAction2 (classNet, 1, classPatternList, 1, U"Learn by layer...", nullptr, 0, MODIFY_Net_PatternList_learnByLayer);
 	praat_addAction2 (classNet, 1, classPatternList, 1, U"Learn (two phases)...", nullptr, 0, MODIFY_Net_PatternList_learn_twoPhases);
 	praat_addAction2 (classNet, 1, classPatternList, 1, U"To ActivationList", nullptr, 0, NEW1_Net_PatternList_to_ActivationList);
+	praat_addAction2 (classNetwork, 1, classPatternList, 1, U"To ActivationList...", nullptr, 0, NEW1_Network_PatternList_to_ActivationList);
 
 	praat_addAction1 (classNoulliGrid, 1, U"View & Edit", nullptr, praat_ATTRACTIVE, WINDOW_NoulliGrid_viewAndEdit);
 	praat_addAction2 (classNoulliGrid, 1, classSound, 1, U"View & Edit", nullptr, praat_ATTRACTIVE, WINDOW_NoulliGrid_viewAndEdit);
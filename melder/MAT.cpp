@@ -17,9 +17,17 @@
  */
 
 #include "melder.h"
+#include "melder_thread.h"
 #include "../dwsys/NUM2.h"
 //#include "../external/gsl/gsl_blas.h"
 
+#if defined (__GNUC__) && (defined (__x86_64__) || defined (__i386__))
+	#define MATmul_blocked_HAS_X86_KERNELS  1
+	#include <immintrin.h>
+#else
+	#define MATmul_blocked_HAS_X86_KERNELS  0
+#endif
+
 #ifdef macintosh
 	#include <Accelerate/Accelerate.h>
 	#import <MetalPerformanceShaders/MetalPerformanceShaders.h>
@@ -466,6 +474,218 @@ void MATmul_fast_ (MATVU const& target, constMATVU const& x, constMATVU const& y
 	}
 }
 
+/*
+	Blocked matrix multiplication, after Goto & Van de Geijn (2008).
+
+	The columns of Y are cut into vertical panels of at most NC columns, the shared dimension into
+	slices of at most KC, and the rows of X into blocks of at most MC rows.
+	A KC x NC panel of Y is copied ("packed") into a contiguous buffer as a sequence of
+	micro-panels of NR columns, and an MC x KC block of X as a sequence of micro-panels of MR rows,
+	so that the innermost "microkernel" can compute an MR x NR tile of the target
+	with the whole tile in registers, while reading both of its operands sequentially.
+	The packing also takes care of any strides, so that X.Y, X'.Y, X.Y' and X'.Y' are equally fast.
+
+	The microkernel is chosen at run time: AVX-512 (8 x 16), AVX2 with FMA (4 x 8), or generic C (4 x 4).
+	The target is cut into bands of rows (or of columns, if there are more columns than rows),
+	and each band is computed in a separate thread.
+
+	Summation is in double precision, in slices of KC terms, so this is less precise
+	than the pairwise summation of MATmul_.
+*/
+constexpr integer MATmul_blocked_KC = 256, MATmul_blocked_MC = 128, MATmul_blocked_NC = 1024;
+constexpr integer MATmul_blocked_MAXIMUM_MR = 8, MATmul_blocked_MAXIMUM_NR = 16;
+
+typedef void (*MATmul_blocked_Kernel) (integer kc, const double *packedX, const double *packedY, double *tile);
+
+static void MATmul_blocked_kernel_generic (integer kc, const double *packedX, const double *packedY, double *tile) {
+	constexpr integer mr = 4, nr = 4;
+	double c [mr] [nr] = { };
+	for (integer k = 0; k < kc; k ++, packedX += mr, packedY += nr)
+		for (integer i = 0; i < mr; i ++)
+			for (integer j = 0; j < nr; j ++)
+				c [i] [j] += packedX [i] * packedY [j];
+	for (integer i = 0; i < mr; i ++)
+		for (integer j = 0; j < nr; j ++)
+			tile [i * nr + j] = c [i] [j];
+}
+
+#if MATmul_blocked_HAS_X86_KERNELS
+__attribute__ ((target ("avx2,fma")))
+static void MATmul_blocked_kernel_avx2 (integer kc, const double *packedX, const double *packedY, double *tile) {
+	constexpr integer mr = 4, nr = 8;
+	__m256d c [mr] [2];
+	for (integer i = 0; i < mr; i ++)
+		c [i] [0] = c [i] [1] = _mm256_setzero_pd ();
+	for (integer k = 0; k < kc; k ++, packedX += mr, packedY += nr) {
+		const __m256d y0 = _mm256_loadu_pd (packedY), y1 = _mm256_loadu_pd (packedY + 4);
+		for (integer i = 0; i < mr; i ++) {
+			const __m256d xi = _mm256_broadcast_sd (packedX + i);
+			c [i] [0] = _mm256_fmadd_pd (xi, y0, c [i] [0]);
+			c [i] [1] = _mm256_fmadd_pd (xi, y1, c [i] [1]);
+		}
+	}
+	for (integer i = 0; i < mr; i ++) {
+		_mm256_storeu_pd (tile + i * nr, c [i] [0]);
+		_mm256_storeu_pd (tile + i * nr + 4, c [i] [1]);
+	}
+}
+
+__attribute__ ((target ("avx512f")))
+static void MATmul_blocked_kernel_avx512 (integer kc, const double *packedX, const double *packedY, double *tile) {
+	constexpr integer mr = 8, nr = 16;
+	__m512d c [mr] [2];
+	for (integer i = 0; i < mr; i ++)
+		c [i] [0] = c [i] [1] = _mm512_setzero_pd ();
+	for (integer k = 0; k < kc; k ++, packedX += mr, packedY += nr) {
+		const __m512d y0 = _mm512_loadu_pd (packedY), y1 = _mm512_loadu_pd (packedY + 8);
+		for (integer i = 0; i < mr; i ++) {
+			const __m512d xi = _mm512_set1_pd (packedX [i]);
+			c [i] [0] = _mm512_fmadd_pd (xi, y0, c [i] [0]);
+			c [i] [1] = _mm512_fmadd_pd (xi, y1, c [i] [1]);
+		}
+	}
+	for (integer i = 0; i < mr; i ++) {
+		_mm512_storeu_pd (tile + i * nr, c [i] [0]);
+		_mm512_storeu_pd (tile + i * nr + 8, c [i] [1]);
+	}
+}
+#endif
+
+struct MATmul_blocked_Engine {
+	integer mr, nr;
+	MATmul_blocked_Kernel kernel;
+};
+
+static MATmul_blocked_Engine MATmul_blocked_chooseEngine () {
+	if (Melder_debug != 54) {
+		#if MATmul_blocked_HAS_X86_KERNELS
+			static const bool hasAvx512 = __builtin_cpu_supports ("avx512f");
+			static const bool hasAvx2 = __builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma");
+			if (hasAvx512)
+				return { 8, 16, MATmul_blocked_kernel_avx512 };
+			if (hasAvx2)
+				return { 4, 8, MATmul_blocked_kernel_avx2 };
+		#endif
+	}
+	return { 4, 4, MATmul_blocked_kernel_generic };
+}
+
+static void MATmul_blocked_packX (constMATVU const& x, integer firstRow, integer mc, integer firstK, integer kc, integer mr, double *packed) {
+	for (integer ir = 0; ir < mc; ir += mr) {
+		const integer numberOfRowsInPanel = std::min (mr, mc - ir);
+		for (integer k = 0; k < kc; k ++, packed += mr) {
+			const double *px = & x.firstCell [(firstRow - 1 + ir) * x.rowStride + (firstK - 1 + k) * x.colStride];
+			integer i = 0;
+			for (; i < numberOfRowsInPanel; i ++, px += x.rowStride)
+				packed [i] = *px;
+			for (; i < mr; i ++)
+				packed [i] = 0.0;
+		}
+	}
+}
+
+static void MATmul_blocked_packY (constMATVU const& y, integer firstK, integer kc, integer firstColumn, integer nc, integer nr, double *packed) {
+	for (integer jr = 0; jr < nc; jr += nr) {
+		const integer numberOfColumnsInPanel = std::min (nr, nc - jr);
+		for (integer k = 0; k < kc; k ++, packed += nr) {
+			const double *py = & y.firstCell [(firstK - 1 + k) * y.rowStride + (firstColumn - 1 + jr) * y.colStride];
+			integer j = 0;
+			for (; j < numberOfColumnsInPanel; j ++, py += y.colStride)
+				packed [j] = *py;
+			for (; j < nr; j ++)
+				packed [j] = 0.0;
+		}
+	}
+}
+
+static void MATmul_blocked_serial (MATVU const& target, constMATVU const& x, constMATVU const& y,
+	MATmul_blocked_Engine const& engine, double *packedX, double *packedY)
+{
+	const integer mr = engine.mr, nr = engine.nr;
+	double tile [MATmul_blocked_MAXIMUM_MR * MATmul_blocked_MAXIMUM_NR];
+	for (integer jc = 1; jc <= target.ncol; jc += MATmul_blocked_NC) {
+		const integer nc = std::min (MATmul_blocked_NC, target.ncol - jc + 1);
+		for (integer pc = 1; pc <= x.ncol; pc += MATmul_blocked_KC) {
+			const integer kc = std::min (MATmul_blocked_KC, x.ncol - pc + 1);
+			const bool accumulate = ( pc > 1 );
+			MATmul_blocked_packY (y, pc, kc, jc, nc, nr, packedY);
+			for (integer ic = 1; ic <= target.nrow; ic += MATmul_blocked_MC) {
+				const integer mc = std::min (MATmul_blocked_MC, target.nrow - ic + 1);
+				MATmul_blocked_packX (x, ic, mc, pc, kc, mr, packedX);
+				for (integer jr = 0; jr < nc; jr += nr) {
+					const integer numberOfColumnsInTile = std::min (nr, nc - jr);
+					for (integer ir = 0; ir < mc; ir += mr) {
+						const integer numberOfRowsInTile = std::min (mr, mc - ir);
+						engine.kernel (kc, packedX + ir * kc, packedY + jr * kc, tile);
+						for (integer i = 0; i < numberOfRowsInTile; i ++) {
+							double *ptarget = & target.firstCell [(ic - 1 + ir + i) * target.rowStride + (jc - 1 + jr) * target.colStride];
+							const double *ptile = & tile [i * nr];
+							if (accumulate)
+								for (integer j = 0; j < numberOfColumnsInTile; j ++, ptarget += target.colStride)
+									*ptarget += ptile [j];
+							else
+								for (integer j = 0; j < numberOfColumnsInTile; j ++, ptarget += target.colStride)
+									*ptarget = ptile [j];
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+void MATmul_fast_allowAllocation_ (MATVU const& target, constMATVU const& x, constMATVU const& y) {
+	/*
+		From size 100 on (a million multiplications), the blocked multithreaded multiplication
+		is tens of times faster than MATmul_fast_ for all four cases.
+	*/
+	if (double (target.nrow) * double (target.ncol) * double (x.ncol) > 1e6)
+		MATmul_blocked_ (target, x, y);
+	else
+		MATmul_fast_ (target, x, y);
+}
+
+void MATmul_blocked_ (MATVU const& target, constMATVU const& x, constMATVU const& y) {
+	if (target.nrow == 0 || target.ncol == 0)
+		return;
+	if (x.ncol == 0) {
+		target <<= 0.0;
+		return;
+	}
+	const MATmul_blocked_Engine engine = MATmul_blocked_chooseEngine ();
+	/*
+		Cut the target into bands of at least a few tiles,
+		with at least a million flops per band.
+	*/
+	const bool cutIntoRows = ( target.nrow >= target.ncol );
+	const integer numberOfTiles = ( cutIntoRows ? (target.nrow - 1) / engine.mr + 1 : (target.ncol - 1) / engine.nr + 1 );
+	const double flopsPerTile = 2.0 * double (x.ncol) * ( cutIntoRows ? engine.mr * target.ncol : engine.nr * target.nrow );
+	const integer minimumNumberOfTilesPerThread = std::max (4_integer, integer (1e6 / flopsPerTile) + 1);
+	const integer numberOfThreads = MelderThread_getNumberOfThreads (numberOfTiles, minimumNumberOfTilesPerThread);
+	/*
+		Each thread gets its own packing buffers, allocated here, in the calling thread.
+	*/
+	const integer packedXsize = MATmul_blocked_MC * MATmul_blocked_KC;
+	const integer packedYsize = MATmul_blocked_KC * (MATmul_blocked_NC + MATmul_blocked_MAXIMUM_NR);
+	autoVEC packedX = newVECraw (numberOfThreads * packedXsize);
+	autoVEC packedY = newVECraw (numberOfThreads * packedYsize);
+	MelderThread_run (numberOfThreads, [&] (integer ithread) {
+		integer firstTile, lastTile;
+		MelderThread_getRange (numberOfTiles, numberOfThreads, ithread, & firstTile, & lastTile);
+		double *threadPackedX = & packedX [1 + (ithread - 1) * packedXsize];
+		double *threadPackedY = & packedY [1 + (ithread - 1) * packedYsize];
+		if (cutIntoRows) {
+			const integer firstRow = (firstTile - 1) * engine.mr + 1, lastRow = std::min (lastTile * engine.mr, target.nrow);
+			MATmul_blocked_serial (target.part (firstRow, lastRow, 1, target.ncol), x.part (firstRow, lastRow, 1, x.ncol), y,
+					engine, threadPackedX, threadPackedY);
+		} else {
+			const integer firstColumn = (firstTile - 1) * engine.nr + 1, lastColumn = std::min (lastTile * engine.nr, target.ncol);
+			MATmul_blocked_serial (target.verticalBand (firstColumn, lastColumn), x, y.verticalBand (firstColumn, lastColumn),
+					engine, threadPackedX, threadPackedY);
+		}
+	});
+}
+
 void MATmul_forceMetal_ (MATVU const& target, constMATVU const& x, constMATVU const& y) {
 #ifdef macintosh
 	if (@available (macOS 10.13, *)) {
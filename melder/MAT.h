@@ -402,6 +402,39 @@ inline autoMAT newMATmul_fast (constMATVU const& x, constMATVU const& y) {
 	MATmul_fast (result.all(), x, y);
 	return result;
 }
+/*
+	Rough multiplication of large matrices: cache-blocked, multithreaded,
+	with a microkernel chosen at run time for the processor (AVX-512, AVX2, or generic).
+	Allocates packing buffers, so this function may not be thread-safe.
+*/
+extern void MATmul_blocked_ (MATVU const& target, constMATVU const& x, constMATVU const& y);
+inline void MATmul_blocked  (MATVU const& target, constMATVU const& x, constMATVU const& y) {
+	Melder_assert (target.nrow == x.nrow);
+	Melder_assert (target.ncol == y.ncol);
+	Melder_assert (x.ncol == y.nrow);
+	MATmul_blocked_ (target, x, y);
+}
+inline autoMAT newMATmul_blocked (constMATVU const& x, constMATVU const& y) {
+	autoMAT result = newMATraw (x.nrow, y.ncol);
+	MATmul_blocked (result.all(), x, y);
+	return result;
+}
+/*
+	The faster of MATmul_fast and MATmul_blocked, for callers that accept rough sums for large matrices.
+	Not for use in a MelderThread_run () job, because MATmul_blocked allocates and starts threads.
+*/
+extern void MATmul_fast_allowAllocation_ (MATVU const& target, constMATVU const& x, constMATVU const& y);
+inline void MATmul_fast_allowAllocation  (MATVU const& target, constMATVU const& x, constMATVU const& y) {
+	Melder_assert (target.nrow == x.nrow);
+	Melder_assert (target.ncol == y.ncol);
+	Melder_assert (x.ncol == y.nrow);
+	MATmul_fast_allowAllocation_ (target, x, y);
+}
+inline autoMAT newMATmul_fast_allowAllocation (constMATVU const& x, constMATVU const& y) {
+	autoMAT result = newMATraw (x.nrow, y.ncol);
+	MATmul_fast_allowAllocation (result.all(), x, y);
+	return result;
+}
 void MATmul_forceMetal_ (MATVU const& target, constMATVU const& x, constMATVU const& y);
 void MATmul_forceOpenCL_ (MATVU const& target, constMATVU const& x, constMATVU const& y);
 
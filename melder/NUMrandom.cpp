@@ -108,6 +108,7 @@ class NUMrandom_State { public:
 		and perhaps for generating reproducible sequences.
 	 */
 	uint64 init_genrand64 (uint64 seed) {
+		secondAvailable = false;   // otherwise the first Gaussian number would still come from the previous seed
 		array [0] = seed;
 		for (index = 1; index < NN; index ++) {
 			array [index] =
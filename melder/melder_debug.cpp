@@ -82,6 +82,22 @@ the behaviour of Praat will temporarily change in the following ways:
 51: compute sum, mean, stdev with two cycles, as in R (80 bits)
 (other numbers than 48-51: compute sum, mean, stdev with simple pairwise algorithm, base case 64 [80 bits])
 52: debug Discriminant_TableOfReal_to_ClassificationTable
+53: Formula: always run formulas on objects cell by cell, never vectorized
+54: MATmul_blocked_: use the generic microkernel, not the AVX2 or AVX-512 ones
+55: MelderThread_getNumberOfThreads: always one thread
+57: Sound_to_Cochleagram: compute frame by frame, with a Spectrum and an Excitation object per frame
+58: Sound_to_Cochleagram_edb: convolve with the sampled gammatones instead of filtering recursively
+59: Sound_to_MelSpectrogram, Sound_to_BarkSpectrogram, Sound_to_MFCC: compute frame by frame, with a Spectrum object per frame
+60: Sound_reduceNoise: compute frame by frame, with a Spectrum and a Sound object per frame
+61: Matrices_to_DTW: compute every distance with pow (), also for the city-block and Euclidean metrics
+62: NMF_improveFactorization_mu, NMF_improveFactorization_als: never use the sparse products, also for sparse data
+63: Sound_to_CrossCorrelationTableList: compute every table separately, lag by lag, instead of all lags from one FFT pass
+64: Sound_to_TextGrid_detectSilences: filter a copy of the whole sound; Intensity_to_TextGrid_detectSilences: cut the short intervals afterwards, instead of in one pass
+65: KlattGrid synthesis: compute the formant filter coefficients from the tiers at every sample, instead of at every 32nd sample with linear interpolation in between
+66: KlattGrid synthesis: compute the glottal flow with pow () at every sample, instead of from a table of the pulse shape
+67: FFNet: propagate and compute costs and derivatives pattern by pattern, instead of in blocks of patterns with one matrix product per layer
+68: Network_spreadActivities: go through the connections one by one, instead of through the adjacency lists of the nodes
+69: OTGrammar: evaluate the data one by one in the grammar itself, instead of through compiled tableaus, in parallel where possible
 181: read and write native-endian real64
 900: use DG Meta Serif Science instead of Palatino
 1264: Mac: Sound_record_fixedTime uses microphone "FW Solo (1264)"
@@ -0,0 +1,88 @@
+#ifndef _melder_thread_h_
+#define _melder_thread_h_
+/* melder_thread.h
+ *
+ * Copyright (C) 2014-2018,2020 Paul Boersma
+ *
+ * This code is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This code is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this work. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+	Multithreading that needs no Things, so that it can be used in the melder library itself.
+	sys/MelderThread.h includes this file.
+*/
+
+#include "melder.h"
+#include <thread>
+#include <vector>
+
+inline static integer MelderThread_getNumberOfProcessors () {
+	return uinteger_to_integer (std::thread::hardware_concurrency ());
+}
+
+/*
+	The number of threads that it makes sense to use for a job that consists of
+	`numberOfElements` independent pieces of work, if each thread should receive
+	at least `minimumNumberOfElementsPerThread` of them.
+	Melder_debug 55 switches multithreading off.
+*/
+inline static integer MelderThread_getNumberOfThreads (integer numberOfElements, integer minimumNumberOfElementsPerThread, integer maximumNumberOfThreads = 16) {
+	if (Melder_debug == 55)
+		return 1;
+	integer numberOfThreads = std::min (MelderThread_getNumberOfProcessors (), maximumNumberOfThreads);
+	numberOfThreads = std::min (numberOfThreads, numberOfElements / std::max (minimumNumberOfElementsPerThread, 1_integer));
+	return std::max (numberOfThreads, 1_integer);
+}
+
+/*
+	Call `func (ithread)` for ithread from 1 to numberOfThreads, all at the same time.
+	The last call is done in the calling thread.
+	Because Melder errors cannot cross thread boundaries, `func` should not throw;
+	all memory that `func` needs should be allocated beforehand (for each thread separately).
+*/
+template <typename Function>
+void MelderThread_run (integer numberOfThreads, Function const& func) {
+	if (numberOfThreads <= 1) {
+		func (1_integer);
+		return;
+	}
+	std::vector <std::thread> thread (integer_to_uinteger (numberOfThreads - 1));
+	try {
+		for (integer ithread = 1; ithread < numberOfThreads; ithread ++)
+			thread [integer_to_uinteger (ithread - 1)] = std::thread (func, ithread);
+		func (numberOfThreads);
+	} catch (...) {
+		for (integer ithread = 1; ithread < numberOfThreads; ithread ++)
+			if (thread [integer_to_uinteger (ithread - 1)]. joinable ())
+				thread [integer_to_uinteger (ithread - 1)]. join ();
+		throw;
+	}
+	for (integer ithread = 1; ithread < numberOfThreads; ithread ++)
+		thread [integer_to_uinteger (ithread - 1)]. join ();
+}
+
+/*
+	The elements that thread `ithread` (out of `numberOfThreads`) should handle,
+	if `numberOfElements` elements are to be divided as evenly as possible.
+*/
+inline static void MelderThread_getRange (integer numberOfElements, integer numberOfThreads, integer ithread,
+	integer *out_firstElement, integer *out_lastElement)
+{
+	const integer base = numberOfElements / numberOfThreads, remainder = numberOfElements % numberOfThreads;
+	*out_firstElement = 1 + (ithread - 1) * base + std::min (ithread - 1, remainder);
+	*out_lastElement = *out_firstElement + base - 1 + ( ithread <= remainder ? 1 : 0 );
+}
+
+/* End of file melder_thread.h */
+#endif
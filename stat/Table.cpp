@@ -20,6 +20,9 @@
 #include "NUM2.h"
 #include "Formula.h"
 #include "SSCP.h"
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
 
 #include "oo_DESTROY.h"
 #include "Table_def.h"
@@ -44,6 +47,17 @@ Thing_implement (TableRow, Daata, 0);
 
 Thing_implement (Table, Daata, 0);
 
+/*
+	What the `number` fields of the cells of a column contain (the transient `numericized` field of its header).
+	A column numericized as numbers stays so while rows are appended, inserted or removed
+	and while numbers or numeric strings are written into it,
+	so that building a table row by row does not have to parse the whole column again for every query.
+	The ranks of a column of strings are computed again after every change.
+*/
+static constexpr int16 Table_NOT_NUMERICIZED = 0;
+static constexpr int16 Table_NUMERICIZED_AS_NUMBERS = 1;   // every cell is numeric; an empty cell is undefined
+static constexpr int16 Table_NUMERICIZED_AS_RANKS = 2;   // the rank of each string among the distinct strings of the column
+
 void structTable :: v_info () {
 	our structDaata :: v_info ();
 	MelderInfo_writeLine (U"Number of rows: ", our rows.size);
@@ -61,6 +75,8 @@ double structTable :: v_getMatrix (integer rowNumber, integer columnNumber) {
 		return undefined;
 	if (columnNumber < 1 || columnNumber > our numberOfColumns)
 		return undefined;
+	if (our columnHeaders [columnNumber]. numericized == Table_NUMERICIZED_AS_NUMBERS)
+		return our rows.at [rowNumber] -> cells [columnNumber]. number;
 	conststring32 stringValue = our rows.at [rowNumber] -> cells [columnNumber]. string.get();
 	return stringValue ? Melder_atof (stringValue) : undefined;
 }
@@ -82,9 +98,20 @@ static autoTableRow TableRow_create (integer numberOfColumns) {
 	autoTableRow me = Thing_new (TableRow);
 	my numberOfColumns = numberOfColumns;
 	my cells = newvectorzero <structTableCell> (numberOfColumns);
+	for (integer icol = 1; icol <= numberOfColumns; icol ++)
+		my cells [icol]. number = undefined;   // the numeric value of an empty cell
 	return me;
 }
 
+/*
+	Adding or removing a row keeps a column of numbers numeric, but changes the ranks of a column of strings.
+*/
+static void Table_invalidateRanks (Table me) noexcept {
+	for (integer icol = 1; icol <= my numberOfColumns; icol ++)
+		if (my columnHeaders [icol]. numericized == Table_NUMERICIZED_AS_RANKS)
+			my columnHeaders [icol]. numericized = Table_NOT_NUMERICIZED;
+}
+
 void Table_initWithoutColumnNames (Table me, integer numberOfRows, integer numberOfColumns) {
 	if (numberOfColumns < 1)
 		Melder_throw (U"Cannot create table without columns.");
@@ -132,6 +159,7 @@ void Table_appendRow (Table me) {
 	try {
 		autoTableRow row = TableRow_create (my numberOfColumns);
 		my rows. addItem_move (row.move());
+		Table_invalidateRanks (me);
 	} catch (MelderError) {
 		Melder_throw (me, U": row not appended.");
 	}
@@ -158,8 +186,7 @@ void Table_removeRow (Table me, integer rowNumber) {
 			Melder_throw (me, U": cannot remove my only row.");
 		Table_checkSpecifiedRowNumberWithinRange (me, rowNumber);
 		my rows. removeItem (rowNumber);
-		for (integer icol = 1; icol <= my numberOfColumns; icol ++)
-			my columnHeaders [icol]. numericized = false;
+		Table_invalidateRanks (me);
 	} catch (MelderError) {
 		Melder_throw (me, U": row ", rowNumber, U" not removed.");
 	}
@@ -214,8 +241,7 @@ void Table_insertRow (Table me, integer rowNumber) {
 		/*
 			Strong exception safety, step 2: perform changes to me without any risk of error.
 		*/
-		for (integer icol = 1; icol <= my numberOfColumns; icol ++)
-			my columnHeaders [icol]. numericized = false;
+		Table_invalidateRanks (me);
 	} catch (MelderError) {
 		Melder_throw (me, U": row ", rowNumber, U" not inserted.");
 	}
@@ -253,7 +279,7 @@ void Table_insertColumn (Table me, integer columnNumber, conststring32 label /*
 			for (integer icol = 1; icol < columnNumber; icol ++)
 				thyRow -> cells [icol] = std::move (myRow -> cells [icol]);
 			Melder_assert (! thyRow -> cells [columnNumber]. string);
-			Melder_assert (thyRow -> cells [columnNumber]. number == 0.0);
+			Melder_assert (isundef (thyRow -> cells [columnNumber]. number));
 			for (integer icol = myRow -> numberOfColumns + 1; icol > columnNumber; icol --)
 				thyRow -> cells [icol] = std::move (myRow -> cells [icol - 1]);
 		}
@@ -312,6 +338,33 @@ integer Table_searchColumn (Table me, integer columnNumber, conststring32 value)
 	return 0;
 }
 
+static bool isStringNumeric (conststring32 cell) {
+	if (! cell)
+		return true;   // namely the value --undefined--
+	/*
+		Skip leading white space, in order to separately detect "?" and "--undefined--".
+	*/
+	Melder_skipHorizontalOrVerticalSpace (& cell);
+	if (cell [0] == U'\0')
+		return true;   // only white space: the value --undefined--
+	if (cell [0] == U'?' || str32nequ (cell, U"--undefined--", 13)) {
+		/*
+			See whether there is anything else besides "?" or "--undefined--" and white space.
+		*/
+		cell += ( cell [0] == U'?' ) ? 1 : 13;
+		Melder_skipHorizontalOrVerticalSpace (& cell);
+		return *cell == U'\0';   // only white space after the "?" or "--undefined--"
+	}
+	return Melder_isStringNumeric (cell);
+}
+
+/*
+	The numeric value of a string for which isStringNumeric() is true.
+*/
+static double numberFromNumericString (conststring32 string) {
+	return ! string || string [0] == U'\0' || (string [0] == U'?' && string [1] == U'\0') ? undefined : Melder_atof (string);
+}
+
 void Table_setStringValue (Table me, integer rowNumber, integer columnNumber, conststring32 value /* cattable */) {
 	try {
 		/*
@@ -324,8 +377,12 @@ void Table_setStringValue (Table me, integer rowNumber, integer columnNumber, co
 			Change without errors.
 		*/
 		TableRow row = my rows.at [rowNumber];
-		row -> cells [columnNumber]. string = newLabel.move();
-		my columnHeaders [columnNumber]. numericized = false;
+		TableCell cell = & row -> cells [columnNumber];
+		cell -> string = newLabel.move();
+		if (my columnHeaders [columnNumber]. numericized == Table_NUMERICIZED_AS_NUMBERS && isStringNumeric (cell -> string.get()))
+			cell -> number = numberFromNumericString (cell -> string.get());
+		else
+			my columnHeaders [columnNumber]. numericized = Table_NOT_NUMERICIZED;
 	} catch (MelderError) {
 		Melder_throw (me, U": string value not set.");
 	}
@@ -344,7 +401,10 @@ void Table_setNumericValue (Table me, integer rowNumber, integer columnNumber, d
 		*/
 		TableRow row = my rows.at [rowNumber];
 		row -> cells [columnNumber]. string = newLabel.move();
-		my columnHeaders [columnNumber]. numericized = false;
+		if (my columnHeaders [columnNumber]. numericized == Table_NUMERICIZED_AS_NUMBERS)
+			row -> cells [columnNumber]. number = ( isdefined (value) ? value : undefined );   // Melder_double() writes an exact round trip
+		else
+			my columnHeaders [columnNumber]. numericized = Table_NOT_NUMERICIZED;
 	} catch (MelderError) {
 		Melder_throw (me, U": numeric value not set.");
 	}
@@ -356,50 +416,20 @@ bool Table_isCellNumeric_ErrorFalse (Table me, integer rowNumber, integer column
 	if (columnNumber < 1 || columnNumber > my numberOfColumns)
 		return false;
 	const TableRow row = my rows.at [rowNumber];
-	conststring32 cell = row -> cells [columnNumber]. string.get();
-	if (! cell)
-		return true;   // namely the value --undefined--
-	/*
-		Skip leading white space, in order to separately detect "?" and "--undefined--".
-	*/
-	Melder_skipHorizontalOrVerticalSpace (& cell);
-	if (cell [0] == U'\0')
-		return true;   // only white space: the value --undefined--
-	if (cell [0] == U'?' || str32nequ (cell, U"--undefined--", 13)) {
-		/*
-			See whether there is anything else besides "?" or "--undefined--" and white space.
-		*/
-		cell += ( cell [0] == U'?' ) ? 1 : 13;
-		Melder_skipHorizontalOrVerticalSpace (& cell);
-		return *cell == U'\0';   // only white space after the "?" or "--undefined--"
-	}
-	return Melder_isStringNumeric (cell);
+	return isStringNumeric (row -> cells [columnNumber]. string.get());
 }
 
 bool Table_isColumnNumeric_ErrorFalse (Table me, integer columnNumber) {
 	if (columnNumber < 1 || columnNumber > my numberOfColumns)
 		return false;
+	if (my columnHeaders [columnNumber]. numericized == Table_NUMERICIZED_AS_NUMBERS)
+		return true;
 	for (integer irow = 1; irow <= my rows.size; irow ++)
 		if (! Table_isCellNumeric_ErrorFalse (me, irow, columnNumber))
 			return false;
 	return true;
 }
 
-static integer stringCompare_column;
-
-static int stringCompare_NoError (const void *first, const void *second) {
-	const TableRow me = * (TableRow *) first, thee = * (TableRow *) second;
-	const conststring32 firstString = my cells [stringCompare_column]. string.get();
-	const conststring32 secondString = thy cells [stringCompare_column]. string.get();
-	return str32cmp (firstString ? firstString : U"", secondString ? secondString : U"");
-}
-
-static void sortRowsByStrings_Assert (Table me, integer columnNumber) {
-	Melder_assert (columnNumber >= 1 && columnNumber <= my numberOfColumns);
-	stringCompare_column = columnNumber;
-	qsort (& my rows.at [1], (unsigned long) my rows.size, sizeof (TableRow), stringCompare_NoError);
-}
-
 static int indexCompare_NoError (const void *first, const void *second) {
 	TableRow me = * (TableRow *) first, thee = * (TableRow *) second;
 	if (my sortingIndex < thy sortingIndex)
@@ -413,6 +443,36 @@ static void sortRowsByIndex_NoError (Table me) {
 	qsort (& my rows.at [1], (unsigned long) my rows.size, sizeof (TableRow), indexCompare_NoError);
 }
 
+autoINTVEC Table_getStringRanks (Table me, integer columnNumber, integer *out_numberOfDistinctStrings) {
+	Melder_assert (columnNumber >= 1 && columnNumber <= my numberOfColumns);
+	const integer numberOfRows = my rows.size;
+	autoINTVEC ranks = newINTVECraw (numberOfRows);
+	/*
+		Intern the strings, so that only the distinct strings (usually a handful of factor levels) have to be sorted.
+		Provisionally, a cell gets the index of its string in order of first appearance.
+	*/
+	std::unordered_map <std::u32string_view, integer> indexOfString;
+	for (integer irow = 1; irow <= numberOfRows; irow ++) {
+		const conststring32 string = my rows.at [irow] -> cells [columnNumber]. string.get();
+		const integer newIndex = integer (indexOfString.size()) + 1;
+		ranks [irow] = indexOfString.emplace (string ? string : U"", newIndex). first -> second;
+	}
+	const integer numberOfDistinctStrings = integer (indexOfString.size());
+	autovector <conststring32> distinctStrings = newvectorraw <conststring32> (numberOfDistinctStrings);
+	for (const auto& [string, index] : indexOfString)
+		distinctStrings [index] = string.data();   // null-terminated, because it is a whole cell
+	autoINTVEC order = newINTVECraw (numberOfDistinctStrings);
+	INTVECindex (order.get(), constSTRVEC (distinctStrings.cells, numberOfDistinctStrings));   // in the order of Melder_cmp, as in a StringsIndex
+	autoINTVEC rankOfIndex = newINTVECraw (numberOfDistinctStrings);
+	for (integer irank = 1; irank <= numberOfDistinctStrings; irank ++)
+		rankOfIndex [order [irank]] = irank;
+	for (integer irow = 1; irow <= numberOfRows; irow ++)
+		ranks [irow] = rankOfIndex [ranks [irow]];
+	if (out_numberOfDistinctStrings)
+		*out_numberOfDistinctStrings = numberOfDistinctStrings;
+	return ranks;
+}
+
 void Table_numericize_Assert (Table me, integer columnNumber) {
 	Melder_assert (columnNumber >= 1 && columnNumber <= my numberOfColumns);
 	if (my columnHeaders [columnNumber]. numericized)
@@ -420,32 +480,15 @@ void Table_numericize_Assert (Table me, integer columnNumber) {
 	if (Table_isColumnNumeric_ErrorFalse (me, columnNumber)) {
 		for (integer irow = 1; irow <= my rows.size; irow ++) {
 			TableRow row = my rows.at [irow];
-			const conststring32 string = row -> cells [columnNumber]. string.get();
-			row -> cells [columnNumber]. number =
-					! string || string [0] == U'\0' || (string [0] == U'?' && string [1] == U'\0') ? undefined :
-					Melder_atof (string);
+			row -> cells [columnNumber]. number = numberFromNumericString (row -> cells [columnNumber]. string.get());
 		}
+		my columnHeaders [columnNumber]. numericized = Table_NUMERICIZED_AS_NUMBERS;
 	} else {
-		integer iunique = 0;
-		conststring32 previousString = nullptr;
-		for (integer irow = 1; irow <= my rows.size; irow ++) {
-			TableRow row = my rows.at [irow];
-			row -> sortingIndex = irow;
-		}
-		sortRowsByStrings_Assert (me, columnNumber);
-		for (integer irow = 1; irow <= my rows.size; irow ++) {
-			TableRow row = my rows.at [irow];
-			conststring32 string = row -> cells [columnNumber]. string.get();
-			if (! string)
-				string = U"";
-			if (! previousString || ! str32equ (string, previousString))
-				iunique ++;
-			row -> cells [columnNumber]. number = iunique;
-			previousString = string;
-		}
-		sortRowsByIndex_NoError (me);
+		autoINTVEC ranks = Table_getStringRanks (me, columnNumber, nullptr);
+		for (integer irow = 1; irow <= my rows.size; irow ++)
+			my rows.at [irow] -> cells [columnNumber]. number = ranks [irow];
+		my columnHeaders [columnNumber]. numericized = Table_NUMERICIZED_AS_RANKS;
 	}
-	my columnHeaders [columnNumber]. numericized = true;
 }
 
 static void Table_numericize_checkDefined (Table me, integer columnNumber) {
@@ -618,20 +661,35 @@ integer Table_drawRowFromDistribution (Table me, integer columnNumber) {
 	}
 }
 
-autoTable Table_extractRowsWhereColumn_number (Table me, integer columnNumber, kMelder_number which, double criterion) {
+autoTable Table_extractRows (Table me, constINTVEC const& rowNumbers) {
 	try {
-		Table_checkSpecifiedColumnNumberWithinRange (me, columnNumber);
-		Table_numericize_Assert (me, columnNumber);   // extraction should work even if cells are not defined
 		autoTable thee = Table_create (0, my numberOfColumns);
-		for (integer icol = 1; icol <= my numberOfColumns; icol ++)
+		for (integer icol = 1; icol <= my numberOfColumns; icol ++) {
 			thy columnHeaders [icol]. label = Melder_dup (my columnHeaders [icol]. label.get());
-		for (integer irow = 1; irow <= my rows.size; irow ++) {
-			TableRow row = my rows.at [irow];
-			if (Melder_numberMatchesCriterion (row -> cells [columnNumber]. number, which, criterion)) {
-				autoTableRow newRow = Data_copy (row);
-				thy rows. addItem_move (newRow.move());
-			}
+			if (my columnHeaders [icol]. numericized == Table_NUMERICIZED_AS_NUMBERS)
+				thy columnHeaders [icol]. numericized = Table_NUMERICIZED_AS_NUMBERS;   // the copied cells keep their numbers
+		}
+		for (integer i = 1; i <= rowNumbers.size; i ++) {
+			Table_checkSpecifiedRowNumberWithinRange (me, rowNumbers [i]);
+			autoTableRow newRow = Data_copy (my rows.at [rowNumbers [i]]);
+			thy rows. addItem_move (newRow.move());
 		}
+		return thee;
+	} catch (MelderError) {
+		Melder_throw (me, U": rows not extracted.");
+	}
+}
+
+autoTable Table_extractRowsWhereColumn_number (Table me, integer columnNumber, kMelder_number which, double criterion) {
+	try {
+		Table_checkSpecifiedColumnNumberWithinRange (me, columnNumber);
+		Table_numericize_Assert (me, columnNumber);   // extraction should work even if cells are not defined
+		autoINTVEC selectedRows = newINTVECraw (my rows.size);
+		integer numberOfSelectedRows = 0;
+		for (integer irow = 1; irow <= my rows.size; irow ++)
+			if (Melder_numberMatchesCriterion (my rows.at [irow] -> cells [columnNumber]. number, which, criterion))
+				selectedRows [++ numberOfSelectedRows] = irow;
+		autoTable thee = Table_extractRows (me, selectedRows.part (1, numberOfSelectedRows));
 		if (thy rows.size == 0)
 			Melder_warning (U"No row matches criterion.");
 		return thee;
@@ -643,19 +701,14 @@ autoTable Table_extractRowsWhereColumn_number (Table me, integer columnNumber, k
 autoTable Table_extractRowsWhereColumn_string (Table me, integer columnNumber, kMelder_string which, conststring32 criterion) {
 	try {
 		Table_checkSpecifiedColumnNumberWithinRange (me, columnNumber);
-		autoTable thee = Table_create (0, my numberOfColumns);
-		for (integer icol = 1; icol <= my numberOfColumns; icol ++)
-			thy columnHeaders [icol]. label = Melder_dup (my columnHeaders [icol]. label.get());
-		for (integer irow = 1; irow <= my rows.size; irow ++) {
-			TableRow row = my rows.at [irow];
-			if (Melder_stringMatchesCriterion (row -> cells [columnNumber]. string.get(), which, criterion, true)) {
-				autoTableRow newRow = Data_copy (row);
-				thy rows. addItem_move (newRow.move());
-			}
-		}
-		if (thy rows.size == 0) {
+		autoINTVEC selectedRows = newINTVECraw (my rows.size);
+		integer numberOfSelectedRows = 0;
+		for (integer irow = 1; irow <= my rows.size; irow ++)
+			if (Melder_stringMatchesCriterion (my rows.at [irow] -> cells [columnNumber]. string.get(), which, criterion, true))
+				selectedRows [++ numberOfSelectedRows] = irow;
+		autoTable thee = Table_extractRows (me, selectedRows.part (1, numberOfSelectedRows));
+		if (thy rows.size == 0)
 			Melder_warning (U"No row matches criterion.");
-		}
 		return thee;
 	} catch (MelderError) {
 		Melder_throw (me, U": rows not extracted.");
@@ -1053,26 +1106,42 @@ autoTable Table_transpose (Table me) {
 	}
 }
 
-static constINTVEC *cellCompare_columns;
-
-static int cellCompare (const void *first, const void *second) {
-	const TableRow me = * (TableRow *) first, thee = * (TableRow *) second;
-	const integer ncol = cellCompare_columns->size;
-	for (integer icol = 1; icol <= ncol; icol ++) {
-		const integer cellNumber = (*cellCompare_columns) [icol];
-		if (my cells [cellNumber]. number < thy cells [cellNumber]. number)
-			return -1;
-		if (my cells [cellNumber]. number > thy cells [cellNumber]. number)
-			return +1;
-	}
-	return 0;
-}
-
 void Table_sortRows_Assert (Table me, constINTVEC columns) {
 	for (integer icol = 1; icol <= columns.size; icol ++)
 		Table_numericize_Assert (me, columns [icol]);
-	cellCompare_columns = & columns;
-	qsort (& my rows.at [1], (unsigned long) my rows.size, sizeof (TableRow), cellCompare);
+	const integer numberOfRows = my rows.size, numberOfKeys = columns.size;
+	if (numberOfRows < 2 || numberOfKeys < 1)
+		return;
+	/*
+		Gather the keys into one contiguous matrix, so that comparing two rows does not have to visit their cells;
+		the sort is stable, so that rows with equal keys keep their order.
+	*/
+	autoMAT keys = newMATraw (numberOfRows, numberOfKeys);
+	for (integer irow = 1; irow <= numberOfRows; irow ++) {
+		const TableRow row = my rows.at [irow];
+		for (integer ikey = 1; ikey <= numberOfKeys; ikey ++)
+			keys [irow] [ikey] = row -> cells [columns [ikey]]. number;
+	}
+	autoINTVEC order = newINTVECraw (numberOfRows);
+	for (integer irow = 1; irow <= numberOfRows; irow ++)
+		order [irow] = irow;
+	std::stable_sort (order.begin(), order.end(),
+		[& keys, numberOfKeys] (integer first, integer second) {
+			const double *firstKeys = & keys [first] [1], *secondKeys = & keys [second] [1];
+			for (integer ikey = 0; ikey < numberOfKeys; ikey ++) {
+				if (firstKeys [ikey] < secondKeys [ikey])
+					return true;
+				if (firstKeys [ikey] > secondKeys [ikey])
+					return false;
+			}
+			return false;
+		}
+	);
+	autovector <TableRow> sortedRows = newvectorraw <TableRow> (numberOfRows);
+	for (integer irow = 1; irow <= numberOfRows; irow ++)
+		sortedRows [irow] = my rows.at [order [irow]];
+	for (integer irow = 1; irow <= numberOfRows; irow ++)
+		my rows.at [irow] = sortedRows [irow];
 }
 
 void Table_sortRows_string (Table me, conststring32 columns_string) {
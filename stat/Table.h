@@ -64,6 +64,12 @@ void Table_setNumericValue (Table me, integer row, integer column, double value)
 /* For optimizations only (e.g. conversion to Matrix or TableOfReal). */
 void Table_numericize_Assert (Table me, integer columnNumber);
 
+/*
+	The rank of the string in each cell of the column among the distinct strings of the column,
+	in the order of Melder_cmp (a null string counts as an empty string).
+*/
+autoINTVEC Table_getStringRanks (Table me, integer columnNumber, integer *out_numberOfDistinctStrings);
+
 double Table_getQuantile (Table me, integer column, double quantile);
 double Table_getMean (Table me, integer column);
 double Table_getMaximum (Table me, integer icol);
@@ -111,6 +117,7 @@ void Table_writeToSemicolonSeparatedFile (Table me, MelderFile file);
 autoTable Table_readFromTableFile (MelderFile file);
 autoTable Table_readFromCharacterSeparatedTextFile (MelderFile file, char32 separator, bool interpretQuotes);
 
+autoTable Table_extractRows (Table me, constINTVEC const& rowNumbers);
 autoTable Table_extractRowsWhereColumn_number (Table me, integer column, kMelder_number which, double criterion);
 autoTable Table_extractRowsWhereColumn_string (Table me, integer column, kMelder_string which, conststring32 criterion);
 autoTable Table_collapseRows (Table me, conststring32 factors_string, conststring32 columnsToSum_string,
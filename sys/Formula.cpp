@@ -5480,7 +5480,7 @@ static void do_MATmul_fast () {
 			U"In the function \"mul_fast##\", the number of columns of the first matrix and the number of rows of the second matrix should be equal, "
 			U"not ", xNcol, U" and ", yNrow, U"."
 		);
-		autoMAT result = newMATmul_fast (x->numericMatrix, y->numericMatrix);
+		autoMAT result = newMATmul_fast_allowAllocation (x->numericMatrix, y->numericMatrix);
 		pushNumericMatrix (result.move());
 	} else {
 		Melder_throw (U"The function \"mul_fast##\" requires two matrices, not ", x->whichText(), U" and ", y->whichText(), U".");
@@ -7069,4 +7069,318 @@ case NUMBER_: { pushNumber (f [programPointer]. content.number);
 	}
 }
 
+/*
+	Vectorized running.
+
+	A formula such as
+		self * 0.5 + sin (2 * pi * 440 * x)
+	refers only to self, x, y, row, col, numbers and numeric variables,
+	and combines these only with elementwise arithmetic and elementwise functions.
+	Such a formula can be run on a whole stretch of a row at a time,
+	which spares us the instruction dispatch and the stack handling for every single cell.
+	An element of the vectorized stack is either a number (if its value is the same
+	for all cells of the stretch) or a row of values, one for each cell of the stretch.
+	The results are identical to those of Formula_run (), cell by cell.
+*/
+
+#define Formula_VECTORIZED_BLOCK_SIZE  1024
+
+typedef struct structVectorizedStackel {
+	bool isNumber;
+	double number;
+	VEC values;   // a stretch of a row of `theVectorizedBuffers`; meaningful only if `isNumber` is false
+} *VectorizedStackel;
+
+static structVectorizedStackel theVectorizedStack [1 + Formula_MAXIMUM_STACK_SIZE];
+static integer vw, theVectorizedStackDepth;
+static autoMAT theVectorizedBuffers;
+
+static double vectorized_round (double x) { return floor (x + 0.5); }
+static double vectorized_floor (double x) { return Melder_roundDown (x); }
+static double vectorized_ceiling (double x) { return Melder_roundUp (x); }
+static double vectorized_rectify (double x) { return x > 0.0 ? x : 0.0; }
+static double vectorized_sqrt (double x) { return x < 0.0 ? undefined : sqrt (x); }
+static double vectorized_arcsin (double x) { return fabs (x) > 1.0 ? undefined : asin (x); }
+static double vectorized_arccos (double x) { return fabs (x) > 1.0 ? undefined : acos (x); }
+static double vectorized_log2 (double x) { return x <= 0.0 ? undefined : log (x) * NUMlog2e; }
+static double vectorized_ln (double x) { return x <= 0.0 ? undefined : log (x); }
+static double vectorized_log10 (double x) { return x <= 0.0 ? undefined : log10 (x); }
+
+/*
+	The functions of one numeric argument that have no side effects
+	(so e.g. not randomBernoulli, which would draw its random numbers in a different order).
+*/
+static double (*vectorizableFunction (int symbol)) (double) {
+	switch (symbol) {
+		case ABS_: return fabs;
+		case ROUND_: return vectorized_round;
+		case FLOOR_: return vectorized_floor;
+		case CEILING_: return vectorized_ceiling;
+		case RECTIFY_: return vectorized_rectify;
+		case SQRT_: return vectorized_sqrt;
+		case SIN_: return sin;
+		case COS_: return cos;
+		case TAN_: return tan;
+		case ARCSIN_: return vectorized_arcsin;
+		case ARCCOS_: return vectorized_arccos;
+		case ARCTAN_: return atan;
+		case SINC_: return NUMsinc;
+		case SINCPI_: return NUMsincpi;
+		case EXP_: return exp;
+		case SINH_: return sinh;
+		case COSH_: return cosh;
+		case TANH_: return tanh;
+		case ARCSINH_: return NUMarcsinh;
+		case ARCCOSH_: return NUMarccosh;
+		case ARCTANH_: return NUMarctanh;
+		case SIGMOID_: return NUMsigmoid;
+		case INV_SIGMOID_: return NUMinvSigmoid;
+		case ERF_: return NUMerf;
+		case ERFC_: return NUMerfcc;
+		case GAUSS_P_: return NUMgaussP;
+		case GAUSS_Q_: return NUMgaussQ;
+		case INV_GAUSS_Q_: return NUMinvGaussQ;
+		case LOG2_: return vectorized_log2;
+		case LN_: return vectorized_ln;
+		case LOG10_: return vectorized_log10;
+		case LN_GAMMA_: return NUMlnGamma;
+		case HERTZ_TO_BARK_: return NUMhertzToBark;
+		case BARK_TO_HERTZ_: return NUMbarkToHertz;
+		case PHON_TO_DIFFERENCE_LIMENS_: return NUMphonToDifferenceLimens;
+		case DIFFERENCE_LIMENS_TO_PHON_: return NUMdifferenceLimensToPhon;
+		case HERTZ_TO_MEL_: return NUMhertzToMel;
+		case MEL_TO_HERTZ_: return NUMmelToHertz;
+		case HERTZ_TO_SEMITONES_: return NUMhertzToSemitones;
+		case SEMITONES_TO_HERTZ_: return NUMsemitonesToHertz;
+		case ERB_: return NUMerb;
+		case HERTZ_TO_ERB_: return NUMhertzToErb;
+		case ERB_TO_HERTZ_: return NUMerbToHertz;
+		default: return nullptr;
+	}
+}
+
+bool Formula_isVectorizable () {
+	if (Melder_debug == 53)
+		return false;
+	if (theExpressionType [theLevel] != kFormula_EXPRESSION_TYPE_NUMERIC)
+		return false;
+	Daata me = theSource;
+	integer depth = 0, maximumDepth = 0;
+	for (int i = 1; i <= numberOfInstructions; i ++) {
+		const int symbol = parse [i]. symbol;
+		if (symbol == NUMBER_ || symbol == NUMERIC_VARIABLE_ || symbol == ROW_ || symbol == COL_) {
+			depth ++;
+		} else if (symbol == X_) {
+			if (! me || ! my v_hasGetX ())
+				return false;   // let Formula_run () complain
+			depth ++;
+		} else if (symbol == Y_) {
+			if (! me || ! my v_hasGetY ())
+				return false;
+			depth ++;
+		} else if (symbol == SELF0_) {
+			/*
+				Only for objects for which `self` means the cell [row, col] of the matrix,
+				i.e. not for objects that have a single cell.
+			*/
+			if (! me || my v_hasGetCell () || ! (my v_hasGetVector () || my v_hasGetMatrix ()))
+				return false;
+			depth ++;
+		} else if (symbol == ADD_ || symbol == SUB_ || symbol == MUL_ || symbol == RDIV_ ||
+			symbol == IDIV_ || symbol == MOD_ || symbol == POWER_)
+		{
+			if (depth < 2)
+				return false;
+			depth --;
+		} else if (symbol == MINUS_ || symbol == SQR_ || vectorizableFunction (symbol)) {
+			if (depth < 1)
+				return false;
+		} else {
+			return false;
+		}
+		if (depth > maximumDepth)
+			maximumDepth = depth;
+	}
+	if (depth != 1 || maximumDepth > Formula_MAXIMUM_STACK_SIZE)
+		return false;
+	theVectorizedStackDepth = maximumDepth;
+	return true;
+}
+
+inline static VectorizedStackel pushVectorized () {
+	VectorizedStackel stackel = & theVectorizedStack [++ vw];
+	stackel -> isNumber = false;
+	return stackel;
+}
+inline static void pushNumberVectorized (double x) {
+	VectorizedStackel stackel = & theVectorizedStack [++ vw];
+	stackel -> isNumber = true;
+	stackel -> number = isdefined (x) ? x : undefined;
+}
+inline static void becomeValues (VectorizedStackel x, integer n) {
+	/*
+		Give the stack element its own stretch of buffer,
+		so that it can be written into without affecting any other stack element.
+	*/
+	x -> isNumber = false;
+	x -> values = theVectorizedBuffers.row (x - theVectorizedStack). part (1, n);
+}
+
+/*
+	The elementwise versions of do_add () and friends:
+	the operation is done in place, in the lower of the two stack elements.
+*/
+template <typename BinaryOperation>
+static void do_vectorizedBinary (integer n, BinaryOperation op) {
+	VectorizedStackel y = & theVectorizedStack [vw --], x = & theVectorizedStack [vw];
+	if (x -> isNumber) {
+		if (y -> isNumber) {
+			x -> number = op (x -> number, y -> number);
+			return;
+		}
+		const double xvalue = x -> number;
+		becomeValues (x, n);
+		for (integer i = 1; i <= n; i ++)
+			x -> values [i] = op (xvalue, y -> values [i]);
+	} else if (y -> isNumber) {
+		const double yvalue = y -> number;
+		for (integer i = 1; i <= n; i ++)
+			x -> values [i] = op (x -> values [i], yvalue);
+	} else {
+		for (integer i = 1; i <= n; i ++)
+			x -> values [i] = op (x -> values [i], y -> values [i]);
+	}
+}
+static void do_vectorizedAdd (integer n) {
+	VectorizedStackel y = & theVectorizedStack [vw --], x = & theVectorizedStack [vw];
+	if (x -> isNumber) {
+		if (y -> isNumber) {
+			x -> number += y -> number;
+			return;
+		}
+		const double xvalue = x -> number;
+		becomeValues (x, n);
+		x -> values <<= xvalue  +  y -> values;
+	} else if (y -> isNumber) {
+		x -> values += y -> number;
+	} else {
+		x -> values += y -> values;
+	}
+}
+static void do_vectorizedSub (integer n) {
+	VectorizedStackel y = & theVectorizedStack [vw --], x = & theVectorizedStack [vw];
+	if (x -> isNumber) {
+		if (y -> isNumber) {
+			x -> number -= y -> number;
+			return;
+		}
+		const double xvalue = x -> number;
+		becomeValues (x, n);
+		x -> values <<= xvalue  -  y -> values;
+	} else if (y -> isNumber) {
+		x -> values -= y -> number;
+	} else {
+		x -> values -= y -> values;
+	}
+}
+static void do_vectorizedMul (integer n) {
+	VectorizedStackel y = & theVectorizedStack [vw --], x = & theVectorizedStack [vw];
+	if (x -> isNumber) {
+		if (y -> isNumber) {
+			x -> number *= y -> number;
+			return;
+		}
+		const double xvalue = x -> number;
+		becomeValues (x, n);
+		x -> values <<= xvalue  *  y -> values;
+	} else if (y -> isNumber) {
+		x -> values *= y -> number;
+	} else {
+		x -> values *= y -> values;
+	}
+}
+template <typename UnaryOperation>
+static void do_vectorizedUnary (UnaryOperation op) {
+	VectorizedStackel x = & theVectorizedStack [vw];
+	if (x -> isNumber) {
+		x -> number = op (x -> number);
+	} else {
+		for (integer i = 1; i <= x -> values.size; i ++)
+			x -> values [i] = op (x -> values [i]);
+	}
+}
+inline static double definedOrUndefined (double x) {
+	return isdefined (x) ? x : undefined;
+}
+
+void Formula_runVectorized (integer row, integer fromColumn, integer toColumn, constVEC const& self, VEC const& target) {
+	Daata me = theSource;
+	if (theVectorizedBuffers.nrow < theVectorizedStackDepth)
+		theVectorizedBuffers = newMATraw (theVectorizedStackDepth, Formula_VECTORIZED_BLOCK_SIZE);
+	for (integer firstColumn = fromColumn; firstColumn <= toColumn; firstColumn += Formula_VECTORIZED_BLOCK_SIZE) {
+		const integer lastColumn = std::min (firstColumn + Formula_VECTORIZED_BLOCK_SIZE - 1, toColumn);
+		const integer n = lastColumn - firstColumn + 1;
+		vw = 0;
+		for (int i = 1; i <= numberOfInstructions; i ++) {
+			const int symbol = parse [i]. symbol;
+			switch (symbol) {
+				case NUMBER_: {
+					pushNumberVectorized (parse [i]. content.number);
+				} break; case NUMERIC_VARIABLE_: {
+					pushNumberVectorized (parse [i]. content.variable -> numericValue);
+				} break; case ROW_: {
+					pushNumberVectorized (row);
+				} break; case Y_: {
+					pushNumberVectorized (my v_getY (row));
+				} break; case COL_: {
+					VectorizedStackel x = pushVectorized ();
+					becomeValues (x, n);
+					for (integer j = 1; j <= n; j ++)
+						x -> values [j] = firstColumn - 1 + j;
+				} break; case X_: {
+					VectorizedStackel x = pushVectorized ();
+					becomeValues (x, n);
+					for (integer j = 1; j <= n; j ++)
+						x -> values [j] = definedOrUndefined (my v_getX (firstColumn - 1 + j));
+				} break; case SELF0_: {
+					VectorizedStackel x = pushVectorized ();
+					becomeValues (x, n);
+					for (integer j = 1; j <= n; j ++)
+						x -> values [j] = definedOrUndefined (self [firstColumn - 1 + j]);
+				} break; case ADD_: {
+					do_vectorizedAdd (n);
+				} break; case SUB_: {
+					do_vectorizedSub (n);
+				} break; case MUL_: {
+					do_vectorizedMul (n);
+				} break; case RDIV_: {
+					do_vectorizedBinary (n, [] (double x, double y) { return definedOrUndefined (x / y); });
+				} break; case IDIV_: {
+					do_vectorizedBinary (n, [] (double x, double y) { return definedOrUndefined (floor (x / y)); });
+				} break; case MOD_: {
+					do_vectorizedBinary (n, [] (double x, double y) { return definedOrUndefined (x - floor (x / y) * y); });
+				} break; case POWER_: {
+					do_vectorizedBinary (n, [] (double x, double y) {
+						return isundef (x) || isundef (y) ? undefined : definedOrUndefined (pow (x, y));
+					});
+				} break; case MINUS_: {
+					do_vectorizedUnary ([] (double x) { return definedOrUndefined (- x); });
+				} break; case SQR_: {
+					do_vectorizedUnary ([] (double x) { return isundef (x) ? undefined : definedOrUndefined (x * x); });
+				} break; default: {
+					double (*f) (double) = vectorizableFunction (symbol);
+					Melder_assert (f);
+					do_vectorizedUnary ([f] (double x) { return isundef (x) ? undefined : definedOrUndefined (f (x)); });
+				}
+			}
+		}
+		Melder_assert (vw == 1);
+		VectorizedStackel result = & theVectorizedStack [1];
+		if (result -> isNumber)
+			target. part (firstColumn, lastColumn) <<= result -> number;
+		else
+			target. part (firstColumn, lastColumn) <<= result -> values;
+	}
+}
+
 /* End of file Formula.cpp */
@@ -165,5 +165,21 @@ void Formula_compile (Interpreter interpreter, Daata data, conststring32 express
 
 void Formula_run (integer row, integer col, Formula_Result *result);
 
+bool Formula_isVectorizable ();
+/*
+	To be called directly after Formula_compile ().
+	Returns true if the compiled formula is numeric and depends on nothing but
+	self, x, y, row, col, numbers and numeric variables, combined with elementwise arithmetic and functions.
+*/
+void Formula_runVectorized (integer row, integer fromColumn, integer toColumn, constVEC const& self, VEC const& target);
+/*
+	Preconditions:
+		Formula_isVectorizable ();
+		self and target are whole rows (indexed by column), and can be the same row.
+	Postcondition:
+		target [col] is what Formula_run (row, col, & result) would have given,
+		for all columns from fromColumn to toColumn.
+*/
+
 /* End of file Formula.h */
 #endif
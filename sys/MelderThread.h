@@ -20,11 +20,7 @@
 
 #include <vector>
 #include "Thing.h"
-#include <thread>
-
-inline static integer MelderThread_getNumberOfProcessors () {
-	return uinteger_to_integer (std::thread::hardware_concurrency ());
-}
+#include "melder_thread.h"   // MelderThread_getNumberOfProcessors, and MelderThread_run for lambdas
 
 template <class T> void MelderThread_run (void (*func) (T *), autoSomeThing <T> *args, integer numberOfThreads) {
 	uinteger unsignedNumberOfThreads = integer_to_uinteger (numberOfThreads);